@@ -1,210 +1,273 @@
+#include "auth_client.hpp"
+
 #include <grpcpp/grpcpp.h>
 
+#include <chrono>
+#include <cstddef>
+#include <fstream>
 #include <iostream>
-#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
-#include "chaum_pedersen.hpp"
-#include "zkp_auth.grpc.pb.h"
-#include "zkp_constants.hpp"
-
-using namespace boost::multiprecision;
-
-// サーバと同じ変換関数をクライアント側にも用意
-cpp_int bytes_to_cpp_int(const std::string& s)
-{
-    if (s.empty())
-    {
-        return 0;
-    }
-    // 16進数文字列からcpp_intに変換
-    return cpp_int("0x" + s);
-}
+#include "client_bench.hpp"
+#include "logger.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_group.hpp"
 
-std::string cpp_int_to_bytes(const cpp_int& n)
+void print_usage()
 {
-    std::stringstream ss;
-    ss << std::hex << n;
-    return ss.str();
+    std::cerr << "Usage:\n"
+              << "  ./auth_client register <username> [modp1024|p256] [--interactive]\n"
+              << "  ./auth_client login <username> <secret_key_hex> [modp1024|p256] [--interactive]\n"
+              << "  --interactive: log in with CreateAuthenticationChallenge + VerifyAuthentication\n"
+              << "  ./auth_client bulk-login <file> [modp1024|p256] [--interactive]\n"
+              << "    log in every \"<username> <secret_key_hex>\" line of the file over one AuthenticateStream\n"
+              << "  ./auth_client metrics\n"
+              << "    print the server metrics in the Prometheus text format\n"
+              << "  ./auth_client bench [options]\n"
+              << "    --target <host:port>   server address (default 0.0.0.0:50051)\n"
+              << "    --users <n>            users registered before the run (default 100)\n"
+              << "    --threads <n>          login threads (default 4)\n"
+              << "    --channels <n>         gRPC channels, one connection each (default 8)\n"
+              << "    --duration-ms <ms>     login phase length (default 10000)\n"
+              << "    --rps <r>              open-loop target logins/s over all threads (default 0: closed loop)\n"
+              << "    --group <name>         modp1024 | p256 (default modp1024)\n"
+              << "    --encoding <name>      binary | hex (default binary)\n"
+              << "    --non-interactive      log in with NonInteractiveAuthentication\n"
+              << "    --user-prefix <s>      prefix of registered user names (default: random per run)\n"
+              << "    --register-batch <n>   register users n at a time with RegisterBatch (default 0: Register)\n"
+              << "    --commitment-pool <n>  precomputed (k, r1, r2) kept ready for logins (default 0: off)\n"
+              << "    --pool-threads <n>     threads refilling the commitment pool (default 1)\n"
+              << "    --output <file>        write the JSON report to a file instead of stdout\n";
 }
 
-class AuthClient
+// bulk-login の入力ファイル（1 行に「ユーザー名 秘密鍵の16進数」）を読む。形式に合わない行がある場合は std::nullopt
+std::optional<std::vector<BulkLogin>> read_bulk_logins(const std::string& path)
 {
-   public:
-    AuthClient(std::shared_ptr<grpc::Channel> channel) : stub_(zkp_auth::Auth::NewStub(channel)) {}
-
-    cpp_int register_flow(const std::string user)
+    std::ifstream file(path);
+    if (!file)
     {
-        const auto constants = get_zkp_constants();
-        ChaumPedersen cp(constants.p, constants.q, constants.g, constants.h);
-
-        // Proverの秘密の知識X
-        const cpp_int x = generate_random(constants.q);
-
-        std::cout << "Registering user: " << user << std::endl;
-        if (!register_user(cp, user, x))
-        {
-            std::cerr << "User registration failed or already exist." << std::endl;
-            return -1;
-        }
-        std::cout << "User registered successfully." << std::endl;
-        std::cout << "!!! IMPORTANT !!!" << std::endl;
-        std::cout << "Your secret key (x) is: " << std::hex << x << std::endl;
-
-        return x;
+        return std::nullopt;
     }
-
-    void login_flow(const std::string& user, const cpp_int& x)
+    std::vector<BulkLogin> logins;
+    std::string line;
+    while (std::getline(file, line))
     {
-        const auto constants = get_zkp_constants();
-        ChaumPedersen cp(constants.p, constants.q, constants.g, constants.h);
-
-        std::cout << "Client starting authentication flow for user: " << user << std::endl;
-
-        // CreateChallenge
-        std::cout << "Creating authentication challenge..." << std::endl;
-        // ランダムなNonce k を生成
-        const cpp_int k = generate_random(constants.q);
-        // コミットメントを作成
-        Commitment commitment = cp.create_commitment(k);
-
-        std::string auth_id;
-        cpp_int challenge_c;
-        if (!create_auth_challenge(user, commitment, auth_id, challenge_c))
+        std::istringstream fields(line);
+        std::string user;
+        std::string x_hex;
+        if (!(fields >> user))
         {
-            std::cerr << "Failed to create authentication challenge." << std::endl;
-            return;
+            continue;  // 空行
         }
-        std::cout << "Authentication challenge created. Auth ID: " << auth_id << std::endl;
-
-        // VerifyAuthentication
-        std::cout << "Verifying authentication..." << std::endl;
-        Challenge challenge_c_struct{challenge_c};
-        const Response response_s = cp.solve_response(k, challenge_c_struct, x);
-
-        std::string session_id;
-        if (!verify_authentication(auth_id, response_s, session_id))
+        if (!(fields >> x_hex))
         {
-            std::cerr << "Authentication failed." << std::endl;
-            return;
+            return std::nullopt;
+        }
+        try
+        {
+            logins.push_back({user, cpp_int("0x" + x_hex)});
+        }
+        catch (const std::exception&)
+        {
+            return std::nullopt;
         }
-
-        std::cout << "Authentication successful for user: " << user << ", session_id: " << session_id << std::endl;
     }
-    ~AuthClient() {}
+    return logins;
+}
 
-   private:
-    bool register_user(const ChaumPedersen& cp, const std::string& user, const cpp_int& x)
+// bench モードのオプションを解釈する。不正な場合は std::nullopt
+std::optional<BenchOptions> parse_bench_options(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 2; i < argc; ++i)
     {
-        zkp_auth::RegisterRequest request;
-        request.set_user(user);
-
-        // 公開鍵 y1, y2 を計算してセット
-        PublicKeys public_keys = cp.calculate_public_keys(x);
-        request.set_y1(cpp_int_to_bytes(public_keys.y1));
-        request.set_y2(cpp_int_to_bytes(public_keys.y2));
-
-        zkp_auth::RegisterResponse response;
-        grpc::ClientContext context;
-        grpc::Status status = stub_->Register(&context, request, &response);
-
-        if (!status.ok())
+        const std::string arg = argv[i];
+        if (arg == "--non-interactive")
+        {
+            options.non_interactive = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return std::nullopt;
+        }
+        const std::string value = argv[++i];
+        try
         {
-            if (status.error_code() != grpc::ALREADY_EXISTS)
+            if (arg == "--target")
+            {
+                options.target = value;
+            }
+            else if (arg == "--users")
+            {
+                options.users = std::stoul(value);
+            }
+            else if (arg == "--threads")
+            {
+                options.threads = std::stoul(value);
+            }
+            else if (arg == "--channels")
             {
-                std::cerr << "Register RPC failed: " << status.error_message() << std::endl;
+                options.channels = std::stoul(value);
+            }
+            else if (arg == "--duration-ms")
+            {
+                options.duration = std::chrono::milliseconds(std::stol(value));
+            }
+            else if (arg == "--rps")
+            {
+                options.rps = std::stod(value);
+            }
+            else if (arg == "--group" && parse_group_id(value))
+            {
+                options.group = *parse_group_id(value);
+            }
+            else if (arg == "--encoding" && (value == "binary" || value == "hex"))
+            {
+                options.encoding = value == "binary" ? WireEncoding::kBinary : WireEncoding::kHex;
+            }
+            else if (arg == "--user-prefix")
+            {
+                options.user_prefix = value;
+            }
+            else if (arg == "--register-batch")
+            {
+                options.register_batch = std::stoul(value);
+            }
+            else if (arg == "--commitment-pool")
+            {
+                options.commitment_pool.depth = std::stoul(value);
+            }
+            else if (arg == "--pool-threads")
+            {
+                options.commitment_pool.refill_threads = std::stoul(value);
+            }
+            else if (arg == "--output")
+            {
+                options.output = value;
+            }
+            else
+            {
+                return std::nullopt;
             }
-            return false;
         }
-        return true;
+        catch (const std::exception&)
+        {
+            return std::nullopt;
+        }
     }
+    return options;
+}
 
-    bool create_auth_challenge(const std::string& user, const Commitment& commitment, std::string& out_auth_id,
-                               cpp_int& out_c)
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && std::string(argv[1]) == "bench")
     {
-        zkp_auth::AuthenticationChallengeRequest request;
-        request.set_user(user);
-        request.set_r1(cpp_int_to_bytes(commitment.r1));
-        request.set_r2(cpp_int_to_bytes(commitment.r2));
-
-        zkp_auth::AuthenticationChallengeResponse response;
-        grpc::ClientContext context;
-        grpc::Status status = stub_->CreateAuthenticationChallenge(&context, request, &response);
-
-        if (!status.ok())
+        const auto bench_options = parse_bench_options(argc, argv);
+        if (!bench_options)
         {
-            std::cerr << "CreateAuthenticationChallenge RPC failed: " << status.error_message() << std::endl;
-            return false;
+            print_usage();
+            return 1;
         }
-
-        out_auth_id = response.auth_id();
-        out_c = bytes_to_cpp_int(response.c());
-        return true;
+        return run_bench(*bench_options);
     }
 
-    bool verify_authentication(const std::string& auth_id, const Response& response_s, std::string& out_session_id)
+    // --interactive 以外は位置引数
+    AuthClientOptions options;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
     {
-        zkp_auth::AuthenticationAnswerRequest request;
-        request.set_auth_id(auth_id);
-        request.set_s(cpp_int_to_bytes(response_s.s));
-
-        zkp_auth::AuthenticationAnswerResponse response;
-        grpc::ClientContext context;
-        grpc::Status status = stub_->VerifyAuthentication(&context, request, &response);
-
-        if (!status.ok())
+        if (std::string(argv[i]) == "--interactive")
         {
-            std::cerr << "VerifyAuthentication RPC failed: " << status.error_message() << std::endl;
-            return false;
+            options.non_interactive = false;
+        }
+        else
+        {
+            args.emplace_back(argv[i]);
         }
-
-        out_session_id = response.session_id();
-        return true;
     }
+    std::string target("0.0.0.0:50051");
+    AuthClient client(grpc::CreateChannel(target, grpc::InsecureChannelCredentials()), options);
 
-    std::unique_ptr<zkp_auth::Auth::Stub> stub_;
-};
-
-void print_usage()
-{
-    std::cerr << "Usage:\n"
-              << "  ./auth_client register <username>\n"
-              << "  ./auth_client login <username> <secret_key_hex>\n";
-}
-
-int main(int argc, char** argv)
-{
-    if (argc < 3)
+    if (args.size() == 1 && args[0] == "metrics")
+    {
+        return client.print_metrics() ? 0 : 1;
+    }
+    if (args.size() < 2)
     {
         print_usage();
         return 1;
     }
 
-    std::string target("0.0.0.0:50051");
-    AuthClient client(grpc::CreateChannel(target, grpc::InsecureChannelCredentials()));
+    std::string mode = args[0];
+    std::string user = args[1];
 
-    std::string mode = argv[1];
-    std::string user = argv[2];
+    // 群の指定（省略時は modp1024）。login では登録時と同じ群を指定すること。
+    const std::size_t group_arg = mode == "login" ? 3 : 2;
+    GroupId group = GroupId::kModp1024;
+    if (args.size() > group_arg)
+    {
+        const auto parsed = parse_group_id(args[group_arg]);
+        if (!parsed)
+        {
+            print_usage();
+            return 1;
+        }
+        group = *parsed;
+    }
 
     if (mode == "register")
     {
-        cpp_int x = client.register_flow(user);
+        cpp_int x = client.register_flow(user, group);
         if (x == -1)
         {
             return 1;
         }
-        client.login_flow(user, x);
+        client.login_flow(user, x, group);
+    }
+    else if (mode == "bulk-login")
+    {
+        const auto logins = read_bulk_logins(args[1]);
+        if (!logins)
+        {
+            std::cerr << "Cannot read " << args[1] << " (expected \"<username> <secret_key_hex>\" lines)." << std::endl;
+            return 1;
+        }
+        std::vector<BulkLoginResult> results;
+        const grpc::Status status = client.bulk_login(*logins, group, results);
+        if (!status.ok())
+        {
+            log_rpc_error("AuthenticateStream", status);
+        }
+        std::size_t failures = 0;
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            if (results[i].status.ok())
+            {
+                std::cout << "Authentication successful for user: " << (*logins)[i].user
+                          << ", session_id: " << results[i].session_id << std::endl;
+                continue;
+            }
+            ++failures;
+            std::cerr << "Authentication failed for user: " << (*logins)[i].user << " ("
+                      << results[i].status.error_message() << ")" << std::endl;
+        }
+        return status.ok() && failures == 0 ? 0 : 1;
     }
     else if (mode == "login")
     {
-        if (argc < 4)
+        if (args.size() < 3)
         {
             print_usage();
             return 1;
         }
         // 16進数文字列として秘密鍵xを受け取り変換
-        cpp_int x("0x" + std::string(argv[3]));
-        client.login_flow(user, x);
+        cpp_int x("0x" + args[2]);
+        client.login_flow(user, x, group);
     }
     else
     {
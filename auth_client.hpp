@@ -0,0 +1,477 @@
+#ifndef AUTH_CLIENT_HPP
+#define AUTH_CLIENT_HPP
+
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+#include "commitment_pool.hpp"
+#include "logger.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_auth.grpc.pb.h"
+#include "zkp_group.hpp"
+
+using namespace boost::multiprecision;
+
+// 失敗した RPC をステータスコードとメッセージ付きで記録する
+inline void log_rpc_error(const char* rpc, const grpc::Status& status)
+{
+    log_error("rpc_failed",
+              {{"rpc", rpc}, {"code", static_cast<int>(status.error_code())}, {"message", status.error_message()}});
+}
+
+// AuthClient の設定
+struct AuthClientOptions
+{
+    // 整数フィールドの送信形式（kHex は移行前のサーバとの互換用）
+    WireEncoding encoding = WireEncoding::kBinary;
+    // ログインを非対話の証明（1 回の RPC）で行う。サーバが対応していない場合はチャレンジ・レスポンスに戻る。
+    bool non_interactive = true;
+    // ログインに使う (k, r1, r2) の事前計算（群ごとに最初のログインで始める。depth が 0 の場合は使わない）
+    CommitmentPoolOptions commitment_pool;
+    // bulk_login で 1 本のストリームに同時に進めるログインの数（サーバの stream_window 以下にすること）
+    std::size_t stream_window = 64;
+};
+
+// bulk_login でログインする 1 ユーザー
+struct BulkLogin
+{
+    std::string user;
+    cpp_int x;
+};
+
+// bulk_login の 1 ユーザー分の結果
+struct BulkLoginResult
+{
+    grpc::Status status;
+    std::string session_id;
+};
+
+class AuthClient
+{
+   public:
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param channel サーバへのチャネル
+     * @param options クライアントの設定
+     */
+    AuthClient(std::shared_ptr<grpc::Channel> channel, const AuthClientOptions& options = {})
+        : stub_(zkp_auth::Auth::NewStub(channel)),
+          encoding_(options.encoding),
+          non_interactive_(options.non_interactive),
+          pool_options_(options.commitment_pool),
+          stream_window_(std::max<std::size_t>(1, options.stream_window))
+    {
+    }
+
+    cpp_int register_flow(const std::string user, GroupId group = GroupId::kModp1024)
+    {
+        return with_chaum_pedersen(group, [&](const auto& cp) { return register_flow(cp, user, group); });
+    }
+
+    void login_flow(const std::string& user, const cpp_int& x, GroupId group = GroupId::kModp1024)
+    {
+        with_chaum_pedersen(group, [&](const auto& cp) { login_flow(cp, user, x, group); });
+    }
+
+    /**
+     * @fn
+     * @brief 1 本の AuthenticateStream で多数のユーザーをログインさせる（ゲートウェイが配下の ID をまとめて認証する場合など）
+     * @note  stream_window 件までのログインを同時に進め、1 件終わるごとに次のログインを送る。
+     *        チャレンジ・レスポンスと非対話の証明のどちらを使うかは non_interactive に従う。
+     * @param logins ユーザー名と秘密鍵（全て group に登録されていること）
+     * @param results logins と同じ順の各ログインの結果
+     * @return ストリームの状態（個々のログインの失敗は results に入る。途中で切れた場合は残りが ABORTED になる）
+     */
+    grpc::Status bulk_login(const std::vector<BulkLogin>& logins, GroupId group,
+                            std::vector<BulkLoginResult>& results)
+    {
+        return with_chaum_pedersen(group, [&](const auto& cp) { return bulk_login(cp, logins, group, results); });
+    }
+
+    /**
+     * @fn
+     * @brief 群の (k, r1, r2) の事前計算を、最初のログインを待たずに始める
+     * @note  commitment_pool.depth が 0 の場合は何もしない
+     */
+    void prepare_commitments(GroupId group) { commitment_pool(group); }
+
+    /**
+     * @fn
+     * @brief サーバのメトリクスを Prometheus のテキスト形式で標準出力に書く
+     * @return RPC が成功した場合は true
+     */
+    bool print_metrics()
+    {
+        grpc::ClientContext context;
+        zkp_auth::MetricsRequest request;
+        zkp_auth::MetricsResponse response;
+        grpc::Status status = stub_->GetMetrics(&context, request, &response);
+        if (!status.ok())
+        {
+            log_rpc_error("GetMetrics", status);
+            return false;
+        }
+        std::cout << response.prometheus_text();
+        return true;
+    }
+
+    ~AuthClient() {}
+
+   private:
+    template <typename CP>
+    cpp_int register_flow(const CP& cp, const std::string& user, GroupId group)
+    {
+        // Proverの秘密の知識X
+        const cpp_int x = generate_random(cp.order());
+
+        log_info("register", {{"user", user}, {"group", group_name(group)}});
+        if (!register_user(cp, user, x, group))
+        {
+            std::cerr << "User registration failed or already exist." << std::endl;
+            return -1;
+        }
+        std::cout << "User registered successfully." << std::endl;
+        std::cout << "!!! IMPORTANT !!!" << std::endl;
+        std::cout << "Your secret key (x) is: " << std::hex << x << std::endl;
+
+        return x;
+    }
+
+    template <typename CP>
+    void login_flow(const CP& cp, const std::string& user, const cpp_int& x, GroupId group)
+    {
+        log_info("login", {{"user", user}, {"non_interactive", non_interactive_}});
+        if (!non_interactive_)
+        {
+            interactive_login_flow(cp, user, x, group);
+            return;
+        }
+
+        std::string session_id;
+        const grpc::Status status = non_interactive_login(cp, user, x, group, session_id);
+        if (status.error_code() == grpc::UNIMPLEMENTED)
+        {
+            log_warn("non_interactive_unsupported", {{"fallback", "challenge-response"}});
+            interactive_login_flow(cp, user, x, group);
+            return;
+        }
+        if (!status.ok())
+        {
+            log_rpc_error("NonInteractiveAuthentication", status);
+            std::cerr << "Authentication failed." << std::endl;
+            return;
+        }
+
+        std::cout << "Authentication successful for user: " << user << ", session_id: " << session_id << std::endl;
+    }
+
+    /**
+     * @fn
+     * @brief 非対話の証明でログインする: チャレンジ c をトランスクリプトのハッシュから導出し、r1, r2, s をまとめて送る
+     */
+    template <typename CP>
+    grpc::Status non_interactive_login(const CP& cp, const std::string& user, const cpp_int& x, GroupId group_id,
+                                       std::string& out_session_id)
+    {
+        const zkp_auth::NonInteractiveAuthenticationRequest request = make_proof_request(cp, user, x, group_id);
+        zkp_auth::AuthenticationAnswerResponse response;
+        grpc::ClientContext context;
+        grpc::Status status = stub_->NonInteractiveAuthentication(&context, request, &response);
+        if (status.ok())
+        {
+            out_session_id = response.session_id();
+        }
+        return status;
+    }
+
+    // 現在時刻のタイムスタンプで非対話の証明を作る
+    template <typename CP>
+    zkp_auth::NonInteractiveAuthenticationRequest make_proof_request(const CP& cp, const std::string& user,
+                                                                     const cpp_int& x, GroupId group_id)
+    {
+        const auto& group = cp.group();
+        const auto [k, commitment] = next_commitment(cp, group_id);
+        const auto public_key_elements = cp.calculate_public_keys(x);
+        const PublicKeys public_keys = {group.encode(public_key_elements.y1), group.encode(public_key_elements.y2)};
+
+        const std::uint64_t timestamp_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        const Challenge c = cp.fiat_shamir_challenge(public_keys, commitment, user, timestamp_ms);
+        const Response s = cp.solve_response(k, c, x);
+
+        const std::size_t element_bytes = group.encoded_bytes();
+        zkp_auth::NonInteractiveAuthenticationRequest request;
+        request.set_user(user);
+        request.set_encoding(static_cast<zkp_auth::Encoding>(encoding_));
+        request.set_r1(encode_wire(commitment.r1, encoding_, element_bytes));
+        request.set_r2(encode_wire(commitment.r2, encoding_, element_bytes));
+        request.set_s(encode_wire(s.s, encoding_, byte_length(cp.order())));
+        request.set_timestamp_ms(timestamp_ms);
+        return request;
+    }
+
+    template <typename CP>
+    grpc::Status bulk_login(const CP& cp, const std::vector<BulkLogin>& logins, GroupId group,
+                            std::vector<BulkLoginResult>& results)
+    {
+        log_info("bulk_login", {{"logins", logins.size()}, {"non_interactive", non_interactive_}});
+        const std::size_t element_bytes = cp.group().encoded_bytes();
+        const std::size_t scalar_bytes = byte_length(cp.order());
+        results.assign(logins.size(), {grpc::Status(grpc::ABORTED, "Stream ended before the login completed."), ""});
+        // チャレンジ・レスポンスでは回答するまで k を保持する（request_id は logins の添字）
+        std::vector<cpp_int> nonces(non_interactive_ ? 0 : logins.size());
+
+        grpc::ClientContext context;
+        auto stream = stub_->AuthenticateStream(&context);
+        bool writable = true;
+        std::size_t sent = 0;
+        // 次のログインの最初のリクエストを送る
+        const auto send_next = [&]
+        {
+            const std::size_t i = sent++;
+            zkp_auth::StreamAuthRequest request;
+            request.set_request_id(i);
+            if (non_interactive_)
+            {
+                *request.mutable_non_interactive() = make_proof_request(cp, logins[i].user, logins[i].x, group);
+            }
+            else
+            {
+                auto [k, commitment] = next_commitment(cp, group);
+                nonces[i] = std::move(k);
+                *request.mutable_challenge() = make_challenge_request(logins[i].user, commitment, element_bytes);
+            }
+            writable = writable && stream->Write(request);
+        };
+
+        while (sent < logins.size() && sent < stream_window_ && writable)
+        {
+            send_next();
+        }
+        // 返信は完了順に届く。ログインが 1 件終わるたびに次のログインを送る
+        std::size_t completed = 0;
+        zkp_auth::StreamAuthResponse response;
+        while (completed < logins.size() && stream->Read(&response))
+        {
+            const std::uint64_t i = response.request_id();
+            if (i >= logins.size())
+            {
+                log_error("unknown_request_id", {{"request_id", i}});
+                continue;
+            }
+            BulkLoginResult& result = results[i];
+            if (response.code() == grpc::OK && response.has_challenge() && !non_interactive_)
+            {
+                const auto c = decode_wire(response.challenge().c(), encoding_, scalar_bytes);
+                if (c)
+                {
+                    const Response s = cp.solve_response(nonces[i], Challenge{*c}, logins[i].x);
+                    zkp_auth::StreamAuthRequest request;
+                    request.set_request_id(i);
+                    *request.mutable_answer() = make_answer_request(response.challenge().auth_id(), s, scalar_bytes);
+                    writable = writable && stream->Write(request);
+                    continue;
+                }
+                result.status = grpc::Status(grpc::INTERNAL, "Malformed challenge.");
+            }
+            else if (response.code() == grpc::OK)
+            {
+                result.status = grpc::Status::OK;
+                result.session_id = response.answer().session_id();
+            }
+            else
+            {
+                result.status = grpc::Status(static_cast<grpc::StatusCode>(response.code()), response.message());
+            }
+            ++completed;
+            if (sent < logins.size() && writable)
+            {
+                send_next();
+            }
+        }
+        stream->WritesDone();
+        return stream->Finish();
+    }
+
+    // CreateAuthenticationChallenge と VerifyAuthentication の 2 往復でログインする
+    template <typename CP>
+    void interactive_login_flow(const CP& cp, const std::string& user, const cpp_int& x, GroupId group)
+    {
+        // CreateChallenge
+        // ランダムなNonce k とコミットメント（事前計算したものがあれば取り出す）
+        const auto [k, commitment] = next_commitment(cp, group);
+
+        std::string auth_id;
+        cpp_int challenge_c;
+        const std::size_t element_bytes = cp.group().encoded_bytes();
+        const std::size_t scalar_bytes = byte_length(cp.order());
+        if (!create_auth_challenge(user, commitment, element_bytes, scalar_bytes, auth_id, challenge_c))
+        {
+            std::cerr << "Failed to create authentication challenge." << std::endl;
+            return;
+        }
+        log_info("challenge_created", {{"auth_id", auth_id}});
+
+        // VerifyAuthentication
+        Challenge challenge_c_struct{challenge_c};
+        const Response response_s = cp.solve_response(k, challenge_c_struct, x);
+
+        std::string session_id;
+        if (!verify_authentication(auth_id, response_s, scalar_bytes, session_id))
+        {
+            std::cerr << "Authentication failed." << std::endl;
+            return;
+        }
+
+        std::cout << "Authentication successful for user: " << user << ", session_id: " << session_id << std::endl;
+    }
+
+    template <typename CP>
+    bool register_user(const CP& cp, const std::string& user, const cpp_int& x, GroupId group)
+    {
+        zkp_auth::RegisterRequest request;
+        request.set_user(user);
+        request.set_group(static_cast<zkp_auth::Group>(group));
+
+        // 公開鍵 y1, y2 を計算してセット
+        const auto public_keys = cp.calculate_public_keys(x);
+        const std::size_t element_bytes = cp.group().encoded_bytes();
+        request.set_encoding(static_cast<zkp_auth::Encoding>(encoding_));
+        request.set_y1(encode_wire(cp.group().encode(public_keys.y1), encoding_, element_bytes));
+        request.set_y2(encode_wire(cp.group().encode(public_keys.y2), encoding_, element_bytes));
+
+        zkp_auth::RegisterResponse response;
+        grpc::ClientContext context;
+        grpc::Status status = stub_->Register(&context, request, &response);
+
+        if (!status.ok())
+        {
+            if (status.error_code() != grpc::ALREADY_EXISTS)
+            {
+                log_rpc_error("Register", status);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    bool create_auth_challenge(const std::string& user, const Commitment& commitment, std::size_t element_bytes,
+                               std::size_t scalar_bytes, std::string& out_auth_id, cpp_int& out_c)
+    {
+        const auto request = make_challenge_request(user, commitment, element_bytes);
+        zkp_auth::AuthenticationChallengeResponse response;
+        grpc::ClientContext context;
+        grpc::Status status = stub_->CreateAuthenticationChallenge(&context, request, &response);
+
+        if (!status.ok())
+        {
+            log_rpc_error("CreateAuthenticationChallenge", status);
+            return false;
+        }
+
+        // c はリクエストと同じ形式で返る
+        auto c = decode_wire(response.c(), encoding_, scalar_bytes);
+        if (!c)
+        {
+            log_error("malformed_challenge", {{"auth_id", response.auth_id()}});
+            return false;
+        }
+        out_auth_id = response.auth_id();
+        out_c = std::move(*c);
+        return true;
+    }
+
+    bool verify_authentication(const std::string& auth_id, const Response& response_s, std::size_t scalar_bytes,
+                               std::string& out_session_id)
+    {
+        const zkp_auth::AuthenticationAnswerRequest request = make_answer_request(auth_id, response_s, scalar_bytes);
+        zkp_auth::AuthenticationAnswerResponse response;
+        grpc::ClientContext context;
+        grpc::Status status = stub_->VerifyAuthentication(&context, request, &response);
+
+        if (!status.ok())
+        {
+            log_rpc_error("VerifyAuthentication", status);
+            return false;
+        }
+
+        out_session_id = response.session_id();
+        return true;
+    }
+
+    zkp_auth::AuthenticationChallengeRequest make_challenge_request(const std::string& user,
+                                                                    const Commitment& commitment,
+                                                                    std::size_t element_bytes) const
+    {
+        zkp_auth::AuthenticationChallengeRequest request;
+        request.set_user(user);
+        request.set_encoding(static_cast<zkp_auth::Encoding>(encoding_));
+        request.set_r1(encode_wire(commitment.r1, encoding_, element_bytes));
+        request.set_r2(encode_wire(commitment.r2, encoding_, element_bytes));
+        return request;
+    }
+
+    zkp_auth::AuthenticationAnswerRequest make_answer_request(const std::string& auth_id, const Response& response_s,
+                                                              std::size_t scalar_bytes) const
+    {
+        zkp_auth::AuthenticationAnswerRequest request;
+        request.set_auth_id(auth_id);
+        request.set_encoding(static_cast<zkp_auth::Encoding>(encoding_));
+        request.set_s(encode_wire(response_s.s, encoding_, scalar_bytes));
+        return request;
+    }
+
+    /**
+     * @fn
+     * @brief ログインに使う (k, r1, r2) を取得する。事前計算を使う場合はプールから取り出し、k を二度使わない。
+     */
+    template <typename CP>
+    PrecomputedCommitment next_commitment(const CP& cp, GroupId group)
+    {
+        if (CommitmentPool* pool = commitment_pool(group))
+        {
+            return pool->take();
+        }
+        return make_commitment(cp);
+    }
+
+    // 群のプールを返す（なければ作って補充を始める）。事前計算を使わない場合は nullptr
+    CommitmentPool* commitment_pool(GroupId group)
+    {
+        if (pool_options_.depth == 0)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        std::unique_ptr<CommitmentPool>& pool = pools_[static_cast<std::size_t>(group)];
+        if (!pool)
+        {
+            pool = std::make_unique<CommitmentPool>(group, pool_options_);
+        }
+        return pool.get();
+    }
+
+    std::unique_ptr<zkp_auth::Auth::Stub> stub_;
+    const WireEncoding encoding_;
+    const bool non_interactive_;
+    const CommitmentPoolOptions pool_options_;
+    const std::size_t stream_window_;
+    // 群ごとの (k, r1, r2) のプール（GroupId の値で添字付けする）
+    std::mutex pools_mutex_;
+    std::array<std::unique_ptr<CommitmentPool>, kGroupCount> pools_;
+};
+
+#endif  // AUTH_CLIENT_HPP
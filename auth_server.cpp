@@ -3,33 +3,583 @@
 #include <grpcpp/server.h>
 #include <grpcpp/server_builder.h>
 
-#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "auth_service_impl.hpp"
+#include "logger.hpp"
+#include "multi_buffer_exp.hpp"
+
+namespace
+{
+// CompletionQueue に登録するタグ。イベントが届くと proceed が呼ばれる。
+class AsyncCall
+{
+   public:
+    virtual ~AsyncCall() = default;
+    virtual void proceed(bool ok) = 0;
+};
+
+/**
+ * @brief 非同期サーバの単項 RPC 1 件分の状態
+ * @note  生成時に RPC の受信を要求し、受信したら次の RPC の受信を要求してからハンドラを呼ぶ。
+ *        ハンドラが done を呼ぶと Finish し、Finish の完了イベントで自身を破棄する。
+ *        done はイベントループ以外のスレッド（検証用ワーカースレッド）から呼んでもよい。
+ */
+template <typename Request, typename Response>
+class AsyncUnaryCall final : public AsyncCall
+{
+   public:
+    using RequestMethod = void (Auth::AsyncService::*)(grpc::ServerContext*, Request*,
+                                                       grpc::ServerAsyncResponseWriter<Response>*,
+                                                       grpc::CompletionQueue*, grpc::ServerCompletionQueue*, void*);
+    using Handler = std::function<void(grpc::ServerContext*, const Request*, Response*,
+                                       std::function<void(grpc::Status)>)>;
+
+    AsyncUnaryCall(Auth::AsyncService* service, grpc::ServerCompletionQueue* cq, RequestMethod method,
+                   const Handler* handler)
+        : service_(service), cq_(cq), method_(method), handler_(handler), responder_(&context_)
+    {
+        (service_->*method_)(&context_, &request_, &responder_, cq_, cq_, this);
+    }
+
+    void proceed(bool ok) override
+    {
+        // Finish の完了、またはシャットダウンにより受信されなかった要求
+        if (finished_ || !ok)
+        {
+            delete this;
+            return;
+        }
+
+        new AsyncUnaryCall(service_, cq_, method_, handler_);
+        (*handler_)(&context_, &request_, &response_,
+                    [this](grpc::Status status)
+                    {
+                        finished_ = true;
+                        responder_.Finish(response_, status, this);
+                    });
+    }
+
+   private:
+    Auth::AsyncService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    RequestMethod method_;
+    const Handler* handler_;
+
+    grpc::ServerContext context_;
+    Request request_;
+    Response response_;
+    grpc::ServerAsyncResponseWriter<Response> responder_;
+    bool finished_ = false;
+};
+
+/**
+ * @brief 非同期サーバの AuthenticateStream 1 本分の状態
+ * @note  受信したら次のストリームの受信を要求し、読み取りを始める。読み取ったリクエストはハンドラに渡し、
+ *        ハンドラが返したレスポンスを 1 件ずつ書き出す（gRPC は同時に 1 つの Write しか許さない）。
+ *        返信していないリクエストが window 件に達すると読み取りを止め、書き出しが進んだら再開する。
+ *        読み取りが終わるか書き出しに失敗し、全てのリクエストに返信したら Finish し、その完了イベントで自身を破棄する。
+ *        レスポンスはイベントループ以外のスレッド（検証用ワーカースレッド）から渡してもよい。
+ */
+class AsyncStreamCall final
+{
+   public:
+    using Handler = std::function<void(grpc::ServerContext*, const StreamAuthRequest*,
+                                       std::function<void(StreamAuthResponse)>)>;
+
+    AsyncStreamCall(Auth::AsyncService* service, grpc::ServerCompletionQueue* cq, const Handler* handler,
+                    std::size_t window)
+        : service_(service), cq_(cq), handler_(handler), window_(window), stream_(&context_)
+    {
+        service_->RequestAuthenticateStream(&context_, &stream_, cq_, cq_, &accept_tag_);
+    }
+
+   private:
+    // 操作ごとのタグ。完了イベントで対応するメンバ関数を呼ぶ
+    class Tag final : public AsyncCall
+    {
+       public:
+        Tag(AsyncStreamCall* call, void (AsyncStreamCall::*on_event)(bool)) : call_(call), on_event_(on_event) {}
+        void proceed(bool ok) override { (call_->*on_event_)(ok); }
+
+       private:
+        AsyncStreamCall* call_;
+        void (AsyncStreamCall::*on_event_)(bool);
+    };
+
+    Auth::AsyncService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    const Handler* handler_;
+    const std::size_t window_;
+
+    grpc::ServerContext context_;
+    grpc::ServerAsyncReaderWriter<StreamAuthResponse, StreamAuthRequest> stream_;
+    Tag accept_tag_{this, &AsyncStreamCall::on_accept};
+    Tag read_tag_{this, &AsyncStreamCall::on_read};
+    Tag write_tag_{this, &AsyncStreamCall::on_write};
+    Tag finish_tag_{this, &AsyncStreamCall::on_finish};
+
+    std::mutex mutex_;
+    StreamAuthRequest request_;
+    // 書き出し待ちのレスポンス（先頭が書き出し中）
+    std::deque<StreamAuthResponse> writes_;
+    // 読み取ったが返信を書き出していないリクエストの数
+    std::size_t unanswered_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool reads_done_ = false;
+    // 書き出しに失敗した（クライアントの切断など）。以降のレスポンスは捨てる
+    bool broken_ = false;
+    bool finishing_ = false;
+
+    void on_accept(bool ok)
+    {
+        // シャットダウンにより受信されなかった要求
+        if (!ok)
+        {
+            delete this;
+            return;
+        }
+        new AsyncStreamCall(service_, cq_, handler_, window_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        start_read();
+    }
+
+    void on_read(bool ok)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        reading_ = false;
+        if (!ok)
+        {
+            reads_done_ = true;
+            maybe_finish();
+            return;
+        }
+        ++unanswered_;
+        const StreamAuthRequest request = std::move(request_);
+        if (unanswered_ < window_ && !broken_)
+        {
+            start_read();
+        }
+        lock.unlock();
+        (*handler_)(&context_, &request, [this](StreamAuthResponse response) { reply(std::move(response)); });
+    }
+
+    void reply(StreamAuthResponse response)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (broken_)
+        {
+            --unanswered_;
+            maybe_finish();
+            return;
+        }
+        writes_.push_back(std::move(response));
+        if (!writing_)
+        {
+            start_write();
+        }
+    }
+
+    void on_write(bool ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_ = false;
+        writes_.pop_front();
+        --unanswered_;
+        if (!ok)
+        {
+            broken_ = true;
+            unanswered_ -= writes_.size();
+            writes_.clear();
+        }
+        else if (!writes_.empty())
+        {
+            start_write();
+        }
+        // 返信が進んで上限を下回ったら読み取りを再開する
+        if (!reading_ && !reads_done_ && !broken_ && unanswered_ < window_)
+        {
+            start_read();
+        }
+        maybe_finish();
+    }
+
+    void on_finish(bool)
+    {
+        // reply が mutex_ を手放すのを待ってから破棄する
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        delete this;
+    }
+
+    // 以下は mutex_ を保持した状態で呼ぶこと
+    void start_read()
+    {
+        reading_ = true;
+        stream_.Read(&request_, &read_tag_);
+    }
+
+    void start_write()
+    {
+        writing_ = true;
+        stream_.Write(writes_.front(), &write_tag_);
+    }
+
+    void maybe_finish()
+    {
+        if ((reads_done_ || broken_) && !reading_ && !writing_ && unanswered_ == 0 && !finishing_)
+        {
+            finishing_ = true;
+            stream_.Finish(grpc::Status::OK, &finish_tag_);
+        }
+    }
+};
+
+// 1 つの CompletionQueue で RPC ごとに同時に受信待ちにしておく数（到着が集中したときの受信待ちを減らす）
+constexpr int kPendingCallsPerMethod = 16;
+
+// プロセスが使える CPU の番号（取得できない場合は 0 からハードウェアスレッド数まで）
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty())
+    {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+        {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+// 呼び出したスレッドを cpus に固定する（以後このスレッドが作るスレッドにも引き継がれる）
+bool pin_current_thread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// shard 番目のシャードの CPU。CPU をシャード数で連続した重ならない範囲に分ける（CPU よりシャードが多い場合は共有する）
+std::vector<int> shard_cpus(const std::vector<int>& cpus, std::size_t shard, std::size_t shards)
+{
+    if (shards >= cpus.size())
+    {
+        return {cpus[shard % cpus.size()]};
+    }
+    return std::vector<int>(cpus.begin() + static_cast<std::ptrdiff_t>(shard * cpus.size() / shards),
+                            cpus.begin() + static_cast<std::ptrdiff_t>((shard + 1) * cpus.size() / shards));
+}
+
+// 1 シャードの設定。スレッド数はシャードの CPU 数に合わせ、メモリとセッションの上限はシャード数で等分する
+AuthServiceOptions shard_options(AuthServiceOptions options, std::size_t cpu_count, std::size_t shards)
+{
+    if (options.batch.worker_threads == 0)
+    {
+        options.batch.worker_threads = cpu_count;
+    }
+    if (options.registration_threads == 0)
+    {
+        options.registration_threads = cpu_count;
+    }
+    options.key_tables.memory_bytes /= shards;
+    if (options.sessions.max_sessions != 0)
+    {
+        options.sessions.max_sessions = std::max<std::size_t>(1, options.sessions.max_sessions / shards);
+    }
+    return options;
+}
+}  // namespace
+
+AuthServer::~AuthServer() { Shutdown(); }
 
-AuthServer::~AuthServer()
+void AuthServer::Shutdown()
 {
-    if (server_)
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shutting_down_)
+    {
+        return;
+    }
+    shutting_down_ = true;
+    // 先にサーバを止めて処理中の RPC を終わらせてから、CompletionQueue を閉じる
+    for (auto& server : servers_)
     {
-        server_->Shutdown();
+        server->Shutdown();
+    }
+    for (auto& cq : completion_queues_)
+    {
+        cq->Shutdown();
     }
 }
 
+bool AuthServer::AddServer(std::unique_ptr<grpc::Server> server,
+                           std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (shutting_down_)
+    {
+        server->Shutdown();
+        for (auto& cq : queues)
+        {
+            cq->Shutdown();
+            void* tag = nullptr;
+            bool ok = false;
+            while (cq->Next(&tag, &ok))
+            {
+            }
+        }
+        return false;
+    }
+    servers_.push_back(std::move(server));
+    for (auto& cq : queues)
+    {
+        completion_queues_.push_back(std::move(cq));
+    }
+    return true;
+}
+
 void AuthServer::Run(const std::string& server_address)
 {
-    AuthServiceImpl service;
+    if (options_.async || options_.shards > 1)
+    {
+        RunAsync(server_address);
+    }
+    else
+    {
+        RunSync(server_address);
+    }
+}
+
+void AuthServer::RunSync(const std::string& server_address)
+{
+    AuthServiceImpl service(options_.service);
 
     grpc::ServerBuilder builder;
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     builder.RegisterService(&service);
 
-    server_ = builder.BuildAndStart();
-    if (!server_)
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        log_error("server_start_failed", {{"address", server_address}});
+        return;
+    }
+    grpc::Server* running = server.get();
+    if (!AddServer(std::move(server), {}))
+    {
+        return;
+    }
+
+    log_info("server_listening",
+             {{"address", server_address}, {"async", false}, {"simd", simd_kernel_name(simd_kernel())}});
+    running->Wait();
+}
+
+void AuthServer::RunAsync(const std::string& server_address)
+{
+    if (options_.shards > 1)
+    {
+        RunSharded(server_address);
+        return;
+    }
+    // service は検証用ワーカースレッドを持つ。イベントループより長く生存させる。
+    AuthServiceImpl service(options_.service);
+    std::size_t queue_count = options_.completion_queues;
+    if (queue_count == 0)
+    {
+        queue_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    ServeAsync(server_address, service, queue_count, -1);
+}
+
+void AuthServer::RunSharded(const std::string& server_address)
+{
+    const std::size_t shards = options_.shards;
+    const std::vector<int> cpus = allowed_cpus();
+    // 登録済みユーザーは全シャードで共有する（ログの書き込みとスナップショットのスレッドはどの CPU にも固定しない）
+    auto users = std::make_shared<UserStore>(options_.service.users);
+
+    // シャードのサービスは、そのシャードの CPU に固定した状態で作る（検証用ワーカースレッドなどが固定を引き継ぐ）
+    std::vector<std::vector<int>> shard_cpu_sets;
+    std::vector<std::unique_ptr<AuthServiceImpl>> services;
+    try
+    {
+        for (std::size_t i = 0; i < shards; ++i)
+        {
+            shard_cpu_sets.push_back(shard_cpus(cpus, i, shards));
+            pin_current_thread(shard_cpu_sets.back());
+            services.push_back(std::make_unique<AuthServiceImpl>(
+                shard_options(options_.service, shard_cpu_sets.back().size(), shards), users));
+        }
+    }
+    catch (...)
+    {
+        pin_current_thread(cpus);
+        throw;
+    }
+    pin_current_thread(cpus);
+
+    std::vector<AuthServiceImpl*> peers;
+    for (const auto& service : services)
+    {
+        peers.push_back(service.get());
+    }
+    for (std::size_t i = 0; i < shards; ++i)
+    {
+        services[i]->set_shards(i, peers);
+    }
+
+    log_info("server_sharded", {{"shards", shards}, {"cpus", cpus.size()}});
+    std::vector<std::thread> shard_threads;
+    for (std::size_t i = 0; i < shards; ++i)
+    {
+        shard_threads.emplace_back(
+            [&, i]
+            {
+                const std::vector<int>& shard_cpu_set = shard_cpu_sets[i];
+                if (!pin_current_thread(shard_cpu_set))
+                {
+                    log_warn("shard_pin_failed", {{"shard", i}});
+                }
+                const std::size_t queue_count =
+                    options_.completion_queues != 0 ? options_.completion_queues : shard_cpu_set.size();
+                ServeAsync(server_address, *services[i], queue_count, static_cast<int>(i));
+            });
+    }
+    for (std::thread& shard_thread : shard_threads)
+    {
+        shard_thread.join();
+    }
+}
+
+void AuthServer::ServeAsync(const std::string& server_address, AuthServiceImpl& service, std::size_t queue_count,
+                            int shard)
+{
+    Auth::AsyncService async_service;
+
+    grpc::ServerBuilder builder;
+    if (shard >= 0)
+    {
+        // 全シャードが同じアドレスで待ち受け、カーネルが接続をシャードに振り分ける
+        builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT, 1);
+    }
+    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    builder.RegisterService(&async_service);
+
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues;
+    std::vector<grpc::ServerCompletionQueue*> loop_queues;
+    for (std::size_t i = 0; i < queue_count; ++i)
     {
-        std::cerr << "Failed to start server on " << server_address << std::endl;
+        queues.push_back(builder.AddCompletionQueue());
+        loop_queues.push_back(queues.back().get());
+    }
+
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server)
+    {
+        log_error("server_start_failed", {{"address", server_address}, {"shard", shard}});
+        for (auto& cq : queues)
+        {
+            cq->Shutdown();
+        }
         return;
     }
+    if (!AddServer(std::move(server), std::move(queues)))
+    {
+        return;
+    }
+    // CreateAuthenticationChallenge（と GetMetrics）は軽いのでイベントループ上で処理する。
+    // Register はユーザーストアのログの書き込みスレッドで、RegisterBatch は一括登録用のスレッドで、
+    // VerifyAuthentication と NonInteractiveAuthentication は検証用ワーカースレッドで完了させ、イベントループを塞がない。
+    // AuthenticateStream の各リクエストも同じ振り分けで処理する。
+    using RegisterCall = AsyncUnaryCall<RegisterRequest, RegisterResponse>;
+    using RegisterBatchCall = AsyncUnaryCall<RegisterBatchRequest, RegisterBatchResponse>;
+    using ChallengeCall = AsyncUnaryCall<AuthenticationChallengeRequest, AuthenticationChallengeResponse>;
+    using VerifyCall = AsyncUnaryCall<AuthenticationAnswerRequest, AuthenticationAnswerResponse>;
+    using NonInteractiveCall = AsyncUnaryCall<NonInteractiveAuthenticationRequest, AuthenticationAnswerResponse>;
+    using MetricsCall = AsyncUnaryCall<MetricsRequest, MetricsResponse>;
+
+    const RegisterCall::Handler register_handler = [&service](auto*, auto* request, auto* response, auto done)
+    { service.RegisterAsync(request, response, std::move(done)); };
+    const RegisterBatchCall::Handler register_batch_handler = [&service](auto*, auto* request, auto* response,
+                                                                         auto done)
+    { service.RegisterBatchAsync(request, response, std::move(done)); };
+    const ChallengeCall::Handler challenge_handler = [&service](auto* context, auto* request, auto* response, auto done)
+    { done(service.CreateAuthenticationChallenge(context, request, response)); };
+    const VerifyCall::Handler verify_handler = [&service](auto*, auto* request, auto* response, auto done)
+    { service.VerifyAuthenticationAsync(request, response, std::move(done)); };
+    const NonInteractiveCall::Handler non_interactive_handler = [&service](auto* context, auto* request,
+                                                                           auto* response, auto done)
+    { service.NonInteractiveAuthenticationAsync(context, request, response, std::move(done)); };
+    const AsyncStreamCall::Handler stream_handler = [&service](auto* context, auto* request, auto reply)
+    { service.HandleStreamRequestAsync(context, request, std::move(reply)); };
+    const MetricsCall::Handler metrics_handler = [&service](auto* context, auto* request, auto* response, auto done)
+    { done(service.GetMetrics(context, request, response)); };
 
-    std::cout << "Server listening on " << server_address << std::endl;
-    server_->Wait();
-}
\ No newline at end of file
+    std::vector<std::thread> event_loops;
+    for (grpc::ServerCompletionQueue* cq : loop_queues)
+    {
+        for (int i = 0; i < kPendingCallsPerMethod; ++i)
+        {
+            new RegisterCall(&async_service, cq, &Auth::AsyncService::RequestRegister, &register_handler);
+            new ChallengeCall(&async_service, cq, &Auth::AsyncService::RequestCreateAuthenticationChallenge,
+                              &challenge_handler);
+            new VerifyCall(&async_service, cq, &Auth::AsyncService::RequestVerifyAuthentication, &verify_handler);
+            new NonInteractiveCall(&async_service, cq, &Auth::AsyncService::RequestNonInteractiveAuthentication,
+                                   &non_interactive_handler);
+        }
+        // メトリクスの取得と一括登録は頻度が低く、ストリームは 1 本で長く使われるため、受信待ちは 1 つで足りる
+        new MetricsCall(&async_service, cq, &Auth::AsyncService::RequestGetMetrics, &metrics_handler);
+        new RegisterBatchCall(&async_service, cq, &Auth::AsyncService::RequestRegisterBatch,
+                              &register_batch_handler);
+        new AsyncStreamCall(&async_service, cq, &stream_handler, service.stream_window());
+        event_loops.emplace_back(
+            [cq]
+            {
+                void* tag = nullptr;
+                bool ok = false;
+                while (cq->Next(&tag, &ok))
+                {
+                    static_cast<AsyncCall*>(tag)->proceed(ok);
+                }
+            });
+    }
+
+    log_info("server_listening",
+             {{"address", server_address},
+              {"async", true},
+              {"completion_queues", queue_count},
+              {"shard", shard},
+              {"simd", simd_kernel_name(simd_kernel())}});
+    for (std::thread& event_loop : event_loops)
+    {
+        event_loop.join();
+    }
+}
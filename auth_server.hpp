@@ -3,32 +3,105 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include "auth_service_impl.hpp"
 
 namespace grpc
 {
 class Server;
+class ServerCompletionQueue;
 }
 
 namespace zkp_auth
 {
+// AuthServer の設定
+struct AuthServerOptions
+{
+    AuthServiceOptions service;
+    // true の場合は CompletionQueue による非同期サーバとして起動する
+    bool async = false;
+    // 非同期サーバの CompletionQueue（= イベントループスレッド）の数（0 の場合はハードウェアスレッド数。
+    // シャードに分ける場合はシャードごとの数で、0 の場合はシャードに割り当てた CPU 数）
+    std::size_t completion_queues = 0;
+    // 2 以上の場合は非同期サーバを shards 個のシャードに分けて起動する。各シャードは重ならない CPU の集合に固定され、
+    // 同じアドレスで別々に待ち受け（SO_REUSEPORT で接続をカーネルが振り分ける）、自分の CompletionQueue・
+    // 検証用ワーカースレッド・認証セッション・メトリクスを持つ。登録済みユーザーは全シャードで共有する。
+    std::size_t shards = 0;
+};
+
 class AuthServer
 {
    public:
-    AuthServer() = default;
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param options サーバの設定
+     */
+    explicit AuthServer(const AuthServerOptions& options = {}) : options_(options) {}
     ~AuthServer();
 
     /**
      * @fn
-     * @brief サーバを起動し、指定されたアドレスでリクエストを待ち受ける。
+     * @brief サーバを起動し、指定されたアドレスでリクエストを待ち受ける。Shutdown が呼ばれるまで戻らない。
      * @param server_address サーバのアドレス（ex."0.0.0.0"）
      */
     void Run(const std::string& server_address);
 
+    /**
+     * @fn
+     * @brief 処理中の RPC の完了を待ってからサーバを停止する（他のスレッドから呼ぶこと）
+     */
+    void Shutdown();
+
    private:
-    std::unique_ptr<grpc::Server> server_;
+    AuthServerOptions options_;
+    // 起動したサーバ（シャードごとに 1 つ）と CompletionQueue。シャードのスレッドが追加するため mutex_ で守る
+    std::mutex mutex_;
+    bool shutting_down_ = false;
+    std::vector<std::unique_ptr<grpc::Server>> servers_;
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> completion_queues_;
+
+    /**
+     * @fn
+     * @brief 同期 API で起動する。ハンドラ（検証を含む）は gRPC のスレッドプール上で実行される。
+     */
+    void RunSync(const std::string& server_address);
+
+    /**
+     * @fn
+     * @brief 非同期 API で起動する。CompletionQueue ごとに 1 スレッドのイベントループを回し、
+     *        検証は検証用ワーカースレッドに任せて、完了時にワーカースレッドから RPC を終了する。
+     */
+    void RunAsync(const std::string& server_address);
+
+    /**
+     * @fn
+     * @brief shards 個のシャードで起動する。シャードごとのサービスは、そのシャードの CPU に固定したスレッドで
+     *        作る（サービスが起動するワーカースレッドは固定を引き継ぐ）。
+     */
+    void RunSharded(const std::string& server_address);
+
+    /**
+     * @fn
+     * @brief 1 つのサービスを非同期 API で待ち受け、queue_count 本のイベントループを回す。Shutdown まで戻らない。
+     * @param shard シャード番号（シャードに分けていない場合は -1。ログと SO_REUSEPORT の指定に使う）
+     */
+    void ServeAsync(const std::string& server_address, AuthServiceImpl& service, std::size_t queue_count,
+                    int shard);
+
+    /**
+     * @fn
+     * @brief 起動したサーバと CompletionQueue を Shutdown の対象に加える
+     * @return Shutdown が既に呼ばれていた場合は false（サーバと CompletionQueue は止めて破棄する）
+     */
+    bool AddServer(std::unique_ptr<grpc::Server> server,
+                   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues);
 };
 }  // namespace zkp_auth
 
-#endif  // AUTH_SERVER_HPP
\ No newline at end of file
+#endif  // AUTH_SERVER_HPP
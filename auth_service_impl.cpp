@@ -1,193 +1,913 @@
 #include "auth_service_impl.hpp"
 
 #include <boost/multiprecision/cpp_int.hpp>
-#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "chaum_pedersen.hpp"
-#include "zkp_constants.hpp"
+#include "logger.hpp"
+#include "parallel_for.hpp"
 
 using namespace boost::multiprecision;
 
-cpp_int AuthServiceImpl::bytes_to_cpp_int(const std::string& s)
+namespace
 {
-    if (s.empty())
+// リクエストの encoding を変換する。未知の値（新しいクライアントが追加した形式など）は std::nullopt
+std::optional<WireEncoding> wire_encoding(zkp_auth::Encoding encoding)
+{
+    switch (encoding)
     {
-        return 0;
+    case zkp_auth::HEX:
+        return WireEncoding::kHex;
+    case zkp_auth::BINARY:
+        return WireEncoding::kBinary;
+    default:
+        return std::nullopt;
     }
-    // 16進数文字列からcpp_intに変換
-    return cpp_int("0x" + s);
 }
 
-std::string AuthServiceImpl::cpp_int_to_bytes(const cpp_int& n)
+const grpc::Status kUnsupportedEncoding(grpc::INVALID_ARGUMENT, "Unsupported encoding.");
+
+// 受け付け制限に使う接続元アドレス（context がない、ストリーム内の呼び出しなどでは空）
+std::string client_address(const grpc::ServerContext* context)
 {
-    std::stringstream ss;
-    ss << std::hex << n;
-    return ss.str();
+    return context ? peer_address(context->peer()) : std::string();
 }
 
+// RegisterBatch の検査で各スレッドが一度に取り出すエントリ数（1 件はべき乗 2 回程度）
+constexpr std::size_t kRegistrationChunk = 64;
+
+grpc::Status registration_status(UserInsertResult result)
+{
+    switch (result)
+    {
+    case UserInsertResult::kInserted:
+        return grpc::Status::OK;
+    case UserInsertResult::kAlreadyExists:
+        return grpc::Status(grpc::ALREADY_EXISTS, "User already registered.");
+    case UserInsertResult::kTooLarge:
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Username is too long.");
+    case UserInsertResult::kStorageFailed:
+    default:
+        return grpc::Status(grpc::INTERNAL, "User store is not writable.");
+    }
+}
+}  // namespace
+
 grpc::Status AuthServiceImpl::Register(grpc::ServerContext* context, const zkp_auth::RegisterRequest* request,
                                        zkp_auth::RegisterResponse* response)
 {
-    // Implementation of user registration
-    std::cout << "Registering user: " << request->user() << std::endl;
+    // ユーザーストアのログへの書き込みが確定するまで待つ
+    std::promise<grpc::Status> promise;
+    std::future<grpc::Status> status = promise.get_future();
+    RegisterAsync(request, response, [&promise](grpc::Status s) { promise.set_value(std::move(s)); });
+    return status.get();
+}
 
-    const std::string& user = request->user();
-    if (user.empty())
+void AuthServiceImpl::RegisterAsync(const zkp_auth::RegisterRequest* request, zkp_auth::RegisterResponse* response,
+                                    std::function<void(grpc::Status)> done)
+{
+    log_info("register", {{"user", request->user()}});
+    RpcTimer timer(metrics_, RpcKind::kRegister);
+    UserInfo user_info;
+    grpc::Status status = prepare_registration(*request, user_info, timer);
+    if (!status.ok())
     {
-        return grpc::Status(grpc::INVALID_ARGUMENT, "Username cannot be empty.");
+        timer.finish(false);
+        done(status);
+        return;
     }
 
-    cpp_int y1 = bytes_to_cpp_int(request->y1());
-    cpp_int y2 = bytes_to_cpp_int(request->y2());
+    // 既に登録済みのユーザー名の場合は挿入しない
+    user_store_.insert(std::move(user_info),
+                       [timer, done = std::move(done)](UserInsertResult result) mutable
+                       {
+                           timer.lap(RpcPhase::kStoreLookup);
+                           grpc::Status status = registration_status(result);
+                           timer.finish(status.ok());
+                           done(std::move(status));
+                       });
+}
+
+grpc::Status AuthServiceImpl::RegisterBatch(grpc::ServerContext* context, const RegisterBatchRequest* request,
+                                            RegisterBatchResponse* response)
+{
+    std::promise<grpc::Status> promise;
+    std::future<grpc::Status> status = promise.get_future();
+    RegisterBatchAsync(request, response, [&promise](grpc::Status s) { promise.set_value(std::move(s)); });
+    return status.get();
+}
+
+void AuthServiceImpl::RegisterBatchAsync(const RegisterBatchRequest* request, RegisterBatchResponse* response,
+                                         std::function<void(grpc::Status)> done)
+{
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex_);
+        registration_jobs_.push_back([this, request, response, done = std::move(done)]() mutable
+                                     { register_batch(*request, response, std::move(done)); });
+    }
+    registration_cv_.notify_one();
+}
 
-    // accessメソッドを使い、マップをスレッドセーフに操作する
-    bool success = user_store_.access(
-        [&](auto& users)
+void AuthServiceImpl::register_batch(const RegisterBatchRequest& request, RegisterBatchResponse* response,
+                                     std::function<void(grpc::Status)> done)
+{
+    const auto count = static_cast<std::size_t>(request.users_size());
+    log_info("register_batch", {{"users", count}});
+    RpcTimer timer(metrics_, RpcKind::kRegisterBatch);
+
+    // 公開鍵の変換と検査（部分群の確認に 1 回ずつべき乗を含む）をエントリごとに並列に行う
+    std::vector<grpc::Status> statuses(count);
+    std::vector<UserInfo> users(count);
+    parallel_for(count, registration_threads_, kRegistrationChunk,
+                 [&](std::size_t i)
+                 {
+                     RpcTimer entry_timer;
+                     statuses[i] = prepare_registration(request.users(static_cast<int>(i)), users[i], entry_timer);
+                 });
+    timer.lap(RpcPhase::kDecode);
+
+    // 検査を通ったエントリをまとめて挿入する（永続化する場合はログへの 1 回の書き込みで確定する）
+    std::vector<UserInfo> valid;
+    std::vector<std::size_t> positions;
+    valid.reserve(count);
+    positions.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (statuses[i].ok())
+        {
+            valid.push_back(std::move(users[i]));
+            positions.push_back(i);
+        }
+    }
+    user_store_.insert_batch(
+        std::move(valid),
+        [timer, response, statuses = std::move(statuses), positions = std::move(positions),
+         done = std::move(done)](std::vector<UserInsertResult> results) mutable
         {
-            if (users.count(user))
+            timer.lap(RpcPhase::kStoreLookup);
+            for (std::size_t j = 0; j < results.size(); ++j)
             {
-                return false;
+                statuses[positions[j]] = registration_status(results[j]);
             }
+            std::uint64_t registered = 0;
+            response->mutable_results()->Reserve(static_cast<int>(statuses.size()));
+            for (const grpc::Status& status : statuses)
+            {
+                RegisterResult* result = response->add_results();
+                result->set_code(static_cast<std::int32_t>(status.error_code()));
+                result->set_message(status.error_message());
+                registered += status.ok() ? 1 : 0;
+            }
+            response->set_registered(registered);
+            timer.lap(RpcPhase::kEncode);
+            timer.finish(registered == statuses.size());
+            done(grpc::Status::OK);
+        });
+}
 
-            UserInfo user_info = {.name = user, .y1 = y1, .y2 = y2};
+AuthServiceImpl::~AuthServiceImpl()
+{
+    {
+        std::lock_guard<std::mutex> lock(registration_mutex_);
+        stopping_ = true;
+    }
+    registration_cv_.notify_all();
+    registration_thread_.join();
+}
 
-            users[user] = std::move(user_info);
-            return true;
-        });
+void AuthServiceImpl::registration_loop()
+{
+    std::unique_lock<std::mutex> lock(registration_mutex_);
+    while (true)
+    {
+        registration_cv_.wait(lock, [this] { return stopping_ || !registration_jobs_.empty(); });
+        if (registration_jobs_.empty())
+        {
+            return;
+        }
+        std::function<void()> job = std::move(registration_jobs_.front());
+        registration_jobs_.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
 
-    if (!success)
+grpc::Status AuthServiceImpl::prepare_registration(const zkp_auth::RegisterRequest& request, UserInfo& user_info,
+                                                   RpcTimer& timer)
+{
+    // Implementation of user registration
+    const std::string& user = request.user();
+    if (user.empty())
     {
-        return grpc::Status(grpc::ALREADY_EXISTS, "User already registered.");
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Username cannot be empty.");
+    }
+
+    // 登録を受け付けるのはサーバ設定の群のみ
+    const auto group = static_cast<GroupId>(request.group());
+    if (group != registration_group_)
+    {
+        return grpc::Status(grpc::INVALID_ARGUMENT,
+                            "Server accepts registrations for group " + std::string(group_name(registration_group_)) +
+                                " only.");
     }
 
+    const auto encoding = wire_encoding(request.encoding());
+    if (!encoding)
+    {
+        return kUnsupportedEncoding;
+    }
+    const ZkpBackend& zkp = backend(group);
+    auto y1 = decode_wire(request.y1(), *encoding, zkp.element_bytes());
+    auto y2 = decode_wire(request.y2(), *encoding, zkp.element_bytes());
+    // 範囲（曲線上の点か）に加えて位数 q の部分群に属することを確認する（以後の全ての検証でこの値を使う）
+    if (!y1 || !y2 || !zkp.is_valid_public_key(*y1) || !zkp.is_valid_public_key(*y2))
+    {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Public keys are not elements of the prime-order subgroup.");
+    }
+    user_info = {.name = user, .group = group, .y1 = std::move(*y1), .y2 = std::move(*y2)};
+    timer.lap(RpcPhase::kDecode);
     return grpc::Status::OK;
 }
 
 grpc::Status AuthServiceImpl::CreateAuthenticationChallenge(grpc::ServerContext* context,
                                                             const zkp_auth::AuthenticationChallengeRequest* request,
                                                             zkp_auth::AuthenticationChallengeResponse* response)
+{
+    RpcTimer timer(metrics_, RpcKind::kCreateAuthenticationChallenge);
+    grpc::Status status = create_challenge(client_address(context), *request, response, timer);
+    timer.finish(status.ok());
+    return status;
+}
+
+grpc::Status AuthServiceImpl::create_challenge(std::string_view peer,
+                                               const zkp_auth::AuthenticationChallengeRequest& request,
+                                               zkp_auth::AuthenticationChallengeResponse* response, RpcTimer& timer)
 {
     // Implementation of creating authentication challenge
-    std::cout << "Creating authentication challenge for user. user: " << request->user() << std::endl;
+    log_info("create_challenge", {{"user", request.user()}});
 
-    const std::string& user = request->user();
+    const std::string& user = request.user();
     if (user.empty())
     {
         return grpc::Status(grpc::INVALID_ARGUMENT, "Username cannot be empty.");
     }
 
-    // RFC5114のqを使用
-    auto constants = get_zkp_constants();
-    cpp_int q = constants.q;
-    cpp_int c = generate_random(q);
-    std::string auth_id = generate_auth_id();
-
-    bool user_found = user_store_.access(
-        [&](auto& users)
-        {
-            auto it = users.find(user);
-            if (it == users.end())
-            {
-                return false;
-            }
-            session_store_.access(
-                [&](auto& sessions)
-                {
-                    AuthSession session = {.user = user,
-                                           .r1 = bytes_to_cpp_int(request->r1()),
-                                           .r2 = bytes_to_cpp_int(request->r2()),
-                                           .c = c};
-                    sessions[auth_id] = std::move(session);
-                });
-            return true;
-        });
+    const auto encoding = wire_encoding(request.encoding());
+    if (!encoding)
+    {
+        return kUnsupportedEncoding;
+    }
+    timer.lap(RpcPhase::kDecode);
 
-    if (!user_found)
+    // ユーザーの群を共有ロックで参照する（セッションストアのロックとは重ねない）
+    const std::optional<GroupId> group = user_store_.find_group(user);
+    timer.lap(RpcPhase::kStoreLookup);
+    if (!group)
     {
         return grpc::Status(grpc::NOT_FOUND, "User not found.");
     }
 
+    const ZkpBackend& zkp = backend(*group);
+    auto r1 = decode_wire(request.r1(), *encoding, zkp.element_bytes());
+    auto r2 = decode_wire(request.r2(), *encoding, zkp.element_bytes());
+    // 範囲外のコミットメントはセッションを作る前に断る（回答を待ってから検証で失敗させない）
+    if (!r1 || !r2 || !zkp.is_valid_commitment(*r1) || !zkp.is_valid_commitment(*r2))
+    {
+        metrics_.record_rejection(RejectReason::kMalformed);
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Malformed commitment.");
+    }
+    timer.lap(RpcPhase::kDecode);
+    // 回答の検証はチャレンジごとに 1 回だけなので、ログインの受け付け制限はチャレンジの発行で数える
+    grpc::Status admitted = admit_login(peer, user);
+    timer.lap(RpcPhase::kStoreLookup);
+    if (!admitted.ok())
+    {
+        return admitted;
+    }
+
+    // チャレンジはユーザーが登録した群の位数 q 未満で生成する
+    cpp_int c = generate_random(zkp.order());
+    timer.lap(RpcPhase::kEncode);
+    AuthSession session = {.user = user, .group = *group, .r1 = std::move(*r1), .r2 = std::move(*r2), .c = c};
+    const std::string auth_id = issue_session(std::move(session));
+    timer.lap(RpcPhase::kStoreLookup);
+
     response->set_auth_id(auth_id);
-    response->set_c(cpp_int_to_bytes(c));  // 16進数文字列としてセット
+    response->set_c(encode_wire(c, *encoding, zkp.scalar_bytes()));  // リクエストと同じ形式で返す
+    timer.lap(RpcPhase::kEncode);
 
     return grpc::Status::OK;
 }
 
+grpc::Status AuthServiceImpl::admit_login(std::string_view peer, const std::string& user)
+{
+    // シャードでは全シャードで同じバケットを使う（接続がどのシャードに振り分けられても制限は変わらない）
+    AuthServiceImpl& limits = shared_state();
+    if (!peer.empty() && !limits.peer_limiter_.try_acquire(peer))
+    {
+        metrics_.record_rejection(RejectReason::kPeerRateLimit);
+        log_debug("login_rate_limited", {{"peer", peer}});
+        return grpc::Status(grpc::RESOURCE_EXHAUSTED, "Too many login attempts from this address.");
+    }
+    if (!limits.user_limiter_.try_acquire(user))
+    {
+        metrics_.record_rejection(RejectReason::kUserRateLimit);
+        log_debug("login_rate_limited", {{"user", user}});
+        return grpc::Status(grpc::RESOURCE_EXHAUSTED, "Too many login attempts for this user.");
+    }
+    return grpc::Status::OK;
+}
+
+void AuthServiceImpl::set_shards(std::size_t index, std::vector<AuthServiceImpl*> shards)
+{
+    shard_index_ = index;
+    shards_ = std::move(shards);
+}
+
+std::optional<std::size_t> AuthServiceImpl::shard_prefix(const std::string& auth_id)
+{
+    const std::size_t pos = auth_id.find(kShardSeparator);
+    if (pos == std::string::npos)
+    {
+        return std::nullopt;
+    }
+    std::size_t index = 0;
+    const auto [end, error] = std::from_chars(auth_id.data(), auth_id.data() + pos, index);
+    if (error != std::errc() || end != auth_id.data() + pos)
+    {
+        return std::nullopt;
+    }
+    return index;
+}
+
+AuthServiceImpl& AuthServiceImpl::session_owner(const std::string& auth_id)
+{
+    const std::optional<std::size_t> index = shard_prefix(auth_id);
+    if (shards_.empty() || !index || *index >= shards_.size())
+    {
+        return *this;
+    }
+    return *shards_[*index];
+}
+
+std::string AuthServiceImpl::issue_session(AuthSession session)
+{
+    // シャードに分けている場合は、回答が別のシャードに届いても渡せるようにシャード番号を付ける
+    const std::string prefix = shards_.empty() ? std::string() : std::to_string(shard_index_) + kShardSeparator;
+    if (!challenge_tokens_)
+    {
+        // 期限切れ・上限超過のセッションはストアが回収する（auth_id には有効期限が付く）
+        const std::string user = session.user;
+        return prefix + session_store_.issue(generate_auth_id(), user, std::move(session));
+    }
+    const std::int64_t expires_at_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            (std::chrono::system_clock::now() + session_ttl_).time_since_epoch())
+            .count();
+    // シャード番号はトークンにも封じ、auth_id の番号を付け替えられないようにする
+    std::optional<std::uint32_t> shard;
+    if (!shards_.empty())
+    {
+        shard = static_cast<std::uint32_t>(shard_index_);
+    }
+    return prefix + challenge_tokens_->seal({.user = std::move(session.user),
+                                             .group = session.group,
+                                             .r1 = std::move(session.r1),
+                                             .r2 = std::move(session.r2),
+                                             .c = std::move(session.c),
+                                             .expires_at_ms = expires_at_ms,
+                                             .shard = shard});
+}
+
+SessionLookup AuthServiceImpl::take_session(const std::string& auth_id, AuthSession& session)
+{
+    // シャード番号は取り除く（シャードに分けていない別のインスタンスに届いたトークンも開けるようにする）
+    const std::size_t pos = auth_id.find(kShardSeparator);
+    const std::string local_id = pos == std::string::npos ? auth_id : auth_id.substr(pos + 1);
+    if (!challenge_tokens_)
+    {
+        return session_store_.take(local_id, session);
+    }
+    std::string nonce;
+    std::optional<ChallengeClaims> claims = challenge_tokens_->open(local_id, &nonce);
+    if (!claims)
+    {
+        return SessionLookup::kNotFound;
+    }
+    const std::int64_t now_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    // auth_id のシャード番号は暗号化されていないため、トークンに封じた番号と一致しないものは受け付けない
+    if (shard_prefix(auth_id) != claims->shard)
+    {
+        return SessionLookup::kNotFound;
+    }
+    if (claims->expires_at_ms <= now_ms)
+    {
+        return SessionLookup::kExpired;
+    }
+    // 回答は 1 つのトークンにつき 1 回だけ検証する（期限を過ぎたトークンは記録がなくても受け付けない）。
+    // シャードでは記録を共有し、番号を付け替えて別のシャードに再送された回答も拒む
+    if (!shared_state().answered_tokens_.insert(nonce, claims->expires_at_ms))
+    {
+        return SessionLookup::kNotFound;
+    }
+    session = {.user = std::move(claims->user),
+               .group = claims->group,
+               .r1 = std::move(claims->r1),
+               .r2 = std::move(claims->r2),
+               .c = std::move(claims->c)};
+    return SessionLookup::kFound;
+}
+
 grpc::Status AuthServiceImpl::VerifyAuthentication(grpc::ServerContext* context,
                                                    const zkp_auth::AuthenticationAnswerRequest* request,
                                                    zkp_auth::AuthenticationAnswerResponse* response)
 {
-    // Implementation of verifying authentication
-    std::cout << "Verifying authentication for auth_id: " << request->auth_id() << std::endl;
+    // 他のシャードが発行したセッションはそのシャードで検証する
+    AuthServiceImpl& owner = session_owner(request->auth_id());
+    if (&owner != this)
+    {
+        return owner.VerifyAuthentication(context, request, response);
+    }
+    PendingVerification pending;
+    pending.timer = RpcTimer(metrics_, RpcKind::kVerifyAuthentication);
+    grpc::Status status = prepare_verification(*request, pending);
+    if (!status.ok())
+    {
+        pending.timer.finish(false);
+        return status;
+    }
 
-    const std::string& auth_id = request->auth_id();
-    if (auth_id.empty())
+    // 3. ユーザーの群で Chaum-Pedersen 検証を実行
+    // 群の要素として不正な値（範囲外・曲線外）が含まれる場合は検証失敗とする
+    const bool is_verified = backend(pending.group).verify(pending.user, pending.commitment, pending.public_keys,
+                                                           pending.challenge, pending.response);
+    pending.timer.lap(RpcPhase::kVerify);
+    return finish_verification(pending, is_verified, response);
+}
+
+void AuthServiceImpl::VerifyAuthenticationAsync(const zkp_auth::AuthenticationAnswerRequest* request,
+                                                zkp_auth::AuthenticationAnswerResponse* response,
+                                                std::function<void(grpc::Status)> done)
+{
+    AuthServiceImpl& owner = session_owner(request->auth_id());
+    if (&owner != this)
     {
-        return grpc::Status(grpc::INVALID_ARGUMENT, "INVALID REQUEST.");
+        owner.VerifyAuthenticationAsync(request, response, std::move(done));
+        return;
+    }
+    auto pending = std::make_shared<PendingVerification>();
+    pending->timer = RpcTimer(metrics_, RpcKind::kVerifyAuthentication);
+    grpc::Status status = prepare_verification(*request, *pending);
+    if (!status.ok())
+    {
+        pending->timer.finish(false);
+        done(status);
+        return;
+    }
+
+    // 3. 検証は検証用ワーカースレッドで行い、完了時に done を呼ぶ
+    submit_verification(std::move(pending), response, std::move(done));
+}
+
+grpc::Status AuthServiceImpl::NonInteractiveAuthentication(grpc::ServerContext* context,
+                                                           const zkp_auth::NonInteractiveAuthenticationRequest* request,
+                                                           zkp_auth::AuthenticationAnswerResponse* response)
+{
+    PendingVerification pending;
+    pending.timer = RpcTimer(metrics_, RpcKind::kNonInteractiveAuthentication);
+    grpc::Status status = prepare_verification(client_address(context), *request, pending);
+    if (!status.ok())
+    {
+        pending.timer.finish(false);
+        return status;
+    }
+    const bool is_verified = backend(pending.group).verify(pending.user, pending.commitment, pending.public_keys,
+                                                           pending.challenge, pending.response);
+    pending.timer.lap(RpcPhase::kVerify);
+    return finish_verification(pending, is_verified, response);
+}
+
+void AuthServiceImpl::NonInteractiveAuthenticationAsync(grpc::ServerContext* context,
+                                                        const zkp_auth::NonInteractiveAuthenticationRequest* request,
+                                                        zkp_auth::AuthenticationAnswerResponse* response,
+                                                        std::function<void(grpc::Status)> done)
+{
+    auto pending = std::make_shared<PendingVerification>();
+    pending->timer = RpcTimer(metrics_, RpcKind::kNonInteractiveAuthentication);
+    grpc::Status status = prepare_verification(client_address(context), *request, *pending);
+    if (!status.ok())
+    {
+        pending->timer.finish(false);
+        done(status);
+        return;
     }
+    submit_verification(std::move(pending), response, std::move(done));
+}
 
-    // 1. セッション情報を取得
-    std::optional<AuthSession> session_opt;
-    session_store_.access(
-        [&](const auto& sessions)
+grpc::Status AuthServiceImpl::AuthenticateStream(
+    grpc::ServerContext* context, grpc::ServerReaderWriter<StreamAuthResponse, StreamAuthRequest>* stream)
+{
+    log_info("stream_open", {{"peer", context->peer()}});
+
+    // 返信のコールバックは検証用ワーカースレッドで呼ばれ、notify の途中でこの関数が戻ることがあるため、
+    // 共有する状態はコールバックにも持たせる
+    struct StreamState
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        // 書き出し待ちの返信と、読み取ったが返信を書き出していないリクエストの数
+        std::deque<StreamAuthResponse> replies;
+        std::size_t unanswered = 0;
+        bool reads_done = false;
+    };
+    const auto state = std::make_shared<StreamState>();
+
+    std::thread reader(
+        [&]
         {
-            auto it = sessions.find(auth_id);
-            if (it != sessions.end())
+            StreamAuthRequest request;
+            while (true)
             {
-                session_opt = it->second;
+                {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    state->cv.wait(lock, [&] { return state->unanswered < stream_window_; });
+                }
+                if (!stream->Read(&request))
+                {
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    ++state->unanswered;
+                }
+                HandleStreamRequestAsync(context, &request,
+                                         [state](StreamAuthResponse response)
+                                         {
+                                             {
+                                                 std::lock_guard<std::mutex> lock(state->mutex);
+                                                 state->replies.push_back(std::move(response));
+                                             }
+                                             state->cv.notify_all();
+                                         });
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->reads_done = true;
             }
+            state->cv.notify_all();
         });
 
-    if (!session_opt)
+    // 読み取りが終わり、全てのリクエストに返信するまで書き出す
+    bool writable = true;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true)
     {
-        return grpc::Status(grpc::NOT_FOUND, "Authentication session not found or expired.");
+        state->cv.wait(lock, [&] { return !state->replies.empty() || (state->reads_done && state->unanswered == 0); });
+        if (state->replies.empty())
+        {
+            break;
+        }
+        StreamAuthResponse response = std::move(state->replies.front());
+        state->replies.pop_front();
+        lock.unlock();
+        if (writable && !stream->Write(response))
+        {
+            // クライアントが切断した。読み取りを止めさせ、残りの返信は捨てる
+            writable = false;
+            context->TryCancel();
+        }
+        lock.lock();
+        --state->unanswered;
+        state->cv.notify_all();
     }
-    const AuthSession& session = *session_opt;
+    lock.unlock();
+    reader.join();
+    return writable ? grpc::Status::OK : grpc::Status(grpc::CANCELLED, "Stream closed by the client.");
+}
 
-    // 2. ユーザー情報を取得
-    std::optional<UserInfo> user_info_opt;
-    user_store_.access(
-        [&](const auto& users)
+void AuthServiceImpl::HandleStreamRequestAsync(grpc::ServerContext* context, const StreamAuthRequest* request,
+                                               std::function<void(StreamAuthResponse)> reply)
+{
+    auto response = std::make_shared<StreamAuthResponse>();
+    response->set_request_id(request->request_id());
+    // 交換ごとのステータスはレスポンスに詰める（失敗してもストリームは続ける）
+    auto done = [response, reply = std::move(reply)](grpc::Status status)
+    {
+        if (!status.ok())
         {
-            auto it = users.find(session.user);
-            if (it != users.end())
-            {
-                user_info_opt = it->second;
-            }
-        });
+            response->clear_kind();
+        }
+        response->set_code(static_cast<std::int32_t>(status.error_code()));
+        response->set_message(status.error_message());
+        reply(std::move(*response));
+    };
+
+    switch (request->kind_case())
+    {
+    case StreamAuthRequest::kChallenge:
+        done(CreateAuthenticationChallenge(context, &request->challenge(), response->mutable_challenge()));
+        return;
+    case StreamAuthRequest::kAnswer:
+        VerifyAuthenticationAsync(&request->answer(), response->mutable_answer(), std::move(done));
+        return;
+    case StreamAuthRequest::kNonInteractive:
+        NonInteractiveAuthenticationAsync(context, &request->non_interactive(), response->mutable_answer(),
+                                          std::move(done));
+        return;
+    default:
+        done(grpc::Status(grpc::INVALID_ARGUMENT, "Stream request carries no challenge, answer or proof."));
+        return;
+    }
+}
+
+void AuthServiceImpl::submit_verification(std::shared_ptr<PendingVerification> pending,
+                                          zkp_auth::AuthenticationAnswerResponse* response,
+                                          std::function<void(grpc::Status)> done)
+{
+    ZkpBackend& zkp = backend(pending->group);
+    const bool accepted =
+        zkp.submit(pending->user, pending->commitment, pending->public_keys, pending->challenge, pending->response,
+                   [this, pending, response, done](bool is_verified)
+                   {
+                       pending->timer.lap(RpcPhase::kVerify);
+                       done(finish_verification(*pending, is_verified, response));
+                   });
+    if (!accepted)
+    {
+        pending->timer.finish(false);
+        done(grpc::Status(grpc::RESOURCE_EXHAUSTED, "Too many pending verifications."));
+    }
+}
+
+grpc::Status AuthServiceImpl::prepare_verification(const zkp_auth::AuthenticationAnswerRequest& request,
+                                                   PendingVerification& pending)
+{
+    // Implementation of verifying authentication
+    log_info("verify", {{"auth_id", request.auth_id()}});
+
+    const std::string& auth_id = request.auth_id();
+    if (auth_id.empty())
+    {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "INVALID REQUEST.");
+    }
+    const auto encoding = wire_encoding(request.encoding());
+    if (!encoding)
+    {
+        return kUnsupportedEncoding;
+    }
+    pending.timer.lap(RpcPhase::kDecode);
+
+    // 1. セッション情報を取り出す。回答は 1 つのセッションにつき 1 回だけ検証する（同時に届いた重複回答は NOT_FOUND）
+    AuthSession session;
+    switch (take_session(auth_id, session))
+    {
+    case SessionLookup::kFound:
+        break;
+    case SessionLookup::kExpired:
+        return grpc::Status(grpc::NOT_FOUND, "Authentication session expired.");
+    case SessionLookup::kNotFound:
+    default:
+        return grpc::Status(grpc::NOT_FOUND, "Authentication session not found (never issued, already answered or "
+                                             "evicted by a newer challenge).");
+    }
+
+    // 2. ユーザー情報を取得
+    std::optional<UserInfo> user_info_opt = user_store_.find(session.user);
+    pending.timer.lap(RpcPhase::kStoreLookup);
 
     if (!user_info_opt)
     {
         // セッションは存在したが、対応するユーザーがいない（通常は起こり得ない）
-        session_store_.access([&](auto& sessions) { sessions.erase(auth_id); });
         return grpc::Status(grpc::INTERNAL, "User associated with the session not found.");
     }
     const UserInfo& user_info = *user_info_opt;
 
-    // 3. Chaum-Pedersen検証を実行
-    const auto constants = get_zkp_constants();
-    ChaumPedersen cp(constants.p, constants.q, constants.g, constants.h);
+    // セッションは取り出し済みのため、形式に合わない回答はそのまま失敗とする（範囲外の s は検証しない）
+    const ZkpBackend& zkp = backend(user_info.group);
+    auto s = decode_wire(request.s(), *encoding, zkp.scalar_bytes());
+    if (!s || *s >= zkp.order())
+    {
+        metrics_.record_rejection(RejectReason::kMalformed);
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Malformed response.");
+    }
+
+    pending.auth_id = auth_id;
+    pending.user = session.user;
+    pending.group = user_info.group;
+    pending.commitment = {session.r1, session.r2};
+    pending.public_keys = {user_info.y1, user_info.y2};
+    pending.challenge = {session.c};
+    pending.response = {std::move(*s)};
+    pending.timer.lap(RpcPhase::kDecode);
+    return grpc::Status::OK;
+}
+
+grpc::Status AuthServiceImpl::prepare_verification(std::string_view peer,
+                                                   const zkp_auth::NonInteractiveAuthenticationRequest& request,
+                                                   PendingVerification& pending)
+{
+    log_info("verify_non_interactive", {{"user", request.user()}});
+
+    const std::string& user = request.user();
+    if (user.empty())
+    {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Username cannot be empty.");
+    }
+    const auto encoding = wire_encoding(request.encoding());
+    if (!encoding)
+    {
+        return kUnsupportedEncoding;
+    }
+
+    // 1. タイムスタンプが許容範囲内か確認する（範囲外の証明は再利用の記録も残っていない）
+    const std::int64_t now_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    const auto timestamp_ms = static_cast<std::int64_t>(request.timestamp_ms());
+    if (timestamp_ms < now_ms - proof_window_.count() || timestamp_ms > now_ms + proof_window_.count())
+    {
+        return grpc::Status(grpc::FAILED_PRECONDITION, "Proof timestamp is outside the accepted window.");
+    }
+    pending.timer.lap(RpcPhase::kDecode);
 
-    Commitment commitment = {session.r1, session.r2};
-    PublicKeys public_keys = {user_info.y1, user_info.y2};
-    Challenge challenge = {session.c};
-    Response response_s = {bytes_to_cpp_int(request->s())};
+    // 2. ユーザー情報を取得
+    std::optional<UserInfo> user_info_opt = user_store_.find(user);
+    pending.timer.lap(RpcPhase::kStoreLookup);
+    if (!user_info_opt)
+    {
+        return grpc::Status(grpc::NOT_FOUND, "User not found.");
+    }
+    const UserInfo& user_info = *user_info_opt;
 
-    bool is_verified = cp.verify_proof(commitment, public_keys, challenge, response_s);
+    const ZkpBackend& zkp = backend(user_info.group);
+    auto r1 = decode_wire(request.r1(), *encoding, zkp.element_bytes());
+    auto r2 = decode_wire(request.r2(), *encoding, zkp.element_bytes());
+    auto s = decode_wire(request.s(), *encoding, zkp.scalar_bytes());
+    // 範囲の確認だけで弾ける証明は、チャレンジの導出と検証の前に断る
+    if (!r1 || !r2 || !s || !zkp.is_valid_commitment(*r1) || !zkp.is_valid_commitment(*r2) || *s >= zkp.order())
+    {
+        metrics_.record_rejection(RejectReason::kMalformed);
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Malformed proof.");
+    }
+    pending.timer.lap(RpcPhase::kDecode);
+    grpc::Status admitted = admit_login(peer, user);
+    if (!admitted.ok())
+    {
+        return admitted;
+    }
 
-    // 4. 検証後、セッションを削除する
-    session_store_.access([&](auto& sessions) { sessions.erase(auth_id); });
+    pending.user = user;
+    pending.group = user_info.group;
+    pending.commitment = {std::move(*r1), std::move(*r2)};
+    pending.public_keys = {user_info.y1, user_info.y2};
+    pending.response = {std::move(*s)};
+    pending.timer.lap(RpcPhase::kDecode);
+
+    // 3. 証明者と同じトランスクリプトからチャレンジを導出する
+    pending.challenge =
+        zkp.fiat_shamir_challenge(pending.public_keys, pending.commitment, user, request.timestamp_ms());
+    // 同じ証明はチャレンジも同じになる。ユーザー名を付けて記録し、許容範囲を過ぎるまで再び受け付けない。
+    pending.replay_key = user + '\n' + encode_fixed(pending.challenge.c, zkp.scalar_bytes());
+    pending.replay_expires_at_ms = timestamp_ms + proof_window_.count();
+    pending.timer.lap(RpcPhase::kVerify);
+    return grpc::Status::OK;
+}
 
+grpc::Status AuthServiceImpl::finish_verification(PendingVerification& pending, bool is_verified,
+                                                  zkp_auth::AuthenticationAnswerResponse* response)
+{
+    metrics_.record_verification(is_verified);
+    // 4. セッションは prepare_verification で取り出し済み
     if (!is_verified)
     {
+        pending.timer.finish(false);
+        log_warn("authentication_failed", {{"user", pending.user}});
         return grpc::Status(grpc::PERMISSION_DENIED, "Authentication failed.");
     }
+    // 非対話の証明は 1 回だけ受け付ける（同時に届いた同じ証明も 1 つだけが記録に成功する）。
+    // シャードでは記録を共有し、別のシャードへの接続で再送された証明も拒む
+    if (!pending.replay_key.empty())
+    {
+        const bool first_use = shared_state().replay_cache_.insert(pending.replay_key, pending.replay_expires_at_ms);
+        pending.timer.lap(RpcPhase::kStoreLookup);
+        if (!first_use)
+        {
+            pending.timer.finish(false);
+            log_warn("proof_replayed", {{"user", pending.user}});
+            return grpc::Status(grpc::PERMISSION_DENIED, "Proof has already been used.");
+        }
+    }
 
     // 5. セッションIDを生成して返す
     std::string session_id = generate_auth_id();  // UUIDをセッションIDとして再利用
     response->set_session_id(session_id);
+    pending.timer.lap(RpcPhase::kEncode);
 
-    std::cout << "Authentication successful for user: " << session.user << ", session_id: " << session_id << std::endl;
+    log_info("authenticated", {{"user", pending.user}, {"session_id", session_id}});
 
+    pending.timer.finish(true);
     return grpc::Status::OK;
-}
\ No newline at end of file
+}
+
+grpc::Status AuthServiceImpl::GetMetrics(grpc::ServerContext* context, const zkp_auth::MetricsRequest* request,
+                                         zkp_auth::MetricsResponse* response)
+{
+    const MetricsSnapshot snapshot = metrics_snapshot();
+    for (std::size_t k = 0; k < kRpcKindCount; ++k)
+    {
+        zkp_auth::RpcMetrics* rpc = response->add_rpcs();
+        rpc->set_rpc(std::string(rpc_kind_name(static_cast<RpcKind>(k))));
+        rpc->set_errors(snapshot.errors[k]);
+        for (std::size_t p = 0; p < kRpcPhaseCount; ++p)
+        {
+            const DurationHistogram& histogram = snapshot.latency[k][p];
+            if (histogram.count == 0)
+            {
+                continue;
+            }
+            zkp_auth::PhaseLatency* phase = rpc->add_phases();
+            phase->set_phase(std::string(rpc_phase_name(static_cast<RpcPhase>(p))));
+            phase->set_count(histogram.count);
+            phase->set_sum_seconds(static_cast<double>(histogram.sum_ns) * 1e-9);
+            phase->set_p50_seconds(static_cast<double>(histogram.percentile(0.5)) * 1e-9);
+            phase->set_p99_seconds(static_cast<double>(histogram.percentile(0.99)) * 1e-9);
+            phase->set_p999_seconds(static_cast<double>(histogram.percentile(0.999)) * 1e-9);
+        }
+    }
+    const std::pair<const char*, const LockWaitCounters&> lock_waits[] = {{"user", snapshot.user_store_wait},
+                                                                          {"session", snapshot.session_store_wait}};
+    for (const auto& [store, counters] : lock_waits)
+    {
+        zkp_auth::LockWaitMetrics* lock_wait = response->add_lock_waits();
+        lock_wait->set_store(store);
+        lock_wait->set_contended(counters.contended);
+        lock_wait->set_wait_seconds(static_cast<double>(counters.wait_ns) * 1e-9);
+    }
+    response->set_users(snapshot.users);
+    response->set_sessions(snapshot.sessions);
+    response->set_verify_success(snapshot.verify_success);
+    response->set_verify_failure(snapshot.verify_failure);
+    zkp_auth::KeyTableCacheMetrics* key_tables = response->mutable_key_tables();
+    key_tables->set_hits(snapshot.key_tables.hits);
+    key_tables->set_misses(snapshot.key_tables.misses);
+    key_tables->set_builds(snapshot.key_tables.builds);
+    key_tables->set_evictions(snapshot.key_tables.evictions);
+    key_tables->set_entries(snapshot.key_tables.entries);
+    key_tables->set_bytes(snapshot.key_tables.bytes);
+    for (std::size_t r = 0; r < kRejectReasonCount; ++r)
+    {
+        zkp_auth::RejectionMetrics* rejection = response->add_rejections();
+        rejection->set_reason(std::string(reject_reason_name(static_cast<RejectReason>(r))));
+        rejection->set_count(snapshot.rejected[r]);
+    }
+    response->set_prometheus_text(to_prometheus_text(snapshot));
+    return grpc::Status::OK;
+}
+
+MetricsSnapshot AuthServiceImpl::metrics_snapshot() const
+{
+    if (shards_.empty())
+    {
+        return shard_metrics_snapshot();
+    }
+    MetricsSnapshot total;
+    for (const AuthServiceImpl* shard : shards_)
+    {
+        total += shard->shard_metrics_snapshot();
+    }
+    // ユーザーストアは共有しているため 1 回だけ数える
+    total.users = user_store_.size();
+    total.user_store_wait = user_store_.lock_wait();
+    return total;
+}
+
+MetricsSnapshot AuthServiceImpl::shard_metrics_snapshot() const
+{
+    MetricsSnapshot snapshot = metrics_.snapshot();
+    snapshot.users = user_store_.size();
+    snapshot.sessions = session_store_.size();
+    snapshot.sessions_expired = session_store_.expired_count();
+    snapshot.sessions_evicted = session_store_.evicted_count();
+    snapshot.replay_entries = replay_cache_.size() + answered_tokens_.size();
+    snapshot.user_store_wait = user_store_.lock_wait();
+    snapshot.session_store_wait = session_store_.lock_wait();
+    for (const std::unique_ptr<ZkpBackend>& zkp : backends_)
+    {
+        snapshot.key_tables += zkp->key_table_stats();
+    }
+    return snapshot;
+}
@@ -4,20 +4,123 @@
 #include <grpcpp/grpcpp.h>
 
 #include <boost/multiprecision/cpp_int.hpp>
-#include <boost/uuid/uuid.hpp>
-#include <boost/uuid/uuid_generators.hpp>
-#include <boost/uuid/uuid_io.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+#include "batch_verifier.hpp"
+#include "challenge_token.hpp"
+#include "chaum_pedersen.hpp"
+#include "rate_limiter.hpp"
+#include "replay_cache.hpp"
+#include "secure_random.hpp"
+#include "server_metrics.hpp"
+#include "session_store.hpp"
+#include "user_store.hpp"
+#include "wire_encoding.hpp"
 #include "zkp_auth.grpc.pb.h"
+#include "zkp_backend.hpp"
+#include "zkp_group.hpp"
 
 using namespace boost::multiprecision;
 using namespace zkp_auth;
 
+// AuthServiceImpl の設定
+struct AuthServiceOptions
+{
+    // VerifyAuthentication のバッチ検証の蓄積窓
+    BatchVerifierOptions batch;
+    // 新規登録を受け付ける群（登録済みユーザーは登録時の群で認証を続ける）
+    GroupId group = GroupId::kModp1024;
+    // 認証セッション（未回答のチャレンジ）の有効期限と上限
+    SessionStoreOptions sessions;
+    // 空でない場合は認証セッションを保存せず、この鍵ファイルの共有鍵で暗号化したトークンを auth_id として返す
+    // （同じ鍵を持つどのインスタンスでも回答を検証できる。有効期限は sessions.ttl、上限は適用しない）
+    std::string challenge_key_file;
+    // 非対話ログインで受け付ける証明のタイムスタンプと現在時刻のずれ（この間は同じ証明を再び受け付けない）
+    std::chrono::milliseconds proof_window{30000};
+    // 登録済みユーザーの永続化（data_dir が空の場合はメモリ上だけに保持する）
+    UserStoreOptions users;
+    // ログイン頻度の高いユーザーの公開鍵テーブルのキャッシュ（memory_bytes が 0 の場合は使わない）
+    KeyTableCacheOptions key_tables;
+    // AuthenticateStream の 1 ストリームで返信していないリクエストの上限（達すると読み取りを止める。0 の場合は 1）
+    std::size_t stream_window = 128;
+    // RegisterBatch で公開鍵の変換と検査に使うスレッド数（0 の場合はハードウェアスレッド数）
+    std::size_t registration_threads = 0;
+    // ログイン（チャレンジの発行と非対話の証明）のユーザーごと・接続元アドレスごとの受け付け制限
+    // （超えた場合は検証せずに RESOURCE_EXHAUSTED を返す。rate_per_second が 0 の場合は制限しない）
+    RateLimitOptions user_rate_limit;
+    RateLimitOptions peer_rate_limit;
+};
+
 class AuthServiceImpl final : public Auth::Service
 {
    public:
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param options サービスの設定
+     * @note  ユーザーストア、チャレンジトークンの鍵ファイルを開けない場合は std::runtime_error を投げる。
+     */
+    explicit AuthServiceImpl(const AuthServiceOptions& options = {})
+        : AuthServiceImpl(options, std::make_shared<UserStore>(options.users))
+    {
+    }
+
+    /**
+     * @fn
+     * @brief コンストラクタ。ユーザーストアを他のインスタンス（同じプロセスのシャード）と共有する。
+     * @param options サービスの設定（options.users は使わない）
+     * @param users 登録済みユーザーのストア
+     */
+    AuthServiceImpl(const AuthServiceOptions& options, std::shared_ptr<UserStore> users)
+        : users_(std::move(users)),
+          user_store_(*users_),
+          session_store_(options.sessions),
+          session_ttl_(options.sessions.ttl),
+          registration_group_(options.group),
+          proof_window_(options.proof_window),
+          stream_window_(std::max<std::size_t>(1, options.stream_window)),
+          user_limiter_(options.user_rate_limit),
+          peer_limiter_(options.peer_rate_limit),
+          registration_threads_(options.registration_threads)
+    {
+        for (std::size_t i = 0; i < kGroupCount; ++i)
+        {
+            backends_[i] = make_zkp_backend(static_cast<GroupId>(i), options.batch, options.key_tables);
+        }
+        if (!options.challenge_key_file.empty())
+        {
+            challenge_tokens_ = std::make_unique<ChallengeTokenCodec>(read_challenge_key(options.challenge_key_file));
+        }
+        registration_thread_ = std::thread([this] { registration_loop(); });
+    }
+
+    // 受け付けた RegisterBatch を処理し終えてから止める
+    ~AuthServiceImpl() override;
+
+    /**
+     * @fn
+     * @brief 同じプロセスのシャードとしてつなぐ。サーバを起動する前に全シャードで呼ぶこと。
+     * @note  発行する auth_id にシャード番号を付け、他のシャードが発行した auth_id への回答はそのシャードに渡す
+     *        （接続が張り直されて別のシャードに届いた場合）。メトリクスは全シャードの合計を返す。
+     *        ログインの受け付け制限は先頭のシャードのものを全シャードで共有する。
+     * @param index このインスタンスのシャード番号
+     * @param shards 全シャード（index 番目がこのインスタンス）
+     */
+    void set_shards(std::size_t index, std::vector<AuthServiceImpl*> shards);
+
     /**
      * @fn
      * @brief ユーザー登録を行う。
@@ -27,10 +130,50 @@ class AuthServiceImpl final : public Auth::Service
      */
     grpc::Status Register(grpc::ServerContext* context, const RegisterRequest* request,
                           RegisterResponse* response) override;
+
     /**
      * @fn
-     * @brief 認証チャレンジを生成する。
+     * @brief ユーザー登録を行う（非同期版）。ユーザーストアのログへの書き込みの確定を待たずに戻る。
+     * @note  非同期サーバのイベントループから呼ばれる。response は done が呼ばれるまで生存していること。
+     * @param done 処理結果を受け取るコールバック（ログの書き込みスレッド、または呼び出し元のスレッドで呼ばれる）
+     */
+    void RegisterAsync(const RegisterRequest* request, RegisterResponse* response,
+                       std::function<void(grpc::Status)> done);
+    /**
+     * @fn
+     * @brief 複数のユーザーをまとめて登録する。各エントリは Register と同じく検査し、失敗したエントリがあっても
+     *        他のエントリは登録する（結果はエントリごとに response に入る）。
      * @param context gRPCのサーバコンテキスト
+     * @param request 登録リクエストの列
+     * @param response エントリと同じ順の結果と、登録した件数
+     */
+    grpc::Status RegisterBatch(grpc::ServerContext* context, const RegisterBatchRequest* request,
+                               RegisterBatchResponse* response) override;
+
+    /**
+     * @fn
+     * @brief 複数のユーザーをまとめて登録する（非同期版）。処理は一括登録用のスレッドに任せ、完了を待たずに戻る。
+     * @note  一括登録用のスレッドはバッチを 1 つずつ取り出し、公開鍵の変換と検査（部分群の確認を含む）を
+     *        registration_threads 本のスレッドに分けて並列に行ってから、ユーザーストアにまとめて挿入する。
+     *        request と response は done が呼ばれるまで生存していること。
+     * @param done 処理結果を受け取るコールバック（ログの書き込みスレッド、または一括登録用のスレッドで呼ばれる）
+     */
+    void RegisterBatchAsync(const RegisterBatchRequest* request, RegisterBatchResponse* response,
+                            std::function<void(grpc::Status)> done);
+
+    /**
+     * @fn
+     * @brief 登録済みユーザーのスナップショットを作り直す（一括インポートの後など）
+     * @return 永続化しない場合、書き込みに失敗した場合は false
+     */
+    bool snapshot_users() { return user_store_.write_snapshot(); }
+
+    /**
+     * @fn
+     * @brief 認証チャレンジを生成する。
+     * @note  コミットメントが範囲外（1 < r < p でない）の場合は INVALID_ARGUMENT、受け付け制限を超えた場合は
+     *        RESOURCE_EXHAUSTED を返す（セッションは作らない）。
+     * @param context gRPCのサーバコンテキスト（nullptr の場合は接続元アドレスごとの制限をかけない）
      * @param request チャレンジリクエスト(ユーザー名、r1、r2を含む)
      * @param response チャレンジレスポンス（auth_id、c)
      */
@@ -49,52 +192,93 @@ class AuthServiceImpl final : public Auth::Service
                                       const AuthenticationAnswerRequest* request,
                                       AuthenticationAnswerResponse* response) override;
 
-   private:
     /**
      * @fn
-     * @brief バイト列をcpp_intに変換する。
-     * @param s 変換するバイト列
-     * @return 変換後のcpp_int
+     * @brief 認証回答を検証する（非同期版）。検証を検証用ワーカースレッドに依頼し、完了を待たずに戻る。
+     * @note  非同期サーバのイベントループから呼ばれる。response は done が呼ばれるまで生存していること。
+     * @param request 認証回答リクエスト（auth_id、sを含む）
+     * @param response 認証回答レスポンス（成功/失敗)
+     * @param done 処理結果を受け取るコールバック（検証用ワーカースレッド、または呼び出し元のスレッドで呼ばれる）
      */
-    cpp_int bytes_to_cpp_int(const std::string& s);
+    void VerifyAuthenticationAsync(const AuthenticationAnswerRequest* request,
+                                   AuthenticationAnswerResponse* response, std::function<void(grpc::Status)> done);
 
     /**
      * @fn
-     * @brief cpp_intをバイト列に変換する。
-     * @param n 変換するcpp_int
-     * @return 変換後のバイト列
+     * @brief 非対話の証明（Fiat-Shamir 変換）を 1 回の RPC で検証する。認証セッションは作らない。
+     * @note  範囲外の値を含む証明と、受け付け制限を超えた証明は検証しない。
+     * @param context gRPCのサーバコンテキスト
+     * @param request 証明（ユーザー名、r1、r2、s、タイムスタンプを含む）
+     * @param response 認証回答レスポンス（成功/失敗)
      */
-    std::string cpp_int_to_bytes(const cpp_int& n);
+    grpc::Status NonInteractiveAuthentication(grpc::ServerContext* context,
+                                              const NonInteractiveAuthenticationRequest* request,
+                                              AuthenticationAnswerResponse* response) override;
 
     /**
      * @fn
-     * @brief 一意な認証IDを生成する。
-     * @return 生成された認証ID
+     * @brief 非対話の証明を検証する（非同期版）。VerifyAuthenticationAsync と同じく検証用ワーカースレッドで検証する。
+     * @param context gRPCのサーバコンテキスト（接続元アドレスを参照する。nullptr の場合は接続元ごとの制限をかけない）
      */
-    std::string generate_auth_id()
-    {
-        boost::uuids::uuid uuid = boost::uuids::random_generator()();
-        return boost::uuids::to_string(uuid);
-    }
+    void NonInteractiveAuthenticationAsync(grpc::ServerContext* context,
+                                           const NonInteractiveAuthenticationRequest* request,
+                                           AuthenticationAnswerResponse* response,
+                                           std::function<void(grpc::Status)> done);
 
-    struct UserInfo
-    {
-        // registration
-        std::string name;
-        cpp_int y1;
-        cpp_int y2;
-        // // authorization
-        // cpp_int r1;
-        // cpp_int r2;
-        // // verification
-        // cpp_int c;
-        // cpp_int s;
-        // std::string session_id;
-    };
+    /**
+     * @fn
+     * @brief 1 つのストリームで多数のログインを処理する。リクエストは request_id ごとに独立に処理し、完了順に返信する。
+     * @note  読み取りは別スレッドで行い、このスレッドが返信を書き出す（検証用ワーカースレッドを書き込みで塞がない）。
+     *        返信していないリクエストが stream_window 件に達すると読み取りを止め、HTTP/2 のフロー制御で送信側を待たせる。
+     * @param context gRPCのサーバコンテキスト
+     * @param stream リクエストとレスポンスのストリーム
+     */
+    grpc::Status AuthenticateStream(grpc::ServerContext* context,
+                                    grpc::ServerReaderWriter<StreamAuthResponse, StreamAuthRequest>* stream) override;
+
+    /**
+     * @fn
+     * @brief ストリームのリクエスト 1 件を処理する（非同期版）。チャレンジはその場で、回答と非対話の証明は
+     *        単項 RPC と同じバッチ検証器で検証し、結果のステータスを詰めたレスポンスを reply に渡す。
+     * @note  request は呼び出しの間だけ参照する。
+     * @param context ストリームのサーバコンテキスト（接続元アドレスを参照する。nullptr でもよい）
+     * @param reply レスポンスを受け取るコールバック（検証用ワーカースレッド、または呼び出し元のスレッドで 1 回呼ばれる）
+     */
+    void HandleStreamRequestAsync(grpc::ServerContext* context, const StreamAuthRequest* request,
+                                  std::function<void(StreamAuthResponse)> reply);
+
+    // 1 ストリームで返信していないリクエストの上限
+    std::size_t stream_window() const { return stream_window_; }
+
+    /**
+     * @fn
+     * @brief RPC ごとの段階別の処理時間、検証結果、ユーザー数・セッション数、ストアのロック待ち、
+     *        公開鍵テーブルのキャッシュのヒット率を返す。
+     * @param context gRPCのサーバコンテキスト
+     * @param request 空のリクエスト
+     * @param response 集計値と、同じ内容の Prometheus テキスト形式
+     */
+    grpc::Status GetMetrics(grpc::ServerContext* context, const MetricsRequest* request,
+                            MetricsResponse* response) override;
+
+    /**
+     * @fn
+     * @brief 起動からの集計値に現在のユーザー数などを加えて返す（シャードの場合は全シャードの合計）
+     */
+    MetricsSnapshot metrics_snapshot() const;
+
+   private:
+    /**
+     * @fn
+     * @brief 一意な認証IDを生成する（スレッドごとの SecureRandom から作る UUID）。
+     * @return 生成された認証ID
+     */
+    std::string generate_auth_id() { return random_uuid(); }
 
     struct AuthSession
     {
         std::string user;
+        GroupId group = GroupId::kModp1024;
         // authorization
         cpp_int r1;
         cpp_int r2;
@@ -102,40 +286,167 @@ class AuthServiceImpl final : public Auth::Service
         cpp_int c;
     };
 
-    // 複数リクエストからの同時アクセス保護のためのユーザーストア
-    struct UserStore
+    // セッションとユーザー情報から組み立てた、検証待ちの認証回答
+    struct PendingVerification
     {
-        std::mutex mutex;
-        std::unordered_map<std::string, UserInfo> user_info;
-
-        // RAIIパターンで例外発生時も必ずロックを解放する
-        template <typename Func>
-        auto access(Func f)
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            return f(user_info);
-        }
+        std::string auth_id;
+        std::string user;
+        GroupId group = GroupId::kModp1024;
+        Commitment commitment;
+        PublicKeys public_keys;
+        Challenge challenge;
+        Response response;
+        // 非対話の証明の場合: 検証に成功したら replay_expires_at_ms まで同じ証明を受け付けない
+        std::string replay_key;
+        std::int64_t replay_expires_at_ms = 0;
+        // RPC の処理時間（finish_verification で記録する）
+        RpcTimer timer;
     };
 
-    struct SessionStore
-    {
-        std::mutex mutex;
-        std::unordered_map<std::string, AuthSession> sessions;
+    /**
+     * @fn
+     * @brief 登録リクエストを検査し、登録するユーザー情報を組み立てる
+     * @return 群が登録を受け付けていない、公開鍵が位数 q の部分群の要素でない場合はエラー
+     */
+    grpc::Status prepare_registration(const RegisterRequest& request, UserInfo& user_info, RpcTimer& timer);
 
-        template <typename Func>
-        auto access(Func f)
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-            return f(sessions);
-        }
-    };
+    /**
+     * @fn
+     * @brief RegisterBatch の本体（一括登録用のスレッドで実行する）
+     */
+    void register_batch(const RegisterBatchRequest& request, RegisterBatchResponse* response,
+                        std::function<void(grpc::Status)> done);
+
+    // 一括登録用のスレッド
+    void registration_loop();
+
+    /**
+     * @fn
+     * @brief CreateAuthenticationChallenge の本体（段階ごとの処理時間を timer に記録する）
+     * @param peer 接続元アドレス（空の場合は接続元ごとの制限をかけない）
+     */
+    grpc::Status create_challenge(std::string_view peer, const AuthenticationChallengeRequest& request,
+                                  AuthenticationChallengeResponse* response, RpcTimer& timer);
+
+    /**
+     * @fn
+     * @brief ログインを受け付けるか、接続元アドレスとユーザーのトークンバケットで判定する
+     * @return 超えた場合は RESOURCE_EXHAUSTED（理由をメトリクスに記録する）
+     */
+    grpc::Status admit_login(std::string_view peer, const std::string& user);
+
+    // auth_id のシャード番号の区切り（UUID・期限・base64url のいずれにも現れない文字）
+    static constexpr char kShardSeparator = ':';
+
+    /**
+     * @fn
+     * @brief auth_id の先頭に付いたシャード番号を返す
+     * @return 番号が付いていない、数値でない場合は std::nullopt
+     */
+    static std::optional<std::size_t> shard_prefix(const std::string& auth_id);
+
+    // 全シャードで共有する状態（受け付け制限と再送の記録）を持つインスタンス（シャードでない場合は this）
+    AuthServiceImpl& shared_state() { return shards_.empty() ? *this : *shards_.front(); }
+
+    // このシャードだけの集計値と現在値
+    MetricsSnapshot shard_metrics_snapshot() const;
+
+    /**
+     * @fn
+     * @brief auth_id を発行したシャードを返す
+     * @return シャードでない場合、シャード番号が付いていない・範囲外の場合は this
+     */
+    AuthServiceImpl& session_owner(const std::string& auth_id);
+
+    /**
+     * @fn
+     * @brief 認証セッションを発行し、auth_id を返す（トークンを使う場合はセッションを封じたトークン）
+     */
+    std::string issue_session(AuthSession session);
+
+    /**
+     * @fn
+     * @brief auth_id の認証セッションを取り出す。同じ auth_id で取り出せるのは 1 回だけ。
+     * @note  トークンを使う場合は、開けないトークン、auth_id のシャード番号がトークンに封じた番号と異なるトークン、
+     *        このインスタンス（シャードでは同じプロセスのいずれかのシャード）で回答済みのトークンを kNotFound とする。
+     */
+    SessionLookup take_session(const std::string& auth_id, AuthSession& session);
+
+    /**
+     * @fn
+     * @brief 認証回答に対応するセッションを取り出してユーザーを取得し、検証する証明を組み立てる
+     * @return セッションまたはユーザーが見つからない場合はエラー
+     */
+    grpc::Status prepare_verification(const AuthenticationAnswerRequest& request, PendingVerification& pending);
+
+    /**
+     * @fn
+     * @brief 非対話の証明のタイムスタンプを確認してユーザーを取得し、チャレンジを導出して検証する証明を組み立てる
+     * @return タイムスタンプが範囲外、ユーザーが見つからない、形式に合わない、受け付け制限を超えた場合はエラー
+     */
+    grpc::Status prepare_verification(std::string_view peer, const NonInteractiveAuthenticationRequest& request,
+                                      PendingVerification& pending);
+
+    /**
+     * @fn
+     * @brief 組み立てた証明を検証用ワーカースレッドで検証し、完了時に done を呼ぶ
+     */
+    void submit_verification(std::shared_ptr<PendingVerification> pending, AuthenticationAnswerResponse* response,
+                             std::function<void(grpc::Status)> done);
+
+    /**
+     * @fn
+     * @brief 検証結果に応じてレスポンスを組み立てる（非対話の証明は再利用されていないことも確認する）
+     *        RPC の処理時間と検証結果を記録する。
+     */
+    grpc::Status finish_verification(PendingVerification& pending, bool is_verified,
+                                     AuthenticationAnswerResponse* response);
+
+    // 各ストアの操作はシャード 1 つのロックだけを取る。ストアをまたいでロックを保持しないこと。
+    // ユーザー名 -> ユーザー情報。起動時にスナップショットとログから復元する（同じプロセスのシャードで共有する）。
+    std::shared_ptr<UserStore> users_;
+    UserStore& user_store_;
+    // auth_id -> 認証セッション。有効期限切れと上限超過のセッションはストアが回収する。
+    SessionStore<AuthSession> session_store_;
+    const std::chrono::milliseconds session_ttl_;
+    // チャレンジトークンを使う場合（nullptr でない場合）は session_store_ を使わず、回答を受け付けたトークンの
+    // ノンスを期限まで answered_tokens_ に記録する（シャードでは shards_ の先頭のものを使う）
+    std::unique_ptr<ChallengeTokenCodec> challenge_tokens_;
+    ReplayCache<> answered_tokens_;
+
+    // 同じプロセスのシャード（空の場合はシャードに分けていない）とこのインスタンスの番号
+    std::vector<AuthServiceImpl*> shards_;
+    std::size_t shard_index_ = 0;
+
+    // 新規登録を受け付ける群
+    const GroupId registration_group_;
+
+    // 非対話ログインの証明のタイムスタンプの許容範囲と、検証済みの証明の記録（シャードでは shards_ の先頭のものを使う）
+    const std::chrono::milliseconds proof_window_;
+    ReplayCache<> replay_cache_;
+
+    const std::size_t stream_window_;
+
+    // ログインのユーザーごと・接続元アドレスごとの受け付け制限（シャードでは shards_ の先頭のものを使う）
+    RateLimiter user_limiter_;
+    RateLimiter peer_limiter_;
+
+    // RPC ごとの段階別の処理時間と検証結果
+    ServerMetrics metrics_;
+
+    // 群ごとの検証器（GroupId の値で添字付けする）。各々がプロセス共通の群コンテキストとバッチ検証器、
+    // 公開鍵テーブルのキャッシュを持つ。
+    std::array<std::unique_ptr<ZkpBackend>, kGroupCount> backends_;
 
-    // NOTE: 実際のgRPCでは、std::mutex + std::unordered_mapではなく、
-    // tbb::concurrent_hash_mapを使ったほうが良い。
-    // ロック粒度が細かく（コンテナ内部で並列化される）、パフォーマンス面でスレッドが増えてもロック競合が起きにくい。
+    ZkpBackend& backend(GroupId id) { return *backends_[static_cast<std::size_t>(id)]; }
 
-    UserStore user_store_;
-    SessionStore session_store_;
+    // RegisterBatch を受け付けた順に 1 つずつ処理する（各バッチが検査を全スレッドに分けるため、同時には処理しない）
+    const std::size_t registration_threads_;
+    std::mutex registration_mutex_;
+    std::condition_variable registration_cv_;
+    std::deque<std::function<void()>> registration_jobs_;
+    bool stopping_ = false;
+    std::thread registration_thread_;
 };
 
 #endif  // AUTH_SERVICE_IMPL_HPP
\ No newline at end of file
@@ -0,0 +1,256 @@
+#ifndef BATCH_VERIFIER_HPP
+#define BATCH_VERIFIER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// バッチ検証の蓄積窓の設定
+struct BatchVerifierOptions
+{
+    // 1 回のバッチ検証でまとめる最大件数（1 以下ならバッチ化せず呼び出し元で直接検証する）。
+    // CP::batching_pays_off() が false の群（SIMD カーネルが AVX-512 IFMA でない Z_p^*）でもバッチ化しない
+    std::size_t max_batch_size = 32;
+    // 最初の要求が到着してからバッチを締め切るまでの最大待ち時間（バッチ化しない場合は待たない）
+    std::chrono::microseconds max_wait{200};
+    // 検証を行うワーカースレッド数（0 の場合はハードウェアスレッド数）
+    std::size_t worker_threads = 0;
+    // submit で受け付ける未処理の検証要求の上限（0 の場合は上限なし）
+    std::size_t max_pending = 1024;
+};
+
+/**
+ * @brief 複数スレッドから届く検証要求を短い蓄積窓でまとめ、ChaumPedersen::verify_batch で検証する
+ * @note  max_batch_size 件たまるか、最古の要求が max_wait を超えて待った時点でバッチを締め切る。
+ *        まとめても速くならない群（CP::batching_pays_off() が false）では蓄積窓を使わず、
+ *        verify は呼び出し元で、submit はワーカーで 1 件ずつすぐに検証する。
+ *        蓄積窓を広げるほどスループットは上がるが、1 件あたりの待ち時間は最大 max_wait 増える。
+ *        ワーカースレッドは検証専用のスレッドプールを兼ねる。submit を使えば呼び出し元は検証を待たずに戻れる。
+ * @tparam CP BasicChaumPedersen のインスタンス型
+ */
+template <typename CP>
+class BatchVerifier
+{
+   public:
+    using Proof = typename CP::Proof;
+
+    /**
+     * @fn
+     * @brief コンストラクタ。ワーカースレッドを起動する。
+     * @param cp 検証に使用する ChaumPedersen（BatchVerifier より長く生存すること）
+     * @param options 蓄積窓の設定
+     */
+    BatchVerifier(const CP& cp, const BatchVerifierOptions& options) : cp_(cp), options_(options)
+    {
+        std::size_t threads = options_.worker_threads;
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~BatchVerifier()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    BatchVerifier(const BatchVerifier&) = delete;
+    BatchVerifier& operator=(const BatchVerifier&) = delete;
+
+    /**
+     * @fn
+     * @brief 証明を検証する。バッチが締め切られて検証が終わるまでブロックする。
+     * @param proof 検証する証明
+     * @return 検証結果 (true: 成功, false: 失敗)
+     */
+    bool verify(Proof proof)
+    {
+        if (!batching_enabled())
+        {
+            return cp_.verify_proof(proof);
+        }
+
+        std::future<bool> result;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Pending& pending = enqueue(std::move(proof));
+            result = pending.result.get_future();
+        }
+        notify_workers();
+        return result.get();
+    }
+
+    /**
+     * @fn
+     * @brief 証明の検証をワーカースレッドに依頼し、検証を待たずに戻る
+     * @note  done はワーカースレッド上で呼ばれるため、重い処理やブロックする処理を行わないこと。
+     *        検証中に例外が発生した場合は検証失敗として done(false) を呼ぶ。
+     * @param proof 検証する証明
+     * @param done 検証結果を受け取るコールバック
+     * @return 受け付けた場合は true。未処理の要求が max_pending に達している場合は false（done は呼ばれない）。
+     */
+    bool submit(Proof proof, std::function<void(bool)> done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (options_.max_pending != 0 && queue_.size() >= options_.max_pending)
+            {
+                return false;
+            }
+            Pending& pending = enqueue(std::move(proof));
+            pending.done = std::move(done);
+        }
+        notify_workers();
+        return true;
+    }
+
+    const BatchVerifierOptions& options() const { return options_; }
+
+   private:
+    struct Pending
+    {
+        Proof proof;
+        // done が空の場合は result で呼び出し元に結果を返す
+        std::function<void(bool)> done;
+        std::promise<bool> result;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    const CP& cp_;
+    const BatchVerifierOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Pending> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    // カーネルは実行中に切り替えられる（set_simd_kernel）ため、呼び出しごとに確認する
+    bool batching_enabled() const { return options_.max_batch_size > 1 && cp_.batching_pays_off(); }
+
+    // mutex_ を保持した状態で呼ぶこと
+    Pending& enqueue(Proof proof)
+    {
+        Pending& pending = queue_.emplace_back();
+        pending.proof = std::move(proof);
+        pending.enqueued = std::chrono::steady_clock::now();
+        return pending;
+    }
+
+    void notify_workers()
+    {
+        bool full = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            full = queue_.size() >= batch_limit();
+        }
+        if (full)
+        {
+            cv_.notify_all();
+        }
+        else
+        {
+            cv_.notify_one();
+        }
+    }
+
+    // バッチ化が無効の場合も submit された要求は 1 件ずつ、蓄積窓を待たずにワーカーで検証する
+    std::size_t batch_limit() const { return batching_enabled() ? options_.max_batch_size : 1; }
+
+    void worker_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                return;  // stopping_
+            }
+
+            // 蓄積窓: バッチが満杯になるか、最古の要求の待ち時間が max_wait に達するまで待つ
+            const auto deadline = queue_.front().enqueued + options_.max_wait;
+            cv_.wait_until(lock, deadline, [this] { return stopping_ || queue_.size() >= batch_limit(); });
+            if (queue_.empty())
+            {
+                continue;  // 他のワーカーが先に取り出した
+            }
+
+            const std::size_t n = std::min(queue_.size(), batch_limit());
+            std::vector<Pending> batch;
+            batch.reserve(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+
+            lock.unlock();
+            run_batch(batch);
+            lock.lock();
+        }
+    }
+
+    void run_batch(std::vector<Pending>& batch)
+    {
+        std::vector<bool> results;
+        try
+        {
+            std::vector<Proof> proofs;
+            proofs.reserve(batch.size());
+            for (Pending& pending : batch)
+            {
+                proofs.push_back(std::move(pending.proof));
+            }
+            results = cp_.verify_batch(proofs);
+        }
+        catch (...)
+        {
+            for (Pending& pending : batch)
+            {
+                if (pending.done)
+                {
+                    pending.done(false);
+                }
+                else
+                {
+                    pending.result.set_exception(std::current_exception());
+                }
+            }
+            return;
+        }
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (batch[i].done)
+            {
+                batch[i].done(results[i]);
+            }
+            else
+            {
+                batch[i].result.set_value(results[i]);
+            }
+        }
+    }
+};
+
+#endif  // BATCH_VERIFIER_HPP
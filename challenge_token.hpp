@@ -0,0 +1,340 @@
+#ifndef CHALLENGE_TOKEN_HPP
+#define CHALLENGE_TOKEN_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "secure_random.hpp"
+#include "sha256.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_group.hpp"
+
+using namespace boost::multiprecision;
+
+// チャレンジトークンに封じる認証セッションの内容
+struct ChallengeClaims
+{
+    std::string user;
+    GroupId group = GroupId::kModp1024;
+    cpp_int r1;
+    cpp_int r2;
+    cpp_int c;
+    // 回答を受け付ける期限（UNIX 時刻のミリ秒）
+    std::int64_t expires_at_ms = 0;
+    // 発行したシャードの番号（シャードに分けていない場合は std::nullopt）。auth_id に付ける番号と照合する
+    std::optional<std::uint32_t> shard;
+};
+
+/**
+ * @brief 認証セッションをサーバに保存せず、暗号化・認証したトークン（auth_id）としてクライアントに持たせる
+ * @note  同じ鍵を持つサーバであれば、どのインスタンスが発行したトークンでも開ける。形式は
+ *        「版 (1) | ノンス (12) | 暗号文 | タグ (16)」を base64url（パディングなし）にしたもの。
+ *        共有鍵から HMAC-SHA256 で暗号化用と認証用の鍵を導出し、ChaCha20（RFC 8439、カウンタ 1 から）で暗号化してから
+ *        版・ノンス・暗号文の HMAC-SHA256 の先頭 16 バイトをタグとして付ける（encrypt-then-MAC）。
+ *        ノンスはトークンごとに SecureRandom から 96 ビットを引く。トークン自体は何度でも開けるため、
+ *        1 回だけ受け付けるには呼び出し側で nonce を記録すること。seal / open はスレッドセーフ。
+ */
+class ChallengeTokenCodec
+{
+   public:
+    static constexpr std::size_t kMinKeyBytes = 32;
+    static constexpr std::size_t kNonceBytes = 12;
+    static constexpr std::size_t kTagBytes = 16;
+
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param key 全インスタンスで共有する鍵（kMinKeyBytes バイト以上。短い場合は std::invalid_argument を投げる）
+     */
+    explicit ChallengeTokenCodec(std::string_view key) : mac_(derive_key(key, "zkp challenge token mac"))
+    {
+        const std::string cipher_key = derive_key(key, "zkp challenge token cipher");
+        for (std::size_t i = 0; i < cipher_key_.size(); ++i)
+        {
+            cipher_key_[i] = load_le32(cipher_key.data() + 4 * i);
+        }
+    }
+
+    /**
+     * @fn
+     * @brief セッションの内容を暗号化してトークンにする
+     */
+    std::string seal(const ChallengeClaims& claims) const
+    {
+        std::string token(1, static_cast<char>(kVersion));
+        std::array<char, kNonceBytes> nonce;
+        SecureRandom::local().fill(nonce.data(), nonce.size());
+        token.append(nonce.data(), nonce.size());
+        token += serialize(claims);
+        apply_keystream(nonce.data(), token.data() + kHeaderBytes, token.size() - kHeaderBytes);
+        const Sha256::Digest tag = mac_.mac(token);
+        token.append(reinterpret_cast<const char*>(tag.data()), kTagBytes);
+        return encode_base64url(token);
+    }
+
+    /**
+     * @fn
+     * @brief トークンを検証して復号する（期限は確認しない）
+     * @param token seal が返したトークン
+     * @param nonce トークンのノンス（トークンごとに一意。1 回だけ受け付ける場合の記録に使う）
+     * @return 形式に合わない、別の鍵で作られた、改ざんされた場合は std::nullopt
+     */
+    std::optional<ChallengeClaims> open(std::string_view token, std::string* nonce = nullptr) const
+    {
+        std::optional<std::string> bytes = decode_base64url(token);
+        if (!bytes || bytes->size() < kHeaderBytes + kTagBytes || static_cast<std::uint8_t>((*bytes)[0]) != kVersion)
+        {
+            return std::nullopt;
+        }
+        const std::size_t body = bytes->size() - kTagBytes;
+        const Sha256::Digest tag = mac_.mac(std::string_view(*bytes).substr(0, body));
+        // タグは定数時間で比較する
+        std::uint8_t diff = 0;
+        for (std::size_t i = 0; i < kTagBytes; ++i)
+        {
+            diff |= static_cast<std::uint8_t>(tag[i] ^ static_cast<std::uint8_t>((*bytes)[body + i]));
+        }
+        if (diff != 0)
+        {
+            return std::nullopt;
+        }
+        apply_keystream(bytes->data() + 1, bytes->data() + kHeaderBytes, body - kHeaderBytes);
+        const std::string_view plaintext = std::string_view(*bytes).substr(kHeaderBytes, body - kHeaderBytes);
+        std::optional<ChallengeClaims> claims = deserialize(plaintext);
+        if (claims && nonce)
+        {
+            nonce->assign(bytes->data() + 1, kNonceBytes);
+        }
+        return claims;
+    }
+
+   private:
+    static constexpr std::uint8_t kVersion = 2;
+    static constexpr std::size_t kHeaderBytes = 1 + kNonceBytes;
+
+    HmacSha256 mac_;
+    std::array<std::uint32_t, 8> cipher_key_{};
+
+    static std::string derive_key(std::string_view key, std::string_view label)
+    {
+        if (key.size() < kMinKeyBytes)
+        {
+            throw std::invalid_argument("challenge token key must be at least 32 bytes");
+        }
+        const Sha256::Digest digest = HmacSha256(key).mac(label);
+        return std::string(digest.begin(), digest.end());
+    }
+
+    static std::uint32_t load_le32(const char* p)
+    {
+        const auto* b = reinterpret_cast<const unsigned char*>(p);
+        return static_cast<std::uint32_t>(b[0]) | (static_cast<std::uint32_t>(b[1]) << 8) |
+               (static_cast<std::uint32_t>(b[2]) << 16) | (static_cast<std::uint32_t>(b[3]) << 24);
+    }
+
+    // data を ChaCha20 のキーストリームと排他的論理和する（暗号化と復号は同じ操作）
+    void apply_keystream(const char* nonce, char* data, std::size_t size) const
+    {
+        std::array<std::uint32_t, 16> state = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+        std::copy(cipher_key_.begin(), cipher_key_.end(), state.begin() + 4);
+        state[12] = 1;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            state[13 + i] = load_le32(nonce + 4 * i);
+        }
+        std::array<unsigned char, SecureRandom::kBlockBytes> block;
+        for (std::size_t offset = 0; offset < size; offset += block.size(), ++state[12])
+        {
+            SecureRandom::chacha20_block(state, block.data());
+            for (std::size_t i = 0; i < block.size() && offset + i < size; ++i)
+            {
+                data[offset + i] = static_cast<char>(data[offset + i] ^ block[i]);
+            }
+        }
+        block.fill(0);
+    }
+
+    // 期限 (8) | 群 (1) | シャード (4、番号 + 1。なしは 0) | ユーザー名・r1・r2・c をそれぞれ 2 バイトの長さと
+    // ビッグエンディアンの値で並べる
+    static std::string serialize(const ChallengeClaims& claims)
+    {
+        std::string out;
+        const auto put = [&out](std::uint64_t value, std::size_t bytes)
+        {
+            for (std::size_t i = bytes; i-- > 0;)
+            {
+                out.push_back(static_cast<char>(value >> (8 * i)));
+            }
+        };
+        const auto put_field = [&](std::string_view field)
+        {
+            put(field.size(), 2);
+            out.append(field);
+        };
+        put(static_cast<std::uint64_t>(claims.expires_at_ms), 8);
+        put(static_cast<std::uint64_t>(claims.group), 1);
+        put(claims.shard ? std::uint64_t{*claims.shard} + 1 : 0, 4);
+        put_field(claims.user);
+        for (const cpp_int* value : {&claims.r1, &claims.r2, &claims.c})
+        {
+            put_field(encode_fixed(*value, byte_length(*value)));
+        }
+        return out;
+    }
+
+    static std::optional<ChallengeClaims> deserialize(std::string_view in)
+    {
+        const auto get = [&in](std::size_t bytes) -> std::optional<std::uint64_t>
+        {
+            if (in.size() < bytes)
+            {
+                return std::nullopt;
+            }
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                value = (value << 8) | static_cast<std::uint8_t>(in[i]);
+            }
+            in.remove_prefix(bytes);
+            return value;
+        };
+        const auto get_field = [&]() -> std::optional<std::string_view>
+        {
+            const std::optional<std::uint64_t> size = get(2);
+            if (!size || in.size() < *size)
+            {
+                return std::nullopt;
+            }
+            const std::string_view field = in.substr(0, *size);
+            in.remove_prefix(*size);
+            return field;
+        };
+
+        ChallengeClaims claims;
+        const std::optional<std::uint64_t> expires_at_ms = get(8);
+        const std::optional<std::uint64_t> group = get(1);
+        const std::optional<std::uint64_t> shard = get(4);
+        const std::optional<std::string_view> user = get_field();
+        if (!expires_at_ms || !group || *group >= kGroupCount || !shard || !user)
+        {
+            return std::nullopt;
+        }
+        claims.expires_at_ms = static_cast<std::int64_t>(*expires_at_ms);
+        claims.group = static_cast<GroupId>(*group);
+        if (*shard != 0)
+        {
+            claims.shard = static_cast<std::uint32_t>(*shard - 1);
+        }
+        claims.user = std::string(*user);
+        for (cpp_int* value : {&claims.r1, &claims.r2, &claims.c})
+        {
+            const std::optional<std::string_view> field = get_field();
+            if (!field)
+            {
+                return std::nullopt;
+            }
+            *value = field->empty() ? cpp_int(0) : *decode_fixed(*field, field->size());
+        }
+        if (!in.empty())
+        {
+            return std::nullopt;
+        }
+        return claims;
+    }
+
+    static constexpr char kBase64Url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    static std::string encode_base64url(std::string_view bytes)
+    {
+        std::string out;
+        out.reserve((bytes.size() * 4 + 2) / 3);
+        std::uint32_t bits = 0;
+        int count = 0;
+        for (const char b : bytes)
+        {
+            bits = (bits << 8) | static_cast<std::uint8_t>(b);
+            count += 8;
+            while (count >= 6)
+            {
+                count -= 6;
+                out.push_back(kBase64Url[(bits >> count) & 0x3F]);
+            }
+        }
+        if (count > 0)
+        {
+            out.push_back(kBase64Url[(bits << (6 - count)) & 0x3F]);
+        }
+        return out;
+    }
+
+    static std::optional<std::string> decode_base64url(std::string_view text)
+    {
+        std::string out;
+        out.reserve(text.size() * 3 / 4);
+        std::uint32_t bits = 0;
+        int count = 0;
+        for (const char ch : text)
+        {
+            const char* pos = std::strchr(kBase64Url, ch);
+            if (ch == '\0' || pos == nullptr)
+            {
+                return std::nullopt;
+            }
+            bits = (bits << 6) | static_cast<std::uint32_t>(pos - kBase64Url);
+            count += 6;
+            if (count >= 8)
+            {
+                count -= 8;
+                out.push_back(static_cast<char>(bits >> count));
+            }
+        }
+        // 余りのビットは 0 でなければならない（同じバイト列に別のトークン文字列を作れないようにする）
+        if (count >= 6 || (bits & ((1u << count) - 1)) != 0)
+        {
+            return std::nullopt;
+        }
+        return out;
+    }
+};
+
+/**
+ * @fn
+ * @brief チャレンジトークンの共有鍵をファイルから読む
+ * @note  ファイルには 16 進数（空白・改行は無視する）で kMinKeyBytes バイト以上を書く（例: openssl rand -hex 32）。
+ *        読めない、形式に合わない、短い場合は std::runtime_error を投げる。
+ */
+inline std::string read_challenge_key(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open challenge key file " + path);
+    }
+    std::string hex;
+    for (auto it = std::istreambuf_iterator<char>(file); it != std::istreambuf_iterator<char>(); ++it)
+    {
+        if (!std::isspace(static_cast<unsigned char>(*it)))
+        {
+            hex.push_back(*it);
+        }
+    }
+    const std::optional<cpp_int> value = hex.size() % 2 == 0 ? decode_hex(hex) : std::nullopt;
+    if (!value || hex.size() / 2 < ChallengeTokenCodec::kMinKeyBytes)
+    {
+        throw std::runtime_error("challenge key file " + path + " must hold at least 32 bytes in hex");
+    }
+    return encode_fixed(*value, hex.size() / 2);
+}
+
+#endif  // CHALLENGE_TOKEN_HPP
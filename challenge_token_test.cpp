@@ -0,0 +1,99 @@
+#include "challenge_token.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+const std::string kKey(32, 'k');
+
+ChallengeClaims make_claims()
+{
+    return {.user = "alice",
+            .group = GroupId::kP256,
+            .r1 = (cpp_int(1) << 1000) + 7,
+            .r2 = 12345,
+            .c = 0,
+            .expires_at_ms = 1700000030000,
+            .shard = 3};
+}
+}  // namespace
+
+TEST(ChallengeTokenTest, ReplicaWithSameKeyOpensToken)
+{
+    const ChallengeTokenCodec issuer(kKey);
+    const ChallengeTokenCodec replica(kKey);
+    const ChallengeClaims claims = make_claims();
+    const std::string token = issuer.seal(claims);
+    // gRPC の string フィールドにそのまま入る文字だけを使う
+    EXPECT_EQ(token.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"),
+              std::string::npos);
+    // 平文のユーザー名は現れない
+    EXPECT_EQ(token.find("alice"), std::string::npos);
+
+    std::string nonce;
+    const std::optional<ChallengeClaims> opened = replica.open(token, &nonce);
+    ASSERT_TRUE(opened);
+    EXPECT_EQ(opened->user, claims.user);
+    EXPECT_EQ(opened->group, claims.group);
+    EXPECT_EQ(opened->r1, claims.r1);
+    EXPECT_EQ(opened->r2, claims.r2);
+    EXPECT_EQ(opened->c, claims.c);
+    EXPECT_EQ(opened->expires_at_ms, claims.expires_at_ms);
+    EXPECT_EQ(opened->shard, claims.shard);
+    EXPECT_EQ(nonce.size(), ChallengeTokenCodec::kNonceBytes);
+
+    // 同じ内容でもトークンごとにノンスが異なる
+    std::string other_nonce;
+    const std::string other = issuer.seal(claims);
+    EXPECT_NE(other, token);
+    ASSERT_TRUE(replica.open(other, &other_nonce));
+    EXPECT_NE(other_nonce, nonce);
+
+    // シャードに分けていないインスタンスのトークン
+    ChallengeClaims unsharded = claims;
+    unsharded.shard.reset();
+    const std::optional<ChallengeClaims> opened_unsharded = replica.open(issuer.seal(unsharded));
+    ASSERT_TRUE(opened_unsharded);
+    EXPECT_FALSE(opened_unsharded->shard);
+}
+
+TEST(ChallengeTokenTest, RejectsTamperedTruncatedAndForeignTokens)
+{
+    const ChallengeTokenCodec codec(kKey);
+    const std::string token = codec.seal(make_claims());
+    for (std::size_t i = 0; i < token.size(); ++i)
+    {
+        std::string tampered = token;
+        tampered[i] = tampered[i] == 'A' ? 'B' : 'A';
+        EXPECT_FALSE(codec.open(tampered)) << i;
+    }
+    EXPECT_FALSE(codec.open(token.substr(0, token.size() - 1)));
+    EXPECT_FALSE(codec.open(token + "A"));
+    EXPECT_FALSE(codec.open(""));
+    EXPECT_FALSE(codec.open("not a token"));
+    EXPECT_FALSE(ChallengeTokenCodec(std::string(32, 'x')).open(token));
+
+    EXPECT_THROW(ChallengeTokenCodec(std::string(31, 'k')), std::invalid_argument);
+}
+
+TEST(ChallengeTokenTest, ReadsHexKeyFile)
+{
+    const std::string path = testing::TempDir() + "challenge_token_test.key";
+    std::ofstream(path) << "000102030405060708090a0b0c0d0e0f\n101112131415161718191a1b1c1d1e1f\n";
+    const std::string key = read_challenge_key(path);
+    ASSERT_EQ(key.size(), 32u);
+    EXPECT_EQ(key[0], '\x00');
+    EXPECT_EQ(key[31], '\x1f');
+
+    std::ofstream(path) << "0001020304";
+    EXPECT_THROW(read_challenge_key(path), std::runtime_error);
+    std::ofstream(path) << std::string(64, 'z');
+    EXPECT_THROW(read_challenge_key(path), std::runtime_error);
+    std::remove(path.c_str());
+    EXPECT_THROW(read_challenge_key(path), std::runtime_error);
+}
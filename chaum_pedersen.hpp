@@ -1,24 +1,42 @@
+#ifndef CHAUM_PEDERSEN_HPP
+#define CHAUM_PEDERSEN_HPP
+
 #include <boost/multiprecision/cpp_int.hpp>
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/uniform_int_distribution.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
+
+#include "modp_group.hpp"
+#include "secure_random.hpp"
+#include "sha256.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_group.hpp"
 
 using namespace boost::multiprecision;
 
 //  証明者と検証者の間で交換される公開鍵
-struct PublicKeys
+template <typename Element>
+struct BasicPublicKeys
 {
-    cpp_int y1;
-    cpp_int y2;
+    Element y1;
+    Element y2;
 };
 
 // 証明者が生成するコミットメント
-struct Commitment
+template <typename Element>
+struct BasicCommitment
 {
-    cpp_int r1;
-    cpp_int r2;
+    Element r1;
+    Element r2;
 };
 
+using PublicKeys = BasicPublicKeys<cpp_int>;
+using Commitment = BasicCommitment<cpp_int>;
+
 // 検証者が生成するチャレンジ
 struct Challenge
 {
@@ -34,22 +52,71 @@ struct Response
 /**
  * @fn
  * @brief 1 から upper_bound - 1 までの範囲で乱数を生成する
+ * @note  スレッドごとの ChaCha20 生成器（SecureRandom）から棄却法で一様に選ぶ。ロックも OS の呼び出しもない。
  * @param upper_bound 乱数生成の上限
  * @return 生成された乱数
  */
-cpp_int generate_random(const cpp_int& upper_bound)
+inline cpp_int generate_random(const cpp_int& upper_bound)
 {
-    // 現在時刻をシードとして使い、メルセンヌ・ツイスター乱数生成器を初期化する
-    static boost::random::mt19937 gen{static_cast<std::uint32_t>(std::time(nullptr))};
-    boost::random::uniform_int_distribution<cpp_int> dist(1, upper_bound - 1);
-    return dist(gen);
+    return SecureRandom::local().uniform_below(upper_bound - 1) + 1;
 }
 
-class ChaumPedersen
+/**
+ * @brief Chaum-Pedersen プロトコル
+ * @tparam Group 群ポリシー。以下を提供すること。
+ *         - Element: 群の要素の表現
+ *         - order(): 位数 q
+ *         - pow_g(e), pow_h(e): g^e, h^e
+ *         - mul_pow_g(s, y, c), mul_pow_h(s, y, c): g^s * y^c, h^s * y^c
+ *           （y の代わりに y の固定基底テーブル Table を受け取る多重定義も）
+ *         - make_table(base, window_bits): base の固定基底テーブル（shared_ptr<const Table>）
+ *         - multi_pow(terms, eg, eh): Π base_i^e_i * g^eg * h^eh（Term は {base, exponent}）
+ *         - pow_many(terms, fixed_terms, count, results), pow_lanes(): 独立したべき乗をまとめて計算する（SIMD カーネル）と、
+ *           同時に計算する数（1 の場合は使わない）。fixed_terms は g_table(), h_table() を基底とする項（FixedTerm）
+ *         - equal(a, b): 要素の比較
+ *         - kPrimeOrder: 全ての要素が位数 q の部分群に属するか（false の場合 verify_batch はまとめて検証しない）
+ */
+template <typename Group>
+class BasicChaumPedersen
 {
    public:
-    // 公開パラメータ
-    const cpp_int p, q, g, h;
+    using Element = typename Group::Element;
+    using PublicKeys = BasicPublicKeys<Element>;
+    using Commitment = BasicCommitment<Element>;
+    using Table = typename Group::Table;
+    using Term = typename Group::Term;
+    using FixedTerm = typename Group::FixedTerm;
+
+    // Fiat-Shamir 変換のトランスクリプトの先頭に入れるドメイン分離タグ
+    static constexpr std::string_view kFiatShamirTag = "zkp-chaum-pedersen/fiat-shamir/v1";
+
+    // 公開鍵 y1, y2 の固定基底テーブル。同じユーザーの検証を繰り返す場合に y1^c, y2^c をテーブル参照にする。
+    struct PublicKeyTables
+    {
+        std::shared_ptr<const Table> y1;
+        std::shared_ptr<const Table> y2;
+
+        // テーブルのエントリが使うバイト数
+        std::size_t memory_bytes() const { return (y1->size() + y2->size()) * sizeof(Element); }
+    };
+
+    // バッチ検証に渡す 1 件分の証明
+    struct Proof
+    {
+        Commitment commitment;
+        PublicKeys public_keys;
+        Challenge challenge;
+        Response response;
+        // public_keys のテーブル（ある場合はバッチにまとめず、テーブルを使って 1 件で検証する）
+        std::shared_ptr<const PublicKeyTables> key_tables{};
+    };
+
+    /**
+     * @fn
+     * @brief コンストラクタ。群のパラメータ（と固定基底テーブル）を共有する。
+     * @param group 群コンテキスト
+     */
+    explicit BasicChaumPedersen(Group group) : group_(std::move(group)) {}
 
     /**
      * @fn
@@ -59,18 +126,22 @@ class ChaumPedersen
      * @param g 位数qの生成子
      * @param h 位数qの別の生成子
      */
-    ChaumPedersen(cpp_int p, cpp_int q, cpp_int g, cpp_int h)
-        : p(std::move(p)), q(std::move(q)), g(std::move(g)), h(std::move(h))
+    BasicChaumPedersen(const cpp_int& p, const cpp_int& q, const cpp_int& g, const cpp_int& h) : group_(p, q, g, h)
     {
     }
 
+    const Group& group() const { return group_; }
+
+    // 位数 q
+    const cpp_int& order() const { return group_.order(); }
+
     /**
      * @fn
      * @brief 公開鍵 y1(g^x mod p), y2(h^x mod p) を計算する
      * @param x 秘密鍵
      * @return 計算された公開鍵 {y1, y2}
      */
-    PublicKeys calculate_public_keys(const cpp_int& x) const { return {powm(g, x, p), powm(h, x, p)}; }
+    PublicKeys calculate_public_keys(const cpp_int& x) const { return {group_.pow_g(x), group_.pow_h(x)}; }
 
     /**
      * @fn
@@ -78,7 +149,7 @@ class ChaumPedersen
      * @param k 一時的な乱数 (Nonce)
      * @return 計算されたコミットメント {r1, r2}
      */
-    Commitment create_commitment(const cpp_int& k) const { return {powm(g, k, p), powm(h, k, p)}; }
+    Commitment create_commitment(const cpp_int& k) const { return {group_.pow_g(k), group_.pow_h(k)}; }
 
     /**
      * @fn
@@ -90,6 +161,7 @@ class ChaumPedersen
      */
     Response solve_response(const cpp_int& k, const Challenge& c, const cpp_int& x) const
     {
+        const cpp_int& q = group_.order();
         cpp_int cx = (c.c * x) % q;
         if (k >= cx)
         {
@@ -101,7 +173,8 @@ class ChaumPedersen
     /**
      * @fn
      * @brief Chaum-Pedersen プロトコルの検証を行う
-     * @note  g^s * y1^c == r1 (mod p) かつ h^s * y2^c == r2 (mod p) を確認する
+     * @note  g^s * y1^c == r1 (mod p) かつ h^s * y2^c == r2 (mod p) を確認する。
+     *        検証に SIMD カーネルを使う場合（simd_lanes() > 1）は g^s * y1^c, h^s * y2^c を pow_many で同時に計算する。
      * @param commitment コミットメント {r1, r2}
      * @param public_keys 公開鍵 {y1, y2}
      * @param challenge チャレンジ {c}
@@ -111,9 +184,309 @@ class ChaumPedersen
     bool verify_proof(const Commitment& commitment, const PublicKeys& public_keys, const Challenge& challenge,
                       const Response& response) const
     {
-        cpp_int left1 = powm(g, response.s, p) * powm(public_keys.y1, challenge.c, p) % p;
-        cpp_int left2 = powm(h, response.s, p) * powm(public_keys.y2, challenge.c, p) % p;
+        if (simd_lanes() > 1)
+        {
+            const Term terms[] = {{public_keys.y1, challenge.c}, {public_keys.y2, challenge.c}};
+            const FixedTerm fixed_terms[] = {{*group_.g_table(), response.s}, {*group_.h_table(), response.s}};
+            Element lhs[2];
+            group_.pow_many(terms, fixed_terms, 2, lhs);
+            return group_.equal(lhs[0], commitment.r1) && group_.equal(lhs[1], commitment.r2);
+        }
+        if (!group_.equal(group_.mul_pow_g(response.s, public_keys.y1, challenge.c), commitment.r1))
+        {
+            return false;
+        }
+        return group_.equal(group_.mul_pow_h(response.s, public_keys.y2, challenge.c), commitment.r2);
+    }
+
+    /**
+     * @fn
+     * @brief 公開鍵のテーブルを使って検証する（verify_proof と同じ等式を、y1^c, y2^c もテーブル参照で計算する）
+     * @param key_tables make_public_key_tables で構築した公開鍵のテーブル
+     */
+    bool verify_proof(const Commitment& commitment, const PublicKeyTables& key_tables, const Challenge& challenge,
+                      const Response& response) const
+    {
+        if (!group_.equal(group_.mul_pow_g(response.s, *key_tables.y1, challenge.c), commitment.r1))
+        {
+            return false;
+        }
+        return group_.equal(group_.mul_pow_h(response.s, *key_tables.y2, challenge.c), commitment.r2);
+    }
+
+    /**
+     * @fn
+     * @brief 1 件分の証明を検証する（テーブルがあればテーブルを使う）
+     */
+    bool verify_proof(const Proof& proof) const
+    {
+        if (proof.key_tables)
+        {
+            return verify_proof(proof.commitment, *proof.key_tables, proof.challenge, proof.response);
+        }
+        return verify_proof(proof.commitment, proof.public_keys, proof.challenge, proof.response);
+    }
+
+    /**
+     * @fn
+     * @brief 公開鍵 y1, y2 の固定基底テーブルを構築する
+     * @note  ウィンドウ幅 w のテーブルは 2 つ合わせて 2 * ceil(|q| / w) * (2^w - 1) 要素。
+     *        構築には同じ回数の乗算がかかる（RFC5114 1024-bit 群、w = 4 では 1 回の検証の数倍）。
+     */
+    PublicKeyTables make_public_key_tables(const PublicKeys& public_keys, unsigned window_bits) const
+    {
+        return {group_.make_table(public_keys.y1, window_bits), group_.make_table(public_keys.y2, window_bits)};
+    }
+
+    /**
+     * @fn
+     * @brief Fiat-Shamir 変換で非対話のチャレンジを導出する: c = SHA-256(トランスクリプト) mod q
+     * @note  トランスクリプトは kFiatShamirTag, g, h, y1, y2, r1, r2, user, timestamp_ms の順に、
+     *        各フィールドの前に 4 バイトの長さ（ビッグエンディアン）を付けて連結したもの。
+     *        群の要素は整数表現を encoded_bytes() バイトの固定長で、timestamp_ms は 8 バイトで入れる。
+     *        証明者と検証者は同じ値から同じ c を得るため、チャレンジを受け取る往復が要らない。
+     * @param public_keys 公開鍵の整数表現 {y1, y2}
+     * @param commitment コミットメントの整数表現 {r1, r2}
+     * @param user 証明を結び付けるユーザー名
+     * @param timestamp_ms 証明を作成した時刻（UNIX 時刻のミリ秒）。検証者が鮮度の確認に使う
+     * @return チャレンジ {c}
+     */
+    Challenge fiat_shamir_challenge(const BasicPublicKeys<cpp_int>& public_keys,
+                                    const BasicCommitment<cpp_int>& commitment, std::string_view user,
+                                    std::uint64_t timestamp_ms) const
+    {
+        Sha256 sha;
+        const auto absorb = [&sha](std::string_view field)
+        {
+            const auto n = static_cast<std::uint32_t>(field.size());
+            const std::uint8_t length[4] = {static_cast<std::uint8_t>(n >> 24), static_cast<std::uint8_t>(n >> 16),
+                                            static_cast<std::uint8_t>(n >> 8), static_cast<std::uint8_t>(n)};
+            sha.update(length, sizeof(length));
+            sha.update(field);
+        };
+        const std::size_t element_bytes = group_.encoded_bytes();
+        absorb(kFiatShamirTag);
+        for (const cpp_int& x : {group_.encode(group_.g()), group_.encode(group_.h()), public_keys.y1,
+                                 public_keys.y2, commitment.r1, commitment.r2})
+        {
+            absorb(encode_fixed(x, element_bytes));
+        }
+        absorb(user);
+        absorb(encode_fixed(timestamp_ms, 8));
+
+        const Sha256::Digest digest = sha.finish();
+        cpp_int c;
+        import_bits(c, digest.begin(), digest.end(), 8, true);
+        return {c % group_.order()};
+    }
+
+    /**
+     * @fn
+     * @brief 複数の証明をまとめて検証する（small exponent batch verification）
+     * @note  各証明 i にランダムな 64-bit の重み z_i, w_i を割り当て、
+     *        Π r1_i^z_i * r2_i^w_i == g^(Σ z_i s_i) * h^(Σ w_i s_i) * Π y1_i^(z_i c_i) * y2_i^(w_i c_i)
+     *        を 2 回の同時べき乗で確認する。各等式のずれが位数 q の部分群に属する限り、
+     *        不正な証明が含まれていると 2^-64 以下の確率でしか成立しない。
+     *        まとめた検証が失敗した場合は二分して再検証し、不正な証明を特定する。
+     *        公開鍵のテーブルを持つ証明はまとめず、テーブルを使って 1 件ずつ検証する
+     *        （テーブル参照は二乗算が不要なため、まとめた場合の 1 件あたりの費用より安い）。
+     *        検証に SIMD カーネルを使う場合（simd_lanes() > 1）は、まとめずに全ての g^s * y1^c,
+     *        h^s * y2^c を pow_many で同時に計算して 1 件ずつ検証する（重みの乱数も二分探索の再検証も要らない）。
+     *        Group::kPrimeOrder が false の群（Z_p^*）もまとめない。r1, r2 は範囲しか確認していないため、
+     *        位数の小さい成分（例: p - r1 の -1）を持つコミットメントが重みの偶奇などによって成立してしまう。
+     * @param proofs 検証する証明の列
+     * @return 証明ごとの検証結果（proofs と同じ順序）
+     */
+    std::vector<bool> verify_batch(const std::vector<Proof>& proofs) const
+    {
+        std::vector<bool> results(proofs.size(), false);
+        std::vector<std::size_t> indices;
+        indices.reserve(proofs.size());
+        for (std::size_t i = 0; i < proofs.size(); ++i)
+        {
+            if (proofs[i].key_tables)
+            {
+                results[i] = verify_proof(proofs[i]);
+            }
+            else
+            {
+                indices.push_back(i);
+            }
+        }
+        if (!Group::kPrimeOrder || simd_lanes() > 1)
+        {
+            verify_each(proofs, indices, results);
+            return results;
+        }
+        verify_bisect(proofs, indices.data(), indices.data() + indices.size(), results);
+        return results;
+    }
+
+    /**
+     * @fn
+     * @brief verify_batch に証明をまとめて渡すと、1 件ずつ verify_proof を呼ぶより速くなるか
+     * @note  まとめた等式で検証できる群（kPrimeOrder）か、検証に SIMD カーネルを使う場合だけ。
+     *        それ以外（Z_p^* のスカラーと AVX2）の verify_batch は 1 件ずつの検証と同じ費用になる。
+     */
+    bool batching_pays_off() const { return Group::kPrimeOrder || simd_lanes() > 1; }
+
+   private:
+    // 検証で pow_many を使うカーネルの最小のレーン数。RFC5114 1024-bit 群の測定（zkp_bench）では、AVX2 の 4 レーンは
+    // べき乗 8 件では約 1.5 倍速いが、verify_proof の 2 件ではスカラーより約 15% 遅く、verify_batch でも差がなかった。
+    // AVX-512 IFMA の 8 レーンは verify_proof で約 1.35 倍、verify_batch で約 5 倍
+    static constexpr std::size_t kVerifySimdMinLanes = 8;
+
+    Group group_;
+
+    // 検証で pow_many の SIMD カーネルを使って同時に計算する数（1 の場合は使わない）。
+    // g, h のテーブルがない場合と、カーネルのレーンが kVerifySimdMinLanes 未満の場合は使わない
+    std::size_t simd_lanes() const
+    {
+        if (!group_.g_table() || !group_.h_table() || group_.pow_lanes() < kVerifySimdMinLanes)
+        {
+            return 1;
+        }
+        return group_.pow_lanes();
+    }
+
+    // indices の証明を 1 件ずつ検証する。SIMD カーネルがあれば全ての証明の g^s * y1^c, h^s * y2^c を
+    // 1 回の pow_many でまとめて計算する
+    void verify_each(const std::vector<Proof>& proofs, const std::vector<std::size_t>& indices,
+                     std::vector<bool>& results) const
+    {
+        if (simd_lanes() <= 1)
+        {
+            for (const std::size_t i : indices)
+            {
+                results[i] = verify_proof(proofs[i]);
+            }
+            return;
+        }
+        std::vector<Term> terms;
+        std::vector<FixedTerm> fixed_terms;
+        terms.reserve(2 * indices.size());
+        fixed_terms.reserve(2 * indices.size());
+        for (const std::size_t i : indices)
+        {
+            const Proof& proof = proofs[i];
+            terms.push_back({proof.public_keys.y1, proof.challenge.c});
+            terms.push_back({proof.public_keys.y2, proof.challenge.c});
+            fixed_terms.push_back({*group_.g_table(), proof.response.s});
+            fixed_terms.push_back({*group_.h_table(), proof.response.s});
+        }
+        std::vector<Element> lhs(terms.size());
+        group_.pow_many(terms.data(), fixed_terms.data(), terms.size(), lhs.data());
+        for (std::size_t k = 0; k < indices.size(); ++k)
+        {
+            const Proof& proof = proofs[indices[k]];
+            results[indices[k]] = group_.equal(lhs[2 * k], proof.commitment.r1) &&
+                                  group_.equal(lhs[2 * k + 1], proof.commitment.r2);
+        }
+    }
+
+    // [first, last) の証明を検証し、結果を results に書き込む
+    void verify_bisect(const std::vector<Proof>& proofs, const std::size_t* first, const std::size_t* last,
+                       std::vector<bool>& results) const
+    {
+        const std::size_t n = static_cast<std::size_t>(last - first);
+        if (n == 0)
+        {
+            return;
+        }
+        if (n == 1)
+        {
+            results[*first] = verify_proof(proofs[*first]);
+            return;
+        }
+        if (verify_combined(proofs, first, last))
+        {
+            for (const std::size_t* it = first; it != last; ++it)
+            {
+                results[*it] = true;
+            }
+            return;
+        }
+        const std::size_t* middle = first + n / 2;
+        verify_bisect(proofs, first, middle, results);
+        verify_bisect(proofs, middle, last, results);
+    }
 
-        return left1 == commitment.r1 && left2 == commitment.r2;
+    // [first, last) の証明をランダムな重みで 1 本の等式にまとめて検証する
+    bool verify_combined(const std::vector<Proof>& proofs, const std::size_t* first, const std::size_t* last) const
+    {
+        // 重みはプルーバに予測されないよう、スレッドごとの暗号論的擬似乱数生成器から得る
+        SecureRandom& weight_gen = SecureRandom::local();
+
+        const std::size_t n = static_cast<std::size_t>(last - first);
+        const cpp_int& q = group_.order();
+
+        // 指数は Term から参照されるため、再確保が起きないよう先に確保しておく
+        std::vector<cpp_int> exponents;
+        exponents.reserve(4 * n);
+        std::vector<Term> lhs;
+        std::vector<Term> rhs;
+        lhs.reserve(2 * n);
+        rhs.reserve(2 * n);
+        cpp_int g_exponent = 0;
+        cpp_int h_exponent = 0;
+
+        for (const std::size_t* it = first; it != last; ++it)
+        {
+            const Proof& proof = proofs[*it];
+            std::uint64_t z = 0;
+            std::uint64_t w = 0;
+            while (z == 0)
+            {
+                z = weight_gen.next_u64();
+            }
+            while (w == 0)
+            {
+                w = weight_gen.next_u64();
+            }
+
+            const cpp_int& z_i = exponents.emplace_back(z);
+            const cpp_int& w_i = exponents.emplace_back(w);
+            const cpp_int& zc_i = exponents.emplace_back(z_i * proof.challenge.c);
+            const cpp_int& wc_i = exponents.emplace_back(w_i * proof.challenge.c);
+            g_exponent += z_i * proof.response.s;
+            h_exponent += w_i * proof.response.s;
+
+            lhs.push_back({proof.commitment.r1, z_i});
+            lhs.push_back({proof.commitment.r2, w_i});
+            rhs.push_back({proof.public_keys.y1, zc_i});
+            rhs.push_back({proof.public_keys.y2, wc_i});
+        }
+
+        // g, h は位数 q なので指数は mod q で還元してよい
+        g_exponent %= q;
+        h_exponent %= q;
+
+        const cpp_int zero = 0;
+        return group_.equal(group_.multi_pow(lhs, zero, zero), group_.multi_pow(rhs, g_exponent, h_exponent));
     }
 };
+
+// cpp_int による参照実装
+using ChaumPedersen = BasicChaumPedersen<ZKPGroup>;
+
+// 固定長 Montgomery 演算による実装（RFC5114 1024-bit 群向け）
+using MontChaumPedersen = BasicChaumPedersen<ZKPMontGroup>;
+
+// 楕円曲線 P-256 上の実装
+using P256ChaumPedersen = BasicChaumPedersen<EcGroup>;
+
+/**
+ * @fn
+ * @brief 群の識別子に対応する ChaumPedersen（プロセス共通の群コンテキストを共有）で f を呼び出す
+ */
+template <typename Func>
+auto with_chaum_pedersen(GroupId group, Func f)
+{
+    if (group == GroupId::kP256)
+    {
+        return f(P256ChaumPedersen(get_zkp_p256_group()));
+    }
+    return f(MontChaumPedersen(get_zkp_mont_group()));
+}
+
+#endif  // CHAUM_PEDERSEN_HPP
@@ -2,9 +2,40 @@
 
 #include <gtest/gtest.h>
 
-TEST(ChaumPedersenTest, SolveResponse)
+#include <thread>
+
+#include "batch_verifier.hpp"
+
+// 各群ポリシーのプロセス共通コンテキスト
+template <typename Group>
+const Group& shared_group();
+
+template <>
+const ZKPGroup& shared_group<ZKPGroup>()
+{
+    return get_zkp_group();
+}
+
+template <>
+const ZKPMontGroup& shared_group<ZKPMontGroup>()
+{
+    return get_zkp_mont_group();
+}
+
+// 同じテストを cpp_int 参照実装と Montgomery 固定長実装の両方で実行する
+template <typename Group>
+class ChaumPedersenTest : public ::testing::Test
+{
+   protected:
+    using CP = BasicChaumPedersen<Group>;
+};
+
+using GroupBackends = ::testing::Types<ZKPGroup, ZKPMontGroup>;
+TYPED_TEST_SUITE(ChaumPedersenTest, GroupBackends);
+
+TYPED_TEST(ChaumPedersenTest, SolveResponse)
 {
-    ChaumPedersen cp(0, 71, 0, 0);  // qのみ使用
+    typename TestFixture::CP cp(0, 71, 0, 0);  // qのみ使用
     cpp_int k = 10;
     Challenge c = {2};
     cpp_int x = 30;
@@ -15,24 +46,26 @@ TEST(ChaumPedersenTest, SolveResponse)
     EXPECT_EQ(res.s, 21);
 }
 
-TEST(ChaumPedersenTest, VerifyProofSuccessful)
+TYPED_TEST(ChaumPedersenTest, VerifyProofSuccessful)
 {
+    using CP = typename TestFixture::CP;
+
     // 1. Setup
     cpp_int p = 23;
     cpp_int q = 11;
     cpp_int g = 4;
     cpp_int h = 9;
-    ChaumPedersen cp(p, q, g, h);
+    CP cp(p, q, g, h);
 
     // 2. Prover's secret
     cpp_int x = generate_random(q);
 
     // 3. y1, y2の計算
-    PublicKeys public_keys = cp.calculate_public_keys(x);
+    typename CP::PublicKeys public_keys = cp.calculate_public_keys(x);
 
     // 4. ランダムのnonce k を生成し、コミットメント r1, r2 を計算する
     cpp_int k = generate_random(q);
-    Commitment commitment = cp.create_commitment(k);
+    typename CP::Commitment commitment = cp.create_commitment(k);
 
     // 5. Verifier は challenge c を送る
     Challenge challenge = {generate_random(q)};
@@ -48,8 +81,10 @@ TEST(ChaumPedersenTest, VerifyProofSuccessful)
     EXPECT_FALSE(cp.verify_proof(commitment, public_keys, challenge, invalid_response));
 }
 
-TEST(ChaumPedersenTest, VerifyProof1024bitConstants)
+TYPED_TEST(ChaumPedersenTest, VerifyProof1024bitConstants)
 {
+    using CP = typename TestFixture::CP;
+
     //  https://datatracker.ietf.org/doc/html/rfc5114
     //  1024-bit MODP Group with 160-bit Prime Order Subgroup
     // 1. Setup
@@ -75,17 +110,17 @@ TEST(ChaumPedersenTest, VerifyProof1024bitConstants)
     // g^i mod p で求められる
     cpp_int h = powm(g, generate_random(q), p);
 
-    ChaumPedersen cp(p, q, g, h);
+    CP cp(p, q, g, h);
 
     // 2. Prover's secret
     cpp_int x = generate_random(q);
 
     // 3. y1, y2の計算
-    PublicKeys public_keys = cp.calculate_public_keys(x);
+    typename CP::PublicKeys public_keys = cp.calculate_public_keys(x);
 
     // 4. ランダムのnonce k を生成し、コミットメント r1, r2 を計算する
     cpp_int k = generate_random(q);
-    Commitment commitment = cp.create_commitment(k);
+    typename CP::Commitment commitment = cp.create_commitment(k);
 
     // 5. Verifier は challenge c を送る
     Challenge challenge = {generate_random(q)};
@@ -99,4 +134,342 @@ TEST(ChaumPedersenTest, VerifyProof1024bitConstants)
     // 失敗ケース: 不正なレスポンス s' = s + 1
     Response invalid_response = {(response.s + 1) % q};
     EXPECT_FALSE(cp.verify_proof(commitment, public_keys, challenge, invalid_response));
-}
\ No newline at end of file
+}
+
+TYPED_TEST(ChaumPedersenTest, FixedBaseTableMatchesPowm)
+{
+    const TypeParam& group = shared_group<TypeParam>();
+    const ZKPConstants constants = get_zkp_constants();
+    const unsigned bits = msb(constants.q) + 1;
+
+    for (unsigned window_bits : {1u, 4u, 6u, 8u})
+    {
+        typename TypeParam::Table table(group.arithmetic(), group.g(), bits, window_bits);
+
+        EXPECT_EQ(group.encode(table.pow(0)), 1);
+        EXPECT_EQ(group.encode(table.pow(1)), constants.g);
+        EXPECT_EQ(group.encode(table.pow(constants.q - 1)), powm(constants.g, constants.q - 1, constants.p));
+
+        cpp_int e = generate_random(constants.q);
+        EXPECT_EQ(group.encode(table.pow(e)), powm(constants.g, e, constants.p));
+    }
+
+    // テーブル範囲外の指数は可変基底のべき乗にフォールバックする
+    typename TypeParam::Table table(group.arithmetic(), group.g(), bits, 6);
+    cpp_int large = constants.q * constants.q + 12345;
+    EXPECT_EQ(group.encode(table.pow(large)), powm(constants.g, large, constants.p));
+}
+
+TYPED_TEST(ChaumPedersenTest, VerifyProofWithGroupContext)
+{
+    using CP = typename TestFixture::CP;
+
+    const TypeParam& group = shared_group<TypeParam>();
+    CP cp(group);
+    const ZKPConstants constants = get_zkp_constants();
+    ChaumPedersen reference(constants.p, constants.q, constants.g, constants.h);
+
+    cpp_int x = generate_random(cp.order());
+    typename CP::PublicKeys public_keys = cp.calculate_public_keys(x);
+    PublicKeys expected_keys = reference.calculate_public_keys(x);
+    EXPECT_EQ(group.encode(public_keys.y1), expected_keys.y1);
+    EXPECT_EQ(group.encode(public_keys.y2), expected_keys.y2);
+
+    cpp_int k = generate_random(cp.order());
+    typename CP::Commitment commitment = cp.create_commitment(k);
+    Challenge challenge = {generate_random(cp.order())};
+    Response response = cp.solve_response(k, challenge, x);
+
+    EXPECT_TRUE(cp.verify_proof(commitment, public_keys, challenge, response));
+    EXPECT_TRUE(reference.verify_proof({group.encode(commitment.r1), group.encode(commitment.r2)}, expected_keys,
+                                       challenge, response));
+
+    Response invalid_response = {(response.s + 1) % cp.order()};
+    EXPECT_FALSE(cp.verify_proof(commitment, public_keys, challenge, invalid_response));
+}
+
+TYPED_TEST(ChaumPedersenTest, MultiExpMatchesProductOfPowm)
+{
+    using Arithmetic = std::decay_t<decltype(shared_group<TypeParam>().arithmetic())>;
+
+    const TypeParam& group = shared_group<TypeParam>();
+    const Arithmetic& arith = group.arithmetic();
+    const ZKPConstants constants = get_zkp_constants();
+    const cpp_int& p = constants.p;
+
+    cpp_int y_int = powm(constants.g, generate_random(constants.q), p);
+    auto y = *group.decode(y_int);
+    cpp_int s = generate_random(constants.q);
+    cpp_int c = generate_random(constants.q);
+    cpp_int expected = cpp_int(powm(constants.g, s, p)) * cpp_int(powm(y_int, c, p)) % p;
+
+    EXPECT_EQ(group.encode(multi_pow<Arithmetic>(arith, {{group.g(), s}, {y, c}})), expected);
+    EXPECT_EQ(group.encode(multi_pow<Arithmetic>(arith, {{y, c}}, {{*group.g_table(), s}})), expected);
+    EXPECT_EQ(group.encode(group.mul_pow_g(s, y, c)), expected);
+
+    // 指数 0 や長さの異なる指数を含む場合
+    cpp_int zero = 0;
+    cpp_int small = 5;
+    EXPECT_EQ(group.encode(multi_pow<Arithmetic>(arith, {{y, zero}})), 1);
+    EXPECT_EQ(group.encode(multi_pow<Arithmetic>(arith, {})), 1);
+    EXPECT_EQ(group.encode(multi_pow<Arithmetic>(arith, {{y, small}, {group.h(), c}})),
+              cpp_int(powm(y_int, small, p)) * cpp_int(powm(constants.h, c, p)) % p);
+}
+
+TYPED_TEST(ChaumPedersenTest, DecodeRejectsOutOfRange)
+{
+    const TypeParam& group = shared_group<TypeParam>();
+
+    EXPECT_FALSE(group.decode(0));
+    EXPECT_FALSE(group.decode(group.modulus()));
+    EXPECT_FALSE(group.decode(group.modulus() + 1));
+    ASSERT_TRUE(group.decode(group.modulus() - 1));
+    EXPECT_EQ(group.encode(*group.decode(group.modulus() - 1)), group.modulus() - 1);
+}
+
+TYPED_TEST(ChaumPedersenTest, PublicKeyMustLieInPrimeOrderSubgroup)
+{
+    const TypeParam& group = shared_group<TypeParam>();
+
+    EXPECT_TRUE(group.is_public_key(group.g()));
+    EXPECT_TRUE(group.is_public_key(*group.decode(group.encode(group.pow_h(12345)))));
+    // p - 1 は位数 2、単位元は秘密鍵 0 に当たる
+    EXPECT_FALSE(group.is_public_key(*group.decode(group.modulus() - 1)));
+    EXPECT_FALSE(group.is_public_key(*group.decode(1)));
+}
+
+TEST(MontgomeryArithmeticTest, CompileTimeConstantsMatchRuntime)
+{
+    const ZKPConstants constants = get_zkp_constants();
+    const ZKPMontGroup& group = get_zkp_mont_group();
+
+    EXPECT_EQ(group.modulus(), constants.p);
+    EXPECT_EQ(group.order(), constants.q);
+    EXPECT_EQ(group.encode(kRfc5114G), constants.g);
+    EXPECT_EQ(group.encode(kRfc5114H), constants.h);
+
+    cpp_int a = generate_random(constants.p);
+    cpp_int b = generate_random(constants.p);
+    const Rfc5114Arithmetic& arith = group.arithmetic();
+    EXPECT_EQ(arith.to_integer(arith.mul(arith.from_integer(a), arith.from_integer(b))), a * b % constants.p);
+}
+
+TYPED_TEST(ChaumPedersenTest, VerifyBatchFindsInvalidProofs)
+{
+    using CP = typename TestFixture::CP;
+
+    CP cp(shared_group<TypeParam>());
+    const cpp_int& q = cp.order();
+
+    std::vector<typename CP::Proof> proofs;
+    for (int i = 0; i < 9; ++i)
+    {
+        cpp_int x = generate_random(q);
+        cpp_int k = generate_random(q);
+        Challenge challenge = {generate_random(q)};
+        proofs.push_back(
+            {cp.create_commitment(k), cp.calculate_public_keys(x), challenge, cp.solve_response(k, challenge, x)});
+    }
+
+    // 全て正しい場合
+    std::vector<bool> results = cp.verify_batch(proofs);
+    EXPECT_EQ(results, std::vector<bool>(proofs.size(), true));
+
+    // 不正な証明を混ぜた場合、二分探索でそれだけが検出される
+    proofs[2].response.s = (proofs[2].response.s + 1) % q;
+    proofs[7].challenge.c = (proofs[7].challenge.c + 1) % q;
+    std::swap(proofs[5].commitment.r1, proofs[5].commitment.r2);
+    results = cp.verify_batch(proofs);
+    for (std::size_t i = 0; i < proofs.size(); ++i)
+    {
+        const auto& proof = proofs[i];
+        EXPECT_EQ(results[i], cp.verify_proof(proof.commitment, proof.public_keys, proof.challenge, proof.response))
+            << "index " << i;
+        EXPECT_EQ(results[i], i != 2 && i != 5 && i != 7) << "index " << i;
+    }
+
+    EXPECT_TRUE(cp.verify_batch({}).empty());
+}
+
+TYPED_TEST(ChaumPedersenTest, VerifyBatchRejectsCommitmentOutsideSubgroup)
+{
+    using CP = typename TestFixture::CP;
+
+    const TypeParam& group = shared_group<TypeParam>();
+    CP cp(group);
+    const cpp_int& q = cp.order();
+
+    std::vector<typename CP::Proof> proofs;
+    for (int i = 0; i < 4; ++i)
+    {
+        cpp_int x = generate_random(q);
+        cpp_int k = generate_random(q);
+        Challenge challenge = {generate_random(q)};
+        proofs.push_back(
+            {cp.create_commitment(k), cp.calculate_public_keys(x), challenge, cp.solve_response(k, challenge, x)});
+    }
+    // p - r1 = -r1 は位数 q の部分群の外にあり、ずれ -1 は重みが偶数ならまとめた等式で消える
+    proofs[1].commitment.r1 = *group.decode(group.modulus() - group.encode(proofs[1].commitment.r1));
+    ASSERT_FALSE(cp.verify_proof(proofs[1]));
+
+    const SimdKernel saved = simd_kernel();
+    for (const SimdKernel kernel : {SimdKernel::kScalar, detect_simd_kernel()})
+    {
+        ASSERT_TRUE(set_simd_kernel(kernel));
+        for (int round = 0; round < 32; ++round)
+        {
+            EXPECT_EQ(cp.verify_batch(proofs), std::vector<bool>({true, false, true, true}))
+                << simd_kernel_name(kernel) << " round " << round;
+        }
+    }
+    set_simd_kernel(saved);
+}
+
+TYPED_TEST(ChaumPedersenTest, VerifyWithPublicKeyTables)
+{
+    using CP = typename TestFixture::CP;
+
+    CP cp(shared_group<TypeParam>());
+    const cpp_int& q = cp.order();
+
+    std::vector<typename CP::Proof> proofs;
+    for (int i = 0; i < 6; ++i)
+    {
+        cpp_int x = generate_random(q);
+        cpp_int k = generate_random(q);
+        Challenge challenge = {generate_random(q)};
+        typename CP::PublicKeys public_keys = cp.calculate_public_keys(x);
+        proofs.push_back({cp.create_commitment(k), public_keys, challenge, cp.solve_response(k, challenge, x)});
+        // 偶数番目だけテーブルで検証する
+        if (i % 2 == 0)
+        {
+            proofs.back().key_tables =
+                std::make_shared<const typename CP::PublicKeyTables>(cp.make_public_key_tables(public_keys, 4));
+        }
+    }
+    const auto& tables = *proofs[0].key_tables;
+    EXPECT_EQ(tables.memory_bytes(), (tables.y1->size() + tables.y2->size()) * sizeof(typename CP::Element));
+    EXPECT_TRUE(cp.verify_proof(proofs[0].commitment, tables, proofs[0].challenge, proofs[0].response));
+    const Response invalid_response = {(proofs[0].response.s + 1) % q};
+    EXPECT_FALSE(cp.verify_proof(proofs[0].commitment, tables, proofs[0].challenge, invalid_response));
+    // 別のユーザーの公開鍵のテーブルでは検証できない
+    EXPECT_FALSE(cp.verify_proof(proofs[2].commitment, tables, proofs[2].challenge, proofs[2].response));
+
+    // テーブルを持つ証明と持たない証明が混ざったバッチ
+    proofs[2].response.s = (proofs[2].response.s + 1) % q;
+    proofs[3].response.s = (proofs[3].response.s + 1) % q;
+    const std::vector<bool> results = cp.verify_batch(proofs);
+    for (std::size_t i = 0; i < proofs.size(); ++i)
+    {
+        EXPECT_EQ(results[i], cp.verify_proof(proofs[i])) << "index " << i;
+        EXPECT_EQ(results[i], i != 2 && i != 3) << "index " << i;
+    }
+}
+
+TEST(BatchVerifierTest, ConcurrentRequestsAreBatched)
+{
+    MontChaumPedersen cp(get_zkp_mont_group());
+    const cpp_int& q = cp.order();
+    BatchVerifier<MontChaumPedersen> verifier(cp, {.max_batch_size = 4, .max_wait = std::chrono::milliseconds(5),
+                                                   .worker_threads = 2});
+
+    constexpr int kRequests = 10;
+    std::vector<MontChaumPedersen::Proof> proofs;
+    for (int i = 0; i < kRequests; ++i)
+    {
+        cpp_int x = generate_random(q);
+        cpp_int k = generate_random(q);
+        Challenge challenge = {generate_random(q)};
+        Response response = cp.solve_response(k, challenge, x);
+        if (i % 3 == 0)
+        {
+            response.s = (response.s + 1) % q;
+        }
+        proofs.push_back({cp.create_commitment(k), cp.calculate_public_keys(x), challenge, response});
+    }
+
+    std::vector<int> results(kRequests, -1);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kRequests; ++i)
+    {
+        threads.emplace_back([&, i] { results[i] = verifier.verify(proofs[i]) ? 1 : 0; });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int i = 0; i < kRequests; ++i)
+    {
+        EXPECT_EQ(results[i], i % 3 == 0 ? 0 : 1) << "index " << i;
+    }
+}
+
+TEST(BatchVerifierTest, SubmitCompletesOnWorkersAndRespectsQueueLimit)
+{
+    // P-256 はカーネルによらずバッチ化する
+    P256ChaumPedersen cp(get_zkp_p256_group());
+    const cpp_int& q = cp.order();
+    // 蓄積窓を長めにとり、最初の 2 件が窓の中で待っている間に 3 件目を投入する
+    BatchVerifier<P256ChaumPedersen> verifier(cp, {.max_batch_size = 8, .max_wait = std::chrono::milliseconds(200),
+                                                   .worker_threads = 1, .max_pending = 2});
+
+    std::vector<P256ChaumPedersen::Proof> proofs;
+    for (int i = 0; i < 3; ++i)
+    {
+        cpp_int x = generate_random(q);
+        cpp_int k = generate_random(q);
+        Challenge challenge = {generate_random(q)};
+        Response response = cp.solve_response(k, challenge, x);
+        if (i == 1)
+        {
+            response.s = (response.s + 1) % q;
+        }
+        proofs.push_back({cp.create_commitment(k), cp.calculate_public_keys(x), challenge, response});
+    }
+
+    std::promise<bool> first;
+    std::promise<bool> second;
+    const auto caller = std::this_thread::get_id();
+    std::thread::id worker;
+    EXPECT_TRUE(verifier.submit(proofs[0],
+                                [&](bool ok)
+                                {
+                                    worker = std::this_thread::get_id();
+                                    first.set_value(ok);
+                                }));
+    EXPECT_TRUE(verifier.submit(proofs[1], [&](bool ok) { second.set_value(ok); }));
+    EXPECT_FALSE(verifier.submit(proofs[2], [](bool) { FAIL() << "rejected request must not complete"; }));
+
+    EXPECT_TRUE(first.get_future().get());
+    EXPECT_FALSE(second.get_future().get());
+    EXPECT_NE(worker, caller);
+}
+
+TEST(BatchVerifierTest, SkipsWindowWhenBatchingDoesNotPayOff)
+{
+    MontChaumPedersen cp(get_zkp_mont_group());
+    EXPECT_TRUE(P256ChaumPedersen(get_zkp_p256_group()).batching_pays_off());
+
+    const SimdKernel saved = simd_kernel();
+    ASSERT_TRUE(set_simd_kernel(SimdKernel::kScalar));
+    EXPECT_FALSE(cp.batching_pays_off());
+
+    const cpp_int& q = cp.order();
+    const cpp_int x = generate_random(q);
+    const cpp_int k = generate_random(q);
+    const Challenge challenge = {generate_random(q)};
+    const MontChaumPedersen::Proof proof = {cp.create_commitment(k), cp.calculate_public_keys(x), challenge,
+                                            cp.solve_response(k, challenge, x)};
+
+    // 蓄積窓が 1 分あっても、1 件目はバッチが埋まるのを待たずに検証される
+    BatchVerifier<MontChaumPedersen> verifier(cp, {.max_batch_size = 32, .max_wait = std::chrono::minutes(1),
+                                                   .worker_threads = 1});
+    EXPECT_TRUE(verifier.verify(proof));
+    std::promise<bool> done;
+    auto result = done.get_future();
+    EXPECT_TRUE(verifier.submit(proof, [&](bool ok) { done.set_value(ok); }));
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_TRUE(result.get());
+    set_simd_kernel(saved);
+}
@@ -0,0 +1,456 @@
+#include "client_bench.hpp"
+
+#include <grpcpp/grpcpp.h>
+
+#include <array>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+#include "latency_histogram.hpp"
+#include "zkp_auth.grpc.pb.h"
+
+using namespace boost::multiprecision;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// 計測する RPC（kLogin はログイン 1 回分の RPC をまとめたもの）
+enum Rpc : std::size_t
+{
+    kRegister,
+    kRegisterBatch,
+    kCreateAuthenticationChallenge,
+    kVerifyAuthentication,
+    kNonInteractiveAuthentication,
+    kLogin,
+    kRpcCount,
+};
+
+constexpr const char* kRpcNames[kRpcCount] = {"Register",
+                                              "RegisterBatch",
+                                              "CreateAuthenticationChallenge",
+                                              "VerifyAuthentication",
+                                              "NonInteractiveAuthentication",
+                                              "Login"};
+
+struct RpcStats
+{
+    LatencyHistogram latency;  // ナノ秒
+    std::uint64_t errors = 0;
+    std::string last_error;
+
+    void merge(const RpcStats& other)
+    {
+        latency.merge(other.latency);
+        errors += other.errors;
+        if (!other.last_error.empty())
+        {
+            last_error = other.last_error;
+        }
+    }
+};
+
+using Stats = std::array<RpcStats, kRpcCount>;
+
+struct BenchUser
+{
+    std::string name;
+    cpp_int x;
+    PublicKeys public_keys;  // 整数表現
+};
+
+std::uint64_t elapsed_ns(Clock::time_point from, Clock::time_point to)
+{
+    if (to <= from)
+    {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+std::string json_string(const std::string& s)
+{
+    std::string out = "\"";
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    return out + "\"";
+}
+
+/**
+ * @brief 群ごとの負荷生成の本体
+ * @tparam CP BasicChaumPedersen のインスタンス型
+ */
+template <typename CP>
+class BenchRunner
+{
+   public:
+    BenchRunner(const BenchOptions& options, CP cp)
+        : options_(options),
+          cp_(std::move(cp)),
+          element_bytes_(cp_.group().encoded_bytes()),
+          scalar_bytes_(byte_length(cp_.order()))
+    {
+        options_.threads = std::max<std::size_t>(1, options_.threads);
+        options_.channels = std::max<std::size_t>(1, options_.channels);
+        options_.users = std::max<std::size_t>(1, options_.users);
+        if (options_.user_prefix.empty())
+        {
+            std::ostringstream prefix;
+            prefix << "bench-" << std::hex << static_cast<std::uint32_t>(SecureRandom::local().next_u64()) << "-";
+            options_.user_prefix = prefix.str();
+        }
+    }
+
+    int run()
+    {
+        // チャネルごとに別のサブチャネル（TCP 接続）を使う
+        for (std::size_t i = 0; i < options_.channels; ++i)
+        {
+            grpc::ChannelArguments args;
+            args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+            stubs_.push_back(zkp_auth::Auth::NewStub(
+                grpc::CreateCustomChannel(options_.target, grpc::InsecureChannelCredentials(), args)));
+        }
+
+        std::cerr << "Registering " << options_.users << " users (" << options_.user_prefix << "*)..." << std::endl;
+        users_.resize(options_.users);
+        register_seconds_ =
+            parallel(register_stats_, [this](std::size_t t, Stats& stats) { register_users(t, stats); });
+        const RpcStats& register_stats = register_stats_[options_.register_batch == 0 ? kRegister : kRegisterBatch];
+        if (register_stats.errors != 0)
+        {
+            std::cerr << "Registration failed for " << register_stats.errors << " users: " << register_stats.last_error
+                      << std::endl;
+            return 1;
+        }
+
+        if (options_.commitment_pool.depth != 0)
+        {
+            // 登録の間に補充を始めておく
+            pool_ = std::make_unique<CommitmentPool>(options_.group, options_.commitment_pool);
+        }
+
+        std::cerr << "Running logins for " << options_.duration.count() << " ms..." << std::endl;
+        login_seconds_ = parallel(login_stats_, [this](std::size_t t, Stats& stats) { run_logins(t, stats); });
+
+        report();
+        return 0;
+    }
+
+   private:
+    BenchOptions options_;
+    const CP cp_;
+    const std::size_t element_bytes_;
+    const std::size_t scalar_bytes_;
+    std::vector<std::unique_ptr<zkp_auth::Auth::Stub>> stubs_;
+    std::vector<BenchUser> users_;
+    std::unique_ptr<CommitmentPool> pool_;
+    Clock::time_point start_;
+    Stats register_stats_;
+    Stats login_stats_;
+    double register_seconds_ = 0;
+    double login_seconds_ = 0;
+
+    // threads 本のスレッドで body(スレッド番号, スレッドの統計) を実行し、統計をまとめて経過秒数を返す
+    template <typename Body>
+    double parallel(Stats& total, Body body)
+    {
+        std::vector<Stats> stats(options_.threads);
+        std::vector<std::thread> threads;
+        start_ = Clock::now();
+        for (std::size_t t = 0; t < options_.threads; ++t)
+        {
+            threads.emplace_back([&, t] { body(t, stats[t]); });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        const std::chrono::duration<double> elapsed = Clock::now() - start_;
+        for (const Stats& s : stats)
+        {
+            for (std::size_t i = 0; i < kRpcCount; ++i)
+            {
+                total[i].merge(s[i]);
+            }
+        }
+        return elapsed.count();
+    }
+
+    // RPC を 1 回呼び、レイテンシとエラーを記録する
+    template <typename Invoke>
+    static bool timed_call(RpcStats& stats, Invoke invoke)
+    {
+        grpc::ClientContext context;
+        const auto begin = Clock::now();
+        const grpc::Status status = invoke(&context);
+        stats.latency.record(elapsed_ns(begin, Clock::now()));
+        if (!status.ok())
+        {
+            ++stats.errors;
+            stats.last_error = status.error_message();
+            return false;
+        }
+        return true;
+    }
+
+    zkp_auth::Auth::Stub& stub(std::size_t i) { return *stubs_[i % stubs_.size()]; }
+
+    void register_users(std::size_t t, Stats& stats)
+    {
+        const auto& group = cp_.group();
+        zkp_auth::RegisterBatchRequest batch;
+        for (std::size_t i = t; i < users_.size(); i += options_.threads)
+        {
+            BenchUser& user = users_[i];
+            user.name = options_.user_prefix + std::to_string(i);
+            user.x = generate_random(cp_.order());
+            const auto y = cp_.calculate_public_keys(user.x);
+            user.public_keys = {group.encode(y.y1), group.encode(y.y2)};
+
+            zkp_auth::RegisterRequest request;
+            request.set_user(user.name);
+            request.set_group(static_cast<zkp_auth::Group>(options_.group));
+            request.set_encoding(static_cast<zkp_auth::Encoding>(options_.encoding));
+            request.set_y1(encode_wire(user.public_keys.y1, options_.encoding, element_bytes_));
+            request.set_y2(encode_wire(user.public_keys.y2, options_.encoding, element_bytes_));
+            if (options_.register_batch != 0)
+            {
+                *batch.add_users() = std::move(request);
+                if (static_cast<std::size_t>(batch.users_size()) >= options_.register_batch)
+                {
+                    register_batch(i, batch, stats[kRegisterBatch]);
+                }
+                continue;
+            }
+            zkp_auth::RegisterResponse response;
+            timed_call(stats[kRegister], [&](grpc::ClientContext* context)
+                       { return stub(i).Register(context, request, &response); });
+        }
+        if (batch.users_size() != 0)
+        {
+            register_batch(t, batch, stats[kRegisterBatch]);
+        }
+    }
+
+    // RegisterBatch を 1 回呼んで batch を空にする。登録できなかったユーザーもエラーとして数える
+    void register_batch(std::size_t i, zkp_auth::RegisterBatchRequest& batch, RpcStats& stats)
+    {
+        zkp_auth::RegisterBatchResponse response;
+        if (timed_call(stats, [&](grpc::ClientContext* context)
+                       { return stub(i).RegisterBatch(context, batch, &response); }))
+        {
+            for (const zkp_auth::RegisterResult& result : response.results())
+            {
+                if (result.code() != grpc::StatusCode::OK)
+                {
+                    ++stats.errors;
+                    stats.last_error = result.message();
+                }
+            }
+        }
+        else
+        {
+            // 呼び出し自体の失敗は timed_call が 1 件数えている
+            stats.errors += batch.users_size() - 1;
+        }
+        batch.clear_users();
+    }
+
+    void run_logins(std::size_t t, Stats& stats)
+    {
+        const Clock::time_point end = start_ + options_.duration;
+        // オープンループではスレッドごとに threads / rps 秒間隔で送る（スレッド間で送信時刻をずらす）
+        const double interval_s = options_.rps > 0 ? static_cast<double>(options_.threads) / options_.rps : 0;
+        for (std::size_t n = 0;; ++n)
+        {
+            Clock::time_point intended = Clock::now();
+            if (options_.rps > 0)
+            {
+                const double offset = (static_cast<double>(n) + static_cast<double>(t) / options_.threads) * interval_s;
+                intended = start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset));
+                if (intended >= end)
+                {
+                    break;
+                }
+                std::this_thread::sleep_until(intended);
+            }
+            else if (intended >= end)
+            {
+                break;
+            }
+
+            const std::size_t i = t + n * options_.threads;
+            const BenchUser& user = users_[i % users_.size()];
+            const bool ok = options_.non_interactive ? login_non_interactive(stub(i), user, stats)
+                                                     : login_interactive(stub(i), user, stats);
+            stats[kLogin].latency.record(elapsed_ns(intended, Clock::now()));
+            if (!ok)
+            {
+                ++stats[kLogin].errors;
+            }
+        }
+    }
+
+    bool login_interactive(zkp_auth::Auth::Stub& stub, const BenchUser& user, Stats& stats)
+    {
+        const auto [k, commitment] = next_commitment();
+
+        zkp_auth::AuthenticationChallengeRequest challenge_request;
+        challenge_request.set_user(user.name);
+        challenge_request.set_encoding(static_cast<zkp_auth::Encoding>(options_.encoding));
+        challenge_request.set_r1(encode_wire(commitment.r1, options_.encoding, element_bytes_));
+        challenge_request.set_r2(encode_wire(commitment.r2, options_.encoding, element_bytes_));
+        zkp_auth::AuthenticationChallengeResponse challenge_response;
+        if (!timed_call(stats[kCreateAuthenticationChallenge],
+                        [&](grpc::ClientContext* context) {
+                            return stub.CreateAuthenticationChallenge(context, challenge_request, &challenge_response);
+                        }))
+        {
+            return false;
+        }
+        const auto c = decode_wire(challenge_response.c(), options_.encoding, scalar_bytes_);
+        if (!c)
+        {
+            return false;
+        }
+
+        const Response s = cp_.solve_response(k, Challenge{*c}, user.x);
+        zkp_auth::AuthenticationAnswerRequest answer_request;
+        answer_request.set_auth_id(challenge_response.auth_id());
+        answer_request.set_encoding(static_cast<zkp_auth::Encoding>(options_.encoding));
+        answer_request.set_s(encode_wire(s.s, options_.encoding, scalar_bytes_));
+        zkp_auth::AuthenticationAnswerResponse answer_response;
+        return timed_call(stats[kVerifyAuthentication], [&](grpc::ClientContext* context)
+                          { return stub.VerifyAuthentication(context, answer_request, &answer_response); });
+    }
+
+    bool login_non_interactive(zkp_auth::Auth::Stub& stub, const BenchUser& user, Stats& stats)
+    {
+        const auto [k, commitment] = next_commitment();
+        const std::uint64_t timestamp_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        const Challenge c = cp_.fiat_shamir_challenge(user.public_keys, commitment, user.name, timestamp_ms);
+        const Response s = cp_.solve_response(k, c, user.x);
+
+        zkp_auth::NonInteractiveAuthenticationRequest request;
+        request.set_user(user.name);
+        request.set_encoding(static_cast<zkp_auth::Encoding>(options_.encoding));
+        request.set_r1(encode_wire(commitment.r1, options_.encoding, element_bytes_));
+        request.set_r2(encode_wire(commitment.r2, options_.encoding, element_bytes_));
+        request.set_s(encode_wire(s.s, options_.encoding, scalar_bytes_));
+        request.set_timestamp_ms(timestamp_ms);
+        zkp_auth::AuthenticationAnswerResponse response;
+        return timed_call(stats[kNonInteractiveAuthentication], [&](grpc::ClientContext* context)
+                          { return stub.NonInteractiveAuthentication(context, request, &response); });
+    }
+
+    // ログイン 1 回分の (k, r1, r2)。プールがあれば取り出す
+    PrecomputedCommitment next_commitment() { return pool_ ? pool_->take() : make_commitment(cp_); }
+
+    // RPC ごとの結果を標準エラー出力に表で、出力先に JSON で書き出す
+    void report() const
+    {
+        std::ostringstream json;
+        json << std::fixed << std::setprecision(3);
+        json << "{\n  \"config\": {\"target\": " << json_string(options_.target)
+             << ", \"group\": " << json_string(std::string(group_name(options_.group)))
+             << ", \"encoding\": " << json_string(options_.encoding == WireEncoding::kBinary ? "binary" : "hex")
+             << ", \"login\": " << json_string(options_.non_interactive ? "non-interactive" : "interactive")
+             << ", \"users\": " << options_.users << ", \"threads\": " << options_.threads
+             << ", \"channels\": " << options_.channels << ", \"duration_ms\": " << options_.duration.count()
+             << ", \"target_rps\": " << options_.rps << ", \"commitment_pool\": " << options_.commitment_pool.depth
+             << ", \"register_batch\": " << options_.register_batch << "},\n";
+        json << "  \"register\": ";
+        write_phase(json, register_stats_, register_seconds_);
+        json << ",\n  \"login\": ";
+        write_phase(json, login_stats_, login_seconds_);
+        json << "\n}\n";
+
+        std::cerr << std::left << std::setw(32) << "rpc" << std::right << std::setw(10) << "count" << std::setw(8)
+                  << "errors" << std::setw(12) << "per sec" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+                  << std::setw(12) << "p999 us" << "\n";
+        print_phase(register_stats_, register_seconds_);
+        print_phase(login_stats_, login_seconds_);
+        if (pool_)
+        {
+            const CommitmentPoolStats pool = pool_->stats();
+            std::cerr << "commitment pool: " << pool.hits << " precomputed, " << pool.misses << " computed inline\n";
+        }
+
+        if (options_.output.empty())
+        {
+            std::cout << json.str();
+        }
+        else
+        {
+            std::ofstream(options_.output) << json.str();
+            std::cerr << "Wrote " << options_.output << std::endl;
+        }
+    }
+
+    static void write_phase(std::ostream& json, const Stats& stats, double seconds)
+    {
+        json << "{\"elapsed_s\": " << seconds << ", \"rpcs\": {";
+        bool first = true;
+        for (std::size_t i = 0; i < kRpcCount; ++i)
+        {
+            const LatencyHistogram& h = stats[i].latency;
+            if (h.count() == 0)
+            {
+                continue;
+            }
+            const auto us = [](double ns) { return ns / 1000.0; };
+            json << (first ? "" : ",") << "\n    " << json_string(kRpcNames[i]) << ": {\"count\": " << h.count()
+                 << ", \"errors\": " << stats[i].errors << ", \"throughput_per_s\": " << h.count() / seconds
+                 << ", \"latency_us\": {\"min\": " << us(h.min()) << ", \"mean\": " << us(h.mean())
+                 << ", \"p50\": " << us(h.percentile(0.5)) << ", \"p90\": " << us(h.percentile(0.9))
+                 << ", \"p99\": " << us(h.percentile(0.99)) << ", \"p999\": " << us(h.percentile(0.999))
+                 << ", \"max\": " << us(h.max()) << "}}";
+            first = false;
+        }
+        json << "}}";
+    }
+
+    static void print_phase(const Stats& stats, double seconds)
+    {
+        for (std::size_t i = 0; i < kRpcCount; ++i)
+        {
+            const LatencyHistogram& h = stats[i].latency;
+            if (h.count() == 0)
+            {
+                continue;
+            }
+            std::cerr << std::left << std::setw(32) << kRpcNames[i] << std::right << std::setw(10) << h.count()
+                      << std::setw(8) << stats[i].errors << std::setw(12) << std::fixed << std::setprecision(1)
+                      << h.count() / seconds << std::setw(12) << h.percentile(0.5) / 1000.0 << std::setw(12)
+                      << h.percentile(0.99) / 1000.0 << std::setw(12) << h.percentile(0.999) / 1000.0 << "\n";
+            if (stats[i].errors != 0)
+            {
+                std::cerr << "  last error: " << stats[i].last_error << "\n";
+            }
+        }
+    }
+};
+}  // namespace
+
+int run_bench(const BenchOptions& options)
+{
+    return with_chaum_pedersen(options.group, [&](auto cp) { return BenchRunner<decltype(cp)>(options, cp).run(); });
+}
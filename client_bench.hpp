@@ -0,0 +1,51 @@
+#ifndef CLIENT_BENCH_HPP
+#define CLIENT_BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "commitment_pool.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_group.hpp"
+
+// zkp_client bench の設定
+struct BenchOptions
+{
+    // 接続先
+    std::string target = "0.0.0.0:50051";
+    // 事前に登録するユーザー数（ログインはこの中から順に選ぶ）
+    std::size_t users = 100;
+    // ログインを行うスレッド数
+    std::size_t threads = 4;
+    // gRPC チャネル数（チャネルごとに別の TCP 接続を張る）
+    std::size_t channels = 8;
+    // ログインを繰り返す時間
+    std::chrono::milliseconds duration{10000};
+    // 全スレッド合計の目標ログイン数/秒。0 の場合はクローズドループ（応答を受けたらすぐ次を送る）
+    double rps = 0;
+    GroupId group = GroupId::kModp1024;
+    WireEncoding encoding = WireEncoding::kBinary;
+    // true の場合は NonInteractiveAuthentication、false の場合はチャレンジ・レスポンスの 2 往復でログインする
+    bool non_interactive = false;
+    // 1 回の RegisterBatch で登録するユーザー数。0 の場合は 1 人ずつ Register で登録する
+    std::size_t register_batch = 0;
+    // ログインに使う (k, r1, r2) の事前計算（depth が 0 の場合はログインのたびに計算する）
+    CommitmentPoolOptions commitment_pool;
+    // 登録するユーザー名の接頭辞（空の場合は実行ごとにランダムに決める）
+    std::string user_prefix;
+    // 結果の JSON の出力先（空の場合は標準出力）
+    std::string output;
+};
+
+/**
+ * @fn
+ * @brief 負荷生成: ユーザーを登録し、threads 本のスレッドから duration の間ログインを繰り返して、
+ *        RPC ごとのスループットとレイテンシ（p50/p99/p999）を JSON で出力する
+ * @note  オープンループ（rps > 0）では、ログインのレイテンシを予定した送信時刻から測る
+ *        （サーバが遅れて送信が詰まった時間も含める）。RPC ごとのレイテンシは実際の送信時刻から測る。
+ * @return 終了コード（ユーザー登録に失敗した場合は 1）
+ */
+int run_bench(const BenchOptions& options);
+
+#endif  // CLIENT_BENCH_HPP
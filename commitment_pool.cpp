@@ -0,0 +1,79 @@
+#include "commitment_pool.hpp"
+
+#include <algorithm>
+
+CommitmentPool::CommitmentPool(GroupId group, const CommitmentPoolOptions& options)
+    : group_(group), depth_(options.depth)
+{
+    if (depth_ == 0)
+    {
+        return;
+    }
+    ready_.reserve(depth_);
+    const std::size_t threads = std::max<std::size_t>(1, options.refill_threads);
+    for (std::size_t i = 0; i < threads; ++i)
+    {
+        refill_threads_.emplace_back([this] { refill_loop(); });
+    }
+}
+
+CommitmentPool::~CommitmentPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    refill_cv_.notify_all();
+    for (std::thread& thread : refill_threads_)
+    {
+        thread.join();
+    }
+}
+
+PrecomputedCommitment CommitmentPool::take()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!ready_.empty())
+        {
+            PrecomputedCommitment commitment = std::move(ready_.back());
+            ready_.pop_back();
+            lock.unlock();
+            refill_cv_.notify_one();
+            ++hits_;
+            return commitment;
+        }
+    }
+    ++misses_;
+    return compute();
+}
+
+std::size_t CommitmentPool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_.size();
+}
+
+PrecomputedCommitment CommitmentPool::compute() const
+{
+    return with_chaum_pedersen(group_, [](const auto& cp) { return make_commitment(cp); });
+}
+
+void CommitmentPool::refill_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        refill_cv_.wait(lock, [this] { return stopping_ || ready_.size() + in_flight_ < depth_; });
+        if (stopping_)
+        {
+            return;
+        }
+        ++in_flight_;
+        lock.unlock();
+        PrecomputedCommitment commitment = compute();
+        lock.lock();
+        --in_flight_;
+        ready_.push_back(std::move(commitment));
+    }
+}
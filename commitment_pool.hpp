@@ -0,0 +1,113 @@
+#ifndef COMMITMENT_POOL_HPP
+#define COMMITMENT_POOL_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+#include "zkp_group.hpp"
+
+using namespace boost::multiprecision;
+
+// CommitmentPool の設定
+struct CommitmentPoolOptions
+{
+    // 事前に計算しておく (k, r1, r2) の数。0 の場合は事前計算せず、ログインのたびに計算する。
+    std::size_t depth = 0;
+    // 補充を行うバックグラウンドスレッド数（0 の場合は 1）
+    std::size_t refill_threads = 1;
+};
+
+// 事前に計算したノンス k とコミットメント {r1, r2}（整数表現）。1 回のログインにだけ使うこと。
+struct PrecomputedCommitment
+{
+    cpp_int k;
+    Commitment commitment;
+};
+
+// CommitmentPool::take の集計値
+struct CommitmentPoolStats
+{
+    // 事前計算したものを渡した回数
+    std::uint64_t hits = 0;
+    // 空だったためその場で計算した回数
+    std::uint64_t misses = 0;
+};
+
+/**
+ * @fn
+ * @brief ノンス k を生成してコミットメント r1 = g^k, r2 = h^k を計算する
+ */
+template <typename CP>
+PrecomputedCommitment make_commitment(const CP& cp)
+{
+    const auto& group = cp.group();
+    cpp_int k = generate_random(cp.order());
+    const auto r = cp.create_commitment(k);
+    return {std::move(k), {group.encode(r.r1), group.encode(r.r2)}};
+}
+
+/**
+ * @brief 1 つの群の (k, r1, r2) をバックグラウンドで事前計算しておくプール
+ * @note  ログインで k の生成と 2 回のべき乗を待たずに済むよう、refill_threads 本のスレッドが
+ *        depth 個に満たない分を補充し続ける。take は 1 つを取り出して渡し、同じ k を二度渡すことはない
+ *        （k を再利用すると、2 つの応答 s から秘密鍵 x が求まる）。空の場合は呼び出し元のスレッドで計算する。
+ *        破棄時に残っている k は使われずに捨てられる。
+ */
+class CommitmentPool
+{
+   public:
+    /**
+     * @fn
+     * @brief コンストラクタ。補充スレッドを起動する（depth が 0 の場合は起動しない）。
+     * @param group 群の識別子（プロセス共通の群コンテキストで計算する）
+     * @param options プールの設定
+     */
+    CommitmentPool(GroupId group, const CommitmentPoolOptions& options);
+    ~CommitmentPool();
+
+    CommitmentPool(const CommitmentPool&) = delete;
+    CommitmentPool& operator=(const CommitmentPool&) = delete;
+
+    /**
+     * @fn
+     * @brief 事前計算した (k, r1, r2) を 1 つ取り出す。空の場合はその場で計算する。
+     * @note  複数スレッドから同時に呼んでよい。
+     */
+    PrecomputedCommitment take();
+
+    // 取り出せる数
+    std::size_t size() const;
+
+    CommitmentPoolStats stats() const { return {hits_.load(), misses_.load()}; }
+
+    GroupId group() const { return group_; }
+
+   private:
+    const GroupId group_;
+    const std::size_t depth_;
+
+    mutable std::mutex mutex_;
+    // 補充が必要になったことを補充スレッドに知らせる
+    std::condition_variable refill_cv_;
+    std::vector<PrecomputedCommitment> ready_;
+    // 補充スレッドが計算中の数（ready_ と合わせて depth_ を超えないようにする）
+    std::size_t in_flight_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> refill_threads_;
+
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+
+    PrecomputedCommitment compute() const;
+    void refill_loop();
+};
+
+#endif  // COMMITMENT_POOL_HPP
@@ -0,0 +1,90 @@
+#include "commitment_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// プールが depth まで補充されるのを待つ
+bool wait_for_size(const CommitmentPool& pool, std::size_t size)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (pool.size() < size)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+template <typename CP>
+void expect_commitment(const CP& cp, const PrecomputedCommitment& pc)
+{
+    const auto r = cp.create_commitment(pc.k);
+    EXPECT_EQ(pc.commitment.r1, cp.group().encode(r.r1));
+    EXPECT_EQ(pc.commitment.r2, cp.group().encode(r.r2));
+}
+}  // namespace
+
+TEST(CommitmentPoolTest, RefillsToDepthAndNeverReusesNonces)
+{
+    constexpr std::size_t kDepth = 8;
+    CommitmentPool pool(GroupId::kModp1024, {.depth = kDepth, .refill_threads = 2});
+    ASSERT_TRUE(wait_for_size(pool, kDepth));
+    EXPECT_EQ(pool.size(), kDepth);
+
+    // 複数スレッドから取り出しても同じ k は渡らない
+    constexpr int kThreads = 4;
+    constexpr int kTakes = 10;
+    std::vector<std::vector<PrecomputedCommitment>> taken(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                for (int i = 0; i < kTakes; ++i)
+                {
+                    taken[t].push_back(pool.take());
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const MontChaumPedersen cp(get_zkp_mont_group());
+    std::set<cpp_int> nonces;
+    for (const auto& commitments : taken)
+    {
+        for (const PrecomputedCommitment& pc : commitments)
+        {
+            EXPECT_TRUE(nonces.insert(pc.k).second);
+            expect_commitment(cp, pc);
+        }
+    }
+    const CommitmentPoolStats stats = pool.stats();
+    EXPECT_EQ(stats.hits + stats.misses, std::uint64_t(kThreads * kTakes));
+    EXPECT_GE(stats.hits, kDepth);
+
+    // 取り出した分は補充される
+    EXPECT_TRUE(wait_for_size(pool, kDepth));
+}
+
+TEST(CommitmentPoolTest, ComputesInlineWithoutDepth)
+{
+    CommitmentPool pool(GroupId::kP256, {});
+    const PrecomputedCommitment pc = pool.take();
+    expect_commitment(P256ChaumPedersen(get_zkp_p256_group()), pc);
+    EXPECT_EQ(pool.size(), 0u);
+    EXPECT_EQ(pool.stats().hits, 0u);
+    EXPECT_EQ(pool.stats().misses, 1u);
+}
@@ -0,0 +1,793 @@
+#ifndef EC_GROUP_HPP
+#define EC_GROUP_HPP
+
+#include <algorithm>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "fixed_base_table.hpp"
+#include "modular_arithmetic.hpp"
+#include "multi_exp.hpp"
+
+using namespace boost::multiprecision;
+
+// NIST P-256 (secp256r1) の曲線パラメータの16進表現（"0x" なし）: y^2 = x^3 - 3x + b (mod p)
+inline constexpr std::string_view kP256PrimeHex = "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF";
+inline constexpr std::string_view kP256BHex = "5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B";
+inline constexpr std::string_view kP256OrderHex = "FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551";
+inline constexpr std::string_view kP256GxHex = "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296";
+inline constexpr std::string_view kP256GyHex = "4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5";
+
+// 第二生成元 h の導出に使う種（この文字列を整数とみなした x 座標から曲線上の点を探す）
+inline constexpr std::string_view kP256HSeed = "Chaum-Pedersen P-256 h";
+
+/**
+ * @brief P-256 の座標体 GF(p) の演算（p = 2^256 - 2^224 + 2^192 + 2^96 - 1）
+ * @note  要素は [0, p) の整数そのもののリム配列。乗算は 512-bit の積を求めてから、p の形を使った
+ *        Solinas の還元（FIPS 186-4 D.2.3）で、乗算を使わずに 32-bit ワードを並べ替えた値の足し引きだけで 256-bit に戻す。
+ *        汎用の MontgomeryArithmetic<4>（CIOS）より乗算が少なく、二乗は交差項を 1 回だけ掛ける。
+ *        MontgomeryArithmetic と同じ one/mul/sqr/add/sub を提供し、全メンバ関数はコンパイル時にも評価できる。
+ */
+class P256FieldArithmetic
+{
+   public:
+    using Element = Limbs<4>;
+
+    static constexpr Element kModulus = limbs_from_hex<4>(kP256PrimeHex);
+
+    constexpr Element one() const { return {1, 0, 0, 0}; }
+
+    // a * b mod p（4 × 4 リムの積を reduce で還元する）
+    constexpr Element mul(const Element& a, const Element& b) const
+    {
+        using Wide = unsigned __int128;
+        Limb t[8] = {};
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            Limb carry = 0;
+#pragma GCC unroll 4
+            for (std::size_t j = 0; j < 4; ++j)
+            {
+                const Wide v = static_cast<Wide>(a[j]) * b[i] + t[i + j] + carry;
+                t[i + j] = static_cast<Limb>(v);
+                carry = static_cast<Limb>(v >> 64);
+            }
+            t[i + 4] = carry;
+        }
+        return reduce(t);
+    }
+
+    // 交差項 a_i a_j (i < j) を 1 回ずつ掛けて 2 倍し、対角項 a_i^2 を足す（乗算 10 回）
+    constexpr Element sqr(const Element& a) const
+    {
+        using Wide = unsigned __int128;
+        Limb t[8] = {};
+        Wide v = static_cast<Wide>(a[0]) * a[1];
+        t[1] = static_cast<Limb>(v);
+        v = static_cast<Wide>(a[0]) * a[2] + static_cast<Limb>(v >> 64);
+        t[2] = static_cast<Limb>(v);
+        v = static_cast<Wide>(a[0]) * a[3] + static_cast<Limb>(v >> 64);
+        t[3] = static_cast<Limb>(v);
+        t[4] = static_cast<Limb>(v >> 64);
+        v = static_cast<Wide>(a[1]) * a[2] + t[3];
+        t[3] = static_cast<Limb>(v);
+        v = static_cast<Wide>(a[1]) * a[3] + t[4] + static_cast<Limb>(v >> 64);
+        t[4] = static_cast<Limb>(v);
+        t[5] = static_cast<Limb>(v >> 64);
+        v = static_cast<Wide>(a[2]) * a[3] + t[5];
+        t[5] = static_cast<Limb>(v);
+        t[6] = static_cast<Limb>(v >> 64);
+
+        t[7] = t[6] >> 63;
+        t[6] = (t[6] << 1) | (t[5] >> 63);
+        t[5] = (t[5] << 1) | (t[4] >> 63);
+        t[4] = (t[4] << 1) | (t[3] >> 63);
+        t[3] = (t[3] << 1) | (t[2] >> 63);
+        t[2] = (t[2] << 1) | (t[1] >> 63);
+        t[1] <<= 1;
+
+        Limb carry = 0;
+#pragma GCC unroll 4
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            const Wide d = static_cast<Wide>(a[i]) * a[i];
+            v = static_cast<Wide>(t[2 * i]) + static_cast<Limb>(d) + carry;
+            t[2 * i] = static_cast<Limb>(v);
+            v = static_cast<Wide>(t[2 * i + 1]) + static_cast<Limb>(d >> 64) + static_cast<Limb>(v >> 64);
+            t[2 * i + 1] = static_cast<Limb>(v);
+            carry = static_cast<Limb>(v >> 64);
+        }
+        return reduce(t);
+    }
+
+    // a + b mod p（a + b と a + b - p を両方求め、借りの有無で選ぶ。分岐しない）
+    constexpr Element add(const Element& a, const Element& b) const
+    {
+        Element sum{};
+        const Limb carry = add_to(sum, a, b);
+        Element reduced{};
+        const Limb borrow = sub_to(reduced, sum, kModulus);
+        // a + b >= p（2^256 の桁があるか、引いても借りが出ない）なら reduced を選ぶ
+        const Limb keep = (borrow & ~carry) * ~Limb{0};
+        Element result{};
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            result[j] = (sum[j] & keep) | (reduced[j] & ~keep);
+        }
+        return result;
+    }
+
+    // a - b mod p（借りが出たら p を足す。分岐しない）
+    constexpr Element sub(const Element& a, const Element& b) const
+    {
+        Element result{};
+        const Limb mask = sub_to(result, a, b) * ~Limb{0};
+        const Element masked = {kModulus[0] & mask, kModulus[1] & mask, kModulus[2] & mask, kModulus[3] & mask};
+        add_to(result, result, masked);
+        return result;
+    }
+
+    constexpr bool is_zero(const Element& a) const { return (a[0] | a[1] | a[2] | a[3]) == 0; }
+
+    // x は [0, p) の範囲にあること
+    Element from_integer(const cpp_int& x) const { return limbs_from_integer<4>(x); }
+    cpp_int to_integer(const Element& a) const { return integer_from_limbs<4>(a); }
+
+   private:
+    // out = a + b（2^256 の桁の繰り上がりを返す）
+    static constexpr Limb add_to(Element& out, const Element& a, const Element& b)
+    {
+        using Wide = unsigned __int128;
+        Wide v = 0;
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            v = static_cast<Wide>(a[j]) + b[j] + static_cast<Limb>(v >> 64);
+            out[j] = static_cast<Limb>(v);
+        }
+        return static_cast<Limb>(v >> 64);
+    }
+
+    // out = a - b（2^256 の桁の借りを返す）
+    static constexpr Limb sub_to(Element& out, const Element& a, const Element& b)
+    {
+        using Wide = unsigned __int128;
+        Limb borrow = 0;
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            const Wide v = static_cast<Wide>(a[j]) - b[j] - borrow;
+            out[j] = static_cast<Limb>(v);
+            borrow = static_cast<Limb>(v >> 64) & 1;
+        }
+        return borrow;
+    }
+
+    static constexpr bool less_than_modulus(const Element& x)
+    {
+        for (std::size_t j = 4; j-- > 0;)
+        {
+            if (x[j] != kModulus[j])
+            {
+                return x[j] < kModulus[j];
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @fn
+     * @brief 512-bit の t を mod p で還元する
+     * @note  t を 32-bit ワード c0..c15 に分け、2^256 ≡ 2^224 - 2^192 - 2^96 + 1 を使って
+     *        s1 + 2 s2 + 2 s3 + s4 + s5 - s6 - s7 - s8 - s9 の 9 つの 256-bit 値の和にする（各 s は c の並べ替え）。
+     *        s を 64-bit リムのまま組み立てて符号付き 128-bit で足し合わせ、残った 2^256 の桁 k（-4 〜 5）を
+     *        同じ関係でもう一度畳み込み、最後に p を高々数回加減して [0, p) に戻す。
+     */
+    static constexpr Element reduce(const Limb (&t)[8])
+    {
+        using SignedWide = __int128;
+        constexpr Limb lo = 0xFFFFFFFF;
+        constexpr Limb hi = ~lo;
+        // c8..c15 は t4..t7 の下位・上位 32 ビット
+        const Limb t4 = t[4], t5 = t[5], t6 = t[6], t7 = t[7];
+        const Limb c10_c9 = (t4 >> 32) | (t5 << 32);
+        const Limb c12_c11 = (t5 >> 32) | (t6 << 32);
+        const Limb c14_c13 = (t6 >> 32) | (t7 << 32);
+
+        // 各リムの s1 + 2 s2 + 2 s3 + s4 + s5 - s6 - s7 - s8 - s9（s の上位リムから順に並べる）
+        SignedWide acc = static_cast<SignedWide>(t[0]) + t4 + c10_c9 - c12_c11 - t6 - c14_c13 - t7;
+        const Limb r0 = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += static_cast<SignedWide>(t[1]) + 2 * static_cast<SignedWide>(t5 & hi) + 2 * static_cast<SignedWide>(t6 << 32) +
+               (t5 & lo) + ((t5 >> 32) | (t6 & hi)) - (t6 >> 32) - t7 - ((t7 >> 32) | (t4 << 32)) - (t4 & hi);
+        const Limb r1 = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += static_cast<SignedWide>(t[2]) + 2 * static_cast<SignedWide>(t6) + 2 * static_cast<SignedWide>(c14_c13) + t7 -
+               c10_c9 - t5;
+        const Limb r2 = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += static_cast<SignedWide>(t[3]) + 2 * static_cast<SignedWide>(t7) + 2 * static_cast<SignedWide>(t7 >> 32) + t7 +
+               ((t6 >> 32) | (t4 << 32)) - ((t4 & lo) | (t5 << 32)) - ((t4 >> 32) | (t5 & hi)) - (t6 << 32) - (t6 & hi);
+        const Limb r3 = static_cast<Limb>(acc);
+        acc >>= 64;
+
+        // k * 2^256 ≡ k * (2^224 - 2^192 - 2^96 + 1)
+        const auto k = static_cast<std::int64_t>(acc);
+        acc = static_cast<SignedWide>(r0) + k;
+        Element result{};
+        result[0] = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += static_cast<SignedWide>(r1) - static_cast<SignedWide>(k) * (SignedWide{1} << 32);
+        result[1] = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += r2;
+        result[2] = static_cast<Limb>(acc);
+        acc >>= 64;
+        acc += static_cast<SignedWide>(r3) + static_cast<SignedWide>(k) * ((SignedWide{1} << 32) - 1);
+        result[3] = static_cast<Limb>(acc);
+        acc >>= 64;
+
+        auto top = static_cast<std::int64_t>(acc);
+        while (top < 0)
+        {
+            top += static_cast<std::int64_t>(add_to(result, result, kModulus));
+        }
+        while (top > 0 || !less_than_modulus(result))
+        {
+            top -= static_cast<std::int64_t>(sub_to(result, result, kModulus));
+        }
+        return result;
+    }
+};
+
+using P256Field = P256FieldArithmetic;
+
+/**
+ * @brief Jacobian 座標の点 (X : Y : Z)。アフィン座標は (X / Z^2, Y / Z^3)。
+ * @note  各座標は P256Field の要素。Z = 0 は無限遠点（単位元）を表し、Z = 1 はアフィン座標のままの点を表す。
+ *        同じ点に複数の表現があるため、比較には EcGroup::equal を使うこと。
+ */
+struct JacobianPoint
+{
+    Limbs<4> x{};
+    Limbs<4> y{};
+    Limbs<4> z{};
+
+    constexpr bool is_identity() const { return z[0] == 0 && z[1] == 0 && z[2] == 0 && z[3] == 0; }
+    constexpr bool is_affine() const { return z[0] == 1 && z[1] == 0 && z[2] == 0 && z[3] == 0; }
+};
+
+/**
+ * @brief a = -3 の短 Weierstrass 曲線上の点演算を、群演算ポリシー（one/mul/sqr）として提供する
+ * @note  FixedBaseTable / multi_pow / power は乗法的な記法で書かれているため、
+ *        mul を点の加算、sqr を 2 倍算、one を無限遠点に対応させるとそのままスカラー倍算になる。
+ *        逆元を使わない Jacobian 座標で計算する。加算は体の乗算 16 回、片方が Z = 1 の点なら 11 回
+ *        （固定基底テーブルのエントリは normalize で Z = 1 にそろえてある）。
+ */
+class P256PointArithmetic
+{
+   public:
+    using Element = JacobianPoint;
+
+    constexpr explicit P256PointArithmetic(const P256Field& field) : field_(field) {}
+
+    constexpr Element one() const { return {field_.one(), field_.one(), Limbs<4>{}}; }
+
+    /**
+     * @fn
+     * @brief 点の加算 a + b（add-2007-bl、片方が Z = 1 の場合は madd-2007-bl）
+     * @note  a == b の場合は 2 倍算に切り替え、a == -b の場合は無限遠点を返す
+     */
+    constexpr Element mul(const Element& a, const Element& b) const
+    {
+        if (a.is_identity())
+        {
+            return b;
+        }
+        if (b.is_identity())
+        {
+            return a;
+        }
+        if (b.is_affine())
+        {
+            return add_affine(a, b);
+        }
+        if (a.is_affine())
+        {
+            return add_affine(b, a);
+        }
+        const auto z1z1 = field_.sqr(a.z);
+        const auto z2z2 = field_.sqr(b.z);
+        const auto u1 = field_.mul(a.x, z2z2);
+        const auto u2 = field_.mul(b.x, z1z1);
+        const auto s1 = field_.mul(a.y, field_.mul(b.z, z2z2));
+        const auto s2 = field_.mul(b.y, field_.mul(a.z, z1z1));
+        const auto h = field_.sub(u2, u1);
+        const auto r_half = field_.sub(s2, s1);
+        if (field_.is_zero(h))
+        {
+            return field_.is_zero(r_half) ? sqr(a) : one();
+        }
+        const auto h2 = field_.add(h, h);
+        const auto i = field_.sqr(h2);
+        const auto j = field_.mul(h, i);
+        const auto r = field_.add(r_half, r_half);
+        const auto v = field_.mul(u1, i);
+
+        Element result;
+        result.x = field_.sub(field_.sub(field_.sqr(r), j), field_.add(v, v));
+        const auto s1j = field_.mul(s1, j);
+        result.y = field_.sub(field_.mul(r, field_.sub(v, result.x)), field_.add(s1j, s1j));
+        result.z = field_.mul(field_.sub(field_.sub(field_.sqr(field_.add(a.z, b.z)), z1z1), z2z2), h);
+        return result;
+    }
+
+    /**
+     * @fn
+     * @brief 点の 2 倍算 2a（dbl-2001-b, a = -3）
+     */
+    constexpr Element sqr(const Element& a) const
+    {
+        if (a.is_identity())
+        {
+            return a;
+        }
+        const auto delta = field_.sqr(a.z);
+        const auto gamma = field_.sqr(a.y);
+        const auto beta = field_.mul(a.x, gamma);
+        const auto t = field_.mul(field_.sub(a.x, delta), field_.add(a.x, delta));
+        const auto alpha = field_.add(field_.add(t, t), t);
+        const auto beta2 = field_.add(beta, beta);
+        const auto beta4 = field_.add(beta2, beta2);
+        const auto beta8 = field_.add(beta4, beta4);
+
+        Element result;
+        result.x = field_.sub(field_.sqr(alpha), beta8);
+        result.z = field_.sub(field_.sub(field_.sqr(field_.add(a.y, a.z)), gamma), delta);
+        auto gamma2 = field_.sqr(gamma);
+        gamma2 = field_.add(gamma2, gamma2);
+        gamma2 = field_.add(gamma2, gamma2);
+        gamma2 = field_.add(gamma2, gamma2);
+        result.y = field_.sub(field_.mul(alpha, field_.sub(beta4, result.x)), gamma2);
+        return result;
+    }
+
+    // 逆元 -a（Y の符号を反転する）
+    constexpr Element negate(const Element& a) const { return {a.x, field_.sub(Limbs<4>{}, a.y), a.z}; }
+
+    /**
+     * @fn
+     * @brief 点の列を Z = 1 の表現にそろえる（FixedBaseTable が構築後に呼ぶ）
+     * @note  Montgomery の同時逆元で、Z の逆元 1 回と乗算 3(count - 1) 回で全ての Z^{-1} を求める。
+     *        無限遠点はそのまま残す。
+     */
+    void normalize(Element* points, std::size_t count) const
+    {
+        // prefix[i] = Z_0 * ... * Z_i（無限遠点は 1 とみなす）
+        std::vector<Limbs<4>> prefix(count);
+        Limbs<4> acc = field_.one();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!points[i].is_identity())
+            {
+                acc = field_.mul(acc, points[i].z);
+            }
+            prefix[i] = acc;
+        }
+        // Z^{-1} = Z^(p-2)（フェルマーの小定理）
+        static const cpp_int inverse_exponent = integer_from_limbs(P256Field::kModulus) - 2;
+        Limbs<4> inverse = power(field_, acc, inverse_exponent);
+        for (std::size_t i = count; i-- > 0;)
+        {
+            Element& point = points[i];
+            if (point.is_identity())
+            {
+                continue;
+            }
+            const Limbs<4> z_inv = i == 0 ? inverse : field_.mul(inverse, prefix[i - 1]);
+            inverse = field_.mul(inverse, point.z);
+            const auto z_inv2 = field_.sqr(z_inv);
+            point.x = field_.mul(point.x, z_inv2);
+            point.y = field_.mul(point.y, field_.mul(z_inv2, z_inv));
+            point.z = field_.one();
+        }
+    }
+
+    constexpr const P256Field& field() const { return field_; }
+
+   private:
+    P256Field field_;
+
+    // a + b（b は Z = 1、madd-2007-bl）
+    constexpr Element add_affine(const Element& a, const Element& b) const
+    {
+        const auto z1z1 = field_.sqr(a.z);
+        const auto u2 = field_.mul(b.x, z1z1);
+        const auto s2 = field_.mul(b.y, field_.mul(a.z, z1z1));
+        const auto h = field_.sub(u2, a.x);
+        const auto r_half = field_.sub(s2, a.y);
+        if (field_.is_zero(h))
+        {
+            return field_.is_zero(r_half) ? sqr(a) : one();
+        }
+        const auto hh = field_.sqr(h);
+        const auto i = field_.add(field_.add(hh, hh), field_.add(hh, hh));
+        const auto j = field_.mul(h, i);
+        const auto r = field_.add(r_half, r_half);
+        const auto v = field_.mul(a.x, i);
+
+        Element result;
+        result.x = field_.sub(field_.sub(field_.sqr(r), j), field_.add(v, v));
+        const auto y1j = field_.mul(a.y, j);
+        result.y = field_.sub(field_.mul(r, field_.sub(v, result.x)), field_.add(y1j, y1j));
+        result.z = field_.sub(field_.sub(field_.sqr(field_.add(a.z, h)), z1z1), hh);
+        return result;
+    }
+};
+
+/**
+ * @brief 楕円曲線 P-256 上の位数 n の群（生成元 G, H）
+ * @note  ModpGroup と同じ群ポリシーを提供するため、BasicChaumPedersen からそのまま使える。
+ *        記法は乗法的なまま（pow_g(e) は スカラー倍 eG、mul は点の加算）。
+ *        P-256 の余因子は 1 のため、曲線上の点はすべて位数 n の部分群に属する。
+ *        構築後は変更されないため、複数スレッドから同時に参照してよい。
+ */
+class EcGroup
+{
+   public:
+    using Element = JacobianPoint;
+    using Table = FixedBaseTable<P256PointArithmetic>;
+    using Term = PowTerm<P256PointArithmetic>;
+    using FixedTerm = FixedPowTerm<P256PointArithmetic>;
+
+    // 256-bit のスカラーに対して 43 ウィンドウ × 63 エントリ
+    static constexpr unsigned kDefaultWindowBits = 6;
+
+    // 符号化した点のバイト長（SEC1 非圧縮形式 0x04 || X || Y）
+    static constexpr std::size_t kEncodedBytes = 65;
+
+    // 余因子が 1 のため、verify_batch でまとめて検証してよい
+    static constexpr bool kPrimeOrder = true;
+
+    /**
+     * @fn
+     * @brief コンストラクタ。P-256 の定数から G を、kP256HSeed から H を導出し、固定基底テーブルを構築する。
+     * @param window_bits 固定基底テーブルのウィンドウ幅
+     */
+    explicit EcGroup(unsigned window_bits = kDefaultWindowBits)
+        : points_(field_),
+          p_(integer_from_limbs(P256Field::kModulus)),
+          n_(integer_from_limbs(limbs_from_hex<4>(kP256OrderHex))),
+          b_(limbs_from_hex<4>(kP256BHex)),
+          g_(affine_point(limbs_from_hex<4>(kP256GxHex), limbs_from_hex<4>(kP256GyHex))),
+          h_(derive_point(kP256HSeed)),
+          g_table_(std::make_shared<const Table>(points_, g_, exponent_bits(n_), window_bits)),
+          h_table_(std::make_shared<const Table>(points_, h_, exponent_bits(n_), window_bits))
+    {
+    }
+
+    const P256PointArithmetic& arithmetic() const { return points_; }
+    const cpp_int& modulus() const { return p_; }
+    const cpp_int& order() const { return n_; }
+    const Element& g() const { return g_; }
+    const Element& h() const { return h_; }
+
+    const std::shared_ptr<const Table>& g_table() const { return g_table_; }
+    const std::shared_ptr<const Table>& h_table() const { return h_table_; }
+
+    Element pow_g(const cpp_int& e) const { return g_table_->pow(e); }
+    Element pow_h(const cpp_int& e) const { return h_table_->pow(e); }
+
+    /**
+     * @fn
+     * @brief sG + cY を計算する（sG はテーブル参照、cY は符号付きウィンドウ）
+     */
+    Element mul_pow_g(const cpp_int& s, const Element& y, const cpp_int& c) const
+    {
+        const Term term{y, c};
+        return points_.mul(g_table_->pow(s), multi_mul(&term, 1));
+    }
+
+    /**
+     * @fn
+     * @brief sH + cY を計算する（sH はテーブル参照、cY は符号付きウィンドウ）
+     */
+    Element mul_pow_h(const cpp_int& s, const Element& y, const cpp_int& c) const
+    {
+        const Term term{y, c};
+        return points_.mul(h_table_->pow(s), multi_mul(&term, 1));
+    }
+
+    /**
+     * @fn
+     * @brief sG + cY を計算する（cY は Y の固定基底テーブル参照）
+     */
+    Element mul_pow_g(const cpp_int& s, const Table& y_table, const cpp_int& c) const
+    {
+        return ::multi_pow<P256PointArithmetic>(points_, {}, {{*g_table_, s}, {y_table, c}});
+    }
+
+    /**
+     * @fn
+     * @brief sH + cY を計算する（cY は Y の固定基底テーブル参照）
+     */
+    Element mul_pow_h(const cpp_int& s, const Table& y_table, const cpp_int& c) const
+    {
+        return ::multi_pow<P256PointArithmetic>(points_, {}, {{*h_table_, s}, {y_table, c}});
+    }
+
+    /**
+     * @fn
+     * @brief 任意の点を基底とする固定基底テーブルを構築する（スカラーは位数 n のビット長まで）
+     */
+    std::shared_ptr<const Table> make_table(const Element& base, unsigned window_bits) const
+    {
+        return std::make_shared<const Table>(points_, base, exponent_bits(n_), window_bits);
+    }
+
+    /**
+     * @fn
+     * @brief Σ e_i P_i + eg G + eh H を同時スカラー倍算で計算する（バッチ検証用）
+     */
+    Element multi_pow(const std::vector<Term>& terms, const cpp_int& g_exponent, const cpp_int& h_exponent) const
+    {
+        const Element fixed = points_.mul(g_table_->pow(g_exponent), h_table_->pow(h_exponent));
+        return points_.mul(fixed, multi_mul(terms.data(), terms.size()));
+    }
+
+    /**
+     * @fn
+     * @brief 独立したスカラー倍算 e_i P_i（固定基底の項を足してもよい）を 1 件ずつ計算する（楕円曲線には SIMD カーネルがない）
+     */
+    void pow_many(const Term* terms, const FixedTerm* fixed_terms, std::size_t count, Element* results) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            results[i] = multi_mul(&terms[i], 1);
+            if (fixed_terms)
+            {
+                results[i] = points_.mul(fixed_terms[i].table.pow(fixed_terms[i].exponent), results[i]);
+            }
+        }
+    }
+
+    std::size_t pow_lanes() const { return 1; }
+
+    /**
+     * @fn
+     * @brief 2 点が等しいかを比較する（Jacobian 座標のまま、Z を掛け合わせて比較する）
+     */
+    bool equal(const Element& a, const Element& b) const
+    {
+        if (a.is_identity() || b.is_identity())
+        {
+            return a.is_identity() && b.is_identity();
+        }
+        const auto z1z1 = field_.sqr(a.z);
+        const auto z2z2 = field_.sqr(b.z);
+        if (field_.mul(a.x, z2z2) != field_.mul(b.x, z1z1))
+        {
+            return false;
+        }
+        return field_.mul(a.y, field_.mul(b.z, z2z2)) == field_.mul(b.y, field_.mul(a.z, z1z1));
+    }
+
+    /**
+     * @fn
+     * @brief 公開鍵として妥当か（無限遠点でない）を確認する
+     * @note  P-256 の余因子は 1 のため、曲線上の点は全て位数 q の部分群に属する。
+     */
+    bool is_public_key(const Element& a) const { return !a.is_identity(); }
+
+    /**
+     * @fn
+     * @brief SEC1 非圧縮形式（0x04 || X || Y）を整数とみなした値を点に変換する
+     * @param x 変換する整数
+     * @return 座標が [0, p) にあり曲線上の点であれば要素表現、それ以外は std::nullopt
+     */
+    std::optional<Element> decode(const cpp_int& x) const
+    {
+        if (x <= 0 || (x >> 512) != 4)
+        {
+            return std::nullopt;
+        }
+        const cpp_int mask = (cpp_int(1) << 256) - 1;
+        const cpp_int ax = (x >> 256) & mask;
+        const cpp_int ay = x & mask;
+        if (ax >= p_ || ay >= p_)
+        {
+            return std::nullopt;
+        }
+        const auto mx = field_.from_integer(ax);
+        const auto my = field_.from_integer(ay);
+        if (field_.sqr(my) != curve_rhs(mx))
+        {
+            return std::nullopt;
+        }
+        return affine_point(mx, my);
+    }
+
+    /**
+     * @fn
+     * @brief 点を SEC1 非圧縮形式の整数表現に変換する（無限遠点は 0）
+     */
+    cpp_int encode(const Element& a) const
+    {
+        if (a.is_identity())
+        {
+            return 0;
+        }
+        // Z^{-1} = Z^(p-2)（フェルマーの小定理）
+        const auto z_inv = power(field_, a.z, p_ - 2);
+        const auto z_inv2 = field_.sqr(z_inv);
+        const cpp_int ax = field_.to_integer(field_.mul(a.x, z_inv2));
+        const cpp_int ay = field_.to_integer(field_.mul(a.y, field_.mul(z_inv2, z_inv)));
+        return (cpp_int(4) << 512) | (ax << 256) | ay;
+    }
+
+    // encode した整数を固定長のバイト列で送るときの長さ
+    std::size_t encoded_bytes() const { return kEncodedBytes; }
+
+   private:
+    P256Field field_;
+    P256PointArithmetic points_;
+    cpp_int p_;
+    cpp_int n_;
+    Limbs<4> b_;
+    Element g_;
+    Element h_;
+    std::shared_ptr<const Table> g_table_;
+    std::shared_ptr<const Table> h_table_;
+
+    Element affine_point(const Limbs<4>& x, const Limbs<4>& y) const { return {x, y, field_.one()}; }
+
+    /**
+     * @fn
+     * @brief Σ e_i P_i を幅 w の wNAF（符号付きの奇数の桁）による Straus 法で計算する
+     * @note  点の逆元は Y の符号の反転だけで求まるため、桁を -(2^(w-1) - 1) 〜 2^(w-1) - 1 の奇数にとり、
+     *        各項に P, 3P, ..., (2^(w-1) - 1)P の 2^(w-2) 点だけを用意する。0 でない桁は平均 w + 1 ビットに 1 つで、
+     *        符号なしの w ビットウィンドウ（2^w - 1 点、w ビットに 1 回の加算）より前計算も加算も少ない。
+     *        2 倍算は全項で共有する。
+     */
+    Element multi_mul(const Term* terms, std::size_t count) const
+    {
+        // 項 i の 2^k の桁は digits[layout[i].digits + k]、(2m + 1) P_i は odd[layout[i].points + m]
+        struct Layout
+        {
+            unsigned bits;
+            std::size_t digits;
+            std::size_t points;
+        };
+        std::vector<Layout> layout(count);
+        unsigned max_bits = 0;
+        std::size_t digit_count = 0;
+        std::size_t point_count = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const unsigned bits = exponent_bits(terms[i].exponent);
+            layout[i] = {bits, digit_count, point_count};
+            max_bits = std::max(max_bits, bits);
+            digit_count += bits + 1;
+            point_count += bits == 0 ? 0 : std::size_t{1} << (wnaf_window_bits(bits) - 2);
+        }
+        if (max_bits == 0)
+        {
+            return points_.one();
+        }
+
+        std::vector<std::int8_t> digits(digit_count, 0);
+        std::vector<Element> odd;
+        odd.reserve(point_count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const unsigned bits = layout[i].bits;
+            if (bits == 0)
+            {
+                continue;
+            }
+            const unsigned w = wnaf_window_bits(bits);
+            wnaf_digits(terms[i].exponent, bits, w, &digits[layout[i].digits]);
+            const Element twice = points_.sqr(terms[i].base);
+            odd.push_back(terms[i].base);
+            for (std::size_t m = 1; m < (std::size_t{1} << (w - 2)); ++m)
+            {
+                odd.push_back(points_.mul(odd.back(), twice));
+            }
+        }
+
+        Element acc = points_.one();
+        for (std::size_t k = max_bits + 1; k-- > 0;)
+        {
+            acc = points_.sqr(acc);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (k > layout[i].bits)
+                {
+                    continue;
+                }
+                const int d = digits[layout[i].digits + k];
+                if (d > 0)
+                {
+                    acc = points_.mul(acc, odd[layout[i].points + static_cast<std::size_t>(d >> 1)]);
+                }
+                else if (d < 0)
+                {
+                    acc = points_.mul(acc, points_.negate(odd[layout[i].points + static_cast<std::size_t>(-d >> 1)]));
+                }
+            }
+        }
+        return acc;
+    }
+
+    // スカラーのビット長に応じた wNAF の幅（短い重みは前計算の点を減らす）
+    static unsigned wnaf_window_bits(unsigned bits) { return bits <= 96 ? 4 : 5; }
+
+    /**
+     * @fn
+     * @brief e の幅 w の wNAF を digits[0 .. bits] に書き込む（digits は 0 で初期化しておくこと）
+     * @note  下位から、繰り上がりを含めたビットが 1 になる位置で w ビットを取り出して奇数の桁にし、
+     *        2^(w-1) 以上なら 2^w を引いて次の桁へ繰り上げる。e 自体は書き換えない。
+     */
+    static void wnaf_digits(const cpp_int& e, unsigned bits, unsigned w, std::int8_t* digits)
+    {
+        unsigned carry = 0;
+        unsigned bit = 0;
+        while (bit < bits)
+        {
+            if (exponent_window(e, bit, 1) == carry)
+            {
+                ++bit;
+                continue;
+            }
+            const unsigned now = std::min(w, bits - bit);
+            int word = static_cast<int>(exponent_window(e, bit, now) + carry);
+            carry = (static_cast<unsigned>(word) >> (w - 1)) & 1;
+            word -= static_cast<int>(carry << w);
+            digits[bit] = static_cast<std::int8_t>(word);
+            bit += now;
+        }
+        digits[bits] = static_cast<std::int8_t>(carry);
+    }
+
+    // x^3 - 3x + b
+    Limbs<4> curve_rhs(const Limbs<4>& x) const
+    {
+        const auto x3 = field_.mul(field_.sqr(x), x);
+        const auto three_x = field_.add(field_.add(x, x), x);
+        return field_.add(field_.sub(x3, three_x), b_);
+    }
+
+    /**
+     * @fn
+     * @brief 種から離散対数が誰にも分からない点を導出する（try-and-increment）
+     * @note  種のバイト列を整数とみなした値を x の初期値とし、x^3 - 3x + b が平方剰余になるまで x を 1 ずつ増やす。
+     *        p ≡ 3 (mod 4) なので平方根は rhs^((p+1)/4) で求まる。2 つの平方根のうち y が偶数の方を選ぶ。
+     */
+    Element derive_point(std::string_view seed) const
+    {
+        cpp_int x;
+        import_bits(x, seed.begin(), seed.end(), 8);
+        const cpp_int sqrt_exponent = (p_ + 1) / 4;
+        for (;; ++x)
+        {
+            const auto mx = field_.from_integer(x % p_);
+            const auto rhs = curve_rhs(mx);
+            auto my = power(field_, rhs, sqrt_exponent);
+            if (field_.sqr(my) != rhs)
+            {
+                continue;
+            }
+            if (field_.to_integer(my) % 2 != 0)
+            {
+                my = field_.sub(Limbs<4>{}, my);
+            }
+            return affine_point(mx, my);
+        }
+    }
+};
+
+#endif  // EC_GROUP_HPP
@@ -0,0 +1,212 @@
+#include "ec_group.hpp"
+
+#include <gtest/gtest.h>
+
+#include "chaum_pedersen.hpp"
+#include "zkp_group.hpp"
+
+namespace
+{
+// 2G のアフィン座標（SEC1 非圧縮形式の整数表現）
+const cpp_int kP256TwoG(
+    "0x04"
+    "7CF27B188D034F7E8A52380304B51AC3C08969E277F21B35A60B48FC47669978"
+    "07775510DB8ED040293D9AC69F7430DBBA7DADE63CE982299E04B79D227873D1");
+}  // namespace
+
+TEST(EcGroupTest, PointArithmetic)
+{
+    const EcGroup& group = get_zkp_p256_group();
+    const P256PointArithmetic& points = group.arithmetic();
+
+    // G + G = 2G（加算は等しい点で 2 倍算に切り替わる）
+    EXPECT_EQ(group.encode(points.sqr(group.g())), kP256TwoG);
+    EXPECT_EQ(group.encode(points.mul(group.g(), group.g())), kP256TwoG);
+    EXPECT_EQ(group.encode(group.pow_g(2)), kP256TwoG);
+
+    // nG = O, (n-1)G + G = O
+    EXPECT_TRUE(group.pow_g(group.order()).is_identity());
+    EXPECT_TRUE(points.mul(group.pow_g(group.order() - 1), group.g()).is_identity());
+
+    // テーブル参照と可変基底のスカラー倍算が一致し、Jacobian 表現が異なっても equal で比較できる
+    const cpp_int k = generate_random(group.order());
+    const auto by_table = group.pow_g(k);
+    const auto by_power = power(points, group.g(), k);
+    EXPECT_TRUE(group.equal(by_table, by_power));
+    EXPECT_EQ(group.encode(by_table), group.encode(by_power));
+    EXPECT_FALSE(group.equal(by_table, group.pow_g(k + 1)));
+}
+
+TEST(EcGroupTest, FieldMatchesReference)
+{
+    const P256Field field;
+    const cpp_int p = integer_from_limbs(P256Field::kModulus);
+
+    // 還元の境界に近い値（0, 1, p - 1, 2^255, 全ビットが 1 に近い値）と乱数
+    std::vector<cpp_int> values = {0, 1, 2, p - 1, p - 2, cpp_int(1) << 255, (cpp_int(1) << 224) - 1,
+                                   p - (cpp_int(1) << 96), (cpp_int(1) << 192) + 1};
+    for (int i = 0; i < 64; ++i)
+    {
+        values.push_back(generate_random(p));
+    }
+    for (const cpp_int& a : values)
+    {
+        const auto ma = field.from_integer(a);
+        EXPECT_EQ(field.to_integer(field.sqr(ma)), a * a % p) << a;
+        for (const cpp_int& b : values)
+        {
+            const auto mb = field.from_integer(b);
+            ASSERT_EQ(field.to_integer(field.mul(ma, mb)), a * b % p) << a << " * " << b;
+            ASSERT_EQ(field.to_integer(field.add(ma, mb)), (a + b) % p) << a << " + " << b;
+            ASSERT_EQ(field.to_integer(field.sub(ma, mb)), (a + p - b) % p) << a << " - " << b;
+        }
+    }
+}
+
+TEST(EcGroupTest, MixedAdditionAndNormalizedTables)
+{
+    const EcGroup& group = get_zkp_p256_group();
+    const P256PointArithmetic& points = group.arithmetic();
+    const P256Field& field = points.field();
+
+    // 同じ点を Z != 1 の表現（(λ^2 X, λ^3 Y, λ Z)）にしても、Z = 1 の点との加算（madd）と一般の加算が一致する
+    const auto p1 = group.pow_g(generate_random(group.order()));
+    const auto affine = *group.decode(group.encode(group.pow_h(generate_random(group.order()))));
+    ASSERT_TRUE(affine.is_affine());
+    const auto lambda = field.from_integer(generate_random(group.modulus()));
+    const auto lambda2 = field.sqr(lambda);
+    const JacobianPoint scaled = {field.mul(affine.x, lambda2), field.mul(affine.y, field.mul(lambda2, lambda)),
+                                  lambda};
+    ASSERT_FALSE(scaled.is_affine());
+    EXPECT_TRUE(group.equal(points.mul(p1, affine), points.mul(p1, scaled)));
+    EXPECT_TRUE(group.equal(points.mul(affine, p1), points.mul(scaled, p1)));
+    // P + P と P + (-P)
+    EXPECT_TRUE(group.equal(points.mul(scaled, affine), points.sqr(affine)));
+    EXPECT_TRUE(points.mul(points.negate(scaled), affine).is_identity());
+
+    // テーブルのエントリは Z = 1 にそろえてあり、値は変わらない
+    const auto& table = *group.g_table();
+    for (unsigned k = 0; k < table.window_count(); k += 7)
+    {
+        const auto& entry = table.entry(k, 5);
+        EXPECT_TRUE(entry.is_affine()) << k;
+        EXPECT_TRUE(group.equal(entry, power(points, group.g(), cpp_int(5) << (k * table.window_bits())))) << k;
+    }
+}
+
+TEST(EcGroupTest, SignedWindowMultiplicationMatchesPower)
+{
+    const EcGroup& group = get_zkp_p256_group();
+    const P256PointArithmetic& points = group.arithmetic();
+    const cpp_int& n = group.order();
+
+    const auto y1 = group.pow_g(generate_random(n));
+    const auto y2 = group.pow_h(generate_random(n));
+    // 0、桁の繰り上がりが続く値（2^k - 1）、短い重み、n を超える値（バッチ検証の z * c）
+    const std::vector<cpp_int> exponents = {0,
+                                            1,
+                                            15,
+                                            16,
+                                            (cpp_int(1) << 64) - 1,
+                                            (cpp_int(1) << 255) - 1,
+                                            n - 1,
+                                            generate_random(n),
+                                            generate_random(n) * ((cpp_int(1) << 64) - 59)};
+    for (const cpp_int& e : exponents)
+    {
+        const cpp_int s = generate_random(n);
+        EXPECT_TRUE(group.equal(group.mul_pow_g(s, y1, e), points.mul(group.pow_g(s), power(points, y1, e)))) << e;
+
+        const std::vector<EcGroup::Term> terms = {{y1, e}, {y2, exponents[2]}};
+        const auto expected = points.mul(points.mul(power(points, y1, e), power(points, y2, exponents[2])),
+                                         points.mul(group.pow_g(s), group.pow_h(e % n)));
+        const cpp_int eh = e % n;
+        EXPECT_TRUE(group.equal(group.multi_pow(terms, s, eh), expected)) << e;
+
+        EcGroup::Element result;
+        group.pow_many(&terms[0], nullptr, 1, &result);
+        EXPECT_TRUE(group.equal(result, power(points, y1, e))) << e;
+    }
+}
+
+TEST(EcGroupTest, DerivedGeneratorIsOnCurve)
+{
+    const EcGroup& group = get_zkp_p256_group();
+
+    // H は種から決定的に導出され、曲線上にあり G とは異なる
+    const cpp_int h = group.encode(group.h());
+    ASSERT_TRUE(group.decode(h));
+    EXPECT_FALSE(group.equal(group.g(), group.h()));
+    EXPECT_EQ(h, group.encode(EcGroup().h()));
+    EXPECT_TRUE(group.pow_h(group.order()).is_identity());
+}
+
+TEST(EcGroupTest, DecodeRejectsInvalidPoints)
+{
+    const EcGroup& group = get_zkp_p256_group();
+
+    const cpp_int g = group.encode(group.g());
+    ASSERT_TRUE(group.decode(g));
+    EXPECT_TRUE(group.equal(*group.decode(g), group.g()));
+    EXPECT_TRUE(group.is_public_key(*group.decode(g)));
+
+    EXPECT_FALSE(group.decode(0));
+    EXPECT_FALSE(group.decode(g + 1));                                // 曲線外
+    EXPECT_FALSE(group.decode(g ^ (cpp_int(6) << 512)));              // 先頭バイトが 0x02（圧縮形式）
+    EXPECT_FALSE(group.decode(g | (cpp_int(1) << 520)));              // 65 バイトを超える
+    EXPECT_FALSE(group.decode((cpp_int(4) << 512) | (group.modulus() << 256)));  // x >= p
+}
+
+TEST(EcGroupTest, VerifyProof)
+{
+    P256ChaumPedersen cp(get_zkp_p256_group());
+    const cpp_int& q = cp.order();
+
+    const cpp_int x = generate_random(q);
+    const auto public_keys = cp.calculate_public_keys(x);
+    const cpp_int k = generate_random(q);
+    const auto commitment = cp.create_commitment(k);
+    const Challenge challenge = {generate_random(q)};
+    const Response response = cp.solve_response(k, challenge, x);
+
+    EXPECT_TRUE(cp.verify_proof(commitment, public_keys, challenge, response));
+    EXPECT_FALSE(cp.verify_proof(commitment, public_keys, challenge, {(response.s + 1) % q}));
+
+    // 整数表現を経由しても検証できる
+    const auto& group = cp.group();
+    const auto r1 = group.decode(group.encode(commitment.r1));
+    const auto y1 = group.decode(group.encode(public_keys.y1));
+    ASSERT_TRUE(r1 && y1);
+    EXPECT_TRUE(cp.verify_proof({*r1, commitment.r2}, {*y1, public_keys.y2}, challenge, response));
+}
+
+TEST(EcGroupTest, VerifyBatchFindsInvalidProofs)
+{
+    P256ChaumPedersen cp(get_zkp_p256_group());
+    const cpp_int& q = cp.order();
+
+    std::vector<P256ChaumPedersen::Proof> proofs;
+    for (int i = 0; i < 6; ++i)
+    {
+        const cpp_int x = generate_random(q);
+        const cpp_int k = generate_random(q);
+        const Challenge challenge = {generate_random(q)};
+        proofs.push_back({cp.create_commitment(k), cp.calculate_public_keys(x), challenge,
+                          cp.solve_response(k, challenge, x)});
+    }
+    EXPECT_EQ(cp.verify_batch(proofs), std::vector<bool>(proofs.size(), true));
+
+    proofs[4].response.s = (proofs[4].response.s + 1) % q;
+    std::vector<bool> expected(proofs.size(), true);
+    expected[4] = false;
+    EXPECT_EQ(cp.verify_batch(proofs), expected);
+}
+
+TEST(GroupIdTest, NamesRoundTrip)
+{
+    for (GroupId id : {GroupId::kModp1024, GroupId::kP256})
+    {
+        EXPECT_EQ(parse_group_id(group_name(id)), id);
+    }
+    EXPECT_FALSE(parse_group_id("secp256k1"));
+}
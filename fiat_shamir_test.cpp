@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "chaum_pedersen.hpp"
+#include "replay_cache.hpp"
+#include "sha256.hpp"
+#include "zkp_group.hpp"
+
+namespace
+{
+std::string to_hex(const Sha256::Digest& digest)
+{
+    std::string bytes(digest.begin(), digest.end());
+    std::string hex = encode_hex(decode_fixed(bytes, bytes.size()).value());
+    return std::string(64 - hex.size(), '0') + hex;
+}
+
+// x を秘密鍵とする非対話の証明を作り、導出したチャレンジとレスポンスを返す
+template <typename CP>
+std::pair<Challenge, Response> prove(const CP& cp, const PublicKeys& public_keys, const Commitment& commitment,
+                                     const cpp_int& k, const cpp_int& x, std::uint64_t timestamp_ms)
+{
+    const Challenge c = cp.fiat_shamir_challenge(public_keys, commitment, "alice", timestamp_ms);
+    return {c, cp.solve_response(k, c, x)};
+}
+
+template <typename CP>
+void expect_non_interactive_proof(const CP& cp)
+{
+    const auto& group = cp.group();
+    const cpp_int x = generate_random(cp.order());
+    const cpp_int k = generate_random(cp.order());
+    const auto y = cp.calculate_public_keys(x);
+    const auto r = cp.create_commitment(k);
+    const PublicKeys public_keys = {group.encode(y.y1), group.encode(y.y2)};
+    const Commitment commitment = {group.encode(r.r1), group.encode(r.r2)};
+
+    const auto [c, s] = prove(cp, public_keys, commitment, k, x, 1700000000000);
+    EXPECT_LT(c.c, cp.order());
+    EXPECT_TRUE(cp.verify_proof(r, y, c, s));
+
+    // 検証者は同じトランスクリプトから同じ c を導出する。ユーザー名・時刻・コミットメントが違えば c も変わる。
+    EXPECT_EQ(cp.fiat_shamir_challenge(public_keys, commitment, "alice", 1700000000000).c, c.c);
+    EXPECT_NE(cp.fiat_shamir_challenge(public_keys, commitment, "bob", 1700000000000).c, c.c);
+    EXPECT_NE(cp.fiat_shamir_challenge(public_keys, commitment, "alice", 1700000000001).c, c.c);
+    const Commitment swapped = {commitment.r2, commitment.r1};
+    EXPECT_NE(cp.fiat_shamir_challenge(public_keys, swapped, "alice", 1700000000000).c, c.c);
+    EXPECT_FALSE(cp.verify_proof(r, y, cp.fiat_shamir_challenge(public_keys, commitment, "bob", 1700000000000), s));
+}
+}  // namespace
+
+TEST(Sha256Test, KnownAnswers)
+{
+    EXPECT_EQ(to_hex(Sha256::hash("")), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(to_hex(Sha256::hash("abc")), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(to_hex(Sha256::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+    // 100 万個の 'a' をブロック境界にそろわない長さで分けて与える
+    Sha256 sha;
+    const std::string chunk(999, 'a');
+    for (int i = 0; i < 1000; ++i)
+    {
+        sha.update(chunk);
+    }
+    sha.update(std::string(1000, 'a'));
+    EXPECT_EQ(to_hex(sha.finish()), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(Sha256Test, HmacKnownAnswers)
+{
+    // RFC 4231 のテストケース 2（短い鍵）と 6（ブロック長を超える鍵）
+    EXPECT_EQ(to_hex(HmacSha256("Jefe").mac("what do ya want for nothing?")),
+              "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    const HmacSha256 hmac(std::string(131, '\xaa'));
+    EXPECT_EQ(to_hex(hmac.mac("Test Using Larger Than Block-Size Key - Hash Key First")),
+              "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+    // 同じインスタンスで繰り返し計算できる
+    EXPECT_EQ(to_hex(hmac.mac("Test Using Larger Than Block-Size Key - Hash Key First")),
+              "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+TEST(FiatShamirTest, ModpProofVerifies) { expect_non_interactive_proof(MontChaumPedersen(get_zkp_mont_group())); }
+
+TEST(FiatShamirTest, P256ProofVerifies) { expect_non_interactive_proof(P256ChaumPedersen(get_zkp_p256_group())); }
+
+TEST(ReplayCacheTest, AcceptsEachKeyOnceUntilExpiry)
+{
+    ReplayCache<4> cache(std::chrono::milliseconds(1));
+    const std::int64_t now_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+
+    EXPECT_TRUE(cache.insert("proof-a", now_ms + 60000));
+    EXPECT_FALSE(cache.insert("proof-a", now_ms + 60000));
+    EXPECT_TRUE(cache.insert("proof-b", now_ms + 20));
+    EXPECT_EQ(cache.size(), 2u);
+
+    // 期限を過ぎたキーは次の insert で取り除かれ、再び記録できる
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(cache.insert("proof-b", now_ms + 60000));
+    EXPECT_FALSE(cache.insert("proof-a", now_ms + 60000));
+}
@@ -0,0 +1,143 @@
+#ifndef FIXED_BASE_TABLE_HPP
+#define FIXED_BASE_TABLE_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "modular_arithmetic.hpp"
+
+using namespace boost::multiprecision;
+
+// 演算ポリシーが normalize(Element*, count) を持つか（楕円曲線の点をテーブル参照で足しやすい表現にそろえる）
+template <typename Arithmetic, typename = void>
+struct HasNormalize : std::false_type
+{
+};
+
+template <typename Arithmetic>
+struct HasNormalize<Arithmetic, std::void_t<decltype(std::declval<const Arithmetic&>().normalize(
+                                    std::declval<typename Arithmetic::Element*>(), std::size_t{}))>> : std::true_type
+{
+};
+
+/**
+ * @brief 固定基底 base に対する固定ウィンドウ事前計算テーブル
+ * @note  指数を w ビットずつのウィンドウに分割し、各ウィンドウ位置 i について
+ *        base^(d * 2^(w*i)) mod p (d = 1 .. 2^w - 1) を保持する。
+ *        べき乗は「ウィンドウ数」回の乗算だけで求まり、二乗算は不要になる。
+ *        演算ポリシーが normalize を持つ場合は、構築後にエントリをまとめて渡す（P-256 では Z = 1 の点にそろえる）。
+ *        テーブルは構築後に変更されないため、複数スレッドから同時に参照してよい。
+ * @tparam Arithmetic 剰余演算ポリシー（CppIntModArithmetic / MontgomeryArithmetic）
+ */
+template <typename Arithmetic>
+class FixedBaseTable
+{
+   public:
+    using Element = typename Arithmetic::Element;
+
+    /**
+     * @fn
+     * @brief コンストラクタ。テーブルを構築する。
+     * @param arith 剰余演算ポリシー
+     * @param base 固定基底（arith の要素表現）
+     * @param max_exponent_bits テーブルで扱う指数の最大ビット長（通常は位数 q のビット長）
+     * @param window_bits ウィンドウ幅 w（1〜8）
+     */
+    FixedBaseTable(const Arithmetic& arith, const Element& base, unsigned max_exponent_bits, unsigned window_bits)
+        : arith_(arith),
+          base_(base),
+          window_bits_(window_bits),
+          window_count_((max_exponent_bits + window_bits - 1) / window_bits),
+          row_size_((1u << window_bits) - 1)
+    {
+        table_.reserve(static_cast<std::size_t>(window_count_) * row_size_);
+
+        // row_base = base^(2^(w*i)) mod p
+        Element row_base = base_;
+        for (unsigned i = 0; i < window_count_; ++i)
+        {
+            Element acc = row_base;
+            table_.push_back(acc);
+            for (unsigned d = 2; d <= row_size_; ++d)
+            {
+                acc = arith_.mul(acc, row_base);
+                table_.push_back(acc);
+            }
+            // 次の行の基底は row_base^(2^w) = acc * row_base
+            row_base = arith_.mul(acc, row_base);
+        }
+        if constexpr (HasNormalize<Arithmetic>::value)
+        {
+            arith_.normalize(table_.data(), table_.size());
+        }
+    }
+
+    /**
+     * @fn
+     * @brief base^exponent mod p をテーブル参照で計算する
+     * @note  指数がテーブルの範囲を超える場合は可変基底のべき乗にフォールバックする
+     * @param exponent 指数（非負）
+     * @return base^exponent mod p
+     */
+    Element pow(const cpp_int& exponent) const
+    {
+        if (!covers(exponent))
+        {
+            return power(arith_, base_, exponent);
+        }
+        const unsigned bits = exponent_bits(exponent);
+
+        Element result = arith_.one();
+        const unsigned windows = (bits + window_bits_ - 1) / window_bits_;
+        for (unsigned k = 0; k < windows; ++k)
+        {
+            const unsigned d = exponent_window(exponent, static_cast<std::size_t>(k) * window_bits_, window_bits_);
+            if (d != 0)
+            {
+                result = arith_.mul(result, table_[k * row_size_ + (d - 1)]);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @fn
+     * @brief テーブル構築に使用した基底を返す
+     */
+    const Element& base() const { return base_; }
+
+    // ウィンドウ幅 w とウィンドウ数
+    unsigned window_bits() const { return window_bits_; }
+    unsigned window_count() const { return window_count_; }
+
+    // 指数がテーブルで扱える長さ（window_count() * w ビット以内）か
+    bool covers(const cpp_int& exponent) const { return exponent_bits(exponent) <= window_count_ * window_bits_; }
+
+    /**
+     * @fn
+     * @brief ウィンドウ位置 k の桁 d のエントリ base^(d * 2^(w*k)) mod p を返す
+     * @param k ウィンドウ位置（window_count() 未満）
+     * @param d 桁（1 〜 2^w - 1）
+     */
+    const Element& entry(unsigned k, unsigned d) const { return table_[k * row_size_ + (d - 1)]; }
+
+    /**
+     * @fn
+     * @brief テーブルが保持するエントリ数を返す
+     */
+    std::size_t size() const { return table_.size(); }
+
+   private:
+    Arithmetic arith_;
+    Element base_;
+    unsigned window_bits_;
+    unsigned window_count_;
+    unsigned row_size_;
+    // table_[i * row_size_ + (d - 1)] = base^(d * 2^(w*i)) mod p
+    std::vector<Element> table_;
+};
+
+#endif  // FIXED_BASE_TABLE_HPP
@@ -0,0 +1,264 @@
+#ifndef KEY_TABLE_CACHE_HPP
+#define KEY_TABLE_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// KeyTableCache の設定
+struct KeyTableCacheOptions
+{
+    // テーブルに使うメモリの上限（バイト）。0 の場合はキャッシュしない。
+    std::size_t memory_bytes = 0;
+    // キャッシュにないユーザーの最近のログイン回数（推定値）がこの回数に達したらテーブルを構築する（1〜255）
+    std::uint32_t min_logins = 8;
+    // テーブルのウィンドウ幅（大きいほど検証は速く、テーブルは大きい）
+    unsigned window_bits = 4;
+};
+
+// KeyTableCache の集計値
+struct KeyTableCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t builds = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t entries = 0;
+    std::uint64_t bytes = 0;
+
+    KeyTableCacheStats& operator+=(const KeyTableCacheStats& other)
+    {
+        hits += other.hits;
+        misses += other.misses;
+        builds += other.builds;
+        evictions += other.evictions;
+        entries += other.entries;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+/**
+ * @brief ログイン頻度の高いユーザーの公開鍵テーブルを、メモリの上限まで保持する LRU キャッシュ
+ * @note  キャッシュにないユーザーのログイン回数は count-min sketch（4 行 × kSketchWidth 個の 8 ビットカウンタ）で
+ *        数え、kSketchSamples 回数えるごとに全カウンタを半分にして古いログインの重みを下げる。
+ *        推定回数が min_logins に達したユーザーは begin_build で 1 スレッドだけが構築を引き受け、
+ *        insert で登録する。上限を超える場合は最も長く参照されていないテーブルから捨てる。
+ *        全体を 1 つの mutex で守る。保持する処理は数百ナノ秒以下で、守られる検証（数十〜数百マイクロ秒）に比べて短い。
+ * @tparam Value テーブルの型
+ */
+template <typename Value>
+class KeyTableCache
+{
+   public:
+    static constexpr std::size_t kSketchDepth = 4;
+    static constexpr unsigned kSketchWidthBits = 12;
+    static constexpr std::size_t kSketchWidth = std::size_t{1} << kSketchWidthBits;
+    static constexpr std::uint64_t kSketchSamples = 10 * kSketchWidth;
+
+    explicit KeyTableCache(const KeyTableCacheOptions& options = {}) : options_(options)
+    {
+        if (enabled())
+        {
+            sketch_.assign(kSketchDepth * kSketchWidth, 0);
+        }
+    }
+
+    KeyTableCache(const KeyTableCache&) = delete;
+    KeyTableCache& operator=(const KeyTableCache&) = delete;
+
+    bool enabled() const { return options_.memory_bytes != 0; }
+
+    const KeyTableCacheOptions& options() const { return options_; }
+
+    /**
+     * @fn
+     * @brief ユーザーのテーブルを取得する。見つからない場合はログイン回数を数える。
+     * @return キャッシュしない場合、見つからない場合は nullptr
+     */
+    std::shared_ptr<const Value> find(const std::string& user)
+    {
+        if (!enabled())
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(user);
+        if (it == index_.end())
+        {
+            ++stats_.misses;
+            count_login(user);
+            return nullptr;
+        }
+        ++stats_.hits;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->value;
+    }
+
+    /**
+     * @fn
+     * @brief テーブルを構築すべきユーザーかを判定し、構築を引き受ける
+     * @return ログイン回数が min_logins に達していて、キャッシュになく、他に構築中でない場合は true。
+     *         true を返した場合は insert または cancel_build を必ず呼ぶこと。
+     */
+    bool begin_build(const std::string& user)
+    {
+        if (!enabled())
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (estimate_logins(user) < options_.min_logins || index_.count(user) != 0)
+        {
+            return false;
+        }
+        return building_.insert(user).second;
+    }
+
+    /**
+     * @fn
+     * @brief begin_build で引き受けた構築をやめる
+     */
+    void cancel_build(const std::string& user)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_.erase(user);
+    }
+
+    /**
+     * @fn
+     * @brief テーブルを登録する。上限を超える分は最も長く参照されていないテーブルから捨てる。
+     * @param bytes テーブルが使うバイト数（上限を超える場合は登録しない）
+     */
+    void insert(const std::string& user, std::shared_ptr<const Value> value, std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        building_.erase(user);
+        if (bytes > options_.memory_bytes)
+        {
+            return;
+        }
+        erase_locked(user);
+        while (bytes_ + bytes > options_.memory_bytes)
+        {
+            const std::string victim = lru_.back().user;
+            erase_locked(victim);
+            ++stats_.evictions;
+        }
+        lru_.push_front({user, std::move(value), bytes});
+        index_.emplace(user, lru_.begin());
+        bytes_ += bytes;
+        ++stats_.builds;
+    }
+
+    /**
+     * @fn
+     * @brief ユーザーのテーブルを捨てる（公開鍵が変わった場合など）
+     */
+    void erase(const std::string& user)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(user);
+    }
+
+    KeyTableCacheStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        KeyTableCacheStats stats = stats_;
+        stats.entries = lru_.size();
+        stats.bytes = bytes_;
+        return stats;
+    }
+
+   private:
+    struct Entry
+    {
+        std::string user;
+        std::shared_ptr<const Value> value;
+        std::size_t bytes;
+    };
+
+    const KeyTableCacheOptions options_;
+
+    mutable std::mutex mutex_;
+    // 先頭が最も最近参照したテーブル
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    std::size_t bytes_ = 0;
+    // begin_build で構築を引き受けたユーザー
+    std::unordered_set<std::string> building_;
+    // sketch_[row * kSketchWidth + column]：キャッシュにないユーザーのログイン回数
+    std::vector<std::uint8_t> sketch_;
+    std::uint64_t sketch_samples_ = 0;
+    KeyTableCacheStats stats_;
+
+    // 行ごとに異なる奇数を掛けて上位ビットを列にする
+    static std::array<std::size_t, kSketchDepth> sketch_columns(const std::string& user)
+    {
+        static constexpr std::array<std::uint64_t, kSketchDepth> kMultipliers = {
+            0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+        const auto h = static_cast<std::uint64_t>(std::hash<std::string>{}(user));
+        std::array<std::size_t, kSketchDepth> columns;
+        for (std::size_t row = 0; row < kSketchDepth; ++row)
+        {
+            const auto column = static_cast<std::size_t>((h * kMultipliers[row]) >> (64 - kSketchWidthBits));
+            columns[row] = row * kSketchWidth + column;
+        }
+        return columns;
+    }
+
+    // mutex_ を保持した状態で呼ぶこと
+    void count_login(const std::string& user)
+    {
+        for (std::size_t column : sketch_columns(user))
+        {
+            if (sketch_[column] != UINT8_MAX)
+            {
+                ++sketch_[column];
+            }
+        }
+        if (++sketch_samples_ >= kSketchSamples)
+        {
+            for (std::uint8_t& counter : sketch_)
+            {
+                counter >>= 1;
+            }
+            sketch_samples_ = 0;
+        }
+    }
+
+    // mutex_ を保持した状態で呼ぶこと
+    std::uint32_t estimate_logins(const std::string& user) const
+    {
+        std::uint32_t estimate = UINT8_MAX;
+        for (std::size_t column : sketch_columns(user))
+        {
+            estimate = std::min<std::uint32_t>(estimate, sketch_[column]);
+        }
+        return estimate;
+    }
+
+    // mutex_ を保持した状態で呼ぶこと
+    void erase_locked(const std::string& user)
+    {
+        auto it = index_.find(user);
+        if (it == index_.end())
+        {
+            return;
+        }
+        bytes_ -= it->second->bytes;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+};
+
+#endif  // KEY_TABLE_CACHE_HPP
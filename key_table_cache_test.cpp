@@ -0,0 +1,119 @@
+#include "key_table_cache.hpp"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <memory>
+#include <string>
+
+#include "chaum_pedersen.hpp"
+#include "zkp_backend.hpp"
+
+TEST(KeyTableCacheTest, BuildsAfterMinLoginsAndEvictsLeastRecentlyUsed)
+{
+    KeyTableCache<int> cache({.memory_bytes = 300, .min_logins = 3});
+
+    // しきい値に達するまでは構築しない
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_FALSE(cache.find("alice"));
+        EXPECT_FALSE(cache.begin_build("alice"));
+    }
+    EXPECT_FALSE(cache.find("alice"));
+    EXPECT_TRUE(cache.begin_build("alice"));
+    // 構築中は他のスレッドに引き受けさせない
+    EXPECT_FALSE(cache.begin_build("alice"));
+    cache.insert("alice", std::make_shared<const int>(1), 100);
+    EXPECT_FALSE(cache.begin_build("alice"));
+    ASSERT_TRUE(cache.find("alice"));
+    EXPECT_EQ(*cache.find("alice"), 1);
+
+    cache.insert("bob", std::make_shared<const int>(2), 100);
+    cache.insert("carol", std::make_shared<const int>(3), 100);
+    // alice を参照したため、上限を超えると最も古い bob が捨てられる
+    EXPECT_TRUE(cache.find("alice"));
+    cache.insert("dave", std::make_shared<const int>(4), 100);
+    EXPECT_FALSE(cache.find("bob"));
+    EXPECT_TRUE(cache.find("carol"));
+    // 上限より大きいテーブルは入れない
+    cache.insert("erin", std::make_shared<const int>(5), 301);
+    EXPECT_FALSE(cache.find("erin"));
+
+    cache.erase("carol");
+    const KeyTableCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 4u);
+    EXPECT_EQ(stats.misses, 5u);
+    EXPECT_EQ(stats.builds, 4u);
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.bytes, 200u);
+}
+
+TEST(KeyTableCacheTest, CancelledBuildCanBeRetriedAndDisabledCacheCountsNothing)
+{
+    KeyTableCache<int> cache({.memory_bytes = 1000, .min_logins = 1});
+    EXPECT_FALSE(cache.find("alice"));
+    EXPECT_TRUE(cache.begin_build("alice"));
+    cache.cancel_build("alice");
+    EXPECT_TRUE(cache.begin_build("alice"));
+
+    KeyTableCache<int> disabled;
+    EXPECT_FALSE(disabled.enabled());
+    EXPECT_FALSE(disabled.find("alice"));
+    EXPECT_FALSE(disabled.begin_build("alice"));
+    EXPECT_EQ(disabled.stats().misses, 0u);
+}
+
+TEST(KeyTableCacheTest, BackendVerifiesFrequentUsersWithTables)
+{
+    MontChaumPedersen cp(get_zkp_mont_group());
+    BasicZkpBackend<MontChaumPedersen> backend(GroupId::kModp1024, MontChaumPedersen(get_zkp_mont_group()),
+                                               {.max_batch_size = 4, .max_wait = std::chrono::milliseconds(1)},
+                                               {.memory_bytes = 1 << 20, .min_logins = 2});
+    const auto& group = cp.group();
+    const cpp_int q = cp.order();
+    const cpp_int x = generate_random(q);
+    const auto keys = cp.calculate_public_keys(x);
+    const PublicKeys public_keys = {group.encode(keys.y1), group.encode(keys.y2)};
+
+    const auto login = [&](bool valid, bool async)
+    {
+        const cpp_int k = generate_random(q);
+        const auto commitment = cp.create_commitment(k);
+        const Challenge challenge = {generate_random(q)};
+        Response response = cp.solve_response(k, challenge, x);
+        if (!valid)
+        {
+            response.s = (response.s + 1) % q;
+        }
+        const Commitment encoded = {group.encode(commitment.r1), group.encode(commitment.r2)};
+        if (!async)
+        {
+            return backend.verify("alice", encoded, public_keys, challenge, response);
+        }
+        std::promise<bool> result;
+        EXPECT_TRUE(backend.submit("alice", encoded, public_keys, challenge, response,
+                                   [&](bool ok) { result.set_value(ok); }));
+        return result.get_future().get();
+    };
+
+    EXPECT_TRUE(login(true, false));
+    // しきい値に達しても検証に失敗した証明ではテーブルを作らない
+    EXPECT_FALSE(login(false, false));
+    EXPECT_EQ(backend.key_table_stats().builds, 0u);
+    // 同期版の検証ではテーブルを構築してから戻る
+    EXPECT_TRUE(login(true, false));
+    KeyTableCacheStats stats = backend.key_table_stats();
+    EXPECT_EQ(stats.builds, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_GT(stats.bytes, 0u);
+
+    EXPECT_TRUE(login(true, false));
+    EXPECT_FALSE(login(false, false));
+    EXPECT_TRUE(login(true, true));
+    EXPECT_FALSE(login(false, true));
+    stats = backend.key_table_stats();
+    EXPECT_EQ(stats.hits, 4u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.builds, 1u);
+}
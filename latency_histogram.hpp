@@ -0,0 +1,110 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief レイテンシのヒストグラム（HDR Histogram と同じ対数・線形の階級）
+ * @note  値（ナノ秒などの非負整数）が 2^kSubBucketBits 未満の範囲は 1 刻みで、それ以上は 2 のべき乗の区間ごとに
+ *        2^(kSubBucketBits-1) 個の等幅の階級で数える。相対誤差は 1/64 以下で、記録は O(1)・メモリは固定長。
+ *        スレッドセーフではない。スレッドごとに記録し、merge でまとめること。
+ */
+class LatencyHistogram
+{
+   public:
+    static constexpr unsigned kSubBucketBits = 7;
+    static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+    static constexpr std::size_t kHalfSubBuckets = kSubBuckets / 2;
+    static constexpr std::size_t kBuckets = kSubBuckets + (64 - kSubBucketBits) * kHalfSubBuckets;
+
+    void record(std::uint64_t value)
+    {
+        ++counts_[index_of(value)];
+        ++count_;
+        sum_ += static_cast<double>(value);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t min() const { return count_ == 0 ? 0 : min_; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : sum_ / static_cast<double>(count_); }
+
+    /**
+     * @fn
+     * @brief 分位点を返す
+     * @param quantile 0 以上 1 以下（0.99 は p99）
+     * @return 記録した値のうち quantile の割合がそれ以下となる値（階級の上端。最大値を超えない）
+     */
+    std::uint64_t percentile(double quantile) const
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+        const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(clamped * count_)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return std::min(std::max(highest_value(i), min_), max_);
+            }
+        }
+        return max_;
+    }
+
+   private:
+    std::array<std::uint64_t, kBuckets> counts_{};
+    std::uint64_t count_ = 0;
+    double sum_ = 0;
+    std::uint64_t min_ = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_ = 0;
+
+    static std::size_t index_of(std::uint64_t value)
+    {
+        if (value < kSubBuckets)
+        {
+            return static_cast<std::size_t>(value);
+        }
+        // value の最上位ビットの下 kSubBucketBits - 1 ビットで区間内の階級を決める
+        const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned shift = msb - kSubBucketBits + 1;
+        const std::size_t sub = static_cast<std::size_t>(value >> shift) - kHalfSubBuckets;
+        return kSubBuckets + (shift - 1) * kHalfSubBuckets + sub;
+    }
+
+    // 階級 index に入る最大の値
+    static std::uint64_t highest_value(std::size_t index)
+    {
+        if (index < kSubBuckets)
+        {
+            return index;
+        }
+        const std::size_t shift = (index - kSubBuckets) / kHalfSubBuckets + 1;
+        const std::uint64_t sub = (index - kSubBuckets) % kHalfSubBuckets + kHalfSubBuckets;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+#endif  // LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,47 @@
+#include "latency_histogram.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+TEST(LatencyHistogramTest, PercentilesWithinRelativeError)
+{
+    LatencyHistogram h;
+    for (std::uint64_t v = 1; v <= 100000; ++v)
+    {
+        h.record(v);
+    }
+    EXPECT_EQ(h.count(), 100000u);
+    EXPECT_EQ(h.min(), 1u);
+    EXPECT_EQ(h.max(), 100000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 50000.5);
+
+    // 階級の上端を返すため、真の値以上で相対誤差 1/64 以内
+    for (const double q : {0.5, 0.9, 0.99, 0.999})
+    {
+        const double exact = q * 100000;
+        const double value = static_cast<double>(h.percentile(q));
+        EXPECT_GE(value, exact) << q;
+        EXPECT_LE(value, exact * (1 + 1.0 / 64)) << q;
+    }
+    EXPECT_EQ(h.percentile(1.0), 100000u);
+    EXPECT_EQ(h.percentile(0.0), 1u);
+}
+
+TEST(LatencyHistogramTest, MergeAndExtremes)
+{
+    LatencyHistogram a;
+    LatencyHistogram b;
+    EXPECT_EQ(a.percentile(0.5), 0u);
+
+    a.record(0);
+    a.record(127);  // 1 刻みの範囲では正確
+    b.record(UINT64_MAX);
+    a.merge(b);
+
+    EXPECT_EQ(a.count(), 3u);
+    EXPECT_EQ(a.min(), 0u);
+    EXPECT_EQ(a.percentile(0.3), 0u);
+    EXPECT_EQ(a.percentile(0.6), 127u);
+    EXPECT_EQ(a.percentile(1.0), UINT64_MAX);
+}
@@ -0,0 +1,86 @@
+#ifndef LOCK_STATS_HPP
+#define LOCK_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+// ロック待ちの累計（LockWaitStats::load の結果）
+struct LockWaitCounters
+{
+    // 待ちが発生したロック取得の回数
+    std::uint64_t contended = 0;
+    // 待った時間の合計（ナノ秒）
+    std::uint64_t wait_ns = 0;
+
+    LockWaitCounters& operator+=(const LockWaitCounters& other)
+    {
+        contended += other.contended;
+        wait_ns += other.wait_ns;
+        return *this;
+    }
+};
+
+/**
+ * @brief mutex ごとのロック待ち時間の計測
+ * @note  まず try_lock を試し、取れなかった場合だけ時刻を読んで待ち時間を記録する。
+ *        競合しないロック取得には時刻の読み出しも共有カウンタの更新も加わらない。
+ *        計測対象の mutex と同じキャッシュラインに置くこと（競合時はどのみちそのラインを奪い合っている）。
+ */
+class LockWaitStats
+{
+   public:
+    void record(std::chrono::steady_clock::duration wait)
+    {
+        contended_.fetch_add(1, std::memory_order_relaxed);
+        wait_ns_.fetch_add(static_cast<std::uint64_t>(std::chrono::nanoseconds(wait).count()),
+                           std::memory_order_relaxed);
+    }
+
+    LockWaitCounters load() const
+    {
+        return {contended_.load(std::memory_order_relaxed), wait_ns_.load(std::memory_order_relaxed)};
+    }
+
+   private:
+    std::atomic<std::uint64_t> contended_{0};
+    std::atomic<std::uint64_t> wait_ns_{0};
+};
+
+/**
+ * @fn
+ * @brief 排他ロックを取り、待ちが発生した場合はその時間を stats に記録する
+ */
+template <typename Mutex>
+std::unique_lock<Mutex> lock_timed(Mutex& mutex, LockWaitStats& stats)
+{
+    std::unique_lock<Mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        stats.record(std::chrono::steady_clock::now() - start);
+    }
+    return lock;
+}
+
+/**
+ * @fn
+ * @brief 共有ロックを取り、待ちが発生した場合はその時間を stats に記録する
+ */
+template <typename Mutex>
+std::shared_lock<Mutex> lock_shared_timed(Mutex& mutex, LockWaitStats& stats)
+{
+    std::shared_lock<Mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        stats.record(std::chrono::steady_clock::now() - start);
+    }
+    return lock;
+}
+
+#endif  // LOCK_STATS_HPP
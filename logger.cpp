@@ -0,0 +1,414 @@
+#include "logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+std::size_t round_up_to_power_of_two(std::size_t n)
+{
+    std::size_t capacity = 1;
+    while (capacity < n)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 2026-01-02T03:04:05.678901Z（UTC、マイクロ秒）
+void append_time(std::string& out, std::int64_t time_ns)
+{
+    const std::time_t seconds = static_cast<std::time_t>(time_ns / 1000000000);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char buffer[40];
+    const std::size_t n = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    out.append(buffer, n);
+    std::snprintf(buffer, sizeof(buffer), ".%06dZ", static_cast<int>((time_ns % 1000000000) / 1000));
+    out.append(buffer);
+}
+
+// logfmt の値。空白・'='・'"'・制御文字を含む場合は引用符で囲んでエスケープする
+void append_value(std::string& out, std::string_view value)
+{
+    const auto special = [](char ch)
+    { return ch == ' ' || ch == '=' || ch == '"' || static_cast<unsigned char>(ch) < 0x20; };
+    const bool needs_quotes = value.empty() || std::any_of(value.begin(), value.end(), special);
+    if (!needs_quotes)
+    {
+        out.append(value);
+        return;
+    }
+    out += '"';
+    for (const char ch : value)
+    {
+        switch (ch)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        default:
+            out += static_cast<unsigned char>(ch) < 0x20 ? ' ' : ch;
+            break;
+        }
+    }
+    out += '"';
+}
+}  // namespace
+
+std::string_view log_level_name(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::kDebug:
+        return "debug";
+    case LogLevel::kInfo:
+        return "info";
+    case LogLevel::kWarn:
+        return "warn";
+    case LogLevel::kError:
+        return "error";
+    case LogLevel::kOff:
+    default:
+        return "off";
+    }
+}
+
+std::optional<LogLevel> parse_log_level(std::string_view name)
+{
+    for (const LogLevel level : {LogLevel::kDebug, LogLevel::kInfo, LogLevel::kWarn, LogLevel::kError, LogLevel::kOff})
+    {
+        if (name == log_level_name(level))
+        {
+            return level;
+        }
+    }
+    return std::nullopt;
+}
+
+// リングバッファの 1 要素。文字列の値は text にコピーする（入りきらない分は切り詰める）
+struct Logger::Record
+{
+    static constexpr std::size_t kTextBytes = 320;
+
+    struct Field
+    {
+        const char* key;
+        LogField::Type type;
+        std::uint16_t offset;
+        std::uint16_t length;
+        LogField::Value value;
+    };
+
+    std::int64_t time_ns;
+    const char* event;
+    LogLevel level;
+    std::uint8_t field_count;
+    std::array<Field, kMaxFields> fields;
+    std::array<char, kTextBytes> text;
+};
+
+/**
+ * @brief 単一生産者（ログを出すスレッド）・単一消費者（書き出しスレッド）のリングバッファ
+ * @note  生産者は head_、消費者は tail_ だけを書く。生産者は消費者の tail_ を満杯に見えたときだけ読み直す。
+ */
+class Logger::Ring
+{
+   public:
+    Ring(std::size_t capacity, std::uint32_t thread_id)
+        : thread_id(thread_id), slots_(new Record[capacity]), mask_(capacity - 1)
+    {
+    }
+
+    // 書き込む要素を返す。満杯の場合は nullptr
+    Record* try_reserve()
+    {
+        const std::uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_)
+        {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_)
+            {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    // try_reserve で返した要素を消費者に公開する
+    void commit() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    template <typename Func>
+    void drain(Func&& f)
+    {
+        std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        const std::uint64_t head = head_.load(std::memory_order_acquire);
+        for (; tail != head; ++tail)
+        {
+            f(slots_[tail & mask_]);
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+    }
+
+    const std::uint32_t thread_id;
+
+   private:
+    std::unique_ptr<Record[]> slots_;
+    const std::uint64_t mask_;
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    std::uint64_t cached_tail_ = 0;
+    alignas(64) std::atomic<std::uint64_t> tail_{0};
+};
+
+std::atomic<std::uint64_t> Logger::next_instance_id_{1};
+
+Logger::Logger(const LoggerOptions& options)
+    : instance_id_(next_instance_id_.fetch_add(1, std::memory_order_relaxed)),
+      level_(options.level),
+      sample_every_(std::max<std::uint32_t>(1, options.sample_every)),
+      ring_records_(round_up_to_power_of_two(std::max<std::size_t>(2, options.ring_records))),
+      flush_interval_(options.flush_interval)
+{
+    if (!options.path.empty())
+    {
+        if (std::FILE* file = std::fopen(options.path.c_str(), "a"))
+        {
+            output_ = file;
+            owns_output_ = true;
+        }
+    }
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        stopping_ = true;
+    }
+    writer_cv_.notify_all();
+    writer_.join();
+    if (owns_output_)
+    {
+        std::fclose(output_);
+    }
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+bool Logger::configure(const LoggerOptions& options)
+{
+    std::FILE* file = nullptr;
+    if (!options.path.empty())
+    {
+        file = std::fopen(options.path.c_str(), "a");
+        if (file == nullptr)
+        {
+            return false;
+        }
+    }
+    level_.store(options.level, std::memory_order_relaxed);
+    sample_every_.store(std::max<std::uint32_t>(1, options.sample_every), std::memory_order_relaxed);
+    ring_records_.store(round_up_to_power_of_two(std::max<std::size_t>(2, options.ring_records)),
+                        std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    // それまでに記録したレコードは元の出力先に書き出す
+    drain();
+    if (owns_output_)
+    {
+        std::fclose(output_);
+    }
+    output_ = file != nullptr ? file : stderr;
+    owns_output_ = file != nullptr;
+    flush_interval_ = options.flush_interval;
+    return true;
+}
+
+void Logger::log(LogLevel level, const char* event, std::initializer_list<LogField> fields)
+{
+    if (!enabled(level))
+    {
+        return;
+    }
+    thread_local ThreadState state;
+    if (level < LogLevel::kWarn)
+    {
+        const std::uint32_t sample_every = sample_every_.load(std::memory_order_relaxed);
+        if (sample_every > 1 && state.sampled++ % sample_every != 0)
+        {
+            return;
+        }
+    }
+
+    Ring& ring = local_ring(state);
+    Record* record = ring.try_reserve();
+    if (record == nullptr)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    record->time_ns = now_ns();
+    record->event = event;
+    record->level = level;
+    record->field_count = 0;
+    std::size_t text_size = 0;
+    for (const LogField& field : fields)
+    {
+        if (record->field_count == kMaxFields)
+        {
+            break;
+        }
+        Record::Field& out = record->fields[record->field_count++];
+        out.key = field.key_;
+        out.type = field.type_;
+        out.value = field.value_;
+        if (field.type_ == LogField::Type::kString)
+        {
+            const std::size_t length = std::min(field.text_.size(), Record::kTextBytes - text_size);
+            std::memcpy(record->text.data() + text_size, field.text_.data(), length);
+            out.offset = static_cast<std::uint16_t>(text_size);
+            out.length = static_cast<std::uint16_t>(length);
+            text_size += length;
+        }
+    }
+    ring.commit();
+}
+
+void Logger::flush()
+{
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    const std::uint64_t target = ++flush_requests_;
+    writer_cv_.notify_all();
+    flushed_cv_.wait(lock, [&] { return flushes_done_ >= target; });
+}
+
+Logger::Ring& Logger::local_ring(ThreadState& state)
+{
+    if (state.logger_id != instance_id_ || !state.ring)
+    {
+        // 初回（または別の Logger から切り替えた場合）だけロックを取ってリングを登録する
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        state.ring = std::make_shared<Ring>(ring_records_.load(std::memory_order_relaxed), next_thread_id_++);
+        state.logger_id = instance_id_;
+        rings_.push_back(state.ring);
+    }
+    return *state.ring;
+}
+
+void Logger::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(writer_mutex_);
+    while (true)
+    {
+        writer_cv_.wait_for(lock, flush_interval_, [this] { return stopping_ || flush_requests_ != flushes_done_; });
+        const std::uint64_t target = flush_requests_;
+        drain();
+        flushes_done_ = target;
+        flushed_cv_.notify_all();
+        if (stopping_)
+        {
+            return;
+        }
+    }
+}
+
+void Logger::drain()
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings = rings_;
+    }
+
+    std::string out;
+    for (const auto& ring : rings)
+    {
+        ring->drain(
+            [&](const Record& record)
+            {
+                out.append("time=");
+                append_time(out, record.time_ns);
+                out.append(" level=").append(log_level_name(record.level));
+                out.append(" thread=").append(std::to_string(ring->thread_id));
+                out.append(" event=");
+                append_value(out, record.event);
+                for (std::size_t i = 0; i < record.field_count; ++i)
+                {
+                    const Record::Field& field = record.fields[i];
+                    out += ' ';
+                    out.append(field.key);
+                    out += '=';
+                    switch (field.type)
+                    {
+                    case LogField::Type::kString:
+                        append_value(out, std::string_view(record.text.data() + field.offset, field.length));
+                        break;
+                    case LogField::Type::kInt:
+                        out.append(std::to_string(field.value.i));
+                        break;
+                    case LogField::Type::kUint:
+                        out.append(std::to_string(field.value.u));
+                        break;
+                    case LogField::Type::kDouble:
+                    {
+                        char buffer[32];
+                        std::snprintf(buffer, sizeof(buffer), "%.9g", field.value.d);
+                        out.append(buffer);
+                        break;
+                    }
+                    case LogField::Type::kBool:
+                        out.append(field.value.u != 0 ? "true" : "false");
+                        break;
+                    }
+                }
+                out += '\n';
+            });
+    }
+    rings.clear();
+
+    const std::uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_)
+    {
+        out.append("time=");
+        append_time(out, now_ns());
+        out.append(" level=warn thread=0 event=log_dropped count=")
+            .append(std::to_string(dropped - reported_dropped_))
+            .append("\n");
+        reported_dropped_ = dropped;
+    }
+
+    if (!out.empty())
+    {
+        std::fwrite(out.data(), 1, out.size(), output_);
+        std::fflush(output_);
+    }
+
+    // 終了したスレッドのリング（参照が rings_ だけで、書き出し済み）を外す
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    const auto finished = [](const std::shared_ptr<Ring>& ring) { return ring.use_count() == 1 && ring->empty(); };
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), finished), rings_.end());
+}
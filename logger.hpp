@@ -0,0 +1,216 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ログの重要度（この順に高い）
+enum class LogLevel : std::uint8_t
+{
+    kDebug,
+    kInfo,
+    kWarn,
+    kError,
+    kOff,  // 設定専用: 何も出力しない
+};
+
+std::string_view log_level_name(LogLevel level);
+std::optional<LogLevel> parse_log_level(std::string_view name);
+
+/**
+ * @brief ログレコードの 1 つのフィールド（key=value）
+ * @note  key は文字列リテラルなど、プロセスの終了まで有効な文字列であること（ポインタのまま記録する）。
+ *        文字列の値は記録時にレコードへコピーし、数値の文字列化は書き出しスレッドで行う。
+ */
+class LogField
+{
+   public:
+    enum class Type : std::uint8_t
+    {
+        kString,
+        kInt,
+        kUint,
+        kDouble,
+        kBool,
+    };
+
+    LogField(const char* key, std::string_view value) : key_(key), type_(Type::kString), text_(value) {}
+    LogField(const char* key, const char* value) : LogField(key, std::string_view(value)) {}
+    LogField(const char* key, const std::string& value) : LogField(key, std::string_view(value)) {}
+    LogField(const char* key, bool value) : key_(key), type_(Type::kBool) { value_.u = value ? 1 : 0; }
+    LogField(const char* key, double value) : key_(key), type_(Type::kDouble) { value_.d = value; }
+
+    template <typename T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T>, int> = 0>
+    LogField(const char* key, T value) : key_(key), type_(Type::kInt)
+    {
+        value_.i = value;
+    }
+
+    template <typename T,
+              std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    LogField(const char* key, T value) : key_(key), type_(Type::kUint)
+    {
+        value_.u = value;
+    }
+
+   private:
+    friend class Logger;
+
+    union Value
+    {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+    };
+
+    const char* key_;
+    Type type_;
+    Value value_{};
+    std::string_view text_;
+};
+
+// Logger の設定
+struct LoggerOptions
+{
+    // これより低い重要度のレコードは記録しない
+    LogLevel level = LogLevel::kInfo;
+    // kInfo 以下のレコードをスレッドごとに sample_every 件に 1 件だけ記録する（1 の場合は全件）。
+    // kWarn 以上は常に記録する。
+    std::uint32_t sample_every = 1;
+    // 出力先のファイル（追記）。空の場合は標準エラー出力
+    std::string path;
+    // スレッドごとのリングバッファのレコード数（2 のべき乗に切り上げる）。設定後に作るリングから適用する。
+    std::size_t ring_records = 256;
+    // 書き出しスレッドがリングバッファを回収する間隔
+    std::chrono::milliseconds flush_interval{10};
+};
+
+/**
+ * @brief 非同期の構造化ロガー
+ * @note  ログを出すスレッドは、初回に自分専用のリングバッファ（単一生産者・単一消費者のロックフリーキュー）を
+ *        登録し、以後はレコードをそこへ書くだけで戻る。ロックも I/O も行わず、リングが満杯の場合は
+ *        レコードを捨てて数だけ数える（捨てた数は書き出しスレッドが warn レコードとして出力する）。
+ *        書き出しスレッドが flush_interval ごとに全リングを回収し、1 行 1 レコードの logfmt
+ *        （time=... level=... thread=... event=... key=value ...）に整形してまとめて書き出す。
+ *        終了したスレッドのリングは、残りを書き出してから破棄する。
+ */
+class Logger
+{
+   public:
+    static constexpr std::size_t kMaxFields = 8;
+
+    explicit Logger(const LoggerOptions& options = {});
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * @fn
+     * @brief サーバとクライアントが共有するプロセス共通のロガー
+     */
+    static Logger& instance();
+
+    /**
+     * @fn
+     * @brief 設定を変更する。出力先を開けない場合は false を返し、それまでの出力先を使い続ける。
+     */
+    bool configure(const LoggerOptions& options);
+
+    bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+    /**
+     * @fn
+     * @brief レコードを記録する（呼び出したスレッドのリングに書くだけで、書き出しは待たない）
+     * @param event イベント名（key と同じく、プロセスの終了まで有効な文字列であること）
+     * @param fields フィールド。kMaxFields を超えた分は捨てる
+     */
+    void log(LogLevel level, const char* event, std::initializer_list<LogField> fields = {});
+
+    /**
+     * @fn
+     * @brief 呼び出し前に記録したレコードが書き出されるまで待つ
+     */
+    void flush();
+
+    // リングが満杯で捨てたレコードの累計
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    struct Record;
+    class Ring;
+
+    // スレッドごとのリングの参照（instance_id_ が一致する場合だけ有効）
+    struct ThreadState
+    {
+        std::uint64_t logger_id = 0;
+        std::shared_ptr<Ring> ring;
+        std::uint64_t sampled = 0;
+    };
+
+    static std::atomic<std::uint64_t> next_instance_id_;
+    const std::uint64_t instance_id_;
+
+    std::atomic<LogLevel> level_;
+    std::atomic<std::uint32_t> sample_every_;
+    std::atomic<std::size_t> ring_records_;
+    std::atomic<std::uint64_t> dropped_{0};
+
+    // 登録済みのリング（登録と書き出しスレッドの走査だけが取る）
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::uint32_t next_thread_id_ = 1;
+
+    // 書き出しスレッドの状態
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    std::condition_variable flushed_cv_;
+    std::FILE* output_ = stderr;
+    bool owns_output_ = false;
+    std::chrono::milliseconds flush_interval_;
+    std::uint64_t flush_requests_ = 0;
+    std::uint64_t flushes_done_ = 0;
+    bool stopping_ = false;
+    std::uint64_t reported_dropped_ = 0;
+    std::thread writer_;
+
+    Ring& local_ring(ThreadState& state);
+    void writer_loop();
+    // 全リングを回収して書き出す（writer_mutex_ を保持して呼ぶ）
+    void drain();
+};
+
+inline void log_debug(const char* event, std::initializer_list<LogField> fields = {})
+{
+    Logger::instance().log(LogLevel::kDebug, event, fields);
+}
+
+inline void log_info(const char* event, std::initializer_list<LogField> fields = {})
+{
+    Logger::instance().log(LogLevel::kInfo, event, fields);
+}
+
+inline void log_warn(const char* event, std::initializer_list<LogField> fields = {})
+{
+    Logger::instance().log(LogLevel::kWarn, event, fields);
+}
+
+inline void log_error(const char* event, std::initializer_list<LogField> fields = {})
+{
+    Logger::instance().log(LogLevel::kError, event, fields);
+}
+
+#endif  // LOGGER_HPP
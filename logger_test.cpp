@@ -0,0 +1,116 @@
+#include "logger.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// テストごとのログファイル（破棄時に削除する）
+class TempLogFile
+{
+   public:
+    explicit TempLogFile(const std::string& name) : path_(testing::TempDir() + name) { std::remove(path_.c_str()); }
+    ~TempLogFile() { std::remove(path_.c_str()); }
+
+    const std::string& path() const { return path_; }
+
+    std::vector<std::string> lines() const
+    {
+        std::ifstream in(path_);
+        std::vector<std::string> out;
+        for (std::string line; std::getline(in, line);)
+        {
+            out.push_back(line);
+        }
+        return out;
+    }
+
+   private:
+    std::string path_;
+};
+}  // namespace
+
+TEST(LoggerTest, WritesStructuredRecordsAsLogfmt)
+{
+    TempLogFile file("logger_logfmt.log");
+    Logger logger({.path = file.path()});
+
+    const std::string user = "alice smith";
+    logger.log(LogLevel::kInfo, "register",
+               {{"user", user}, {"attempt", 42}, {"bytes", std::size_t(128)}, {"ok", true}, {"delta", -3},
+                {"ratio", 0.5}, {"quote", "a\"b"}});
+    logger.flush();
+
+    const auto lines = file.lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0].rfind("time=", 0), 0u);
+    EXPECT_NE(lines[0].find(" level=info thread="), std::string::npos);
+    EXPECT_NE(lines[0].find(" event=register user=\"alice smith\" attempt=42 bytes=128 ok=true delta=-3 ratio=0.5 "
+                            "quote=\"a\\\"b\""),
+              std::string::npos);
+}
+
+TEST(LoggerTest, FiltersByLevelAndSamplesLowLevels)
+{
+    TempLogFile file("logger_sampling.log");
+    Logger logger({.level = LogLevel::kInfo, .sample_every = 4, .path = file.path()});
+
+    logger.log(LogLevel::kDebug, "hidden");
+    for (int i = 0; i < 8; ++i)
+    {
+        logger.log(LogLevel::kInfo, "sampled", {{"i", i}});
+    }
+    logger.log(LogLevel::kWarn, "always");
+    logger.log(LogLevel::kError, "always");
+    logger.flush();
+
+    const auto lines = file.lines();
+    ASSERT_EQ(lines.size(), 4u);  // info 8 件のうち 2 件と warn / error
+    EXPECT_NE(lines[0].find("event=sampled i=0"), std::string::npos);
+    EXPECT_NE(lines[1].find("event=sampled i=4"), std::string::npos);
+    EXPECT_NE(lines[2].find("level=warn"), std::string::npos);
+    EXPECT_NE(lines[3].find("level=error"), std::string::npos);
+
+    EXPECT_EQ(parse_log_level("warn"), LogLevel::kWarn);
+    EXPECT_FALSE(parse_log_level("verbose"));
+}
+
+TEST(LoggerTest, DropsRecordsWhenRingIsFullInsteadOfBlocking)
+{
+    TempLogFile file("logger_drops.log");
+    // 書き出しスレッドが回収しない間に、スレッドごとのリング（16 件）を超えて書く
+    Logger logger({.path = file.path(), .ring_records = 16, .flush_interval = std::chrono::hours(1)});
+    constexpr int kThreads = 4;
+    constexpr int kRecords = 100;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                for (int i = 0; i < kRecords; ++i)
+                {
+                    logger.log(LogLevel::kInfo, "burst", {{"worker", t}, {"i", i}});
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(logger.dropped(), std::uint64_t(kThreads) * (kRecords - 16));
+
+    // 終了したスレッドのリングも書き出す
+    logger.flush();
+    const auto lines = file.lines();
+    ASSERT_EQ(lines.size(), kThreads * 16 + 1u);
+    EXPECT_NE(lines.back().find("event=log_dropped count=" + std::to_string(kThreads * (kRecords - 16))),
+              std::string::npos);
+}
@@ -1,14 +1,297 @@
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
 
 #include "auth_server.hpp"
+#include "logger.hpp"
+#include "multi_buffer_exp.hpp"
+#include "user_import.hpp"
 
 using namespace zkp_auth;
 
-int main()
+void print_usage()
+{
+    std::cerr << "Usage:\n"
+              << "  ./zkp_server [options]\n"
+              << "Options:\n"
+              << "  --async                      serve with the async API (one completion queue per core)\n"
+              << "  --completion-queues <n>      completion queues for --async, per shard with --shards "
+                 "(default: hardware threads / the shard's CPUs)\n"
+              << "  --shards <n>                 async server shards pinned to disjoint CPUs, sharing the port via "
+                 "SO_REUSEPORT (default 0: off)\n"
+              << "  --verify-queue <n>           max queued verifications for --async (0: unbounded, default 1024)\n"
+              << "  --batch-size <n>             max proofs per batch verification (1 disables batching, default 32;\n"
+              << "                               only P-256 and AVX-512 IFMA hosts batch, others verify one by one)\n"
+              << "  --batch-wait-us <us>         max time a proof waits for its batch to fill (default 200)\n"
+              << "  --verify-threads <n>         batch verification worker threads (default: hardware threads)\n"
+              << "  --session-ttl-ms <ms>        time a challenge stays answerable (default 30000)\n"
+              << "  --max-sessions <n>           max outstanding challenges (0: unbounded, default 100000)\n"
+              << "  --max-sessions-per-user <n>  max outstanding challenges per user (0: unbounded, default 16)\n"
+              << "  --challenge-key-file <path>  issue stateless challenge tokens sealed with this shared hex key\n"
+              << "  --proof-window-ms <ms>       accepted clock skew of non-interactive proofs (default 30000)\n"
+              << "  --group <name>               group for new registrations: modp1024 | p256 (default modp1024)\n"
+              << "  --data-dir <path>            persist registered users in this directory (default: memory only)\n"
+              << "  --snapshot-interval-s <s>    interval of user snapshots after new registrations (default 60)\n"
+              << "  --snapshot-records <n>       registrations that trigger an early user snapshot (default 100000)\n"
+              << "  --key-table-cache-mb <n>     key table memory per group for frequent users (default 0: off)\n"
+              << "  --key-table-min-logins <n>   recent logins before building a user's key tables (default 8)\n"
+              << "  --stream-window <n>          unanswered requests per AuthenticateStream before reads pause "
+                 "(default 128)\n"
+              << "  --import <file>              register \"<user> <group> <y1_hex> <y2_hex>\" lines into --data-dir "
+                 "and exit\n"
+              << "  --registration-threads <n>   threads checking RegisterBatch / --import keys (default: hardware)\n"
+              << "  --user-login-rate <n>        challenges / non-interactive proofs per second per user "
+                 "(default 0: unlimited)\n"
+              << "  --user-login-burst <n>       logins a user may make back to back (default: the rate, at least 1)\n"
+              << "  --peer-login-rate <n>        challenges / non-interactive proofs per second per client address "
+                 "(IPv6: per /64, default 0: unlimited)\n"
+              << "  --peer-login-burst <n>       logins a client address may make back to back (default: the rate)\n"
+              << "  --simd <kernel>              modexp kernel: scalar | avx2 | avx512ifma (default: best supported)\n"
+              << "  --log-level <level>          debug | info | warn | error | off (default info)\n"
+              << "  --log-file <path>            append logs to a file (default stderr)\n"
+              << "  --log-sample <n>             log 1 in n info/debug records per thread (default 1)\n";
+}
+
+// 0 以上の実数（受け付け制限の rate / burst）。それ以外は std::invalid_argument を投げる
+double parse_non_negative(const std::string& value)
+{
+    const double number = std::stod(value);
+    if (!(number >= 0))
+    {
+        throw std::invalid_argument(value);
+    }
+    return number;
+}
+
+// --import: ファイルのユーザーを登録してスナップショットを作り、終了する
+int import_and_exit(const AuthServiceOptions& options, const std::string& path)
+{
+    if (options.users.data_dir.empty())
+    {
+        std::cerr << "--import requires --data-dir (imported users would be lost on exit)." << std::endl;
+        return 1;
+    }
+    try
+    {
+        AuthServiceImpl service(options);
+        const auto started = std::chrono::steady_clock::now();
+        const std::optional<ImportSummary> summary = import_users(service, path);
+        if (!summary)
+        {
+            std::cerr << "Cannot open " << path << std::endl;
+            return 1;
+        }
+        const bool snapshot_ok = service.snapshot_users();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        std::cerr << "Imported " << summary->registered << " of " << summary->records << " users in "
+                  << elapsed.count() << " s (" << summary->failed << " failed, see the import_failed log records)"
+                  << std::endl;
+        return summary->failed == 0 && snapshot_ok ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        log_error("import_failed", {{"path", path}, {"error", e.what()}});
+        return 1;
+    }
+}
+
+int main(int argc, char** argv)
 {
     std::string server_address("0.0.0.0:50051");
-    AuthServer server;
-    server.Run(server_address);
+    AuthServerOptions options;
+    LoggerOptions log_options;
+    std::string import_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--async")
+        {
+            options.async = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            print_usage();
+            return 1;
+        }
+        const std::string value = argv[++i];
+        try
+        {
+            if (arg == "--completion-queues")
+            {
+                options.completion_queues = std::stoul(value);
+            }
+            else if (arg == "--shards")
+            {
+                options.shards = std::stoul(value);
+            }
+            else if (arg == "--verify-queue")
+            {
+                options.service.batch.max_pending = std::stoul(value);
+            }
+            else if (arg == "--batch-size")
+            {
+                options.service.batch.max_batch_size = std::stoul(value);
+            }
+            else if (arg == "--batch-wait-us")
+            {
+                options.service.batch.max_wait = std::chrono::microseconds(std::stol(value));
+            }
+            else if (arg == "--verify-threads")
+            {
+                options.service.batch.worker_threads = std::stoul(value);
+            }
+            else if (arg == "--session-ttl-ms")
+            {
+                options.service.sessions.ttl = std::chrono::milliseconds(std::stol(value));
+            }
+            else if (arg == "--max-sessions")
+            {
+                options.service.sessions.max_sessions = std::stoul(value);
+            }
+            else if (arg == "--max-sessions-per-user")
+            {
+                options.service.sessions.max_sessions_per_user = std::stoul(value);
+            }
+            else if (arg == "--challenge-key-file")
+            {
+                options.service.challenge_key_file = value;
+            }
+            else if (arg == "--proof-window-ms")
+            {
+                options.service.proof_window = std::chrono::milliseconds(std::stol(value));
+            }
+            else if (arg == "--group")
+            {
+                const auto group = parse_group_id(value);
+                if (!group)
+                {
+                    throw std::invalid_argument(value);
+                }
+                options.service.group = *group;
+            }
+            else if (arg == "--data-dir")
+            {
+                options.service.users.data_dir = value;
+            }
+            else if (arg == "--snapshot-interval-s")
+            {
+                options.service.users.snapshot_interval = std::chrono::seconds(std::stol(value));
+            }
+            else if (arg == "--snapshot-records")
+            {
+                options.service.users.snapshot_records = std::stoul(value);
+            }
+            else if (arg == "--key-table-cache-mb")
+            {
+                options.service.key_tables.memory_bytes = std::stoul(value) << 20;
+            }
+            else if (arg == "--key-table-min-logins")
+            {
+                const unsigned long min_logins = std::stoul(value);
+                if (min_logins == 0 || min_logins > 255)
+                {
+                    throw std::invalid_argument(value);
+                }
+                options.service.key_tables.min_logins = static_cast<std::uint32_t>(min_logins);
+            }
+            else if (arg == "--import")
+            {
+                import_path = value;
+            }
+            else if (arg == "--registration-threads")
+            {
+                options.service.registration_threads = std::stoul(value);
+            }
+            else if (arg == "--stream-window")
+            {
+                options.service.stream_window = std::stoul(value);
+            }
+            else if (arg == "--user-login-rate")
+            {
+                options.service.user_rate_limit.rate_per_second = parse_non_negative(value);
+            }
+            else if (arg == "--user-login-burst")
+            {
+                options.service.user_rate_limit.burst = parse_non_negative(value);
+            }
+            else if (arg == "--peer-login-rate")
+            {
+                options.service.peer_rate_limit.rate_per_second = parse_non_negative(value);
+            }
+            else if (arg == "--peer-login-burst")
+            {
+                options.service.peer_rate_limit.burst = parse_non_negative(value);
+            }
+            else if (arg == "--simd")
+            {
+                const auto kernel = parse_simd_kernel(value);
+                if (!kernel)
+                {
+                    throw std::invalid_argument(value);
+                }
+                if (!set_simd_kernel(*kernel))
+                {
+                    std::cerr << "--simd " << value << " is not supported by this CPU." << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--log-level")
+            {
+                const auto level = parse_log_level(value);
+                if (!level)
+                {
+                    throw std::invalid_argument(value);
+                }
+                log_options.level = *level;
+            }
+            else if (arg == "--log-file")
+            {
+                log_options.path = value;
+            }
+            else if (arg == "--log-sample")
+            {
+                log_options.sample_every = static_cast<std::uint32_t>(std::stoul(value));
+            }
+            else
+            {
+                print_usage();
+                return 1;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return 1;
+        }
+    }
+
+    if (!Logger::instance().configure(log_options))
+    {
+        std::cerr << "Cannot open log file: " << log_options.path << std::endl;
+        return 1;
+    }
+
+    if (!import_path.empty())
+    {
+        return import_and_exit(options.service, import_path);
+    }
+
+    AuthServer server(options);
+    try
+    {
+        server.Run(server_address);
+    }
+    catch (const std::exception& e)
+    {
+        // ユーザーストアを開けない場合など
+        log_error("server_start_failed", {{"address", server_address}, {"error", e.what()}});
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,256 @@
+#ifndef MODP_GROUP_HPP
+#define MODP_GROUP_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "fixed_base_table.hpp"
+#include "modular_arithmetic.hpp"
+#include "multi_buffer_exp.hpp"
+#include "multi_exp.hpp"
+#include "zkp_constants.hpp"
+
+using namespace boost::multiprecision;
+
+/**
+ * @brief 乗法群 Z_p^* の位数 q の部分群（生成元 g, h）
+ * @note  ChaumPedersen が要求する群ポリシーの実装。要素の表現と乗算は Arithmetic に委ねる。
+ *        固定基底テーブルを持つ場合は g^e, h^e をテーブル参照で計算する。
+ *        独立したべき乗をまとめて計算する pow_many は MultiBufferExp（SIMD カーネル）に委ねる。
+ *        構築後は変更されないため、複数スレッドから同時に参照してよい。
+ * @tparam Arithmetic 剰余演算ポリシー（CppIntModArithmetic / MontgomeryArithmetic）
+ */
+template <typename Arithmetic>
+class ModpGroup
+{
+   public:
+    using Element = typename Arithmetic::Element;
+    using Table = FixedBaseTable<Arithmetic>;
+    using Term = PowTerm<Arithmetic>;
+    using FixedTerm = FixedPowTerm<Arithmetic>;
+
+    // 160-bit の指数に対して 27 ウィンドウ × 63 エントリ
+    static constexpr unsigned kDefaultWindowBits = 6;
+
+    // Z_p^* は位数 q 以外の部分群も含む（decode は範囲しか確認しない）
+    static constexpr bool kPrimeOrder = false;
+
+    /**
+     * @fn
+     * @brief コンストラクタ。固定基底テーブルは構築しない。
+     * @param p 素数
+     * @param q p-1の素因数
+     * @param g 位数qの生成子
+     * @param h 位数qの別の生成子
+     */
+    ModpGroup(const cpp_int& p, const cpp_int& q, const cpp_int& g, const cpp_int& h)
+        : arith_(p),
+          pow_kernel_(std::make_shared<const MultiBufferExp<Arithmetic>>(arith_)),
+          p_(p),
+          q_(q),
+          g_(arith_.from_integer(g)),
+          h_(arith_.from_integer(h))
+    {
+    }
+
+    /**
+     * @fn
+     * @brief コンストラクタ。g, h の固定基底テーブルを構築する。
+     * @param constants 公開パラメータ {p, q, g, h}
+     * @param window_bits 固定基底テーブルのウィンドウ幅
+     */
+    explicit ModpGroup(const ZKPConstants& constants, unsigned window_bits = kDefaultWindowBits)
+        : ModpGroup(Arithmetic(constants.p), constants.p, constants.q, Arithmetic(constants.p).from_integer(constants.g),
+                    Arithmetic(constants.p).from_integer(constants.h), window_bits)
+    {
+    }
+
+    /**
+     * @fn
+     * @brief コンストラクタ。構築済みの演算ポリシーと要素表現の g, h からテーブルを構築する。
+     * @param arith 剰余演算ポリシー
+     * @param p 素数
+     * @param q p-1の素因数
+     * @param g 位数qの生成子（要素表現）
+     * @param h 位数qの別の生成子（要素表現）
+     * @param window_bits 固定基底テーブルのウィンドウ幅
+     */
+    ModpGroup(const Arithmetic& arith, cpp_int p, cpp_int q, const Element& g, const Element& h,
+              unsigned window_bits = kDefaultWindowBits)
+        : arith_(arith),
+          pow_kernel_(std::make_shared<const MultiBufferExp<Arithmetic>>(arith_)),
+          p_(std::move(p)),
+          q_(std::move(q)),
+          g_(g),
+          h_(h),
+          g_table_(std::make_shared<const Table>(arith_, g_, exponent_bits(q_), window_bits)),
+          h_table_(std::make_shared<const Table>(arith_, h_, exponent_bits(q_), window_bits))
+    {
+    }
+
+    const Arithmetic& arithmetic() const { return arith_; }
+    const cpp_int& modulus() const { return p_; }
+    const cpp_int& order() const { return q_; }
+    const Element& g() const { return g_; }
+    const Element& h() const { return h_; }
+
+    // テーブルを構築していない場合は nullptr
+    const std::shared_ptr<const Table>& g_table() const { return g_table_; }
+    const std::shared_ptr<const Table>& h_table() const { return h_table_; }
+
+    Element pow_g(const cpp_int& e) const { return g_table_ ? g_table_->pow(e) : power(arith_, g_, e); }
+    Element pow_h(const cpp_int& e) const { return h_table_ ? h_table_->pow(e) : power(arith_, h_, e); }
+
+    /**
+     * @fn
+     * @brief g^s * y^c mod p を同時べき乗で計算する
+     * @note  テーブルがあれば g^s はテーブル参照、なければ g と y を Straus 法で同時に計算する
+     */
+    Element mul_pow_g(const cpp_int& s, const Element& y, const cpp_int& c) const
+    {
+        return mul_pow(g_, g_table_, s, y, c);
+    }
+
+    /**
+     * @fn
+     * @brief h^s * y^c mod p を同時べき乗で計算する
+     */
+    Element mul_pow_h(const cpp_int& s, const Element& y, const cpp_int& c) const
+    {
+        return mul_pow(h_, h_table_, s, y, c);
+    }
+
+    /**
+     * @fn
+     * @brief g^s * y^c mod p を計算する（y^c は y の固定基底テーブル参照）
+     * @param y_table make_table で構築した y のテーブル
+     */
+    Element mul_pow_g(const cpp_int& s, const Table& y_table, const cpp_int& c) const
+    {
+        return mul_pow(g_, g_table_, s, y_table, c);
+    }
+
+    /**
+     * @fn
+     * @brief h^s * y^c mod p を計算する（y^c は y の固定基底テーブル参照）
+     */
+    Element mul_pow_h(const cpp_int& s, const Table& y_table, const cpp_int& c) const
+    {
+        return mul_pow(h_, h_table_, s, y_table, c);
+    }
+
+    /**
+     * @fn
+     * @brief 任意の要素を基底とする固定基底テーブルを構築する（指数は位数 q のビット長まで）
+     * @note  ログイン頻度の高いユーザーの公開鍵 y1, y2 のように、同じ基底で何度もべき乗する場合に使う
+     */
+    std::shared_ptr<const Table> make_table(const Element& base, unsigned window_bits) const
+    {
+        return std::make_shared<const Table>(arith_, base, exponent_bits(q_), window_bits);
+    }
+
+    /**
+     * @fn
+     * @brief Π base_i^e_i * g^eg * h^eh mod p を同時べき乗で計算する（バッチ検証用）
+     * @param terms 可変基底の項
+     * @param g_exponent g の指数
+     * @param h_exponent h の指数
+     */
+    Element multi_pow(const std::vector<Term>& terms, const cpp_int& g_exponent, const cpp_int& h_exponent) const
+    {
+        if (g_table_ && h_table_)
+        {
+            return ::multi_pow<Arithmetic>(arith_, terms, {{*g_table_, g_exponent}, {*h_table_, h_exponent}});
+        }
+        std::vector<Term> all(terms);
+        all.push_back({g_, g_exponent});
+        all.push_back({h_, h_exponent});
+        return ::multi_pow<Arithmetic>(arith_, all);
+    }
+
+    /**
+     * @fn
+     * @brief 独立したべき乗 terms[i].base^terms[i].exponent をまとめて計算する
+     * @note  Montgomery 固定長の演算では SIMD カーネルで pow_lanes() 件ずつ同時に計算する。指数は公開値であること。
+     * @param terms 可変基底の項
+     * @param fixed_terms nullptr でなければ fixed_terms[i] の固定基底のべき乗も掛ける（g_table() など）
+     * @param count 項の数
+     * @param results 結果の書き込み先（count 要素）
+     */
+    void pow_many(const Term* terms, const FixedTerm* fixed_terms, std::size_t count, Element* results) const
+    {
+        pow_kernel_->pow(terms, fixed_terms, count, results);
+    }
+
+    // pow_many が同時に計算する数（1 の場合は SIMD カーネルを使わない）
+    std::size_t pow_lanes() const { return pow_kernel_->lanes(); }
+
+    bool equal(const Element& a, const Element& b) const { return a == b; }
+
+    /**
+     * @fn
+     * @brief 公開鍵として妥当か（位数 q の部分群に属し、単位元でない）を確認する
+     * @note  decode は範囲だけを確認する。p - 1 の他の因数の部分群に属する値は a^q != 1 で弾く
+     *        （q ビットのべき乗 1 回）。単位元は秘密鍵 0 に当たるため受け付けない。
+     */
+    bool is_public_key(const Element& a) const { return a != arith_.one() && power(arith_, a, q_) == arith_.one(); }
+
+    /**
+     * @fn
+     * @brief 整数を群の要素表現に変換する
+     * @param x 変換する整数
+     * @return 1 <= x < p の場合は要素表現、範囲外の場合は std::nullopt
+     */
+    std::optional<Element> decode(const cpp_int& x) const
+    {
+        if (x <= 0 || x >= p_)
+        {
+            return std::nullopt;
+        }
+        return arith_.from_integer(x);
+    }
+
+    /**
+     * @fn
+     * @brief 群の要素表現を整数に変換する
+     */
+    cpp_int encode(const Element& a) const { return arith_.to_integer(a); }
+
+    // encode した整数を固定長のバイト列で送るときの長さ（p のバイト長）
+    std::size_t encoded_bytes() const { return static_cast<std::size_t>(msb(p_)) / 8 + 1; }
+
+   private:
+    Arithmetic arith_;
+    std::shared_ptr<const MultiBufferExp<Arithmetic>> pow_kernel_;
+    cpp_int p_;
+    cpp_int q_;
+    Element g_;
+    Element h_;
+    std::shared_ptr<const Table> g_table_;
+    std::shared_ptr<const Table> h_table_;
+
+    Element mul_pow(const Element& base, const std::shared_ptr<const Table>& table, const cpp_int& s,
+                    const Element& y, const cpp_int& c) const
+    {
+        if (table)
+        {
+            return ::multi_pow<Arithmetic>(arith_, {{y, c}}, {{*table, s}});
+        }
+        return ::multi_pow<Arithmetic>(arith_, {{base, s}, {y, c}});
+    }
+
+    Element mul_pow(const Element& base, const std::shared_ptr<const Table>& table, const cpp_int& s,
+                    const Table& y_table, const cpp_int& c) const
+    {
+        if (table)
+        {
+            return ::multi_pow<Arithmetic>(arith_, {}, {{*table, s}, {y_table, c}});
+        }
+        return ::multi_pow<Arithmetic>(arith_, {{base, s}}, {{y_table, c}});
+    }
+};
+
+#endif  // MODP_GROUP_HPP
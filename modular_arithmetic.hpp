@@ -0,0 +1,381 @@
+#ifndef MODULAR_ARITHMETIC_HPP
+#define MODULAR_ARITHMETIC_HPP
+
+#include <array>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+using namespace boost::multiprecision;
+
+// 固定長演算で使用するリム（64-bit）
+using Limb = std::uint64_t;
+
+template <std::size_t N>
+using Limbs = std::array<Limb, N>;
+
+/**
+ * @fn
+ * @brief 16進数文字列をリトルエンディアンのリム配列に変換する（コンパイル時評価可能）
+ * @param hex 16進数文字列（"0x" なし）
+ * @return リム配列。N リムに収まらない上位桁は無視される。
+ */
+template <std::size_t N>
+constexpr Limbs<N> limbs_from_hex(std::string_view hex)
+{
+    Limbs<N> limbs{};
+    std::size_t bit = 0;
+    for (std::size_t i = hex.size(); i-- > 0 && bit < N * 64; bit += 4)
+    {
+        const char ch = hex[i];
+        Limb nibble = 0;
+        if (ch >= '0' && ch <= '9')
+        {
+            nibble = static_cast<Limb>(ch - '0');
+        }
+        else if (ch >= 'a' && ch <= 'f')
+        {
+            nibble = static_cast<Limb>(ch - 'a' + 10);
+        }
+        else if (ch >= 'A' && ch <= 'F')
+        {
+            nibble = static_cast<Limb>(ch - 'A' + 10);
+        }
+        limbs[bit / 64] |= nibble << (bit % 64);
+    }
+    return limbs;
+}
+
+/**
+ * @fn
+ * @brief cpp_int をリトルエンディアンのリム配列に変換する
+ * @param x 変換する非負整数（N リムに収まること）
+ */
+template <std::size_t N>
+Limbs<N> limbs_from_integer(const cpp_int& x)
+{
+    Limbs<N> limbs{};
+    cpp_int rest = x;
+    for (std::size_t i = 0; i < N && !rest.is_zero(); ++i)
+    {
+        limbs[i] = static_cast<Limb>(rest & std::numeric_limits<Limb>::max());
+        rest >>= 64;
+    }
+    return limbs;
+}
+
+/**
+ * @fn
+ * @brief リトルエンディアンのリム配列を cpp_int に変換する
+ */
+template <std::size_t N>
+cpp_int integer_from_limbs(const Limbs<N>& limbs)
+{
+    cpp_int x;
+    import_bits(x, limbs.rbegin(), limbs.rend(), 64);
+    return x;
+}
+
+/**
+ * @fn
+ * @brief 指数 e の bit ビット目から w ビット分の値を取り出す（アロケーションなし）
+ * @param e 非負の指数
+ * @param bit 取り出し開始位置（下位から）
+ * @param w 取り出すビット数（1〜8）
+ */
+inline unsigned exponent_window(const cpp_int& e, std::size_t bit, unsigned w)
+{
+    constexpr std::size_t limb_bits = sizeof(limb_type) * 8;
+    const auto& backend = e.backend();
+    const std::size_t index = bit / limb_bits;
+    const std::size_t offset = bit % limb_bits;
+    if (index >= backend.size())
+    {
+        return 0;
+    }
+    limb_type value = backend.limbs()[index] >> offset;
+    if (offset + w > limb_bits && index + 1 < backend.size())
+    {
+        value |= backend.limbs()[index + 1] << (limb_bits - offset);
+    }
+    return static_cast<unsigned>(value & ((limb_type(1) << w) - 1));
+}
+
+/**
+ * @fn
+ * @brief 指数 e のビット長を返す（e = 0 の場合は 0）
+ */
+inline unsigned exponent_bits(const cpp_int& e) { return e.is_zero() ? 0 : static_cast<unsigned>(msb(e)) + 1; }
+
+/**
+ * @brief cpp_int による剰余演算（参照実装）
+ * @note  要素は [0, p) の整数そのもの。乗算のたびにヒープ確保と汎用除算が発生する。
+ */
+class CppIntModArithmetic
+{
+   public:
+    using Element = cpp_int;
+
+    explicit CppIntModArithmetic(cpp_int modulus) : modulus_(std::move(modulus)) {}
+
+    Element one() const { return cpp_int(1) % modulus_; }
+    Element mul(const Element& a, const Element& b) const { return a * b % modulus_; }
+    Element sqr(const Element& a) const { return a * a % modulus_; }
+
+    // x は [0, p) の範囲にあること
+    Element from_integer(const cpp_int& x) const { return x; }
+    cpp_int to_integer(const Element& a) const { return a; }
+
+    const cpp_int& modulus() const { return modulus_; }
+
+   private:
+    cpp_int modulus_;
+};
+
+/**
+ * @brief N リム固定長の Montgomery 剰余演算
+ * @note  要素は Montgomery 表現 aR mod p（R = 2^(64N)）のリム配列で、常に [0, p) に正規化される。
+ *        乗算は CIOS 法でスタック上のみで行い、ヒープ確保や除算を伴わない。
+ *        p は奇数であること。全メンバ関数はコンパイル時にも評価できる。
+ */
+template <std::size_t N>
+class MontgomeryArithmetic
+{
+   public:
+    using Element = Limbs<N>;
+
+    constexpr explicit MontgomeryArithmetic(const Element& modulus) : p_(modulus)
+    {
+        // -p^{-1} mod 2^64 をニュートン法で求める（p[0] が奇数なら 3 ビットから倍々に収束する）
+        Limb inv = p_[0];
+        for (int i = 0; i < 5; ++i)
+        {
+            inv *= 2 - p_[0] * inv;
+        }
+        n0_inv_ = ~inv + 1;
+
+        // R mod p と R^2 mod p を 2 倍と条件付き減算の繰り返しで求める
+        Element x{};
+        x[0] = 1;
+        reduce_once(x, false);
+        for (std::size_t i = 0; i < 2 * N * 64; ++i)
+        {
+            const bool carry = (x[N - 1] >> 63) != 0;
+            for (std::size_t j = N; j-- > 1;)
+            {
+                x[j] = (x[j] << 1) | (x[j - 1] >> 63);
+            }
+            x[0] <<= 1;
+            reduce_once(x, carry);
+            if (i + 1 == N * 64)
+            {
+                r_ = x;
+            }
+        }
+        r2_ = x;
+    }
+
+    explicit MontgomeryArithmetic(const cpp_int& modulus) : MontgomeryArithmetic(limbs_from_integer<N>(modulus)) {}
+
+    constexpr Element one() const { return r_; }
+
+    /**
+     * @fn
+     * @brief Montgomery 乗算 a * b * R^{-1} mod p（CIOS法）
+     */
+    constexpr Element mul(const Element& a, const Element& b) const
+    {
+        using Wide = unsigned __int128;
+        Limb t[N + 2] = {};
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            Limb carry = 0;
+            for (std::size_t j = 0; j < N; ++j)
+            {
+                const Wide v = static_cast<Wide>(a[j]) * b[i] + t[j] + carry;
+                t[j] = static_cast<Limb>(v);
+                carry = static_cast<Limb>(v >> 64);
+            }
+            Wide v = static_cast<Wide>(t[N]) + carry;
+            t[N] = static_cast<Limb>(v);
+            t[N + 1] = static_cast<Limb>(v >> 64);
+
+            const Limb m = t[0] * n0_inv_;
+            v = static_cast<Wide>(m) * p_[0] + t[0];
+            carry = static_cast<Limb>(v >> 64);
+            for (std::size_t j = 1; j < N; ++j)
+            {
+                v = static_cast<Wide>(m) * p_[j] + t[j] + carry;
+                t[j - 1] = static_cast<Limb>(v);
+                carry = static_cast<Limb>(v >> 64);
+            }
+            v = static_cast<Wide>(t[N]) + carry;
+            t[N - 1] = static_cast<Limb>(v);
+            t[N] = t[N + 1] + static_cast<Limb>(v >> 64);
+        }
+
+        Element result{};
+        for (std::size_t j = 0; j < N; ++j)
+        {
+            result[j] = t[j];
+        }
+        reduce_once(result, t[N] != 0);
+        return result;
+    }
+
+    constexpr Element sqr(const Element& a) const { return mul(a, a); }
+
+    // a + b mod p（Montgomery 表現のまま計算できる）
+    constexpr Element add(const Element& a, const Element& b) const
+    {
+        Element result{};
+        Limb carry = 0;
+        for (std::size_t j = 0; j < N; ++j)
+        {
+            const Limb s1 = a[j] + b[j];
+            const Limb c1 = s1 < a[j] ? 1 : 0;
+            const Limb s2 = s1 + carry;
+            const Limb c2 = s2 < s1 ? 1 : 0;
+            result[j] = s2;
+            carry = c1 | c2;
+        }
+        reduce_once(result, carry != 0);
+        return result;
+    }
+
+    // a - b mod p
+    constexpr Element sub(const Element& a, const Element& b) const
+    {
+        Element result{};
+        Limb borrow = 0;
+        for (std::size_t j = 0; j < N; ++j)
+        {
+            const Limb d1 = a[j] - b[j];
+            const Limb b1 = a[j] < b[j] ? 1 : 0;
+            const Limb d2 = d1 - borrow;
+            const Limb b2 = d1 < borrow ? 1 : 0;
+            result[j] = d2;
+            borrow = b1 | b2;
+        }
+        if (borrow != 0)
+        {
+            Limb carry = 0;
+            for (std::size_t j = 0; j < N; ++j)
+            {
+                const Limb s1 = result[j] + p_[j];
+                const Limb c1 = s1 < result[j] ? 1 : 0;
+                const Limb s2 = s1 + carry;
+                const Limb c2 = s2 < s1 ? 1 : 0;
+                result[j] = s2;
+                carry = c1 | c2;
+            }
+        }
+        return result;
+    }
+
+    constexpr bool is_zero(const Element& a) const
+    {
+        for (std::size_t j = 0; j < N; ++j)
+        {
+            if (a[j] != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // x（通常表現, [0, p)）を Montgomery 表現に変換する
+    constexpr Element to_montgomery(const Element& x) const { return mul(x, r2_); }
+
+    // Montgomery 表現を通常表現に戻す
+    constexpr Element from_montgomery(const Element& a) const
+    {
+        Element unit{};
+        unit[0] = 1;
+        return mul(a, unit);
+    }
+
+    // x は [0, p) の範囲にあること
+    Element from_integer(const cpp_int& x) const { return to_montgomery(limbs_from_integer<N>(x)); }
+    cpp_int to_integer(const Element& a) const { return integer_from_limbs<N>(from_montgomery(a)); }
+
+    constexpr const Element& modulus_limbs() const { return p_; }
+
+   private:
+    Element p_;
+    Limb n0_inv_ = 0;
+    Element r_{};   // R mod p（Montgomery 表現の 1）
+    Element r2_{};  // R^2 mod p
+
+    // carry（2^(64N) の桁）を含めて x >= p なら x -= p を行う
+    constexpr void reduce_once(Element& x, bool carry) const
+    {
+        if (!carry)
+        {
+            for (std::size_t j = N; j-- > 0;)
+            {
+                if (x[j] != p_[j])
+                {
+                    if (x[j] < p_[j])
+                    {
+                        return;
+                    }
+                    break;
+                }
+            }
+        }
+        Limb borrow = 0;
+        for (std::size_t j = 0; j < N; ++j)
+        {
+            const Limb d = x[j] - p_[j];
+            const Limb b1 = x[j] < p_[j] ? 1 : 0;
+            const Limb d2 = d - borrow;
+            const Limb b2 = d < borrow ? 1 : 0;
+            x[j] = d2;
+            borrow = b1 | b2;
+        }
+    }
+};
+
+/**
+ * @fn
+ * @brief 可変基底のべき乗 base^e を左から右への 4-bit 固定ウィンドウ法で計算する
+ * @param arith 剰余演算ポリシー
+ * @param base 基底
+ * @param e 非負の指数
+ */
+template <typename Arithmetic>
+typename Arithmetic::Element power(const Arithmetic& arith, const typename Arithmetic::Element& base,
+                                   const cpp_int& e)
+{
+    using Element = typename Arithmetic::Element;
+    constexpr unsigned w = 4;
+
+    std::array<Element, (1u << w)> powers;
+    powers[0] = arith.one();
+    for (std::size_t d = 1; d < powers.size(); ++d)
+    {
+        powers[d] = arith.mul(powers[d - 1], base);
+    }
+
+    Element acc = arith.one();
+    const unsigned bits = exponent_bits(e);
+    for (std::size_t k = (bits + w - 1) / w; k-- > 0;)
+    {
+        for (unsigned j = 0; j < w; ++j)
+        {
+            acc = arith.sqr(acc);
+        }
+        const unsigned d = exponent_window(e, k * w, w);
+        if (d != 0)
+        {
+            acc = arith.mul(acc, powers[d]);
+        }
+    }
+    return acc;
+}
+
+#endif  // MODULAR_ARITHMETIC_HPP
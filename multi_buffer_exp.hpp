@@ -0,0 +1,667 @@
+#ifndef MULTI_BUFFER_EXP_HPP
+#define MULTI_BUFFER_EXP_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define ZKP_MULTI_BUFFER_X86 1
+#endif
+
+#include "modular_arithmetic.hpp"
+#include "multi_exp.hpp"
+
+using namespace boost::multiprecision;
+
+// 独立した複数のべき乗を SIMD のレーンで同時に計算するカーネル
+enum class SimdKernel
+{
+    kScalar = 0,      // 1 件ずつ power() で計算する
+    kAvx2 = 1,        // 4 レーン、28-bit リム（vpmuludq）
+    kAvx512Ifma = 2,  // 8 レーン、52-bit リム（vpmadd52luq / vpmadd52huq）
+};
+
+inline constexpr std::size_t kSimdKernelCount = 3;
+
+/**
+ * @fn
+ * @brief カーネルをコマンドライン・ログ用の名前に変換する
+ */
+inline constexpr std::string_view simd_kernel_name(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+    case SimdKernel::kScalar:
+        return "scalar";
+    case SimdKernel::kAvx2:
+        return "avx2";
+    case SimdKernel::kAvx512Ifma:
+        return "avx512ifma";
+    }
+    return "unknown";
+}
+
+/**
+ * @fn
+ * @brief 名前（"scalar" / "avx2" / "avx512ifma"）をカーネルに変換する
+ * @return 未知の名前の場合は std::nullopt
+ */
+inline std::optional<SimdKernel> parse_simd_kernel(std::string_view name)
+{
+    for (std::size_t i = 0; i < kSimdKernelCount; ++i)
+    {
+        const auto kernel = static_cast<SimdKernel>(i);
+        if (simd_kernel_name(kernel) == name)
+        {
+            return kernel;
+        }
+    }
+    return std::nullopt;
+}
+
+// カーネルが同時に計算するべき乗の数
+inline constexpr std::size_t simd_kernel_lanes(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+    case SimdKernel::kAvx2:
+        return 4;
+    case SimdKernel::kAvx512Ifma:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * @fn
+ * @brief 実行中の CPU（と OS）がカーネルの命令に対応しているか
+ */
+inline bool simd_kernel_supported(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+    case SimdKernel::kScalar:
+        return true;
+#ifdef ZKP_MULTI_BUFFER_X86
+    case SimdKernel::kAvx2:
+        return __builtin_cpu_supports("avx2");
+    case SimdKernel::kAvx512Ifma:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @fn
+ * @brief 対応しているうちで最もレーンの多いカーネルを返す
+ */
+inline SimdKernel detect_simd_kernel()
+{
+    for (std::size_t i = kSimdKernelCount; i-- > 1;)
+    {
+        if (simd_kernel_supported(static_cast<SimdKernel>(i)))
+        {
+            return static_cast<SimdKernel>(i);
+        }
+    }
+    return SimdKernel::kScalar;
+}
+
+namespace multi_buffer_detail
+{
+inline std::atomic<SimdKernel>& active_kernel()
+{
+    static std::atomic<SimdKernel> kernel{detect_simd_kernel()};
+    return kernel;
+}
+}  // namespace multi_buffer_detail
+
+/**
+ * @fn
+ * @brief プロセス全体で使うカーネル（既定値は detect_simd_kernel()）
+ */
+inline SimdKernel simd_kernel() { return multi_buffer_detail::active_kernel().load(std::memory_order_relaxed); }
+
+/**
+ * @fn
+ * @brief プロセス全体で使うカーネルを切り替える（比較計測や、SIMD を使わない運用のため）
+ * @return CPU が対応していない場合は false（切り替えない）
+ */
+inline bool set_simd_kernel(SimdKernel kernel)
+{
+    if (!simd_kernel_supported(kernel))
+    {
+        return false;
+    }
+    multi_buffer_detail::active_kernel().store(kernel, std::memory_order_relaxed);
+    return true;
+}
+
+namespace multi_buffer_detail
+{
+// カーネルは値を Bits ビットのリム M 個で持ち、レーンを並べて格納する（レーン l のリム j は [j * Lanes + l]）。
+// M は 64-bit リム N 個の p に対して R' = 2^(Bits * M) > 4p となるように選ぶ。
+// このとき入力が 2p 未満なら Montgomery 乗算の結果も 2p 未満に収まるため、乗算ごとの条件付き減算が要らない。
+template <unsigned Bits, std::size_t N>
+inline constexpr std::size_t kLimbCount = (64 * N + 2) / Bits + 1;
+
+template <unsigned Bits>
+inline constexpr std::uint64_t kLimbMask = (std::uint64_t{1} << Bits) - 1;
+
+// 剰余 p ごとに一度だけ求める定数（Bits ビットのリムで表す）
+template <unsigned Bits, std::size_t M>
+struct KernelModulus
+{
+    std::array<std::uint64_t, M> p{};
+    std::uint64_t k0 = 0;                    // -p^{-1} mod 2^Bits
+    std::array<std::uint64_t, M> one{};      // R' mod p（カーネルの Montgomery 表現の 1）
+    std::array<std::uint64_t, M> to_kernel{};  // R'^2 / R mod p（aR を aR' に移す）
+    std::array<std::uint64_t, M> to_scalar{};  // R mod p（aR' を aR に戻す）
+};
+
+// 64-bit リムの値を Bits ビットのリム M 個に分ける
+template <unsigned Bits, std::size_t M, std::size_t N>
+std::array<std::uint64_t, M> split_limbs(const Limbs<N>& x)
+{
+    std::array<std::uint64_t, M> out{};
+    for (std::size_t j = 0; j < M; ++j)
+    {
+        const std::size_t index = j * Bits / 64;
+        const std::size_t offset = j * Bits % 64;
+        if (index >= N)
+        {
+            break;
+        }
+        std::uint64_t value = x[index] >> offset;
+        if (offset + Bits > 64 && index + 1 < N)
+        {
+            value |= x[index + 1] << (64 - offset);
+        }
+        out[j] = value & kLimbMask<Bits>;
+    }
+    return out;
+}
+
+// Bits ビットのリム（レーン間隔 stride）を 64-bit リム N 個に戻す（値は 2^(64N) 未満であること）
+template <unsigned Bits, std::size_t M, std::size_t N>
+Limbs<N> join_limbs(const std::uint64_t* x, std::size_t stride)
+{
+    Limbs<N> out{};
+    for (std::size_t j = 0; j < M; ++j)
+    {
+        const std::size_t index = j * Bits / 64;
+        const std::size_t offset = j * Bits % 64;
+        const std::uint64_t value = x[j * stride];
+        if (index < N)
+        {
+            out[index] |= value << offset;
+        }
+        if (offset + Bits > 64 && index + 1 < N)
+        {
+            out[index + 1] |= value >> (64 - offset);
+        }
+    }
+    return out;
+}
+
+template <unsigned Bits, std::size_t M, std::size_t N>
+KernelModulus<Bits, M> make_kernel_modulus(const Limbs<N>& modulus_limbs)
+{
+    const cpp_int p = integer_from_limbs<N>(modulus_limbs);
+    const auto limbs_of = [&p](unsigned exponent)
+    {
+        return split_limbs<Bits, M>(limbs_from_integer<N>(powm(cpp_int(2), exponent, p)));
+    };
+    KernelModulus<Bits, M> modulus;
+    modulus.p = split_limbs<Bits, M>(modulus_limbs);
+    std::uint64_t inv = modulus_limbs[0];
+    for (int i = 0; i < 5; ++i)
+    {
+        inv *= 2 - modulus_limbs[0] * inv;
+    }
+    modulus.k0 = (~inv + 1) & kLimbMask<Bits>;
+    modulus.one = limbs_of(Bits * M);
+    modulus.to_kernel = limbs_of(2 * Bits * M - 64 * N);
+    modulus.to_scalar = limbs_of(64 * N);
+    return modulus;
+}
+
+#ifdef ZKP_MULTI_BUFFER_X86
+// 4 レーンの Montgomery 乗算 out = a * b / R' mod p（28-bit リム）
+// vpmuludq の 56-bit の積をそのまま 64-bit に足し込み、繰り上げは最下位のリムだけ毎回行う。
+// 1 つのリムに足し込まれる積は 2M 個以下のため、M < 128（3000 ビット程度まで）なら 2^64 を超えない。
+template <std::size_t M>
+__attribute__((target("avx2"))) void avx2_mont_mul(std::uint64_t* out, const std::uint64_t* a,
+                                                   const std::uint64_t* b, const KernelModulus<28, M>& modulus)
+{
+    static_assert(2 * M < 256, "28-bit limb accumulators would overflow");
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(kLimbMask<28>));
+    const __m256i k0 = _mm256_set1_epi64x(static_cast<long long>(modulus.k0));
+    // t[i + j] に積を足していき、i 回目の還元で t[i] の下位 28 ビットを 0 にする（結果は t[M .. 2M - 1]）
+    __m256i t[2 * M];
+    for (std::size_t j = 0; j < 2 * M; ++j)
+    {
+        t[j] = _mm256_setzero_si256();
+    }
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        const __m256i bi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 4 * i));
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const __m256i aj = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 4 * j));
+            t[i + j] = _mm256_add_epi64(t[i + j], _mm256_mul_epu32(aj, bi));
+        }
+        const __m256i m = _mm256_and_si256(_mm256_mul_epu32(t[i], k0), mask);
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const __m256i pj = _mm256_set1_epi64x(static_cast<long long>(modulus.p[j]));
+            t[i + j] = _mm256_add_epi64(t[i + j], _mm256_mul_epu32(pj, m));
+        }
+        t[i + 1] = _mm256_add_epi64(t[i + 1], _mm256_srli_epi64(t[i], 28));
+    }
+    __m256i carry = _mm256_setzero_si256();
+    for (std::size_t j = 0; j < M; ++j)
+    {
+        const __m256i v = _mm256_add_epi64(t[M + j], carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * j), _mm256_and_si256(v, mask));
+        carry = _mm256_srli_epi64(v, 28);
+    }
+}
+
+// 8 レーンの Montgomery 乗算 out = a * b / R' mod p（52-bit リム）
+// 104-bit の積の下位 52 ビットを t[j] に、上位を t[j + 1] に vpmadd52luq / vpmadd52huq で足し込む。
+template <std::size_t M>
+__attribute__((target("avx512f,avx512ifma"))) void ifma_mont_mul(std::uint64_t* out, const std::uint64_t* a,
+                                                                   const std::uint64_t* b,
+                                                                   const KernelModulus<52, M>& modulus)
+{
+    static_assert(4 * M < 4096, "52-bit limb accumulators would overflow");
+    const __m512i mask = _mm512_set1_epi64(static_cast<long long>(kLimbMask<52>));
+    const __m512i k0 = _mm512_set1_epi64(static_cast<long long>(modulus.k0));
+    const __m512i zero = _mm512_setzero_si512();
+    // _mm512_srli_epi64 は未初期化のパススルー（_mm512_undefined_epi32）を渡すため GCC 12 の -Wall で
+    // -Wuninitialized になる。全レーンを選ぶマスク付きのシフト（パススルーはゼロ）で同じ命令にする
+    const __mmask8 all_lanes = 0xFF;
+    __m512i t[2 * M];
+    for (std::size_t j = 0; j < 2 * M; ++j)
+    {
+        t[j] = zero;
+    }
+    for (std::size_t i = 0; i < M; ++i)
+    {
+        const __m512i bi = _mm512_loadu_si512(b + 8 * i);
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const __m512i aj = _mm512_loadu_si512(a + 8 * j);
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], aj, bi);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], aj, bi);
+        }
+        const __m512i m = _mm512_madd52lo_epu64(zero, t[i], k0);
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const __m512i pj = _mm512_set1_epi64(static_cast<long long>(modulus.p[j]));
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], pj, m);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], pj, m);
+        }
+        t[i + 1] = _mm512_add_epi64(t[i + 1], _mm512_maskz_srli_epi64(all_lanes, t[i], 52));
+    }
+    __m512i carry = zero;
+    for (std::size_t j = 0; j < M; ++j)
+    {
+        const __m512i v = _mm512_add_epi64(t[M + j], carry);
+        _mm512_storeu_si512(out + 8 * j, _mm512_and_si512(v, mask));
+        carry = _mm512_maskz_srli_epi64(all_lanes, v, 52);
+    }
+}
+#endif
+
+// SIMD カーネルでの Montgomery 乗算（Lanes レーン、Bits ビットのリム）
+template <std::size_t Lanes, unsigned Bits>
+struct KernelTraits;
+
+template <>
+struct KernelTraits<4, 28>
+{
+    template <std::size_t M>
+    static void mul(std::uint64_t* out, const std::uint64_t* a, const std::uint64_t* b,
+                    const KernelModulus<28, M>& modulus)
+    {
+#ifdef ZKP_MULTI_BUFFER_X86
+        avx2_mont_mul<M>(out, a, b, modulus);
+#endif
+    }
+};
+
+template <>
+struct KernelTraits<8, 52>
+{
+    template <std::size_t M>
+    static void mul(std::uint64_t* out, const std::uint64_t* a, const std::uint64_t* b,
+                    const KernelModulus<52, M>& modulus)
+    {
+#ifdef ZKP_MULTI_BUFFER_X86
+        ifma_mont_mul<M>(out, a, b, modulus);
+#endif
+    }
+};
+
+/**
+ * @brief Lanes 件の base_i^e_i を 1 つの SIMD カーネルで同時に計算する
+ * @note  各レーンは独立したべき乗で、左から右への 4-bit 固定ウィンドウ法（power() と同じ手順）を全レーンで揃えて進める。
+ *        指数のビット長が違う場合は最長に合わせ、短いレーンは上位のウィンドウで 1 を掛ける。
+ *        固定基底の項を掛ける場合は、各レーンのテーブルのエントリを選んでカーネルの表現に変換してから掛ける
+ *        （ウィンドウ 1 つあたり 2 回の乗算。桁が 0 のレーンは 1 を掛ける）。
+ *        ウィンドウの表引きはレーンごとの添字で行うため定数時間ではない。指数は公開値（c, s など）に限ること。
+ */
+template <std::size_t N, std::size_t Lanes, unsigned Bits>
+class KernelModExp
+{
+   public:
+    static constexpr std::size_t kLanes = Lanes;
+    static constexpr std::size_t M = kLimbCount<Bits, N>;
+
+    explicit KernelModExp(const Limbs<N>& modulus_limbs) : modulus_(make_kernel_modulus<Bits, M>(modulus_limbs)) {}
+
+    /**
+     * @fn
+     * @brief results[l] = terms[l].base^terms[l].exponent（l < count <= kLanes、要素は MontgomeryArithmetic<N> の表現）
+     * @param fixed_terms nullptr でなければ fixed_terms[l] の固定基底のべき乗も掛ける（指数はテーブルの範囲内であること）
+     */
+    void pow(const PowTerm<MontgomeryArithmetic<N>>* terms, const FixedPowTerm<MontgomeryArithmetic<N>>* fixed_terms,
+             std::size_t count, Limbs<N>* results) const
+    {
+        constexpr unsigned w = 4;
+        using Vector = std::array<std::uint64_t, M * Lanes>;
+
+        Vector x{};
+        for (std::size_t l = 0; l < Lanes; ++l)
+        {
+            const std::array<std::uint64_t, M> limbs =
+                l < count ? split_limbs<Bits, M>(terms[l].base) : std::array<std::uint64_t, M>{};
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                x[j * Lanes + l] = limbs[j];
+            }
+        }
+        const Vector one = broadcast(modulus_.one);
+        mul(x, x, broadcast(modulus_.to_kernel));
+
+        std::array<Vector, (1u << w)> powers;
+        powers[0] = one;
+        powers[1] = x;
+        for (std::size_t d = 2; d < powers.size(); ++d)
+        {
+            mul(powers[d], powers[d - 1], x);
+        }
+
+        unsigned bits = 0;
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            bits = std::max(bits, exponent_bits(terms[l].exponent));
+        }
+        Vector acc = one;
+        Vector selected;
+        bool started = false;
+        for (std::size_t k = (bits + w - 1) / w; k-- > 0;)
+        {
+            if (started)
+            {
+                for (unsigned j = 0; j < w; ++j)
+                {
+                    mul(acc, acc, acc);
+                }
+            }
+            bool any = false;
+            for (std::size_t l = 0; l < Lanes; ++l)
+            {
+                const unsigned d = l < count ? exponent_window(terms[l].exponent, k * w, w) : 0;
+                any = any || d != 0;
+                for (std::size_t j = 0; j < M; ++j)
+                {
+                    selected[j * Lanes + l] = powers[d][j * Lanes + l];
+                }
+            }
+            if (any)
+            {
+                if (started)
+                {
+                    mul(acc, acc, selected);
+                }
+                else
+                {
+                    acc = selected;
+                    started = true;
+                }
+            }
+        }
+
+        if (fixed_terms != nullptr)
+        {
+            unsigned windows = 0;
+            for (std::size_t l = 0; l < count; ++l)
+            {
+                windows = std::max(windows, fixed_terms[l].table.window_count());
+            }
+            const Vector to_kernel = broadcast(modulus_.to_kernel);
+            for (unsigned k = 0; k < windows; ++k)
+            {
+                bool any = false;
+                for (std::size_t l = 0; l < Lanes; ++l)
+                {
+                    // to_scalar は R mod p（MontgomeryArithmetic<N> の 1）
+                    std::array<std::uint64_t, M> limbs = modulus_.to_scalar;
+                    if (l < count && k < fixed_terms[l].table.window_count())
+                    {
+                        const FixedBaseTable<MontgomeryArithmetic<N>>& table = fixed_terms[l].table;
+                        const unsigned d = exponent_window(fixed_terms[l].exponent,
+                                                           static_cast<std::size_t>(k) * table.window_bits(),
+                                                           table.window_bits());
+                        if (d != 0)
+                        {
+                            limbs = split_limbs<Bits, M>(table.entry(k, d));
+                            any = true;
+                        }
+                    }
+                    for (std::size_t j = 0; j < M; ++j)
+                    {
+                        selected[j * Lanes + l] = limbs[j];
+                    }
+                }
+                if (any)
+                {
+                    mul(selected, selected, to_kernel);
+                    mul(acc, acc, selected);
+                }
+            }
+        }
+
+        mul(acc, acc, broadcast(modulus_.to_scalar));
+        for (std::size_t l = 0; l < count; ++l)
+        {
+            reduce_lane(acc.data() + l);
+            results[l] = join_limbs<Bits, M, N>(acc.data() + l, Lanes);
+        }
+    }
+
+   private:
+    KernelModulus<Bits, M> modulus_;
+
+    // out は a, b と同じでもよい（カーネルは入力を読み終えてから書き込む）
+    void mul(std::array<std::uint64_t, M * Lanes>& out, const std::array<std::uint64_t, M * Lanes>& a,
+             const std::array<std::uint64_t, M * Lanes>& b) const
+    {
+        KernelTraits<Lanes, Bits>::template mul<M>(out.data(), a.data(), b.data(), modulus_);
+    }
+
+    static std::array<std::uint64_t, M * Lanes> broadcast(const std::array<std::uint64_t, M>& limbs)
+    {
+        std::array<std::uint64_t, M * Lanes> out;
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            std::fill_n(out.begin() + static_cast<std::ptrdiff_t>(j * Lanes), Lanes, limbs[j]);
+        }
+        return out;
+    }
+
+    // [0, 2p) のレーンの値を [0, p) に正規化する
+    void reduce_lane(std::uint64_t* x) const
+    {
+        std::array<std::uint64_t, M> diff;
+        std::uint64_t borrow = 0;
+        for (std::size_t j = 0; j < M; ++j)
+        {
+            const std::uint64_t d = x[j * Lanes] - modulus_.p[j] - borrow;
+            borrow = d >> 63;
+            diff[j] = d & kLimbMask<Bits>;
+        }
+        if (borrow == 0)
+        {
+            for (std::size_t j = 0; j < M; ++j)
+            {
+                x[j * Lanes] = diff[j];
+            }
+        }
+    }
+};
+
+// SIMD カーネルを使わずに 1 件ずつ計算する
+template <typename Arithmetic>
+void pow_each(const Arithmetic& arith, const PowTerm<Arithmetic>* terms, const FixedPowTerm<Arithmetic>* fixed_terms,
+              std::size_t count, typename Arithmetic::Element* results)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        results[i] = fixed_terms ? ::multi_pow<Arithmetic>(arith, {terms[i]}, {fixed_terms[i]})
+                                 : power(arith, terms[i].base, terms[i].exponent);
+    }
+}
+}  // namespace multi_buffer_detail
+
+/**
+ * @brief 独立した複数のべき乗 base_i^e_i（固定基底の項 G_i^s_i を掛けてもよい）をまとめて計算する
+ * @note  演算ポリシーが Montgomery 固定長の場合は、simd_kernel() で選ばれたカーネルのレーン数ずつ同時に計算する
+ *        （MontgomeryArithmetic<N> の特殊化）。それ以外は 1 件ずつ power() で計算する。
+ *        構築後は変更されないため、複数スレッドから同時に参照してよい。
+ * @tparam Arithmetic 剰余演算ポリシー
+ */
+template <typename Arithmetic>
+class MultiBufferExp
+{
+   public:
+    using Element = typename Arithmetic::Element;
+    using Term = PowTerm<Arithmetic>;
+    using FixedTerm = FixedPowTerm<Arithmetic>;
+
+    explicit MultiBufferExp(const Arithmetic& arith) : arith_(arith) {}
+
+    // 同時に計算する数（1 なら SIMD を使わない）
+    std::size_t lanes() const { return 1; }
+
+    /**
+     * @fn
+     * @brief results[i] = terms[i].base^terms[i].exponent (i < count)
+     * @note  指数は公開値であること（SIMD カーネルの表引きは定数時間ではない）
+     * @param fixed_terms nullptr でなければ fixed_terms[i] の固定基底のべき乗も掛ける（count 要素）
+     */
+    void pow(const Term* terms, const FixedTerm* fixed_terms, std::size_t count, Element* results) const
+    {
+        multi_buffer_detail::pow_each(arith_, terms, fixed_terms, count, results);
+    }
+
+   private:
+    Arithmetic arith_;
+};
+
+template <std::size_t N>
+class MultiBufferExp<MontgomeryArithmetic<N>>
+{
+   public:
+    using Element = Limbs<N>;
+    using Term = PowTerm<MontgomeryArithmetic<N>>;
+    using FixedTerm = FixedPowTerm<MontgomeryArithmetic<N>>;
+
+    // CPU が対応しているカーネルの定数を求めておく（p が奇数でない場合は Montgomery 演算にならないため作らない）
+    explicit MultiBufferExp(const MontgomeryArithmetic<N>& arith) : arith_(arith)
+    {
+        if ((arith.modulus_limbs()[0] & 1) == 0)
+        {
+            return;
+        }
+        if (simd_kernel_supported(SimdKernel::kAvx2))
+        {
+            avx2_.emplace(arith.modulus_limbs());
+        }
+        if (simd_kernel_supported(SimdKernel::kAvx512Ifma))
+        {
+            ifma_.emplace(arith.modulus_limbs());
+        }
+    }
+
+    std::size_t lanes() const
+    {
+        const SimdKernel kernel = simd_kernel();
+        return (kernel == SimdKernel::kAvx2 && avx2_) || (kernel == SimdKernel::kAvx512Ifma && ifma_)
+                   ? simd_kernel_lanes(kernel)
+                   : 1;
+    }
+
+    void pow(const Term* terms, const FixedTerm* fixed_terms, std::size_t count, Element* results) const
+    {
+        const SimdKernel kernel = simd_kernel();
+        // テーブルの範囲を超える指数（通常は現れない）を含む場合はスカラーで計算する
+        bool covered = true;
+        for (std::size_t i = 0; fixed_terms != nullptr && i < count; ++i)
+        {
+            covered = covered && fixed_terms[i].table.covers(fixed_terms[i].exponent);
+        }
+        if (covered && kernel == SimdKernel::kAvx2 && avx2_)
+        {
+            pow_lanes(*avx2_, 3, terms, fixed_terms, count, results);
+        }
+        else if (covered && kernel == SimdKernel::kAvx512Ifma && ifma_)
+        {
+            pow_lanes(*ifma_, 2, terms, fixed_terms, count, results);
+        }
+        else
+        {
+            multi_buffer_detail::pow_each(arith_, terms, fixed_terms, count, results);
+        }
+    }
+
+   private:
+    MontgomeryArithmetic<N> arith_;
+    std::optional<multi_buffer_detail::KernelModExp<N, 4, 28>> avx2_;
+    std::optional<multi_buffer_detail::KernelModExp<N, 8, 52>> ifma_;
+
+    // カーネルの 1 回の呼び出しは埋まったレーン数によらず同じ時間がかかるため、
+    // 残りが min_lanes 件（スカラーで計算したほうが速くなる境目）未満の場合はスカラーで計算する
+    template <typename Kernel>
+    void pow_lanes(const Kernel& kernel, std::size_t min_lanes, const Term* terms, const FixedTerm* fixed_terms,
+                   std::size_t count, Element* results) const
+    {
+        std::size_t i = 0;
+        for (; count - i >= min_lanes; i += Kernel::kLanes)
+        {
+            const std::size_t n = std::min(Kernel::kLanes, count - i);
+            kernel.pow(terms + i, fixed_terms ? fixed_terms + i : nullptr, n, results + i);
+            if (n < Kernel::kLanes)
+            {
+                return;
+            }
+        }
+        multi_buffer_detail::pow_each(arith_, terms + i, fixed_terms ? fixed_terms + i : nullptr, count - i,
+                                      results + i);
+    }
+};
+
+#endif  // MULTI_BUFFER_EXP_HPP
@@ -0,0 +1,160 @@
+#include "multi_buffer_exp.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+#include "zkp_group.hpp"
+
+namespace
+{
+// テストの間だけプロセス全体のカーネルを切り替え、元に戻す
+class KernelGuard
+{
+   public:
+    ~KernelGuard() { set_simd_kernel(saved_); }
+
+   private:
+    const SimdKernel saved_ = simd_kernel();
+};
+
+std::vector<SimdKernel> supported_kernels()
+{
+    std::vector<SimdKernel> kernels;
+    for (std::size_t i = 0; i < kSimdKernelCount; ++i)
+    {
+        if (simd_kernel_supported(static_cast<SimdKernel>(i)))
+        {
+            kernels.push_back(static_cast<SimdKernel>(i));
+        }
+    }
+    return kernels;
+}
+
+// 指数の長さや基底の端の値を混ぜた項を作り、全てのカーネルで power() と一致することを確認する
+template <std::size_t N>
+void expect_kernels_match_power(const MontgomeryArithmetic<N>& arith)
+{
+    using Element = Limbs<N>;
+    const cpp_int p = integer_from_limbs<N>(arith.modulus_limbs());
+
+    std::vector<Element> bases;
+    std::vector<cpp_int> exponents;
+    for (int i = 0; i < 19; ++i)
+    {
+        bases.push_back(arith.from_integer(generate_random(p)));
+        exponents.push_back(generate_random(i % 3 == 0 ? p : cpp_int(1) << (20 * i)));
+    }
+    bases[1] = arith.one();
+    bases[2] = arith.from_integer(p - 1);
+    bases[3] = Element{};
+    exponents[4] = 0;
+    exponents[5] = 1;
+    exponents[6] = p - 1;
+
+    // 固定基底の項はウィンドウ幅の異なる 2 つのテーブルを交互に使う（0 と、テーブルの範囲いっぱいの指数を含む）
+    const FixedBaseTable<MontgomeryArithmetic<N>> tables[] = {{arith, arith.from_integer(generate_random(p)), 160, 6},
+                                                               {arith, arith.from_integer(generate_random(p)), 160, 4}};
+    std::vector<cpp_int> fixed_exponents;
+    for (std::size_t i = 0; i < bases.size(); ++i)
+    {
+        fixed_exponents.push_back(generate_random(cpp_int(1) << 160));
+    }
+    fixed_exponents[7] = 0;
+    fixed_exponents[8] = (cpp_int(1) << 160) - 1;
+
+    std::vector<PowTerm<MontgomeryArithmetic<N>>> terms;
+    std::vector<FixedPowTerm<MontgomeryArithmetic<N>>> fixed_terms;
+    std::vector<Element> expected;
+    std::vector<Element> expected_fixed;
+    for (std::size_t i = 0; i < bases.size(); ++i)
+    {
+        terms.push_back({bases[i], exponents[i]});
+        fixed_terms.push_back({tables[i % 2], fixed_exponents[i]});
+        expected.push_back(power(arith, bases[i], exponents[i]));
+        expected_fixed.push_back(arith.mul(expected.back(), tables[i % 2].pow(fixed_exponents[i])));
+    }
+
+    const KernelGuard guard;
+    const MultiBufferExp<MontgomeryArithmetic<N>> exp(arith);
+    for (const SimdKernel kernel : supported_kernels())
+    {
+        ASSERT_TRUE(set_simd_kernel(kernel));
+        EXPECT_EQ(exp.lanes(), simd_kernel_lanes(kernel));
+        // レーン数の倍数でない件数と、1 件だけの場合（スカラーに切り替わる）
+        for (const std::size_t count : {terms.size(), std::size_t{1}})
+        {
+            std::vector<Element> results(count);
+            exp.pow(terms.data(), nullptr, count, results.data());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                EXPECT_EQ(results[i], expected[i]) << simd_kernel_name(kernel) << " index " << i;
+            }
+            exp.pow(terms.data(), fixed_terms.data(), count, results.data());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                EXPECT_EQ(results[i], expected_fixed[i]) << simd_kernel_name(kernel) << " fixed index " << i;
+            }
+        }
+    }
+}
+}  // namespace
+
+TEST(SimdKernelTest, NamesAndDetection)
+{
+    for (std::size_t i = 0; i < kSimdKernelCount; ++i)
+    {
+        const auto kernel = static_cast<SimdKernel>(i);
+        EXPECT_EQ(parse_simd_kernel(simd_kernel_name(kernel)), kernel);
+    }
+    EXPECT_FALSE(parse_simd_kernel("sse2"));
+    EXPECT_EQ(simd_kernel_lanes(SimdKernel::kScalar), 1u);
+
+    EXPECT_TRUE(simd_kernel_supported(SimdKernel::kScalar));
+    EXPECT_TRUE(simd_kernel_supported(detect_simd_kernel()));
+    for (const SimdKernel kernel : supported_kernels())
+    {
+        EXPECT_LE(simd_kernel_lanes(kernel), simd_kernel_lanes(detect_simd_kernel()));
+    }
+}
+
+TEST(MultiBufferExpTest, KernelsMatchPowerForRfc5114Group) { expect_kernels_match_power(kRfc5114Arithmetic); }
+
+TEST(MultiBufferExpTest, KernelsMatchPowerForOtherModuli)
+{
+    // 2^(64N) に近い p（カーネルの余裕が最も小さい）と、リム数の異なる p
+    expect_kernels_match_power(MontgomeryArithmetic<16>((cpp_int(1) << 1024) - 105));
+    const cpp_int odd_2048 = (cpp_int(1) << 2047) + generate_random(cpp_int(1) << 2046) * 2 + 1;
+    expect_kernels_match_power(MontgomeryArithmetic<32>(odd_2048));
+    expect_kernels_match_power(MontgomeryArithmetic<4>((cpp_int(1) << 256) - 189));
+}
+
+TEST(MultiBufferExpTest, VerificationAgreesAcrossKernels)
+{
+    const MontChaumPedersen cp(get_zkp_mont_group());
+    const cpp_int& q = cp.order();
+    std::vector<MontChaumPedersen::Proof> proofs;
+    for (int i = 0; i < 11; ++i)
+    {
+        const cpp_int x = generate_random(q);
+        const cpp_int k = generate_random(q);
+        const Challenge challenge = {generate_random(q)};
+        proofs.push_back(
+            {cp.create_commitment(k), cp.calculate_public_keys(x), challenge, cp.solve_response(k, challenge, x)});
+    }
+    proofs[3].response.s = (proofs[3].response.s + 1) % q;
+    std::swap(proofs[8].public_keys.y1, proofs[8].public_keys.y2);
+
+    const KernelGuard guard;
+    for (const SimdKernel kernel : supported_kernels())
+    {
+        ASSERT_TRUE(set_simd_kernel(kernel));
+        const std::vector<bool> results = cp.verify_batch(proofs);
+        for (std::size_t i = 0; i < proofs.size(); ++i)
+        {
+            EXPECT_EQ(results[i], i != 3 && i != 8) << simd_kernel_name(kernel) << " index " << i;
+            EXPECT_EQ(cp.verify_proof(proofs[i]), results[i]) << simd_kernel_name(kernel) << " index " << i;
+        }
+    }
+}
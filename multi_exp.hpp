@@ -0,0 +1,128 @@
+#ifndef MULTI_EXP_HPP
+#define MULTI_EXP_HPP
+
+#include <algorithm>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <vector>
+
+#include "fixed_base_table.hpp"
+#include "modular_arithmetic.hpp"
+
+using namespace boost::multiprecision;
+
+// 可変基底の項 base^exponent
+template <typename Arithmetic>
+struct PowTerm
+{
+    const typename Arithmetic::Element& base;
+    const cpp_int& exponent;
+};
+
+// 固定基底テーブルを持つ項 table.base()^exponent
+template <typename Arithmetic>
+struct FixedPowTerm
+{
+    const FixedBaseTable<Arithmetic>& table;
+    const cpp_int& exponent;
+};
+
+/**
+ * @fn
+ * @brief 指数のビット長に応じた Straus 法のウィンドウ幅を返す
+ * @param exponent_bits 最大の指数ビット長
+ * @return ウィンドウ幅
+ */
+inline unsigned multi_exp_window_bits(unsigned exponent_bits)
+{
+    if (exponent_bits <= 16)
+    {
+        return 1;
+    }
+    if (exponent_bits <= 64)
+    {
+        return 3;
+    }
+    if (exponent_bits <= 256)
+    {
+        return 4;
+    }
+    return 5;
+}
+
+/**
+ * @fn
+ * @brief Π base_i^e_i mod p を同時べき乗（Straus法）で計算する
+ * @note  可変基底の項は w ビットウィンドウで上位桁から同時に処理し、二乗算を全項で共有する。
+ *        n 項の場合でも二乗算は最大指数のビット長分だけで済む。
+ *        固定基底の項は事前計算テーブルで二乗算なしに計算し、最後に掛け合わせる。
+ * @param arith 剰余演算ポリシー
+ * @param terms 可変基底の項
+ * @param fixed_terms 固定基底テーブルを持つ項
+ * @return Π base_i^e_i mod p
+ */
+template <typename Arithmetic>
+typename Arithmetic::Element multi_pow(const Arithmetic& arith, const std::vector<PowTerm<Arithmetic>>& terms,
+                                       const std::vector<FixedPowTerm<Arithmetic>>& fixed_terms = {})
+{
+    using Element = typename Arithmetic::Element;
+
+    Element result = arith.one();
+    for (const FixedPowTerm<Arithmetic>& term : fixed_terms)
+    {
+        result = arith.mul(result, term.table.pow(term.exponent));
+    }
+
+    unsigned max_bits = 0;
+    for (const PowTerm<Arithmetic>& term : terms)
+    {
+        max_bits = std::max(max_bits, exponent_bits(term.exponent));
+    }
+    if (max_bits == 0)
+    {
+        return result;
+    }
+
+    const unsigned w = multi_exp_window_bits(max_bits);
+    const std::size_t window_count = (max_bits + w - 1) / w;
+    const std::size_t row_size = (std::size_t{1} << w) - 1;
+
+    // 各項について base^1 .. base^(2^w - 1) を用意する
+    std::vector<Element> powers;
+    powers.reserve(terms.size() * row_size);
+    for (const PowTerm<Arithmetic>& term : terms)
+    {
+        Element acc = term.base;
+        powers.push_back(acc);
+        for (std::size_t d = 2; d <= row_size; ++d)
+        {
+            acc = arith.mul(acc, term.base);
+            powers.push_back(acc);
+        }
+    }
+
+    Element acc = arith.one();
+    bool started = false;
+    for (std::size_t k = window_count; k-- > 0;)
+    {
+        if (started)
+        {
+            for (unsigned j = 0; j < w; ++j)
+            {
+                acc = arith.sqr(acc);
+            }
+        }
+        for (std::size_t i = 0; i < terms.size(); ++i)
+        {
+            const unsigned d = exponent_window(terms[i].exponent, k * w, w);
+            if (d != 0)
+            {
+                acc = arith.mul(acc, powers[i * row_size + (d - 1)]);
+                started = true;
+            }
+        }
+    }
+
+    return arith.mul(result, acc);
+}
+
+#endif  // MULTI_EXP_HPP
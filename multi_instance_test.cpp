@@ -0,0 +1,759 @@
+#include <arpa/inet.h>
+#include <grpcpp/grpcpp.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "auth_client.hpp"
+#include "auth_server.hpp"
+#include "auth_service_impl.hpp"
+#include "chaum_pedersen.hpp"
+#include "commitment_pool.hpp"
+#include "user_import.hpp"
+#include "zkp_auth.grpc.pb.h"
+
+namespace
+{
+using Stream = grpc::ClientReaderWriter<StreamAuthRequest, StreamAuthResponse>;
+
+// localhost の空いているポートで起動した 1 つのサーバインスタンス
+class Instance
+{
+   public:
+    explicit Instance(const AuthServiceOptions& options) : Instance(options, std::make_shared<UserStore>(options.users))
+    {
+    }
+
+    Instance(const AuthServiceOptions& options, std::shared_ptr<UserStore> users) : service_(options, std::move(users))
+    {
+        grpc::ServerBuilder builder;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port_);
+        builder.RegisterService(&service_);
+        server_ = builder.BuildAndStart();
+        channel_ = grpc::CreateChannel("127.0.0.1:" + std::to_string(port_), grpc::InsecureChannelCredentials());
+        stub_ = Auth::NewStub(channel_);
+    }
+
+    ~Instance() { server_->Shutdown(); }
+
+    Auth::Stub& stub() { return *stub_; }
+
+    std::shared_ptr<grpc::Channel> channel() const { return channel_; }
+
+    AuthServiceImpl& service() { return service_; }
+
+   private:
+    AuthServiceImpl service_;
+    int port_ = 0;
+    std::unique_ptr<grpc::Server> server_;
+    std::shared_ptr<grpc::Channel> channel_;
+    std::unique_ptr<Auth::Stub> stub_;
+};
+
+// localhost の空いているポート（一度閉じてから使うため、まれに他のプロセスと競合しうる）
+int free_port()
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+    {
+        throw std::runtime_error("cannot find a free port");
+    }
+    close(fd);
+    return ntohs(address.sin_port);
+}
+
+// 非同期サーバ（AuthServer の CompletionQueue によるイベントループ）で起動した 1 つのインスタンス
+class AsyncInstance
+{
+   public:
+    explicit AsyncInstance(const AuthServiceOptions& options)
+        : server_({.service = options, .async = true, .completion_queues = 1})
+    {
+        const std::string address = "127.0.0.1:" + std::to_string(free_port());
+        thread_ = std::thread([this, address] { server_.Run(address); });
+        channel_ = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
+        channel_->WaitForConnected(std::chrono::system_clock::now() + std::chrono::seconds(10));
+        stub_ = Auth::NewStub(channel_);
+    }
+
+    ~AsyncInstance()
+    {
+        server_.Shutdown();
+        thread_.join();
+    }
+
+    Auth::Stub& stub() { return *stub_; }
+
+    std::shared_ptr<grpc::Channel> channel() const { return channel_; }
+
+   private:
+    AuthServer server_;
+    std::thread thread_;
+    std::shared_ptr<grpc::Channel> channel_;
+    std::unique_ptr<Auth::Stub> stub_;
+};
+
+class MultiInstanceTest : public testing::Test
+{
+   protected:
+    const MontChaumPedersen cp_{get_zkp_mont_group()};
+    const cpp_int x_ = generate_random(cp_.order());
+    std::string key_file_ = testing::TempDir() + "multi_instance_test.key";
+
+    void SetUp() override { std::ofstream(key_file_) << std::string(64, 'a') << "\n"; }
+    void TearDown() override { std::remove(key_file_.c_str()); }
+
+    AuthServiceOptions options(const std::string& key_file) const
+    {
+        AuthServiceOptions options;
+        options.challenge_key_file = key_file;
+        options.sessions.ttl = std::chrono::milliseconds(2000);
+        return options;
+    }
+
+    grpc::Status register_user(Instance& instance) { return register_user(instance.stub(), "alice", x_); }
+
+    grpc::Status register_user(Auth::Stub& stub, const std::string& user, const cpp_int& x) const
+    {
+        RegisterResponse response;
+        grpc::ClientContext context;
+        return stub.Register(&context, registration(user, x), &response);
+    }
+
+    // 秘密鍵 x の user の登録の要求
+    RegisterRequest registration(const std::string& user, const cpp_int& x) const
+    {
+        const auto y = cp_.calculate_public_keys(x);
+        RegisterRequest request;
+        request.set_user(user);
+        request.set_encoding(BINARY);
+        request.set_y1(encode_fixed(cp_.group().encode(y.y1), cp_.group().encoded_bytes()));
+        request.set_y2(encode_fixed(cp_.group().encode(y.y2), cp_.group().encoded_bytes()));
+        return request;
+    }
+
+    // logins を 1 本のストリームでログインさせ、各ログインの状態を返す
+    static std::vector<grpc::Status> log_in(Instance& instance, const std::vector<BulkLogin>& logins)
+    {
+        AuthClient client(instance.channel());
+        std::vector<BulkLoginResult> results;
+        EXPECT_TRUE(client.bulk_login(logins, GroupId::kModp1024, results).ok());
+        std::vector<grpc::Status> statuses;
+        for (const BulkLoginResult& result : results)
+        {
+            statuses.push_back(result.status);
+        }
+        return statuses;
+    }
+
+    // user のチャレンジの要求（k は回答に使う）
+    AuthenticationChallengeRequest challenge_request(const std::string& user, const cpp_int& k) const
+    {
+        const auto r = cp_.create_commitment(k);
+        AuthenticationChallengeRequest request;
+        request.set_user(user);
+        request.set_encoding(BINARY);
+        request.set_r1(encode_fixed(cp_.group().encode(r.r1), cp_.group().encoded_bytes()));
+        request.set_r2(encode_fixed(cp_.group().encode(r.r2), cp_.group().encoded_bytes()));
+        return request;
+    }
+
+    // 受け取ったチャレンジへの alice の正しい回答
+    AuthenticationAnswerRequest answer_request(const AuthenticationChallengeResponse& challenge, const cpp_int& k) const
+    {
+        const Response s = cp_.solve_response(k, Challenge{*decode_fixed(challenge.c(), challenge.c().size())}, x_);
+        AuthenticationAnswerRequest answer;
+        answer.set_auth_id(challenge.auth_id());
+        answer.set_encoding(BINARY);
+        answer.set_s(encode_fixed(s.s, byte_length(cp_.order())));
+        return answer;
+    }
+
+    // issuer でチャレンジを受け取り、正しい回答を作る
+    AuthenticationAnswerRequest challenge(Instance& issuer)
+    {
+        const cpp_int k = generate_random(cp_.order());
+        const AuthenticationChallengeRequest request = challenge_request("alice", k);
+        AuthenticationChallengeResponse response;
+        grpc::ClientContext context;
+        EXPECT_TRUE(issuer.stub().CreateAuthenticationChallenge(&context, request, &response).ok());
+        return answer_request(response, k);
+    }
+
+    // alice の現在時刻の非対話の証明
+    NonInteractiveAuthenticationRequest proof() const
+    {
+        const PrecomputedCommitment commitment = make_commitment(cp_);
+        const auto y = cp_.calculate_public_keys(x_);
+        const std::uint64_t timestamp_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        const Challenge c = cp_.fiat_shamir_challenge({cp_.group().encode(y.y1), cp_.group().encode(y.y2)},
+                                                      commitment.commitment, "alice", timestamp_ms);
+        const Response s = cp_.solve_response(commitment.k, c, x_);
+        const std::size_t bytes = cp_.group().encoded_bytes();
+        NonInteractiveAuthenticationRequest request;
+        request.set_user("alice");
+        request.set_encoding(BINARY);
+        request.set_r1(encode_fixed(commitment.commitment.r1, bytes));
+        request.set_r2(encode_fixed(commitment.commitment.r2, bytes));
+        request.set_s(encode_fixed(s.s, byte_length(cp_.order())));
+        request.set_timestamp_ms(timestamp_ms);
+        return request;
+    }
+
+    static grpc::Status verify(Instance& verifier, const AuthenticationAnswerRequest& answer)
+    {
+        AuthenticationAnswerResponse response;
+        grpc::ClientContext context;
+        return verifier.stub().VerifyAuthentication(&context, answer, &response);
+    }
+};
+
+// AuthenticateStream を同期サーバ（読み取り用のスレッド）と非同期サーバ（AsyncStreamCall）の両方で試す
+class StreamTest : public MultiInstanceTest, public testing::WithParamInterface<bool>
+{
+   protected:
+    std::unique_ptr<Instance> sync_;
+    std::unique_ptr<AsyncInstance> async_;
+
+    // GetParam() が true の場合は非同期サーバで起動し、alice を登録する
+    Auth::Stub& start(const AuthServiceOptions& options)
+    {
+        sync_.reset();
+        async_.reset();
+        if (GetParam())
+        {
+            async_ = std::make_unique<AsyncInstance>(options);
+        }
+        else
+        {
+            sync_ = std::make_unique<Instance>(options);
+        }
+        EXPECT_TRUE(register_user(stub(), "alice", x_).ok());
+        return stub();
+    }
+
+    Auth::Stub& stub() { return async_ ? async_->stub() : sync_->stub(); }
+
+    std::shared_ptr<grpc::Channel> channel() const { return async_ ? async_->channel() : sync_->channel(); }
+
+    // 非対話の証明の検証を max_wait の間待たせる（チャレンジの返信が必ず先に届く）
+    AuthServiceOptions slow_verification(std::size_t window) const
+    {
+        AuthServiceOptions options = MultiInstanceTest::options("");
+        options.stream_window = window;
+        options.batch.max_batch_size = 64;
+        options.batch.max_wait = std::chrono::milliseconds(300);
+        return options;
+    }
+
+    static StreamAuthRequest stream_request(std::uint64_t request_id, const AuthenticationChallengeRequest& challenge)
+    {
+        StreamAuthRequest request;
+        request.set_request_id(request_id);
+        *request.mutable_challenge() = challenge;
+        return request;
+    }
+
+    static StreamAuthRequest stream_request(std::uint64_t request_id, const AuthenticationAnswerRequest& answer)
+    {
+        StreamAuthRequest request;
+        request.set_request_id(request_id);
+        *request.mutable_answer() = answer;
+        return request;
+    }
+
+    static StreamAuthRequest stream_request(std::uint64_t request_id, const NonInteractiveAuthenticationRequest& proof)
+    {
+        StreamAuthRequest request;
+        request.set_request_id(request_id);
+        *request.mutable_non_interactive() = proof;
+        return request;
+    }
+
+    // n 件の返信を届いた順に読む
+    static std::vector<StreamAuthResponse> read_replies(Stream& stream, std::size_t n)
+    {
+        std::vector<StreamAuthResponse> replies;
+        StreamAuthResponse response;
+        while (replies.size() < n && stream.Read(&response))
+        {
+            replies.push_back(response);
+        }
+        EXPECT_EQ(replies.size(), n);
+        return replies;
+    }
+};
+}  // namespace
+
+TEST_F(MultiInstanceTest, AnyReplicaVerifiesChallengeTokens)
+{
+    Instance a(options(key_file_));
+    Instance b(options(key_file_));
+    // ユーザーは各インスタンスに登録しておく（ユーザーストアは共有しない）
+    ASSERT_TRUE(register_user(a).ok());
+    ASSERT_TRUE(register_user(b).ok());
+
+    // a が発行したチャレンジに b で回答する
+    const AuthenticationAnswerRequest answer = challenge(a);
+    EXPECT_TRUE(verify(b, answer).ok());
+    // 同じトークンは同じインスタンスで二度受け付けない
+    EXPECT_EQ(verify(b, answer).error_code(), grpc::NOT_FOUND);
+    // 逆向きと、発行したインスタンス自身でも検証できる
+    EXPECT_TRUE(verify(a, challenge(b)).ok());
+    EXPECT_TRUE(verify(a, challenge(a)).ok());
+
+    // 誤った回答は失敗し、同じトークンでやり直すことはできない
+    AuthenticationAnswerRequest wrong = challenge(a);
+    const std::string s = wrong.s();
+    wrong.set_s(encode_fixed((*decode_fixed(s, s.size()) + 1) % cp_.order(), s.size()));
+    EXPECT_EQ(verify(b, wrong).error_code(), grpc::PERMISSION_DENIED);
+    wrong.set_s(s);
+    EXPECT_EQ(verify(b, wrong).error_code(), grpc::NOT_FOUND);
+
+    // 改ざんしたトークン
+    AuthenticationAnswerRequest tampered = challenge(a);
+    std::string auth_id = tampered.auth_id();
+    auth_id[auth_id.size() / 2] = auth_id[auth_id.size() / 2] == 'A' ? 'B' : 'A';
+    tampered.set_auth_id(auth_id);
+    EXPECT_EQ(verify(b, tampered).error_code(), grpc::NOT_FOUND);
+}
+
+TEST_F(MultiInstanceTest, RejectsForeignKeysAndExpiredTokens)
+{
+    const std::string other_key_file = testing::TempDir() + "multi_instance_test.other.key";
+    std::ofstream(other_key_file) << std::string(64, 'b');
+    AuthServiceOptions short_ttl = options(key_file_);
+    short_ttl.sessions.ttl = std::chrono::milliseconds(50);
+    Instance a(short_ttl);
+    Instance other(options(other_key_file));
+    Instance stateful(options(""));
+    std::remove(other_key_file.c_str());
+    for (Instance* instance : {&a, &other, &stateful})
+    {
+        ASSERT_TRUE(register_user(*instance).ok());
+    }
+
+    // 別の鍵のインスタンスや、セッションをメモリに持つインスタンスはトークンを開けない
+    EXPECT_EQ(verify(other, challenge(a)).error_code(), grpc::NOT_FOUND);
+    EXPECT_EQ(verify(stateful, challenge(a)).error_code(), grpc::NOT_FOUND);
+    EXPECT_EQ(verify(a, challenge(stateful)).error_code(), grpc::NOT_FOUND);
+
+    const AuthenticationAnswerRequest answer = challenge(a);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const grpc::Status expired = verify(a, answer);
+    EXPECT_EQ(expired.error_code(), grpc::NOT_FOUND);
+    EXPECT_EQ(expired.error_message(), "Authentication session expired.");
+}
+
+TEST_F(MultiInstanceTest, ShardsForwardAnswersToTheIssuingShard)
+{
+    // 同じプロセスのシャード（セッションはシャードごと、ユーザーは共有）
+    auto users = std::make_shared<UserStore>();
+    Instance shard0(options(""), users);
+    Instance shard1(options(""), users);
+    const std::vector<AuthServiceImpl*> shards = {&shard0.service(), &shard1.service()};
+    shard0.service().set_shards(0, shards);
+    shard1.service().set_shards(1, shards);
+    ASSERT_TRUE(register_user(shard0).ok());
+    EXPECT_EQ(register_user(shard1).error_code(), grpc::ALREADY_EXISTS);
+
+    // 接続が別のシャードに振り分けられても、回答は発行したシャードのセッションで検証される
+    const AuthenticationAnswerRequest answer = challenge(shard0);
+    EXPECT_EQ(answer.auth_id().substr(0, 2), "0:");
+    EXPECT_TRUE(verify(shard1, answer).ok());
+    EXPECT_EQ(verify(shard0, answer).error_code(), grpc::NOT_FOUND);
+    EXPECT_TRUE(verify(shard1, challenge(shard1)).ok());
+
+    // メトリクスはどのシャードに問い合わせても全シャードの合計
+    EXPECT_EQ(shard0.service().metrics_snapshot().verify_success, 2u);
+    EXPECT_EQ(shard1.service().metrics_snapshot().verify_success, 2u);
+    EXPECT_EQ(shard1.service().metrics_snapshot().users, 1u);
+}
+
+TEST_F(MultiInstanceTest, ShardsShareReplayProtection)
+{
+    // トークンを使うシャード。回答と証明の記録は全シャードで共有する
+    auto users = std::make_shared<UserStore>();
+    Instance shard0(options(key_file_), users);
+    Instance shard1(options(key_file_), users);
+    const std::vector<AuthServiceImpl*> shards = {&shard0.service(), &shard1.service()};
+    shard0.service().set_shards(0, shards);
+    shard1.service().set_shards(1, shards);
+    ASSERT_TRUE(register_user(shard0).ok());
+
+    // 回答済みのトークンのシャード番号を付け替えたり外したりして、別のシャードに再送しても受け付けない
+    const AuthenticationAnswerRequest answer = challenge(shard0);
+    ASSERT_EQ(answer.auth_id().substr(0, 2), "0:");
+    EXPECT_TRUE(verify(shard1, answer).ok());
+    AuthenticationAnswerRequest replayed = answer;
+    replayed.set_auth_id("1:" + answer.auth_id().substr(2));
+    EXPECT_EQ(verify(shard1, replayed).error_code(), grpc::NOT_FOUND);
+    replayed.set_auth_id(answer.auth_id().substr(2));
+    EXPECT_EQ(verify(shard1, replayed).error_code(), grpc::NOT_FOUND);
+
+    // 回答前のトークンでも、封じた番号と異なる番号では開けない
+    AuthenticationAnswerRequest relabeled = challenge(shard1);
+    const std::string auth_id = relabeled.auth_id();
+    relabeled.set_auth_id("0:" + auth_id.substr(2));
+    EXPECT_EQ(verify(shard0, relabeled).error_code(), grpc::NOT_FOUND);
+    relabeled.set_auth_id(auth_id);
+    EXPECT_TRUE(verify(shard0, relabeled).ok());
+
+    // 非対話の証明も、別のシャードへの接続で再送すると拒む
+    const NonInteractiveAuthenticationRequest request = proof();
+    const auto log_in = [&request](Instance& instance)
+    {
+        AuthenticationAnswerResponse response;
+        grpc::ClientContext context;
+        return instance.stub().NonInteractiveAuthentication(&context, request, &response);
+    };
+    EXPECT_TRUE(log_in(shard0).ok());
+    const grpc::Status replayed_proof = log_in(shard1);
+    EXPECT_EQ(replayed_proof.error_code(), grpc::PERMISSION_DENIED);
+    EXPECT_EQ(replayed_proof.error_message(), "Proof has already been used.");
+}
+
+TEST_F(MultiInstanceTest, RejectsOutOfRangeValuesAndExcessLoginsBeforeVerifying)
+{
+    AuthServiceOptions limited = options("");
+    limited.user_rate_limit = {.rate_per_second = 0.001, .burst = 2};
+    Instance instance(limited);
+    ASSERT_TRUE(register_user(instance).ok());
+
+    // 範囲外のコミットメント（単位元と p）はセッションを作らずに断り、受け付け制限のトークンも使わない
+    const std::size_t bytes = cp_.group().encoded_bytes();
+    for (const cpp_int& r : {cpp_int(1), cp_.group().modulus()})
+    {
+        AuthenticationChallengeRequest request;
+        request.set_user("alice");
+        request.set_encoding(BINARY);
+        request.set_r1(encode_fixed(r, bytes));
+        request.set_r2(encode_fixed(cp_.group().encode(cp_.create_commitment(generate_random(cp_.order())).r2), bytes));
+        AuthenticationChallengeResponse response;
+        grpc::ClientContext context;
+        EXPECT_EQ(instance.stub().CreateAuthenticationChallenge(&context, request, &response).error_code(),
+                  grpc::INVALID_ARGUMENT);
+    }
+
+    // q 以上の s は検証しない
+    AuthenticationAnswerRequest out_of_range = challenge(instance);
+    out_of_range.set_s(encode_fixed(cp_.order(), out_of_range.s().size()));
+    EXPECT_EQ(verify(instance, out_of_range).error_code(), grpc::INVALID_ARGUMENT);
+    EXPECT_TRUE(verify(instance, challenge(instance)).ok());
+
+    // ユーザーごとの上限（2 回）を超えたチャレンジは RESOURCE_EXHAUSTED
+    AuthenticationChallengeRequest request;
+    request.set_user("alice");
+    request.set_encoding(BINARY);
+    const auto r = cp_.create_commitment(generate_random(cp_.order()));
+    request.set_r1(encode_fixed(cp_.group().encode(r.r1), bytes));
+    request.set_r2(encode_fixed(cp_.group().encode(r.r2), bytes));
+    AuthenticationChallengeResponse response;
+    grpc::ClientContext context;
+    const grpc::Status limited_status = instance.stub().CreateAuthenticationChallenge(&context, request, &response);
+    EXPECT_EQ(limited_status.error_code(), grpc::RESOURCE_EXHAUSTED);
+    EXPECT_EQ(limited_status.error_message(), "Too many login attempts for this user.");
+
+    const MetricsSnapshot metrics = instance.service().metrics_snapshot();
+    EXPECT_EQ(metrics.rejected[static_cast<std::size_t>(RejectReason::kMalformed)], 3u);
+    EXPECT_EQ(metrics.rejected[static_cast<std::size_t>(RejectReason::kUserRateLimit)], 1u);
+    EXPECT_EQ(metrics.verify_success, 1u);
+    EXPECT_EQ(metrics.verify_failure, 0u);
+
+    // 接続元アドレスごとの上限
+    AuthServiceOptions per_peer = options("");
+    per_peer.peer_rate_limit = {.rate_per_second = 0.001, .burst = 1};
+    Instance peer_limited(per_peer);
+    ASSERT_TRUE(register_user(peer_limited).ok());
+    challenge(peer_limited);
+    grpc::ClientContext peer_context;
+    const grpc::Status peer_status =
+        peer_limited.stub().CreateAuthenticationChallenge(&peer_context, request, &response);
+    EXPECT_EQ(peer_status.error_code(), grpc::RESOURCE_EXHAUSTED);
+    EXPECT_EQ(peer_status.error_message(), "Too many login attempts from this address.");
+}
+
+TEST_F(MultiInstanceTest, RegisterBatchReportsEachEntryAndContinuesPastFailures)
+{
+    Instance instance(options(""));
+    const cpp_int taken_x = generate_random(cp_.order());
+    ASSERT_TRUE(register_user(instance.stub(), "taken", taken_x).ok());
+
+    const std::vector<cpp_int> xs = {generate_random(cp_.order()), generate_random(cp_.order()),
+                                     generate_random(cp_.order())};
+    RegisterBatchRequest request;
+    *request.add_users() = registration("user0", xs[0]);
+    // p - 1 は Z_p^* の要素だが、位数 2 のため位数 q の部分群には属さない
+    RegisterRequest outside = registration("outside", xs[1]);
+    outside.set_y2(encode_fixed(cp_.group().modulus() - 1, cp_.group().encoded_bytes()));
+    *request.add_users() = outside;
+    *request.add_users() = registration("user1", xs[1]);
+    RegisterRequest wrong_group = registration("wrong_group", xs[1]);
+    wrong_group.set_group(P256);
+    *request.add_users() = wrong_group;
+    // バッチ内で重なる名前は先のエントリを登録する
+    *request.add_users() = registration("user1", xs[2]);
+    *request.add_users() = registration("taken", xs[2]);
+    *request.add_users() = registration("user2", xs[2]);
+
+    RegisterBatchResponse response;
+    grpc::ClientContext context;
+    ASSERT_TRUE(instance.stub().RegisterBatch(&context, request, &response).ok());
+    const std::vector<std::pair<grpc::StatusCode, std::string>> expected = {
+        {grpc::OK, ""},
+        {grpc::INVALID_ARGUMENT, "Public keys are not elements of the prime-order subgroup."},
+        {grpc::OK, ""},
+        {grpc::INVALID_ARGUMENT, "Server accepts registrations for group modp1024 only."},
+        {grpc::ALREADY_EXISTS, "User already registered."},
+        {grpc::ALREADY_EXISTS, "User already registered."},
+        {grpc::OK, ""},
+    };
+    ASSERT_EQ(response.results_size(), static_cast<int>(expected.size()));
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_EQ(response.results(static_cast<int>(i)).code(), expected[i].first) << i;
+        EXPECT_EQ(response.results(static_cast<int>(i)).message(), expected[i].second) << i;
+    }
+    EXPECT_EQ(response.registered(), 3u);
+    EXPECT_EQ(instance.service().metrics_snapshot().users, 4u);
+
+    // 登録したユーザーはバッチ内の先のエントリの鍵でログインでき、登録済みのユーザーの鍵は変わらない
+    const std::vector<grpc::Status> statuses = log_in(
+        instance, {{"user0", xs[0]}, {"user1", xs[1]}, {"user2", xs[2]}, {"taken", taken_x}, {"outside", xs[1]}});
+    ASSERT_EQ(statuses.size(), 5u);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(statuses[i].ok()) << i << ": " << statuses[i].error_message();
+    }
+    EXPECT_EQ(statuses[4].error_code(), grpc::NOT_FOUND);
+}
+
+TEST_F(MultiInstanceTest, ImportUsersCountsEachLine)
+{
+    Instance instance(options(""));
+    const std::string path = testing::TempDir() + "multi_instance_test.import";
+    const auto line = [this](const std::string& user, const std::string& group, const cpp_int& x)
+    {
+        const auto y = cp_.calculate_public_keys(x);
+        return user + " " + group + " " + encode_hex(cp_.group().encode(y.y1)) + " " +
+               encode_hex(cp_.group().encode(y.y2)) + "\n";
+    };
+    const cpp_int alice_x = generate_random(cp_.order());
+    const cpp_int bob_x = generate_random(cp_.order());
+    {
+        std::ofstream file(path);
+        file << line("alice", "modp1024", alice_x)  // 1: 登録する
+             << "\n"                                // 2: 空行
+             << "   \t\n"                           // 3: 空白だけの行
+             << "carol modp1024 0a\n"               // 4: y2 がない
+             << line("dave", "modp2048", bob_x)     // 5: 知らない群
+             << "erin modp1024 xyz 0a\n"            // 6: 16 進数でない y1
+             << line("frank", "p256", bob_x)        // 7: サーバの群と異なる
+             << line("bob", "modp1024", bob_x)      // 8: 登録する
+             << line("alice", "modp1024", bob_x);   // 9: 登録済み
+    }
+
+    // 2 行ずつのバッチに分け、前のバッチの登録中に次の行を読む
+    const std::optional<ImportSummary> summary = import_users(instance.service(), path, 2);
+    std::remove(path.c_str());
+    ASSERT_TRUE(summary);
+    EXPECT_EQ(summary->records, 7u);
+    EXPECT_EQ(summary->registered, 2u);
+    EXPECT_EQ(summary->failed, 5u);
+    EXPECT_EQ(instance.service().metrics_snapshot().users, 2u);
+
+    const std::vector<grpc::Status> statuses = log_in(instance, {{"alice", alice_x}, {"bob", bob_x}});
+    ASSERT_EQ(statuses.size(), 2u);
+    EXPECT_TRUE(statuses[0].ok()) << statuses[0].error_message();
+    EXPECT_TRUE(statuses[1].ok()) << statuses[1].error_message();
+
+    EXPECT_FALSE(import_users(instance.service(), testing::TempDir() + "multi_instance_test.missing"));
+}
+
+TEST_P(StreamTest, RepliesCarryTheRequestIdInCompletionOrder)
+{
+    start(slow_verification(16));
+    grpc::ClientContext context;
+    const std::unique_ptr<Stream> stream = stub().AuthenticateStream(&context);
+
+    // request_id はクライアントが選ぶ（連番でなくてよい）。チャレンジは証明の検証より先に返る
+    const cpp_int k3 = generate_random(cp_.order());
+    const cpp_int k5 = generate_random(cp_.order());
+    ASSERT_TRUE(stream->Write(stream_request(7, proof())));
+    ASSERT_TRUE(stream->Write(stream_request(3, challenge_request("alice", k3))));
+    ASSERT_TRUE(stream->Write(stream_request(42, proof())));
+    ASSERT_TRUE(stream->Write(stream_request(5, challenge_request("alice", k5))));
+    std::map<std::uint64_t, AuthenticationChallengeResponse> challenges;
+    for (const StreamAuthResponse& reply : read_replies(*stream, 2))
+    {
+        EXPECT_EQ(reply.code(), grpc::OK);
+        ASSERT_TRUE(reply.has_challenge());
+        challenges[reply.request_id()] = reply.challenge();
+    }
+    ASSERT_EQ(challenges.size(), 2u);
+    ASSERT_EQ(challenges.count(3), 1u);
+    ASSERT_EQ(challenges.count(5), 1u);
+
+    // 回答は同じ request_id で同じストリームに送る
+    ASSERT_TRUE(stream->Write(stream_request(5, answer_request(challenges[5], k5))));
+    ASSERT_TRUE(stream->Write(stream_request(3, answer_request(challenges[3], k3))));
+    std::map<std::uint64_t, StreamAuthResponse> answers;
+    for (const StreamAuthResponse& reply : read_replies(*stream, 4))
+    {
+        answers[reply.request_id()] = reply;
+    }
+    for (const std::uint64_t request_id : {3, 5, 7, 42})
+    {
+        ASSERT_EQ(answers.count(request_id), 1u) << request_id;
+        EXPECT_EQ(answers[request_id].code(), grpc::OK) << answers[request_id].message();
+        EXPECT_FALSE(answers[request_id].answer().session_id().empty());
+    }
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_P(StreamTest, FailedExchangesDoNotEndTheStream)
+{
+    start(options(""));
+    grpc::ClientContext context;
+    const std::unique_ptr<Stream> stream = stub().AuthenticateStream(&context);
+
+    NonInteractiveAuthenticationRequest wrong = proof();
+    wrong.set_s(encode_fixed((*decode_fixed(wrong.s(), wrong.s().size()) + 1) % cp_.order(), wrong.s().size()));
+    StreamAuthRequest empty;
+    empty.set_request_id(2);
+    ASSERT_TRUE(stream->Write(stream_request(1, challenge_request("bob", generate_random(cp_.order())))));
+    ASSERT_TRUE(stream->Write(empty));
+    ASSERT_TRUE(stream->Write(stream_request(3, wrong)));
+    ASSERT_TRUE(stream->Write(stream_request(4, proof())));
+
+    std::map<std::uint64_t, StreamAuthResponse> replies;
+    for (const StreamAuthResponse& reply : read_replies(*stream, 4))
+    {
+        replies[reply.request_id()] = reply;
+    }
+    EXPECT_EQ(replies[1].code(), grpc::NOT_FOUND);
+    EXPECT_EQ(replies[1].message(), "User not found.");
+    EXPECT_EQ(replies[2].code(), grpc::INVALID_ARGUMENT);
+    EXPECT_EQ(replies[3].code(), grpc::PERMISSION_DENIED);
+    EXPECT_EQ(replies[4].code(), grpc::OK);
+    EXPECT_FALSE(replies[4].answer().session_id().empty());
+
+    // 失敗した後もストリームは使える
+    ASSERT_TRUE(stream->Write(stream_request(5, proof())));
+    EXPECT_EQ(read_replies(*stream, 1).front().code(), grpc::OK);
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_P(StreamTest, StopsReadingAtTheWindowUntilRepliesAreWritten)
+{
+    // 証明 2 件とチャレンジ 1 件を続けて送る。window が 2 の場合、チャレンジは証明の返信を書き出すまで読まれず、
+    // 検証を待たずに返るはずのチャレンジの返信が証明の返信より後になる
+    for (const std::size_t window : {2, 3})
+    {
+        start(slow_verification(window));
+        grpc::ClientContext context;
+        const std::unique_ptr<Stream> stream = stub().AuthenticateStream(&context);
+        ASSERT_TRUE(stream->Write(stream_request(0, proof())));
+        ASSERT_TRUE(stream->Write(stream_request(1, proof())));
+        ASSERT_TRUE(stream->Write(stream_request(2, challenge_request("alice", generate_random(cp_.order())))));
+
+        const std::vector<StreamAuthResponse> replies = read_replies(*stream, 3);
+        ASSERT_EQ(replies.size(), 3u);
+        for (const StreamAuthResponse& reply : replies)
+        {
+            EXPECT_EQ(reply.code(), grpc::OK) << reply.message();
+        }
+        EXPECT_EQ(replies.front().request_id() == 2, window == 3) << "window " << window;
+        stream->WritesDone();
+        EXPECT_TRUE(stream->Finish().ok());
+    }
+}
+
+TEST_P(StreamTest, ClientCancellationEndsTheStream)
+{
+    start(slow_verification(2));
+    {
+        // 返信を読まずに取り消す（サーバには検証中の証明と読まれていない証明が残っている）
+        grpc::ClientContext context;
+        const std::unique_ptr<Stream> stream = stub().AuthenticateStream(&context);
+        for (std::uint64_t i = 0; i < 4; ++i)
+        {
+            stream->Write(stream_request(i, proof()));
+        }
+        context.TryCancel();
+        EXPECT_EQ(stream->Finish().error_code(), grpc::CANCELLED);
+    }
+
+    // 取り消されたストリームの後始末の後も、新しいストリームを処理できる
+    grpc::ClientContext context;
+    const std::unique_ptr<Stream> stream = stub().AuthenticateStream(&context);
+    ASSERT_TRUE(stream->Write(stream_request(0, proof())));
+    EXPECT_EQ(read_replies(*stream, 1).front().code(), grpc::OK);
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_P(StreamTest, BulkLoginReportsEachLogin)
+{
+    // クライアントの window はサーバより大きく、サーバは読み取りを止めながら進める
+    AuthServiceOptions options = MultiInstanceTest::options("");
+    options.stream_window = 2;
+    start(options);
+    std::vector<BulkLogin> logins;
+    for (int i = 0; i < 6; ++i)
+    {
+        logins.push_back({"user" + std::to_string(i), generate_random(cp_.order())});
+        ASSERT_TRUE(register_user(stub(), logins.back().user, logins.back().x).ok());
+    }
+    logins.insert(logins.begin() + 3, {"nobody", 1});
+
+    for (const bool non_interactive : {true, false})
+    {
+        AuthClient client(channel(), {.non_interactive = non_interactive, .stream_window = 4});
+        std::vector<BulkLoginResult> results;
+        EXPECT_TRUE(client.bulk_login(logins, GroupId::kModp1024, results).ok());
+        ASSERT_EQ(results.size(), logins.size());
+        for (std::size_t i = 0; i < logins.size(); ++i)
+        {
+            if (logins[i].user == "nobody")
+            {
+                EXPECT_EQ(results[i].status.error_code(), grpc::NOT_FOUND);
+                continue;
+            }
+            EXPECT_TRUE(results[i].status.ok()) << logins[i].user << ": " << results[i].status.error_message();
+            EXPECT_FALSE(results[i].session_id.empty());
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(SyncAndAsync, StreamTest, testing::Bool(),
+                         [](const testing::TestParamInfo<bool>& info) { return info.param ? "Async" : "Sync"; });
+
+TEST(MultiInstanceStartupTest, MissingKeyFileFailsConstruction)
+{
+    AuthServiceOptions options;
+    options.challenge_key_file = testing::TempDir() + "multi_instance_test.missing.key";
+    EXPECT_THROW(AuthServiceImpl service(options), std::runtime_error);
+}
@@ -0,0 +1,73 @@
+#ifndef PARALLEL_FOR_HPP
+#define PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @fn
+ * @brief f(i) を i = 0 .. count - 1 について並列に呼ぶ。全て終わるまで戻らない。
+ * @note  添字は chunk 件ずつ取り出して処理する。呼び出し元のスレッドも処理に加わり、
+ *        count が chunk 以下の場合はスレッドを作らない。f は異なる i について同時に呼ばれる。
+ *        f が例外を投げた場合は残りの添字を取り出さず、全てのスレッドの終了を待ってから最初の例外を投げ直す。
+ * @param threads 使うスレッド数（呼び出し元を含む。0 の場合はハードウェアスレッド数）
+ */
+template <typename Func>
+void parallel_for(std::size_t count, std::size_t threads, std::size_t chunk, Func&& f)
+{
+    chunk = std::max<std::size_t>(1, chunk);
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, (count + chunk - 1) / chunk);
+
+    std::atomic<std::size_t> next{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto work = [&]
+    {
+        try
+        {
+            for (std::size_t begin = next.fetch_add(chunk); begin < count; begin = next.fetch_add(chunk))
+            {
+                const std::size_t end = std::min(count, begin + chunk);
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    f(i);
+                }
+            }
+        }
+        catch (...)
+        {
+            // 他のスレッドは処理中の chunk を終えたところで止まる
+            next.store(count);
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < threads; ++t)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif  // PARALLEL_FOR_HPP
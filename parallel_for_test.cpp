@@ -0,0 +1,76 @@
+#include "parallel_for.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ParallelForTest, EmptyRangeCallsNothing)
+{
+    std::atomic<int> calls{0};
+    parallel_for(0, 4, 8, [&](std::size_t) { ++calls; });
+    EXPECT_EQ(calls.load(), 0);
+}
+
+TEST(ParallelForTest, CallsEachIndexOnceWithFewerItemsThanThreads)
+{
+    std::vector<std::atomic<int>> calls(3);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    parallel_for(calls.size(), 16, 1,
+                 [&](std::size_t i)
+                 {
+                     ++calls[i];
+                     std::lock_guard<std::mutex> lock(mutex);
+                     threads.insert(std::this_thread::get_id());
+                 });
+    for (const std::atomic<int>& count : calls)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+    // 添字の数より多いスレッドは作らない
+    EXPECT_LE(threads.size(), calls.size());
+
+    // chunk 以下の件数は呼び出し元のスレッドだけで処理する
+    threads.clear();
+    parallel_for(calls.size(), 16, 64,
+                 [&](std::size_t)
+                 {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     threads.insert(std::this_thread::get_id());
+                 });
+    EXPECT_EQ(threads, std::set<std::thread::id>{std::this_thread::get_id()});
+}
+
+TEST(ParallelForTest, RethrowsWorkerExceptionAfterJoining)
+{
+    constexpr std::size_t kCount = 1000;
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> worker_ran{false};
+    std::atomic<std::size_t> calls{0};
+    const auto run = [&]
+    {
+        parallel_for(kCount, 4, 1,
+                     [&](std::size_t)
+                     {
+                         ++calls;
+                         if (std::this_thread::get_id() != caller)
+                         {
+                             worker_ran = true;
+                             throw std::runtime_error("worker failed");
+                         }
+                         // 作ったスレッドが添字を取り出すまで、呼び出し元は最初の添字で待つ
+                         while (!worker_ran)
+                         {
+                             std::this_thread::yield();
+                         }
+                     });
+    };
+    EXPECT_THROW(run(), std::runtime_error);
+    // 例外の後は残りの添字を取り出さない
+    EXPECT_LT(calls.load(), kCount);
+}
@@ -0,0 +1,228 @@
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+// キーごとのトークンバケットの設定
+struct RateLimitOptions
+{
+    // 1 秒あたりに補充するトークン数（0 の場合は制限しない）
+    double rate_per_second = 0;
+    // バケットの容量（連続して受け付けられる数。0 の場合は rate_per_second。最低 1）
+    double burst = 0;
+    // 記録するキーの上限。超える場合は長く使われていない満杯のバケット（制限していないキー）から捨てる
+    std::size_t max_keys = 100000;
+};
+
+/**
+ * @brief キー（ユーザー名・接続元アドレス）ごとのトークンバケットで、超過したリクエストを受け付けない
+ * @note  キーのハッシュで Shards 個のシャードに分け、シャードごとに mutex とバケットの表を持つ。
+ *        バケットは取り出しの際に経過時間分を補充する（補充スレッドは持たない）。
+ *        満杯に戻ったバケットは新しいキーと区別がつかないため、表が上限に達したときに捨ててよい。
+ *        シャードのバケットは最後に使った順のリストに並べ、表が上限に達したら最も古いものから kSweep 個までを見て、
+ *        最初に見つかった満杯のものを捨てる（クロック方式）。満杯でないもの（制限中のキー）はリストの先頭に戻して
+ *        次の掃引まで残し、kSweep 個の中に満杯のものがなければ残りトークンが最も多いものを捨てる。
+ *        新しいキー 1 つあたりの処理は表の大きさによらず一定。
+ * @tparam Shards シャード数（2 のべき乗）
+ */
+template <std::size_t Shards = 64>
+class BasicRateLimiter
+{
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // 表が上限に達したときに、捨てるバケットを探すために 1 回で見る数
+    static constexpr std::size_t kSweep = 8;
+
+    explicit BasicRateLimiter(const RateLimitOptions& options = {})
+        : rate_per_ns_(std::max(options.rate_per_second, 0.0) * 1e-9),
+          burst_(std::max(options.burst > 0 ? options.burst : options.rate_per_second, 1.0)),
+          max_keys_per_shard_(std::max<std::size_t>(1, options.max_keys / Shards))
+    {
+    }
+
+    BasicRateLimiter(const BasicRateLimiter&) = delete;
+    BasicRateLimiter& operator=(const BasicRateLimiter&) = delete;
+
+    // 制限するか（rate_per_second が 0 の場合は常に受け付ける）
+    bool enabled() const { return rate_per_ns_ > 0; }
+
+    /**
+     * @fn
+     * @brief key のバケットからトークンを 1 つ取り出す
+     * @param key ユーザー名・接続元アドレスなど
+     * @param now 現在時刻（テスト用）
+     * @return 取り出せた（受け付ける）場合は true
+     */
+    bool try_acquire(std::string_view key, Clock::time_point now = Clock::now())
+    {
+        if (!enabled())
+        {
+            return true;
+        }
+        const std::int64_t now_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        const std::string name(key);
+        Shard& shard = shards_[(std::hash<std::string>{}(name) * 0x9E3779B97F4A7C15ull >> 32) & (Shards - 1)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(name);
+        if (it == shard.index.end())
+        {
+            if (shard.index.size() >= max_keys_per_shard_)
+            {
+                make_room(shard, now_ns);
+            }
+            shard.lru.push_front({name, Bucket{burst_ - 1, now_ns}});
+            shard.index.emplace(name, shard.lru.begin());
+            return true;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        Bucket& bucket = it->second->bucket;
+        bucket.tokens = refilled(bucket, now_ns);
+        bucket.updated_ns = std::max(bucket.updated_ns, now_ns);
+        if (bucket.tokens < 1)
+        {
+            return false;
+        }
+        bucket.tokens -= 1;
+        return true;
+    }
+
+   private:
+    struct Bucket
+    {
+        double tokens = 0;
+        std::int64_t updated_ns = 0;
+    };
+
+    struct Entry
+    {
+        std::string key;
+        Bucket bucket;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        // 先頭が最も最近使ったバケット
+        std::list<Entry> lru;
+        std::unordered_map<std::string, typename std::list<Entry>::iterator> index;
+    };
+
+    const double rate_per_ns_;
+    const double burst_;
+    const std::size_t max_keys_per_shard_;
+    std::array<Shard, Shards> shards_;
+
+    double refilled(const Bucket& bucket, std::int64_t now_ns) const
+    {
+        const auto elapsed = static_cast<double>(std::max<std::int64_t>(0, now_ns - bucket.updated_ns));
+        return std::min(burst_, bucket.tokens + elapsed * rate_per_ns_);
+    }
+
+    // 古い方から kSweep 個までを見て、満杯に戻ったバケットを 1 つ捨てる。1 つもない場合は残りトークンが最も多いものを捨てる
+    void make_room(Shard& shard, std::int64_t now_ns)
+    {
+        auto fullest = shard.lru.end();
+        double fullest_tokens = -1;
+        for (std::size_t i = 0; i < kSweep && i < shard.lru.size(); ++i)
+        {
+            const auto it = std::prev(shard.lru.end());
+            const double tokens = refilled(it->bucket, now_ns);
+            if (tokens >= burst_)
+            {
+                erase(shard, it);
+                return;
+            }
+            if (tokens > fullest_tokens)
+            {
+                fullest = it;
+                fullest_tokens = tokens;
+            }
+            // 制限中のキーは先頭に戻し、次の掃引では別のバケットを見る
+            shard.lru.splice(shard.lru.begin(), shard.lru, it);
+        }
+        if (fullest != shard.lru.end())
+        {
+            erase(shard, fullest);
+        }
+    }
+
+    static void erase(Shard& shard, typename std::list<Entry>::iterator it)
+    {
+        shard.index.erase(it->key);
+        shard.lru.erase(it);
+    }
+};
+
+using RateLimiter = BasicRateLimiter<>;
+
+// IPv6 の接続元は上位 64 ビット（/64、通常 1 つのサイトに割り当てられる単位）でまとめる
+constexpr std::size_t kIpv6PrefixBytes = 8;
+
+/**
+ * @fn
+ * @brief gRPC の peer 文字列（"ipv4:10.0.0.1:53211" など）からポートを除いた接続元アドレスを返す
+ * @note  同じホストからの接続はポートが変わっても同じキーにする。IPv6 は /64 のプレフィックス
+ *        （"ipv6:[2001:db8:1:2::]/64"）にし、1 つのホストが持つ多数のアドレスを使い分けても同じキーにする
+ *        （IPv4 射影アドレスは IPv4 として扱う）。ipv4 / ipv6 以外（unix ソケットなど）はそのまま返す。
+ */
+inline std::string peer_address(std::string_view peer)
+{
+    if (peer.substr(0, 5) != "ipv4:" && peer.substr(0, 5) != "ipv6:")
+    {
+        return std::string(peer);
+    }
+    const std::size_t colon = peer.rfind(':');
+    const std::string_view address = colon > 4 ? peer.substr(0, colon) : peer;
+    if (peer.substr(0, 5) == "ipv4:")
+    {
+        return std::string(address);
+    }
+
+    // "[2001:db8::1]"（gRPC の版によっては "%5B2001:db8::1%5D"）の括弧とゾーン ID を外す
+    std::string_view host = address.substr(5);
+    for (const auto& [open, close] : {std::pair<std::string_view, std::string_view>{"[", "]"}, {"%5B", "%5D"}})
+    {
+        if (host.size() >= open.size() + close.size() && host.substr(0, open.size()) == open &&
+            host.substr(host.size() - close.size()) == close)
+        {
+            host = host.substr(open.size(), host.size() - open.size() - close.size());
+            break;
+        }
+    }
+    host = host.substr(0, host.find('%'));
+    in6_addr parsed{};
+    if (inet_pton(AF_INET6, std::string(host).c_str(), &parsed) != 1)
+    {
+        return std::string(address);
+    }
+    char text[INET6_ADDRSTRLEN];
+    if (IN6_IS_ADDR_V4MAPPED(&parsed))
+    {
+        inet_ntop(AF_INET, parsed.s6_addr + 12, text, sizeof(text));
+        return std::string("ipv4:") + text;
+    }
+    std::fill(parsed.s6_addr + kIpv6PrefixBytes, parsed.s6_addr + sizeof(parsed.s6_addr), 0);
+    inet_ntop(AF_INET6, &parsed, text, sizeof(text));
+    return std::string("ipv6:[") + text + "]/64";
+}
+
+#endif  // RATE_LIMITER_HPP
@@ -0,0 +1,121 @@
+#include "rate_limiter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+TEST(RateLimiterTest, BurstThenRefillPerKey)
+{
+    RateLimiter limiter({.rate_per_second = 10, .burst = 3});
+    const auto t0 = RateLimiter::Clock::now();
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(limiter.try_acquire("alice", t0));
+    }
+    EXPECT_FALSE(limiter.try_acquire("alice", t0));
+    // キーごとに独立している
+    EXPECT_TRUE(limiter.try_acquire("bob", t0));
+
+    // 100ms で 1 つ補充される
+    EXPECT_FALSE(limiter.try_acquire("alice", t0 + 50ms));
+    EXPECT_TRUE(limiter.try_acquire("alice", t0 + 100ms));
+    EXPECT_FALSE(limiter.try_acquire("alice", t0 + 100ms));
+
+    // 補充は容量まで
+    const auto later = t0 + 10s;
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(limiter.try_acquire("alice", later));
+    }
+    EXPECT_FALSE(limiter.try_acquire("alice", later));
+}
+
+TEST(RateLimiterTest, DisabledAndDefaultBurst)
+{
+    RateLimiter unlimited;
+    EXPECT_FALSE(unlimited.enabled());
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(unlimited.try_acquire("alice"));
+    }
+
+    // burst を省略すると 1 秒分
+    RateLimiter limiter({.rate_per_second = 2});
+    const auto t0 = RateLimiter::Clock::now();
+    EXPECT_TRUE(limiter.try_acquire("alice", t0));
+    EXPECT_TRUE(limiter.try_acquire("alice", t0));
+    EXPECT_FALSE(limiter.try_acquire("alice", t0));
+}
+
+TEST(RateLimiterTest, KeepsLimitedKeysWhenFull)
+{
+    // 1 シャードに 2 キーまで
+    BasicRateLimiter<1> limiter({.rate_per_second = 1, .burst = 1, .max_keys = 2});
+    const auto t0 = BasicRateLimiter<1>::Clock::now();
+    EXPECT_TRUE(limiter.try_acquire("idle", t0));
+    EXPECT_TRUE(limiter.try_acquire("busy", t0 + 5s));
+    EXPECT_FALSE(limiter.try_acquire("busy", t0 + 5s));
+
+    // 満杯に戻った idle を捨てて new を記録し、制限中の busy は残す
+    EXPECT_TRUE(limiter.try_acquire("new", t0 + 5s));
+    EXPECT_FALSE(limiter.try_acquire("busy", t0 + 5s));
+    EXPECT_FALSE(limiter.try_acquire("new", t0 + 5s));
+
+    // 満杯のバケットがない場合は残りが最も多いものを捨てる（記録は上限を超えない）
+    EXPECT_TRUE(limiter.try_acquire("other", t0 + 5s));
+    EXPECT_FALSE(limiter.try_acquire("other", t0 + 5s));
+}
+
+TEST(RateLimiterTest, SweepsPastLimitedKeysInBoundedSteps)
+{
+    using Limiter = BasicRateLimiter<1>;
+    constexpr std::size_t kLimited = Limiter::kSweep + 4;
+    Limiter limiter({.rate_per_second = 0.001, .burst = 1, .max_keys = kLimited + 4});
+    const auto t0 = Limiter::Clock::now();
+    const auto later = t0 + 2000s;
+    // 古い方に制限中のキー（later の時点で残り 0）、新しい方に later までに満杯に戻るキーを並べる
+    for (std::size_t i = 0; i < kLimited; ++i)
+    {
+        EXPECT_TRUE(limiter.try_acquire("limited" + std::to_string(i), later));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(limiter.try_acquire("idle" + std::to_string(i), t0));
+    }
+
+    // 最初の新しいキーは古い方から kSweep 個を見て、満杯のものがないためそのうちの 1 つを捨てる。
+    // 見た制限中のキーは先頭に戻るため、続く新しいキーは満杯に戻った idle を捨てる
+    EXPECT_TRUE(limiter.try_acquire("new0", later));
+    EXPECT_TRUE(limiter.try_acquire("new1", later));
+    EXPECT_TRUE(limiter.try_acquire("new2", later));
+    for (std::size_t i = 1; i < kLimited; ++i)
+    {
+        EXPECT_FALSE(limiter.try_acquire("limited" + std::to_string(i), later)) << i;
+    }
+    EXPECT_TRUE(limiter.try_acquire("limited0", later));
+}
+
+TEST(RateLimiterTest, PeerAddressDropsThePort)
+{
+    EXPECT_EQ(peer_address("ipv4:10.0.0.1:53211"), "ipv4:10.0.0.1");
+    EXPECT_EQ(peer_address("unix:/tmp/zkp.sock"), "unix:/tmp/zkp.sock");
+    EXPECT_EQ(peer_address(""), "");
+}
+
+TEST(RateLimiterTest, PeerAddressGroupsIpv6ByPrefix)
+{
+    // 同じ /64 のアドレスは 1 つのキーにする（括弧が URL エンコードされた形式とゾーン ID も受け付ける）
+    EXPECT_EQ(peer_address("ipv6:[2001:db8:1:2:3:4:5:6]:443"), "ipv6:[2001:db8:1:2::]/64");
+    EXPECT_EQ(peer_address("ipv6:[2001:db8:1:2:ffff::1]:50051"), "ipv6:[2001:db8:1:2::]/64");
+    EXPECT_EQ(peer_address("ipv6:%5B2001:db8:1:2::7%5D:50051"), "ipv6:[2001:db8:1:2::]/64");
+    EXPECT_EQ(peer_address("ipv6:[2001:db8:1:3::1]:443"), "ipv6:[2001:db8:1:3::]/64");
+    EXPECT_EQ(peer_address("ipv6:[fe80::1%25eth0]:50051"), "ipv6:[fe80::]/64");
+    EXPECT_EQ(peer_address("ipv6:[::1]:50051"), "ipv6:[::]/64");
+    // IPv4 射影アドレスは IPv4 のアドレスごと
+    EXPECT_EQ(peer_address("ipv6:[::ffff:10.0.0.1]:50051"), "ipv4:10.0.0.1");
+    // 解釈できないものはポートを除いたまま
+    EXPECT_EQ(peer_address("ipv6:[not an address]:50051"), "ipv6:[not an address]");
+}
@@ -0,0 +1,100 @@
+#ifndef REPLAY_CACHE_HPP
+#define REPLAY_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "timer_wheel.hpp"
+
+/**
+ * @brief 一度だけ受け付ける値（非対話の証明など）を有効期限まで記録するキャッシュ
+ * @note  キーのハッシュで Shards 個のシャードに分け、シャードごとに mutex・集合・タイマーホイールを持つ。
+ *        期限切れのキーは insert の際にそのシャードのタイマーホイールを進めて取り除く（回収スレッドは持たない）。
+ *        有効期限は UNIX 時刻のミリ秒で指定する（クライアントが付けたタイムスタンプから決まるため）。
+ * @tparam Shards シャード数（2 のべき乗）
+ */
+template <std::size_t Shards = 64>
+class ReplayCache
+{
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+
+   public:
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param tick 期限切れを判定する時間の粒度（期限はこの粒度で切り上げる）
+     */
+    explicit ReplayCache(std::chrono::milliseconds tick = std::chrono::milliseconds(100))
+        : tick_ms_(std::max<std::int64_t>(1, tick.count()))
+    {
+        const TimerWheel<std::string>::Tick now = current_tick();
+        for (Shard& shard : shards_)
+        {
+            shard.timers = TimerWheel<std::string>(now);
+        }
+    }
+
+    ReplayCache(const ReplayCache&) = delete;
+    ReplayCache& operator=(const ReplayCache&) = delete;
+
+    /**
+     * @fn
+     * @brief key を期限まで記録する。同じ key を同時に insert しても true を返すのは 1 つだけ。
+     * @param key 記録する値
+     * @param expires_at_ms 期限（UNIX 時刻のミリ秒）
+     * @return 記録した場合は true。期限内の同じ key が記録済みの場合は false
+     */
+    bool insert(const std::string& key, std::int64_t expires_at_ms)
+    {
+        Shard& shard = shards_[(std::hash<std::string>{}(key) * 0x9E3779B97F4A7C15ull >> 32) & (Shards - 1)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.timers.advance(current_tick(),
+                             [&](std::string&& expired)
+                             {
+                                 shard.keys.erase(expired);
+                                 size_.fetch_sub(1, std::memory_order_relaxed);
+                             });
+        if (!shard.keys.insert(key).second)
+        {
+            return false;
+        }
+        // 期限を含む tick が過ぎてから取り除く
+        shard.timers.schedule(static_cast<TimerWheel<std::string>::Tick>((expires_at_ms + tick_ms_ - 1) / tick_ms_),
+                              key);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 記録中のキーの数（期限切れで未回収のものを含む）
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+   private:
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::unordered_set<std::string> keys;
+        TimerWheel<std::string> timers;
+    };
+
+    const std::int64_t tick_ms_;
+    std::array<Shard, Shards> shards_;
+    std::atomic<std::size_t> size_{0};
+
+    TimerWheel<std::string>::Tick current_tick() const
+    {
+        const std::int64_t now_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        return static_cast<TimerWheel<std::string>::Tick>(now_ms / tick_ms_);
+    }
+};
+
+#endif  // REPLAY_CACHE_HPP
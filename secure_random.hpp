@@ -0,0 +1,247 @@
+#ifndef SECURE_RANDOM_HPP
+#define SECURE_RANDOM_HPP
+
+#include <sys/random.h>
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @fn
+ * @brief OS のエントロピー（getrandom）で out を埋める
+ * @note  起動直後でエントロピーが不足している間は待つ。失敗した場合は std::runtime_error を投げる。
+ */
+inline void os_random_bytes(void* out, std::size_t size)
+{
+    auto* p = static_cast<unsigned char*>(out);
+    while (size > 0)
+    {
+        const ssize_t n = getrandom(p, size, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("getrandom failed");
+        }
+        p += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+/**
+ * @brief ChaCha20 による暗号論的擬似乱数生成器
+ * @note  生成時に OS のエントロピーから 256 ビットの鍵を 1 回だけ読み、以後は ChaCha20 のキーストリームを
+ *        kBlocks ブロックずつまとめて生成してバッファから返す。バッファを作り直すたびに先頭 32 バイトを次の鍵にして
+ *        使った鍵を消す（fast key erasure）ため、状態が漏れても過去の出力は復元できない。
+ *        スレッドセーフではない。local() でスレッドごとのインスタンスを使うこと。
+ */
+class SecureRandom
+{
+   public:
+    static constexpr std::size_t kBlockBytes = 64;
+    static constexpr std::size_t kBlocks = 16;
+    static constexpr std::size_t kKeyBytes = 32;
+
+    SecureRandom()
+    {
+        std::array<unsigned char, kKeyBytes> seed;
+        os_random_bytes(seed.data(), seed.size());
+        load_key(seed.data());
+        std::fill(seed.begin(), seed.end(), 0);
+    }
+
+    SecureRandom(const SecureRandom&) = delete;
+    SecureRandom& operator=(const SecureRandom&) = delete;
+
+    ~SecureRandom()
+    {
+        std::fill(key_.begin(), key_.end(), 0);
+        std::fill(buffer_.begin(), buffer_.end(), 0);
+    }
+
+    /**
+     * @fn
+     * @brief 呼び出したスレッドの生成器（初回だけ OS のエントロピーを読む）
+     */
+    static SecureRandom& local()
+    {
+        thread_local SecureRandom instance;
+        return instance;
+    }
+
+    void fill(void* out, std::size_t size)
+    {
+        auto* p = static_cast<unsigned char*>(out);
+        while (size > 0)
+        {
+            if (position_ == buffer_.size())
+            {
+                refill();
+            }
+            const std::size_t n = std::min(size, buffer_.size() - position_);
+            std::memcpy(p, buffer_.data() + position_, n);
+            // 返したバイトはバッファに残さない
+            std::memset(buffer_.data() + position_, 0, n);
+            position_ += n;
+            p += n;
+            size -= n;
+        }
+    }
+
+    std::uint64_t next_u64()
+    {
+        std::uint64_t value = 0;
+        fill(&value, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @fn
+     * @brief 0 以上 bound 未満の一様な整数を返す
+     * @note  bound のビット長の乱数を作り、bound 以上なら引き直す（1 回あたりの棄却確率は 1/2 未満）。
+     *        剰余による偏りがない。
+     */
+    boost::multiprecision::cpp_int uniform_below(const boost::multiprecision::cpp_int& bound)
+    {
+        if (bound <= 1)
+        {
+            return 0;
+        }
+        const unsigned bits = static_cast<unsigned>(boost::multiprecision::msb(bound - 1)) + 1;
+        const std::size_t bytes = (bits + 7) / 8;
+        const unsigned char top_mask = static_cast<unsigned char>(0xFF >> (bytes * 8 - bits));
+        std::array<unsigned char, 512> stack_buffer;
+        std::string heap_buffer;
+        unsigned char* buffer = stack_buffer.data();
+        if (bytes > stack_buffer.size())
+        {
+            heap_buffer.resize(bytes);
+            buffer = reinterpret_cast<unsigned char*>(heap_buffer.data());
+        }
+        boost::multiprecision::cpp_int value;
+        do
+        {
+            fill(buffer, bytes);
+            buffer[0] &= top_mask;
+            value = 0;
+            boost::multiprecision::import_bits(value, buffer, buffer + bytes, 8, true);
+        } while (value >= bound);
+        std::memset(buffer, 0, bytes);
+        return value;
+    }
+
+    /**
+     * @fn
+     * @brief ChaCha20 のブロック関数（RFC 8439 2.3）
+     * @param input 定数・鍵・カウンタ・ノンスからなる 16 ワードの状態
+     * @param out 64 バイトのキーストリーム
+     */
+    static void chacha20_block(const std::array<std::uint32_t, 16>& input, unsigned char* out)
+    {
+        std::array<std::uint32_t, 16> x = input;
+        for (int round = 0; round < 10; ++round)
+        {
+            quarter_round(x, 0, 4, 8, 12);
+            quarter_round(x, 1, 5, 9, 13);
+            quarter_round(x, 2, 6, 10, 14);
+            quarter_round(x, 3, 7, 11, 15);
+            quarter_round(x, 0, 5, 10, 15);
+            quarter_round(x, 1, 6, 11, 12);
+            quarter_round(x, 2, 7, 8, 13);
+            quarter_round(x, 3, 4, 9, 14);
+        }
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            const std::uint32_t word = x[i] + input[i];
+            out[4 * i] = static_cast<unsigned char>(word);
+            out[4 * i + 1] = static_cast<unsigned char>(word >> 8);
+            out[4 * i + 2] = static_cast<unsigned char>(word >> 16);
+            out[4 * i + 3] = static_cast<unsigned char>(word >> 24);
+        }
+    }
+
+   private:
+    // "expand 32-byte k"
+    static constexpr std::array<std::uint32_t, 4> kConstants = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+
+    std::array<std::uint32_t, 8> key_{};
+    std::array<unsigned char, kBlocks * kBlockBytes> buffer_{};
+    std::size_t position_ = kBlocks * kBlockBytes;
+
+    static std::uint32_t rotl(std::uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+    static void quarter_round(std::array<std::uint32_t, 16>& x, int a, int b, int c, int d)
+    {
+        x[a] += x[b];
+        x[d] = rotl(x[d] ^ x[a], 16);
+        x[c] += x[d];
+        x[b] = rotl(x[b] ^ x[c], 12);
+        x[a] += x[b];
+        x[d] = rotl(x[d] ^ x[a], 8);
+        x[c] += x[d];
+        x[b] = rotl(x[b] ^ x[c], 7);
+    }
+
+    void load_key(const unsigned char* bytes)
+    {
+        for (std::size_t i = 0; i < key_.size(); ++i)
+        {
+            key_[i] = static_cast<std::uint32_t>(bytes[4 * i]) | (static_cast<std::uint32_t>(bytes[4 * i + 1]) << 8) |
+                      (static_cast<std::uint32_t>(bytes[4 * i + 2]) << 16) |
+                      (static_cast<std::uint32_t>(bytes[4 * i + 3]) << 24);
+        }
+    }
+
+    // 鍵ごとにカウンタ 0 から kBlocks ブロックを生成し、先頭 32 バイトを次の鍵にする
+    void refill()
+    {
+        std::array<std::uint32_t, 16> state{};
+        std::copy(kConstants.begin(), kConstants.end(), state.begin());
+        std::copy(key_.begin(), key_.end(), state.begin() + 4);
+        for (std::size_t block = 0; block < kBlocks; ++block)
+        {
+            state[12] = static_cast<std::uint32_t>(block);
+            chacha20_block(state, buffer_.data() + block * kBlockBytes);
+        }
+        load_key(buffer_.data());
+        std::memset(buffer_.data(), 0, kKeyBytes);
+        std::fill(state.begin(), state.end(), 0);
+        position_ = kKeyBytes;
+    }
+};
+
+/**
+ * @fn
+ * @brief ランダムな UUID（バージョン 4）を "xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx" の形式で返す
+ */
+inline std::string random_uuid()
+{
+    std::array<unsigned char, 16> bytes;
+    SecureRandom::local().fill(bytes.data(), bytes.size());
+    bytes[6] = static_cast<unsigned char>((bytes[6] & 0x0F) | 0x40);  // バージョン 4
+    bytes[8] = static_cast<unsigned char>((bytes[8] & 0x3F) | 0x80);  // RFC 4122 のバリアント
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(36);
+    for (std::size_t i = 0; i < bytes.size(); ++i)
+    {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+        {
+            out += '-';
+        }
+        out += kHex[bytes[i] >> 4];
+        out += kHex[bytes[i] & 0x0F];
+    }
+    return out;
+}
+
+#endif  // SECURE_RANDOM_HPP
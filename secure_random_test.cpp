@@ -0,0 +1,95 @@
+#include "secure_random.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+
+using boost::multiprecision::cpp_int;
+
+TEST(SecureRandomTest, ChaCha20BlockMatchesRfc8439)
+{
+    // RFC 8439 2.3.2 のテストベクタ（鍵 00..1f、カウンタ 1、ノンス 000000090000004a00000000）
+    std::array<std::uint32_t, 16> state = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574, 0x03020100, 0x07060504,
+                                           0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c,
+                                           0x00000001, 0x09000000, 0x4a000000, 0x00000000};
+    std::array<unsigned char, 64> out;
+    SecureRandom::chacha20_block(state, out.data());
+    const std::array<unsigned char, 16> expected_head = {0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+                                                         0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4};
+    const std::array<unsigned char, 4> expected_tail = {0xa2, 0x50, 0x3c, 0x4e};
+    EXPECT_TRUE(std::equal(expected_head.begin(), expected_head.end(), out.begin()));
+    EXPECT_TRUE(std::equal(expected_tail.begin(), expected_tail.end(), out.end() - 4));
+}
+
+TEST(SecureRandomTest, UniformBelowStaysInRangeWithoutBias)
+{
+    SecureRandom& random = SecureRandom::local();
+    constexpr int kBound = 6;  // 2 のべき乗でない上限（剰余で選ぶと偏る）
+    constexpr int kSamples = 60000;
+    std::array<int, kBound> counts{};
+    for (int i = 0; i < kSamples; ++i)
+    {
+        const cpp_int value = random.uniform_below(kBound);
+        ASSERT_GE(value, 0);
+        ASSERT_LT(value, kBound);
+        ++counts[static_cast<int>(value)];
+    }
+    for (const int count : counts)
+    {
+        EXPECT_NEAR(count, kSamples / kBound, kSamples / kBound / 10);
+    }
+
+    // generate_random は 1 から q - 1 まで
+    const cpp_int q("0xF518AA8781A8DF278ABA4E7D64B7CB9D49462353");
+    for (int i = 0; i < 100; ++i)
+    {
+        const cpp_int value = generate_random(q);
+        EXPECT_GE(value, 1);
+        EXPECT_LT(value, q);
+    }
+    EXPECT_EQ(generate_random(2), 1);
+}
+
+TEST(SecureRandomTest, ThreadsGetIndependentStreams)
+{
+    constexpr int kThreads = 4;
+    constexpr int kIds = 500;
+    std::mutex mutex;
+    std::set<std::string> ids;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back(
+            [&]
+            {
+                std::vector<std::string> local;
+                for (int i = 0; i < kIds; ++i)
+                {
+                    local.push_back(random_uuid());
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                ids.insert(local.begin(), local.end());
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(ids.size(), std::size_t(kThreads) * kIds);
+
+    const std::string uuid = *ids.begin();
+    ASSERT_EQ(uuid.size(), 36u);
+    EXPECT_EQ(uuid[8], '-');
+    EXPECT_EQ(uuid[13], '-');
+    EXPECT_EQ(uuid[14], '4');
+    EXPECT_NE(std::string("89ab").find(uuid[19]), std::string::npos);
+}
@@ -0,0 +1,508 @@
+#ifndef SERVER_METRICS_HPP
+#define SERVER_METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "key_table_cache.hpp"
+#include "lock_stats.hpp"
+
+// 計測する RPC
+enum class RpcKind : std::size_t
+{
+    kRegister,
+    kCreateAuthenticationChallenge,
+    kVerifyAuthentication,
+    kNonInteractiveAuthentication,
+    kRegisterBatch,
+};
+inline constexpr std::size_t kRpcKindCount = 5;
+
+// RPC ハンドラの処理段階
+enum class RpcPhase : std::size_t
+{
+    kDecode,       // リクエストの検査と整数の変換
+    kStoreLookup,  // ユーザー・セッション・再利用記録の参照と更新
+    kVerify,       // チャレンジの導出と証明の検証（非同期サーバでは検証用ワーカースレッドの待ち時間を含む）
+    kEncode,       // チャレンジ・セッションIDの生成とレスポンスの組み立て
+    kTotal,        // ハンドラ全体
+};
+inline constexpr std::size_t kRpcPhaseCount = 5;
+
+// 検証（べき乗）の前にログインを断った理由
+enum class RejectReason : std::size_t
+{
+    kMalformed,      // 範囲外のコミットメント・レスポンス、長すぎる値
+    kUserRateLimit,  // ユーザーごとの受け付け制限
+    kPeerRateLimit,  // 接続元アドレスごとの受け付け制限
+};
+inline constexpr std::size_t kRejectReasonCount = 3;
+
+inline constexpr std::string_view rpc_kind_name(RpcKind kind)
+{
+    constexpr std::array<std::string_view, kRpcKindCount> kNames = {
+        "Register", "CreateAuthenticationChallenge", "VerifyAuthentication", "NonInteractiveAuthentication",
+        "RegisterBatch"};
+    return kNames[static_cast<std::size_t>(kind)];
+}
+
+inline constexpr std::string_view rpc_phase_name(RpcPhase phase)
+{
+    constexpr std::array<std::string_view, kRpcPhaseCount> kNames = {"decode", "store_lookup", "verify", "encode",
+                                                                     "total"};
+    return kNames[static_cast<std::size_t>(phase)];
+}
+
+inline constexpr std::string_view reject_reason_name(RejectReason reason)
+{
+    constexpr std::array<std::string_view, kRejectReasonCount> kNames = {"malformed", "user_rate", "peer_rate"};
+    return kNames[static_cast<std::size_t>(reason)];
+}
+
+/**
+ * @brief 処理時間（ナノ秒）のヒストグラム
+ * @note  256ns 未満を 1 つの階級にまとめ、それ以上は 2 のべき乗の区間ごとに 4 つの等幅の階級で数える
+ *        （相対誤差 25% 以下）。2^36ns（約 69 秒）以上は最後の階級に入れる。
+ *        LatencyHistogram より粗いが、スレッドごとのスロットに RPC と段階の数だけ持てる大きさに抑えている。
+ */
+struct DurationHistogram
+{
+    static constexpr unsigned kMinShift = 8;
+    static constexpr unsigned kSubBucketBits = 2;
+    static constexpr unsigned kOctaves = 28;
+    static constexpr std::size_t kBuckets = 1 + (std::size_t(kOctaves) << kSubBucketBits);
+
+    std::array<std::uint64_t, kBuckets> counts{};
+    std::uint64_t count = 0;
+    std::uint64_t sum_ns = 0;
+
+    DurationHistogram& operator+=(const DurationHistogram& other)
+    {
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+        count += other.count;
+        sum_ns += other.sum_ns;
+        return *this;
+    }
+
+    static std::size_t index_of(std::uint64_t ns)
+    {
+        if (ns < (std::uint64_t(1) << kMinShift))
+        {
+            return 0;
+        }
+        const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+        if (msb >= kMinShift + kOctaves)
+        {
+            return kBuckets - 1;
+        }
+        const std::size_t sub = static_cast<std::size_t>(ns >> (msb - kSubBucketBits)) & ((1u << kSubBucketBits) - 1);
+        return 1 + (std::size_t(msb - kMinShift) << kSubBucketBits) + sub;
+    }
+
+    // 階級 index の上端（この値未満が入る）
+    static std::uint64_t upper_bound(std::size_t index)
+    {
+        if (index == 0)
+        {
+            return std::uint64_t(1) << kMinShift;
+        }
+        const unsigned msb = static_cast<unsigned>((index - 1) >> kSubBucketBits) + kMinShift;
+        const std::uint64_t sub = (index - 1) & ((1u << kSubBucketBits) - 1);
+        return ((std::uint64_t(1) << kSubBucketBits) + sub + 1) << (msb - kSubBucketBits);
+    }
+
+    /**
+     * @fn
+     * @brief 分位点を返す
+     * @param quantile 0 以上 1 以下（0.99 は p99）
+     * @return 分位点が入る階級の上端（ナノ秒）。記録がない場合は 0
+     */
+    std::uint64_t percentile(double quantile) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        const double clamped = std::min(std::max(quantile, 0.0), 1.0);
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(clamped * count)));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                return upper_bound(i);
+            }
+        }
+        return upper_bound(kBuckets - 1);
+    }
+};
+
+// ServerMetrics::snapshot の結果に、サービスが現在値（ユーザー数など）を加えたもの
+struct MetricsSnapshot
+{
+    std::array<std::array<DurationHistogram, kRpcPhaseCount>, kRpcKindCount> latency;
+    // エラーで終わった RPC の数
+    std::array<std::uint64_t, kRpcKindCount> errors{};
+    // 証明の検証結果
+    std::uint64_t verify_success = 0;
+    std::uint64_t verify_failure = 0;
+    // 検証の前に断ったログイン（1 件あたり 1 回分の検証、べき乗 4 回を省いた）
+    std::array<std::uint64_t, kRejectReasonCount> rejected{};
+
+    // 以下はサービスが埋める
+    std::uint64_t users = 0;
+    std::uint64_t sessions = 0;
+    std::uint64_t sessions_expired = 0;
+    std::uint64_t sessions_evicted = 0;
+    std::uint64_t replay_entries = 0;
+    LockWaitCounters user_store_wait;
+    LockWaitCounters session_store_wait;
+    // 公開鍵テーブルのキャッシュ（全群の合計）
+    KeyTableCacheStats key_tables;
+
+    // 同じプロセスの別のシャードの値を足す
+    MetricsSnapshot& operator+=(const MetricsSnapshot& other)
+    {
+        for (std::size_t k = 0; k < kRpcKindCount; ++k)
+        {
+            for (std::size_t p = 0; p < kRpcPhaseCount; ++p)
+            {
+                latency[k][p] += other.latency[k][p];
+            }
+            errors[k] += other.errors[k];
+        }
+        verify_success += other.verify_success;
+        verify_failure += other.verify_failure;
+        for (std::size_t r = 0; r < kRejectReasonCount; ++r)
+        {
+            rejected[r] += other.rejected[r];
+        }
+        users += other.users;
+        sessions += other.sessions;
+        sessions_expired += other.sessions_expired;
+        sessions_evicted += other.sessions_evicted;
+        replay_entries += other.replay_entries;
+        user_store_wait += other.user_store_wait;
+        session_store_wait += other.session_store_wait;
+        key_tables += other.key_tables;
+        return *this;
+    }
+};
+
+/**
+ * @brief RPC ハンドラの段階ごとの処理時間と検証結果の集計
+ * @note  スレッドは初回の記録時に kStripes 個のスロットの 1 つを順に割り当てられ、以後はそのスロットの
+ *        カウンタだけを relaxed で加算する。スロットはキャッシュラインに揃えて配置するため、
+ *        スレッド数が kStripes 以下なら記録でキャッシュラインを奪い合わない。
+ *        snapshot は全スロットを足し合わせる（記録と並行して読むため、RPC の間で数がずれることがある）。
+ */
+class ServerMetrics
+{
+   public:
+    static constexpr std::size_t kStripes = 16;
+
+    ServerMetrics() : stripes_(std::make_unique<std::array<Stripe, kStripes>>()) {}
+    ServerMetrics(const ServerMetrics&) = delete;
+    ServerMetrics& operator=(const ServerMetrics&) = delete;
+
+    /**
+     * @fn
+     * @brief 1 回の RPC の段階ごとの処理時間を記録する
+     * @param phases 段階ごとの処理時間（kTotal は無視する）
+     * @param used_phases 記録する段階のビット集合（1 << RpcPhase）
+     * @param total ハンドラ全体の処理時間
+     * @param ok RPC が成功したか
+     */
+    void record_rpc(RpcKind kind, const std::array<std::chrono::nanoseconds, kRpcPhaseCount>& phases,
+                    unsigned used_phases, std::chrono::nanoseconds total, bool ok)
+    {
+        Stripe& stripe = local_stripe();
+        auto& latency = stripe.latency[static_cast<std::size_t>(kind)];
+        for (std::size_t i = 0; i < kRpcPhaseCount; ++i)
+        {
+            if (i != static_cast<std::size_t>(RpcPhase::kTotal) && (used_phases & (1u << i)) != 0)
+            {
+                latency[i].record(phases[i]);
+            }
+        }
+        latency[static_cast<std::size_t>(RpcPhase::kTotal)].record(total);
+        if (!ok)
+        {
+            stripe.errors[static_cast<std::size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 証明の検証結果を記録する
+    void record_verification(bool is_verified)
+    {
+        Stripe& stripe = local_stripe();
+        (is_verified ? stripe.verify_success : stripe.verify_failure).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 検証の前にログインを断ったことを記録する
+    void record_rejection(RejectReason reason)
+    {
+        local_stripe().rejected[static_cast<std::size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 全スロットの合計（サービスが埋める現在値は 0 のまま）
+    MetricsSnapshot snapshot() const
+    {
+        MetricsSnapshot out;
+        for (const Stripe& stripe : *stripes_)
+        {
+            for (std::size_t k = 0; k < kRpcKindCount; ++k)
+            {
+                for (std::size_t p = 0; p < kRpcPhaseCount; ++p)
+                {
+                    stripe.latency[k][p].add_to(out.latency[k][p]);
+                }
+                out.errors[k] += stripe.errors[k].load(std::memory_order_relaxed);
+            }
+            out.verify_success += stripe.verify_success.load(std::memory_order_relaxed);
+            out.verify_failure += stripe.verify_failure.load(std::memory_order_relaxed);
+            for (std::size_t r = 0; r < kRejectReasonCount; ++r)
+            {
+                out.rejected[r] += stripe.rejected[r].load(std::memory_order_relaxed);
+            }
+        }
+        return out;
+    }
+
+   private:
+    // 複数スレッドが同じスロットを使う場合もあるため、カウンタは atomic で加算する
+    struct AtomicHistogram
+    {
+        std::array<std::atomic<std::uint64_t>, DurationHistogram::kBuckets> counts{};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum_ns{0};
+
+        void record(std::chrono::nanoseconds duration)
+        {
+            const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+            counts[DurationHistogram::index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+            sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        }
+
+        void add_to(DurationHistogram& out) const
+        {
+            for (std::size_t i = 0; i < DurationHistogram::kBuckets; ++i)
+            {
+                out.counts[i] += counts[i].load(std::memory_order_relaxed);
+            }
+            out.count += count.load(std::memory_order_relaxed);
+            out.sum_ns += sum_ns.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct alignas(64) Stripe
+    {
+        std::array<std::array<AtomicHistogram, kRpcPhaseCount>, kRpcKindCount> latency;
+        std::array<std::atomic<std::uint64_t>, kRpcKindCount> errors{};
+        std::atomic<std::uint64_t> verify_success{0};
+        std::atomic<std::uint64_t> verify_failure{0};
+        std::array<std::atomic<std::uint64_t>, kRejectReasonCount> rejected{};
+    };
+
+    // 1 スロット約 18KB のため、サービスと一緒にスタックに置かず確保する
+    std::unique_ptr<std::array<Stripe, kStripes>> stripes_;
+
+    Stripe& local_stripe()
+    {
+        static std::atomic<std::size_t> next_stripe{0};
+        thread_local const std::size_t index = next_stripe.fetch_add(1, std::memory_order_relaxed) & (kStripes - 1);
+        return (*stripes_)[index];
+    }
+};
+
+/**
+ * @brief 1 回の RPC の段階ごとの処理時間を測り、finish で ServerMetrics に記録する
+ * @note  lap(phase) は前回の lap（または開始）からの時間を phase に加える。同じ段階を何度 lap してもよい
+ *        （例: ユーザー参照の前後で decode を 2 回）。非同期の検証ではワーカースレッドに移して finish してよい。
+ */
+class RpcTimer
+{
+   public:
+    RpcTimer() = default;
+    RpcTimer(ServerMetrics& metrics, RpcKind kind)
+        : metrics_(&metrics), kind_(kind), start_(std::chrono::steady_clock::now()), mark_(start_)
+    {
+    }
+
+    void lap(RpcPhase phase)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        phases_[static_cast<std::size_t>(phase)] += now - mark_;
+        used_phases_ |= 1u << static_cast<std::size_t>(phase);
+        mark_ = now;
+    }
+
+    // 記録する（2 回目以降は何もしない）
+    void finish(bool ok)
+    {
+        if (metrics_ == nullptr)
+        {
+            return;
+        }
+        metrics_->record_rpc(kind_, phases_, used_phases_, std::chrono::steady_clock::now() - start_, ok);
+        metrics_ = nullptr;
+    }
+
+   private:
+    ServerMetrics* metrics_ = nullptr;
+    RpcKind kind_ = RpcKind::kRegister;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point mark_;
+    std::array<std::chrono::nanoseconds, kRpcPhaseCount> phases_{};
+    unsigned used_phases_ = 0;
+};
+
+namespace metrics_detail
+{
+inline void append_number(std::string& out, double value)
+{
+    char buffer[32];
+    const int n = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, static_cast<std::size_t>(n));
+}
+
+inline void append_sample(std::string& out, std::string_view name, std::string_view labels, double value)
+{
+    out.append(name);
+    if (!labels.empty())
+    {
+        out += '{';
+        out.append(labels);
+        out += '}';
+    }
+    out += ' ';
+    append_number(out, value);
+    out += '\n';
+}
+
+inline void append_header(std::string& out, std::string_view name, std::string_view type, std::string_view help)
+{
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+}  // namespace metrics_detail
+
+/**
+ * @fn
+ * @brief Prometheus のテキスト形式（version 0.0.4）で出力する
+ * @note  段階ごとの処理時間は 2 のべき乗のナノ秒を境界（le）とするヒストグラムとして出力する。
+ *        記録のない RPC と段階の組（Register の verify など）は出力しない。
+ */
+inline std::string to_prometheus_text(const MetricsSnapshot& snapshot)
+{
+    using metrics_detail::append_header;
+    using metrics_detail::append_sample;
+    std::string out;
+
+    constexpr std::string_view kDuration = "zkp_rpc_phase_duration_seconds";
+    append_header(out, kDuration, "histogram", "Time spent in each phase of the RPC handlers.");
+    for (std::size_t k = 0; k < kRpcKindCount; ++k)
+    {
+        for (std::size_t p = 0; p < kRpcPhaseCount; ++p)
+        {
+            const DurationHistogram& histogram = snapshot.latency[k][p];
+            if (histogram.count == 0)
+            {
+                continue;
+            }
+            const std::string labels = "rpc=\"" + std::string(rpc_kind_name(static_cast<RpcKind>(k))) +
+                                       "\",phase=\"" + std::string(rpc_phase_name(static_cast<RpcPhase>(p))) + "\"";
+            // 2 のべき乗の区間の終わりごとに累積数を出す
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < DurationHistogram::kBuckets; ++i)
+            {
+                cumulative += histogram.counts[i];
+                if (i % (std::size_t(1) << DurationHistogram::kSubBucketBits) != 0)
+                {
+                    continue;
+                }
+                std::string le;
+                metrics_detail::append_number(le, static_cast<double>(DurationHistogram::upper_bound(i)) * 1e-9);
+                append_sample(out, std::string(kDuration) + "_bucket", labels + ",le=\"" + le + "\"",
+                              static_cast<double>(cumulative));
+            }
+            append_sample(out, std::string(kDuration) + "_bucket", labels + ",le=\"+Inf\"",
+                          static_cast<double>(histogram.count));
+            append_sample(out, std::string(kDuration) + "_sum", labels, static_cast<double>(histogram.sum_ns) * 1e-9);
+            append_sample(out, std::string(kDuration) + "_count", labels, static_cast<double>(histogram.count));
+        }
+    }
+
+    append_header(out, "zkp_rpc_errors_total", "counter", "RPCs that returned a non-OK status.");
+    for (std::size_t k = 0; k < kRpcKindCount; ++k)
+    {
+        append_sample(out, "zkp_rpc_errors_total",
+                      "rpc=\"" + std::string(rpc_kind_name(static_cast<RpcKind>(k))) + "\"",
+                      static_cast<double>(snapshot.errors[k]));
+    }
+
+    append_header(out, "zkp_verifications_total", "counter", "Proof verifications by result.");
+    append_sample(out, "zkp_verifications_total", "result=\"success\"", static_cast<double>(snapshot.verify_success));
+    append_sample(out, "zkp_verifications_total", "result=\"failure\"", static_cast<double>(snapshot.verify_failure));
+    append_header(out, "zkp_verifications_avoided_total", "counter",
+                  "Logins rejected before any exponentiation (one verification saved each), by reason.");
+    for (std::size_t r = 0; r < kRejectReasonCount; ++r)
+    {
+        append_sample(out, "zkp_verifications_avoided_total",
+                      "reason=\"" + std::string(reject_reason_name(static_cast<RejectReason>(r))) + "\"",
+                      static_cast<double>(snapshot.rejected[r]));
+    }
+
+    append_header(out, "zkp_users", "gauge", "Registered users.");
+    append_sample(out, "zkp_users", "", static_cast<double>(snapshot.users));
+    append_header(out, "zkp_sessions", "gauge", "Outstanding authentication sessions.");
+    append_sample(out, "zkp_sessions", "", static_cast<double>(snapshot.sessions));
+    append_header(out, "zkp_sessions_expired_total", "counter", "Sessions reclaimed after their TTL.");
+    append_sample(out, "zkp_sessions_expired_total", "", static_cast<double>(snapshot.sessions_expired));
+    append_header(out, "zkp_sessions_evicted_total", "counter", "Sessions evicted by the session limits.");
+    append_sample(out, "zkp_sessions_evicted_total", "", static_cast<double>(snapshot.sessions_evicted));
+    append_header(out, "zkp_replay_cache_entries", "gauge", "Non-interactive proofs remembered to reject replays.");
+    append_sample(out, "zkp_replay_cache_entries", "", static_cast<double>(snapshot.replay_entries));
+
+    append_header(out, "zkp_key_table_lookups_total", "counter",
+                  "Verifications that looked up the public key table cache, by result.");
+    append_sample(out, "zkp_key_table_lookups_total", "result=\"hit\"", static_cast<double>(snapshot.key_tables.hits));
+    append_sample(out, "zkp_key_table_lookups_total", "result=\"miss\"",
+                  static_cast<double>(snapshot.key_tables.misses));
+    append_header(out, "zkp_key_table_builds_total", "counter", "Public key tables built for frequent users.");
+    append_sample(out, "zkp_key_table_builds_total", "", static_cast<double>(snapshot.key_tables.builds));
+    append_header(out, "zkp_key_table_evictions_total", "counter", "Public key tables evicted by the memory budget.");
+    append_sample(out, "zkp_key_table_evictions_total", "", static_cast<double>(snapshot.key_tables.evictions));
+    append_header(out, "zkp_key_table_entries", "gauge", "Users with a cached public key table.");
+    append_sample(out, "zkp_key_table_entries", "", static_cast<double>(snapshot.key_tables.entries));
+    append_header(out, "zkp_key_table_bytes", "gauge", "Memory used by cached public key tables.");
+    append_sample(out, "zkp_key_table_bytes", "", static_cast<double>(snapshot.key_tables.bytes));
+
+    append_header(out, "zkp_lock_contended_total", "counter", "Store lock acquisitions that had to wait.");
+    append_sample(out, "zkp_lock_contended_total", "store=\"user\"",
+                  static_cast<double>(snapshot.user_store_wait.contended));
+    append_sample(out, "zkp_lock_contended_total", "store=\"session\"",
+                  static_cast<double>(snapshot.session_store_wait.contended));
+    append_header(out, "zkp_lock_wait_seconds_total", "counter", "Time spent waiting for store locks.");
+    append_sample(out, "zkp_lock_wait_seconds_total", "store=\"user\"",
+                  static_cast<double>(snapshot.user_store_wait.wait_ns) * 1e-9);
+    append_sample(out, "zkp_lock_wait_seconds_total", "store=\"session\"",
+                  static_cast<double>(snapshot.session_store_wait.wait_ns) * 1e-9);
+    return out;
+}
+
+#endif  // SERVER_METRICS_HPP
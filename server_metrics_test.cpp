@@ -0,0 +1,134 @@
+#include "server_metrics.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lock_stats.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(DurationHistogramTest, BucketsCoverTheirValues)
+{
+    for (std::uint64_t ns : {0ull, 255ull, 256ull, 319ull, 320ull, 511ull, 512ull, 1000ull, 123456789ull})
+    {
+        const std::size_t index = DurationHistogram::index_of(ns);
+        EXPECT_LT(ns, DurationHistogram::upper_bound(index)) << ns;
+        if (index > 0)
+        {
+            EXPECT_GE(ns, DurationHistogram::upper_bound(index - 1)) << ns;
+        }
+    }
+    // 上限を超える値は最後の階級に入れる
+    EXPECT_EQ(DurationHistogram::index_of(~0ull), DurationHistogram::kBuckets - 1);
+}
+
+TEST(ServerMetricsTest, AggregatesAcrossThreads)
+{
+    ServerMetrics metrics;
+    constexpr int kThreads = 4;
+    constexpr int kRpcs = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back(
+            [&]
+            {
+                for (int i = 0; i < kRpcs; ++i)
+                {
+                    std::array<std::chrono::nanoseconds, kRpcPhaseCount> phases{};
+                    phases[static_cast<std::size_t>(RpcPhase::kVerify)] = 1ms;
+                    metrics.record_rpc(RpcKind::kVerifyAuthentication, phases,
+                                       1u << static_cast<std::size_t>(RpcPhase::kVerify), 2ms, i % 10 != 0);
+                    metrics.record_verification(i % 10 != 0);
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const MetricsSnapshot snapshot = metrics.snapshot();
+    const auto& latency = snapshot.latency[static_cast<std::size_t>(RpcKind::kVerifyAuthentication)];
+    const DurationHistogram& verify = latency[static_cast<std::size_t>(RpcPhase::kVerify)];
+    const DurationHistogram& total = latency[static_cast<std::size_t>(RpcPhase::kTotal)];
+    EXPECT_EQ(verify.count, kThreads * kRpcs);
+    EXPECT_EQ(total.count, kThreads * kRpcs);
+    EXPECT_EQ(latency[static_cast<std::size_t>(RpcPhase::kDecode)].count, 0u);  // 記録していない段階
+    EXPECT_EQ(verify.sum_ns, std::uint64_t(kThreads) * kRpcs * 1000000);
+    // 分位点は階級の上端（相対誤差 25% 以下）
+    EXPECT_GE(verify.percentile(0.5), 1000000u);
+    EXPECT_LE(verify.percentile(0.5), 1250000u);
+    EXPECT_EQ(snapshot.errors[static_cast<std::size_t>(RpcKind::kVerifyAuthentication)], kThreads * kRpcs / 10);
+    EXPECT_EQ(snapshot.verify_success, kThreads * kRpcs * 9 / 10);
+    EXPECT_EQ(snapshot.verify_failure, kThreads * kRpcs / 10);
+}
+
+TEST(ServerMetricsTest, RpcTimerRecordsOnce)
+{
+    ServerMetrics metrics;
+    RpcTimer timer(metrics, RpcKind::kRegister);
+    timer.lap(RpcPhase::kDecode);
+    timer.lap(RpcPhase::kStoreLookup);
+    timer.lap(RpcPhase::kDecode);  // 同じ段階は合算して 1 回として記録する
+    timer.finish(true);
+    timer.finish(false);
+
+    const MetricsSnapshot snapshot = metrics.snapshot();
+    const auto& latency = snapshot.latency[static_cast<std::size_t>(RpcKind::kRegister)];
+    EXPECT_EQ(latency[static_cast<std::size_t>(RpcPhase::kDecode)].count, 1u);
+    EXPECT_EQ(latency[static_cast<std::size_t>(RpcPhase::kStoreLookup)].count, 1u);
+    EXPECT_EQ(latency[static_cast<std::size_t>(RpcPhase::kVerify)].count, 0u);
+    EXPECT_EQ(latency[static_cast<std::size_t>(RpcPhase::kTotal)].count, 1u);
+    EXPECT_EQ(snapshot.errors[static_cast<std::size_t>(RpcKind::kRegister)], 0u);
+}
+
+TEST(ServerMetricsTest, PrometheusText)
+{
+    ServerMetrics metrics;
+    RpcTimer timer(metrics, RpcKind::kCreateAuthenticationChallenge);
+    timer.lap(RpcPhase::kDecode);
+    timer.finish(false);
+    metrics.record_rejection(RejectReason::kPeerRateLimit);
+    metrics.record_rejection(RejectReason::kPeerRateLimit);
+    MetricsSnapshot snapshot = metrics.snapshot();
+    snapshot.users = 3;
+    snapshot.session_store_wait = {2, 1500000000};
+
+    const std::string text = to_prometheus_text(snapshot);
+    EXPECT_NE(text.find("# TYPE zkp_rpc_phase_duration_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_rpc_phase_duration_seconds_count{rpc=\"CreateAuthenticationChallenge\","
+                        "phase=\"decode\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("phase=\"total\",le=\"+Inf\"} 1\n"), std::string::npos);
+    EXPECT_EQ(text.find("rpc=\"Register\",phase="), std::string::npos);  // 記録のない組は出さない
+    EXPECT_NE(text.find("zkp_rpc_errors_total{rpc=\"CreateAuthenticationChallenge\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_verifications_avoided_total{reason=\"peer_rate\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_verifications_avoided_total{reason=\"malformed\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_users 3\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_lock_contended_total{store=\"session\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("zkp_lock_wait_seconds_total{store=\"session\"} 1.5\n"), std::string::npos);
+}
+
+TEST(LockStatsTest, RecordsOnlyContendedAcquisitions)
+{
+    std::mutex mutex;
+    LockWaitStats stats;
+    {
+        auto lock = lock_timed(mutex, stats);
+    }
+    EXPECT_EQ(stats.load().contended, 0u);
+
+    std::unique_lock<std::mutex> held(mutex);
+    std::thread waiter([&] { auto lock = lock_timed(mutex, stats); });
+    std::this_thread::sleep_for(20ms);
+    held.unlock();
+    waiter.join();
+    EXPECT_EQ(stats.load().contended, 1u);
+    EXPECT_GT(stats.load().wait_ns, 0u);
+}
@@ -0,0 +1,393 @@
+#ifndef SESSION_STORE_HPP
+#define SESSION_STORE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lock_stats.hpp"
+#include "timer_wheel.hpp"
+
+// 認証セッション（チャレンジ）の有効期限と上限の設定
+struct SessionStoreOptions
+{
+    // チャレンジを発行してから回答を受け付ける時間
+    std::chrono::milliseconds ttl{30000};
+    // 未回答のチャレンジの上限（0 の場合は上限なし）。超えた場合は最も早く期限切れになるものを追い出す。
+    std::size_t max_sessions = 100000;
+    // ユーザーごとの未回答のチャレンジの上限（0 の場合は上限なし）。超えた場合はそのユーザーの最も古いものを追い出す。
+    std::size_t max_sessions_per_user = 16;
+    // 期限切れを判定する時間の粒度
+    std::chrono::milliseconds tick{100};
+};
+
+// SessionStore::take の結果
+enum class SessionLookup
+{
+    kFound,
+    kNotFound,  // 発行していない、回答済み、または上限により追い出された
+    kExpired,   // 有効期限切れ
+};
+
+/**
+ * @brief 有効期限と上限付きの認証セッションストア
+ * @note  セッションは auth_id のハッシュで Shards 個のシャードに分け、シャードごとに mutex・マップ・
+ *        タイマーホイールを持つ。期限切れのセッションはバックグラウンドスレッドが tick ごとに
+ *        タイマーホイールを進めて回収する（マップ全体の走査は行わない）。
+ *        max_sessions はシャードごとに max_sessions / Shards 件ずつ割り当て、超過時はそのシャードで最も早く
+ *        期限切れになるセッションを追い出す。ユーザーごとの上限はユーザー名で分けた別のシャードで数える。
+ *        どの操作もロックを 1 つずつ取り、保持したまま別のロックを取らない。
+ *        auth_id の末尾には有効期限（UNIX 時刻のミリ秒）を付けるため、回収済みのセッションについても
+ *        「期限切れ」と「存在しない」を区別して返せる。
+ *        シャードのロック取得で待ちが発生した回数と時間を数え、lock_wait で合計を返す。
+ * @tparam Session セッションの型
+ * @tparam Shards シャード数
+ */
+template <typename Session, std::size_t Shards = 64>
+class SessionStore
+{
+   public:
+    /**
+     * @fn
+     * @brief コンストラクタ。期限切れを回収するスレッドを起動する。
+     */
+    explicit SessionStore(const SessionStoreOptions& options = {})
+        : options_(options), epoch_(std::chrono::steady_clock::now())
+    {
+        if (options_.tick.count() <= 0)
+        {
+            options_.tick = std::chrono::milliseconds(1);
+        }
+        if (options_.max_sessions != 0)
+        {
+            shard_capacity_ = std::max<std::size_t>(1, (options_.max_sessions + Shards - 1) / Shards);
+        }
+        reaper_ = std::thread([this] { reaper_loop(); });
+    }
+
+    ~SessionStore()
+    {
+        {
+            std::lock_guard<std::mutex> lock(reaper_mutex_);
+            stopping_ = true;
+        }
+        reaper_cv_.notify_all();
+        reaper_.join();
+    }
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    /**
+     * @fn
+     * @brief セッションを登録し、auth_id を発行する
+     * @param nonce auth_id の一意な部分（推測できない値であること）
+     * @param user セッションのユーザー名（ユーザーごとの上限に使う）
+     * @param session セッション
+     * @return auth_id（nonce に有効期限を付けたもの）
+     */
+    std::string issue(const std::string& nonce, const std::string& user, Session session)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const std::int64_t expires_at_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                (std::chrono::system_clock::now() + options_.ttl).time_since_epoch())
+                .count();
+        std::string auth_id = nonce + kExpirySeparator + std::to_string(expires_at_ms);
+
+        // 1. ユーザーごとの上限: 超えた場合は最も古いセッションを追い出す
+        std::optional<std::string> user_victim;
+        {
+            UserShard& shard = user_shard(user);
+            auto lock = lock_timed(shard.mutex, shard.lock_wait);
+            std::deque<std::string>& ids = shard.sessions[user];
+            ids.push_back(auth_id);
+            if (options_.max_sessions_per_user != 0 && ids.size() > options_.max_sessions_per_user)
+            {
+                user_victim = std::move(ids.front());
+                ids.pop_front();
+            }
+        }
+        if (user_victim && remove(*user_victim))
+        {
+            evicted_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 2. 登録: シャードの上限を超える場合は最も早く期限切れになるセッションを追い出す
+        std::optional<std::pair<std::string, std::string>> capacity_victim;  // {user, auth_id}
+        {
+            Shard& shard = session_shard(auth_id);
+            auto lock = lock_timed(shard.mutex, shard.lock_wait);
+            if (shard_capacity_ != 0 && shard.entries.size() >= shard_capacity_)
+            {
+                shard.timers.pop_earliest(
+                    [&](std::string&& victim)
+                    {
+                        auto it = shard.entries.find(victim);
+                        capacity_victim.emplace(std::move(it->second.user), std::move(victim));
+                        shard.entries.erase(it);
+                    });
+            }
+            Entry entry{std::move(session), user, {}};
+            entry.timer = shard.timers.schedule(expiry_tick(now), auth_id);
+            shard.entries.emplace(auth_id, std::move(entry));
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+        if (capacity_victim)
+        {
+            // ユーザーの一覧から外すのはシャードのロックを外してから
+            forget(capacity_victim->first, capacity_victim->second);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            evicted_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return auth_id;
+    }
+
+    /**
+     * @fn
+     * @brief セッションを取り出して削除する。同じ auth_id を同時に take しても受け取るのは 1 つだけ。
+     * @param auth_id issue が返した auth_id
+     * @param out 見つかった場合のセッション
+     * @return 取り出した場合は kFound。期限切れの場合は kExpired（回収済みの場合も auth_id から判定する）。
+     */
+    SessionLookup take(const std::string& auth_id, Session& out)
+    {
+        std::optional<Entry> entry;
+        {
+            Shard& shard = session_shard(auth_id);
+            auto lock = lock_timed(shard.mutex, shard.lock_wait);
+            auto it = shard.entries.find(auth_id);
+            if (it != shard.entries.end())
+            {
+                shard.timers.cancel(it->second.timer);
+                entry = std::move(it->second);
+                shard.entries.erase(it);
+            }
+        }
+        if (!entry)
+        {
+            return is_expired(auth_id) ? SessionLookup::kExpired : SessionLookup::kNotFound;
+        }
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        forget(entry->user, auth_id);
+        // 回収スレッドがまだ回収していない期限切れのセッション
+        if (is_expired(auth_id))
+        {
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            return SessionLookup::kExpired;
+        }
+        out = std::move(entry->session);
+        return SessionLookup::kFound;
+    }
+
+    /**
+     * @fn
+     * @brief 期限切れのセッションを回収する（回収スレッドが tick ごとに呼ぶ）
+     */
+    void expire_now()
+    {
+        const TimerWheel<std::string>::Tick now_tick = current_tick(std::chrono::steady_clock::now());
+        std::vector<std::pair<std::string, std::string>> expired;  // {user, auth_id}
+        for (Shard& shard : shards_)
+        {
+            {
+                auto lock = lock_timed(shard.mutex, shard.lock_wait);
+                shard.timers.advance(now_tick,
+                                     [&](std::string&& auth_id)
+                                     {
+                                         auto it = shard.entries.find(auth_id);
+                                         expired.emplace_back(std::move(it->second.user), std::move(auth_id));
+                                         shard.entries.erase(it);
+                                     });
+            }
+            for (auto& [user, auth_id] : expired)
+            {
+                forget(user, auth_id);
+            }
+            size_.fetch_sub(expired.size(), std::memory_order_relaxed);
+            expired_.fetch_add(expired.size(), std::memory_order_relaxed);
+            expired.clear();
+        }
+    }
+
+    // 未回答のセッション数
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+    // 期限切れで回収したセッションの累計
+    std::uint64_t expired_count() const { return expired_.load(std::memory_order_relaxed); }
+    // 上限により追い出したセッションの累計
+    std::uint64_t evicted_count() const { return evicted_.load(std::memory_order_relaxed); }
+
+    // セッションとユーザーごとの一覧の全シャードのロック待ちの累計
+    LockWaitCounters lock_wait() const
+    {
+        LockWaitCounters total;
+        for (const Shard& shard : shards_)
+        {
+            total += shard.lock_wait.load();
+        }
+        for (const UserShard& shard : user_shards_)
+        {
+            total += shard.lock_wait.load();
+        }
+        return total;
+    }
+
+    const SessionStoreOptions& options() const { return options_; }
+
+   private:
+    static constexpr char kExpirySeparator = '.';
+
+    struct Entry
+    {
+        Session session;
+        std::string user;
+        TimerWheel<std::string>::Handle timer;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        LockWaitStats lock_wait;
+        std::unordered_map<std::string, Entry> entries;
+        TimerWheel<std::string> timers;
+    };
+
+    struct alignas(64) UserShard
+    {
+        std::mutex mutex;
+        LockWaitStats lock_wait;
+        // ユーザー名 -> 未回答の auth_id（発行順）。件数は max_sessions_per_user で抑えられる。
+        std::unordered_map<std::string, std::deque<std::string>> sessions;
+    };
+
+    SessionStoreOptions options_;
+    const std::chrono::steady_clock::time_point epoch_;
+    std::size_t shard_capacity_ = 0;
+
+    std::array<Shard, Shards> shards_;
+    std::array<UserShard, Shards> user_shards_;
+
+    std::atomic<std::size_t> size_{0};
+    std::atomic<std::uint64_t> expired_{0};
+    std::atomic<std::uint64_t> evicted_{0};
+
+    std::mutex reaper_mutex_;
+    std::condition_variable reaper_cv_;
+    bool stopping_ = false;
+    std::thread reaper_;
+
+    static std::size_t shard_index(const std::string& key)
+    {
+        const std::uint64_t h = static_cast<std::uint64_t>(std::hash<std::string>{}(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(h >> 32) % Shards;
+    }
+
+    Shard& session_shard(const std::string& auth_id) { return shards_[shard_index(auth_id)]; }
+    UserShard& user_shard(const std::string& user) { return user_shards_[shard_index(user)]; }
+
+    TimerWheel<std::string>::Tick current_tick(std::chrono::steady_clock::time_point now) const
+    {
+        return static_cast<TimerWheel<std::string>::Tick>((now - epoch_) / options_.tick);
+    }
+
+    // 期限の tick（切り上げ）
+    TimerWheel<std::string>::Tick expiry_tick(std::chrono::steady_clock::time_point now) const
+    {
+        const auto elapsed = now + options_.ttl - epoch_;
+        return static_cast<TimerWheel<std::string>::Tick>((elapsed + options_.tick - std::chrono::nanoseconds(1)) /
+                                                          options_.tick);
+    }
+
+    // auth_id の末尾の有効期限を過ぎているか（形式が不正な場合は false）
+    static bool is_expired(std::string_view auth_id)
+    {
+        const std::size_t pos = auth_id.rfind(kExpirySeparator);
+        if (pos == std::string_view::npos)
+        {
+            return false;
+        }
+        std::int64_t expires_at_ms = 0;
+        const char* first = auth_id.data() + pos + 1;
+        const char* last = auth_id.data() + auth_id.size();
+        const auto [ptr, ec] = std::from_chars(first, last, expires_at_ms);
+        if (ec != std::errc() || ptr != last)
+        {
+            return false;
+        }
+        const std::int64_t now_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        return now_ms >= expires_at_ms;
+    }
+
+    // セッションをシャードから削除する
+    bool remove(const std::string& auth_id)
+    {
+        Shard& shard = session_shard(auth_id);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        auto it = shard.entries.find(auth_id);
+        if (it == shard.entries.end())
+        {
+            return false;
+        }
+        shard.timers.cancel(it->second.timer);
+        shard.entries.erase(it);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // ユーザーの未回答一覧から auth_id を外す
+    void forget(const std::string& user, const std::string& auth_id)
+    {
+        UserShard& shard = user_shard(user);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        auto it = shard.sessions.find(user);
+        if (it == shard.sessions.end())
+        {
+            return;
+        }
+        std::deque<std::string>& ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), auth_id);
+        if (pos != ids.end())
+        {
+            ids.erase(pos);
+        }
+        if (ids.empty())
+        {
+            shard.sessions.erase(it);
+        }
+    }
+
+    void reaper_loop()
+    {
+        std::unique_lock<std::mutex> lock(reaper_mutex_);
+        while (!stopping_)
+        {
+            reaper_cv_.wait_for(lock, options_.tick, [this] { return stopping_; });
+            if (stopping_)
+            {
+                return;
+            }
+            lock.unlock();
+            expire_now();
+            lock.lock();
+        }
+    }
+};
+
+#endif  // SESSION_STORE_HPP
@@ -0,0 +1,97 @@
+#include "session_store.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+TEST(TimerWheelTest, FiresAtExpiryAcrossLevels)
+{
+    TimerWheel<int> wheel;
+    // レベル 0 / 1 / 2 / 3 とホイールの範囲外にまたがる期限
+    const std::vector<TimerWheel<int>::Tick> expiries = {1, 63, 64, 65, 4095, 4096, 300000, 20000000};
+    for (std::size_t i = 0; i < expiries.size(); ++i)
+    {
+        wheel.schedule(expiries[i], static_cast<int>(i));
+    }
+    EXPECT_EQ(wheel.size(), expiries.size());
+
+    std::vector<TimerWheel<int>::Tick> fired(expiries.size(), 0);
+    for (TimerWheel<int>::Tick now : expiries)
+    {
+        wheel.advance(now - 1, [&](int&& i) { fired[i] = wheel.now(); });
+        wheel.advance(now, [&](int&& i) { fired[i] = wheel.now(); });
+    }
+    EXPECT_EQ(fired, expiries);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, CancelAndPopEarliest)
+{
+    TimerWheel<std::string> wheel(100);
+    auto a = wheel.schedule(150, "a");
+    wheel.schedule(120, "b");
+    wheel.schedule(5000, "c");
+    wheel.schedule(50, "late");  // 過去の期限は次の tick で発火する
+
+    EXPECT_TRUE(wheel.cancel(a));
+    EXPECT_FALSE(wheel.cancel(a));
+
+    std::string popped;
+    EXPECT_TRUE(wheel.pop_earliest([&](std::string&& v) { popped = v; }));
+    EXPECT_EQ(popped, "late");
+    EXPECT_TRUE(wheel.pop_earliest([&](std::string&& v) { popped = v; }));
+    EXPECT_EQ(popped, "b");
+
+    std::vector<std::string> fired;
+    wheel.advance(10000, [&](std::string&& v) { fired.push_back(v); });
+    EXPECT_EQ(fired, std::vector<std::string>{"c"});
+    EXPECT_FALSE(wheel.pop_earliest([](std::string&&) {}));
+}
+
+TEST(SessionStoreTest, TakeDistinguishesExpiredFromNotFound)
+{
+    SessionStore<int> store({.ttl = std::chrono::milliseconds(50), .tick = std::chrono::milliseconds(5)});
+    const std::string first = store.issue("n1", "alice", 1);
+    const std::string second = store.issue("n2", "alice", 2);
+    EXPECT_EQ(store.size(), 2u);
+
+    int session = 0;
+    EXPECT_EQ(store.take(first, session), SessionLookup::kFound);
+    EXPECT_EQ(session, 1);
+    EXPECT_EQ(store.take(first, session), SessionLookup::kNotFound);  // 回答済み
+    EXPECT_EQ(store.take("unknown", session), SessionLookup::kNotFound);
+
+    // 回収スレッドが期限切れのセッションを回収しても、期限切れとして報告する
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(store.size(), 0u);
+    EXPECT_EQ(store.expired_count(), 1u);
+    EXPECT_EQ(store.take(second, session), SessionLookup::kExpired);
+}
+
+TEST(SessionStoreTest, CapsEvictOldestSessions)
+{
+    // シャード 1 つで上限 3、ユーザーごとの上限 2
+    SessionStore<int, 1> store({.max_sessions = 3, .max_sessions_per_user = 2});
+    const std::string a1 = store.issue("a1", "alice", 1);
+    const std::string a2 = store.issue("a2", "alice", 2);
+    const std::string a3 = store.issue("a3", "alice", 3);  // alice の最古の a1 を追い出す
+    EXPECT_EQ(store.size(), 2u);
+
+    const std::string b1 = store.issue("b1", "bob", 4);
+    const std::string c1 = store.issue("c1", "carol", 5);  // 全体の上限: 最も早く期限切れになる a2 を追い出す
+    EXPECT_EQ(store.size(), 3u);
+    EXPECT_EQ(store.evicted_count(), 2u);
+
+    int session = 0;
+    EXPECT_EQ(store.take(a1, session), SessionLookup::kNotFound);
+    EXPECT_EQ(store.take(a2, session), SessionLookup::kNotFound);
+    EXPECT_EQ(store.take(a3, session), SessionLookup::kFound);
+    EXPECT_EQ(store.take(b1, session), SessionLookup::kFound);
+    EXPECT_EQ(store.take(c1, session), SessionLookup::kFound);
+    EXPECT_EQ(session, 5);
+    EXPECT_EQ(store.size(), 0u);
+}
@@ -0,0 +1,202 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @brief SHA-256（FIPS 180-4）
+ * @note  Fiat-Shamir 変換のチャレンジ導出とチャレンジトークンの認証（HmacSha256）に使う。外部ライブラリに依存しないよう自前で実装する。
+ *        update で任意の長さのデータを追加し、finish でダイジェストを得る（finish 後は再利用しないこと）。
+ */
+class Sha256
+{
+   public:
+    static constexpr std::size_t kDigestBytes = 32;
+    static constexpr std::size_t kBlockBytes = 64;
+    using Digest = std::array<std::uint8_t, kDigestBytes>;
+
+    /**
+     * @fn
+     * @brief data をまとめてハッシュする
+     */
+    static Digest hash(std::string_view data)
+    {
+        Sha256 sha;
+        sha.update(data);
+        return sha.finish();
+    }
+
+    void update(std::string_view data) { update(data.data(), data.size()); }
+
+    void update(const void* data, std::size_t size)
+    {
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+        length_ += size;
+        if (buffered_ != 0)
+        {
+            const std::size_t n = size < kBlockBytes - buffered_ ? size : kBlockBytes - buffered_;
+            std::memcpy(buffer_.data() + buffered_, bytes, n);
+            buffered_ += n;
+            bytes += n;
+            size -= n;
+            if (buffered_ < kBlockBytes)
+            {
+                return;
+            }
+            compress(buffer_.data());
+            buffered_ = 0;
+        }
+        // バッファを経由せずにブロック単位で処理する
+        for (; size >= kBlockBytes; bytes += kBlockBytes, size -= kBlockBytes)
+        {
+            compress(bytes);
+        }
+        std::memcpy(buffer_.data(), bytes, size);
+        buffered_ = size;
+    }
+
+    Digest finish()
+    {
+        // パディング: 0x80、0 埋め、メッセージ長（ビット、ビッグエンディアン 64-bit）
+        const std::uint64_t bit_length = length_ * 8;
+        buffer_[buffered_++] = 0x80;
+        if (buffered_ > kBlockBytes - 8)
+        {
+            std::memset(buffer_.data() + buffered_, 0, kBlockBytes - buffered_);
+            compress(buffer_.data());
+            buffered_ = 0;
+        }
+        std::memset(buffer_.data() + buffered_, 0, kBlockBytes - 8 - buffered_);
+        for (int i = 0; i < 8; ++i)
+        {
+            buffer_[kBlockBytes - 1 - i] = static_cast<std::uint8_t>(bit_length >> (8 * i));
+        }
+        compress(buffer_.data());
+
+        Digest digest;
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            for (std::size_t j = 0; j < 4; ++j)
+            {
+                digest[i * 4 + j] = static_cast<std::uint8_t>(state_[i] >> (24 - 8 * j));
+            }
+        }
+        return digest;
+    }
+
+   private:
+    static constexpr std::array<std::uint32_t, 64> kRoundConstants = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    std::array<std::uint32_t, 8> state_ = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::array<std::uint8_t, kBlockBytes> buffer_{};
+    std::size_t buffered_ = 0;
+    std::uint64_t length_ = 0;
+
+    static constexpr std::uint32_t rotr(std::uint32_t x, unsigned n) { return (x >> n) | (x << (32 - n)); }
+
+    // 64 バイトのブロック 1 つを圧縮関数に通す
+    void compress(const std::uint8_t* block)
+    {
+        std::array<std::uint32_t, 64> w;
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            w[i] = (std::uint32_t(block[i * 4]) << 24) | (std::uint32_t(block[i * 4 + 1]) << 16) |
+                   (std::uint32_t(block[i * 4 + 2]) << 8) | std::uint32_t(block[i * 4 + 3]);
+        }
+        for (std::size_t i = 16; i < 64; ++i)
+        {
+            const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        std::uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (std::size_t i = 0; i < 64; ++i)
+        {
+            const std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                                     kRoundConstants[i] + w[i];
+            const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state_[0] += a;
+        state_[1] += b;
+        state_[2] += c;
+        state_[3] += d;
+        state_[4] += e;
+        state_[5] += f;
+        state_[6] += g;
+        state_[7] += h;
+    }
+};
+
+/**
+ * @brief HMAC-SHA256（RFC 2104）
+ * @note  鍵を詰めた ipad / opad のブロックを通した内側・外側のハッシュの状態をコンストラクタで作っておき、
+ *        mac のたびにそれを複製して使う（1 回あたりの圧縮関数の呼び出しが 2 回減る）。mac はスレッドセーフ。
+ */
+class HmacSha256
+{
+   public:
+    explicit HmacSha256(std::string_view key)
+    {
+        std::array<std::uint8_t, Sha256::kBlockBytes> block{};
+        if (key.size() > block.size())
+        {
+            const Sha256::Digest digest = Sha256::hash(key);
+            std::memcpy(block.data(), digest.data(), digest.size());
+        }
+        else
+        {
+            std::memcpy(block.data(), key.data(), key.size());
+        }
+        for (std::uint8_t& b : block)
+        {
+            b ^= 0x36;
+        }
+        inner_.update(block.data(), block.size());
+        for (std::uint8_t& b : block)
+        {
+            b ^= 0x36 ^ 0x5c;
+        }
+        outer_.update(block.data(), block.size());
+        block.fill(0);
+    }
+
+    Sha256::Digest mac(std::string_view data) const
+    {
+        Sha256 inner = inner_;
+        inner.update(data);
+        const Sha256::Digest inner_digest = inner.finish();
+        Sha256 outer = outer_;
+        outer.update(inner_digest.data(), inner_digest.size());
+        return outer.finish();
+    }
+
+   private:
+    Sha256 inner_;
+    Sha256 outer_;
+};
+
+#endif  // SHA256_HPP
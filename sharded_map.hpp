@@ -0,0 +1,201 @@
+#ifndef SHARDED_MAP_HPP
+#define SHARDED_MAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "lock_stats.hpp"
+
+/**
+ * @brief ロックストライピングによるスレッドセーフなハッシュマップ
+ * @note  キーのハッシュ値で Shards 個のシャードに振り分け、シャードごとに std::shared_mutex と
+ *        std::unordered_map を持つ。異なるシャードへのアクセスは互いに待たず、同じシャードでも
+ *        参照（find / visit）は共有ロックで同時に行える。
+ *        各操作は 1 つのシャードのロックだけを取り、ロックを保持したまま別のロックを取らない。
+ *        シャードはキャッシュラインに揃えて配置し、隣接シャード間の false sharing を避ける。
+ *        ロック取得で待ちが発生した回数と時間をシャードごとに数え、lock_wait で合計を返す。
+ * @tparam Key キーの型
+ * @tparam Value 値の型
+ * @tparam Shards シャード数（2 のべき乗）
+ * @tparam Hash キーのハッシュ関数
+ */
+template <typename Key, typename Value, std::size_t Shards = 64, typename Hash = std::hash<Key>>
+class ShardedMap
+{
+    static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+
+   public:
+    ShardedMap() = default;
+    ShardedMap(const ShardedMap&) = delete;
+    ShardedMap& operator=(const ShardedMap&) = delete;
+
+    /**
+     * @fn
+     * @brief キーが存在しない場合のみ値を挿入する
+     * @return 挿入した場合は true、既に存在した場合は false
+     */
+    bool insert(const Key& key, Value value)
+    {
+        Shard& shard = shard_for(key);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        return shard.map.try_emplace(key, std::move(value)).second;
+    }
+
+    /**
+     * @fn
+     * @brief 値を挿入する。既に存在する場合は上書きする。
+     */
+    void insert_or_assign(const Key& key, Value value)
+    {
+        Shard& shard = shard_for(key);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        shard.map.insert_or_assign(key, std::move(value));
+    }
+
+    /**
+     * @fn
+     * @brief 値のコピーを取得する（共有ロック）
+     * @return 存在しない場合は std::nullopt
+     */
+    std::optional<Value> find(const Key& key) const
+    {
+        const Shard& shard = shard_for(key);
+        auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * @fn
+     * @brief 共有ロックを保持したまま値を f(const Value&) に渡す。値の一部だけを読む場合にコピーを避けられる。
+     * @note  f の中で同じマップにアクセスしないこと。
+     * @return キーが存在して f を呼んだ場合は true
+     */
+    template <typename Func>
+    bool visit(const Key& key, Func&& f) const
+    {
+        const Shard& shard = shard_for(key);
+        auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end())
+        {
+            return false;
+        }
+        f(it->second);
+        return true;
+    }
+
+    /**
+     * @fn
+     * @brief 値を取り出して削除する。同じキーを同時に take しても値を受け取るのは 1 つだけ。
+     * @return 存在しない場合は std::nullopt
+     */
+    std::optional<Value> take(const Key& key)
+    {
+        Shard& shard = shard_for(key);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end())
+        {
+            return std::nullopt;
+        }
+        std::optional<Value> value(std::move(it->second));
+        shard.map.erase(it);
+        return value;
+    }
+
+    /**
+     * @fn
+     * @brief 値を削除する
+     * @return 削除した場合は true
+     */
+    bool erase(const Key& key)
+    {
+        Shard& shard = shard_for(key);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        return shard.map.erase(key) != 0;
+    }
+
+    /**
+     * @fn
+     * @brief 要素数を返す。シャードを 1 つずつロックして数えるため、並行更新中は概数になる。
+     */
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for (const Shard& shard : shards_)
+        {
+            auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+            total += shard.map.size();
+        }
+        return total;
+    }
+
+    /**
+     * @fn
+     * @brief 全要素を f(const Key&, const Value&) に渡す。シャードを 1 つずつ共有ロックして走査するため、
+     *        並行更新中は走査の途中で挿入された要素を含む場合と含まない場合がある。
+     * @note  f の中で同じマップにアクセスしないこと。
+     */
+    template <typename Func>
+    void for_each(Func&& f) const
+    {
+        for (const Shard& shard : shards_)
+        {
+            auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+            for (const auto& [key, value] : shard.map)
+            {
+                f(key, value);
+            }
+        }
+    }
+
+    /**
+     * @fn
+     * @brief 全シャードのロック待ちの累計を返す
+     */
+    LockWaitCounters lock_wait() const
+    {
+        LockWaitCounters total;
+        for (const Shard& shard : shards_)
+        {
+            total += shard.lock_wait.load();
+        }
+        return total;
+    }
+
+    static constexpr std::size_t shard_count() { return Shards; }
+
+   private:
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        mutable LockWaitStats lock_wait;
+        std::unordered_map<Key, Value, Hash> map;
+    };
+
+    std::array<Shard, Shards> shards_;
+
+    // unordered_map もハッシュ値の下位ビットでバケットを選ぶため、シャードの選択には上位ビットを使う
+    static std::size_t shard_index(const Key& key)
+    {
+        const std::uint64_t h = static_cast<std::uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(h >> 32) & (Shards - 1);
+    }
+
+    Shard& shard_for(const Key& key) { return shards_[shard_index(key)]; }
+    const Shard& shard_for(const Key& key) const { return shards_[shard_index(key)]; }
+};
+
+#endif  // SHARDED_MAP_HPP
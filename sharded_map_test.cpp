@@ -0,0 +1,70 @@
+#include "sharded_map.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ShardedMapTest, InsertFindTakeErase)
+{
+    ShardedMap<std::string, int, 8> map;
+
+    EXPECT_TRUE(map.insert("alice", 1));
+    EXPECT_FALSE(map.insert("alice", 2));  // 既存のキーは上書きしない
+    EXPECT_EQ(map.find("alice"), 1);
+    EXPECT_FALSE(map.find("bob"));
+
+    map.insert_or_assign("alice", 3);
+    int seen = 0;
+    EXPECT_TRUE(map.visit("alice", [&](const int& v) { seen = v; }));
+    EXPECT_EQ(seen, 3);
+    EXPECT_FALSE(map.visit("bob", [&](const int&) { FAIL(); }));
+
+    EXPECT_TRUE(map.insert("bob", 4));
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map.take("alice"), 3);
+    EXPECT_FALSE(map.take("alice"));
+    EXPECT_TRUE(map.erase("bob"));
+    EXPECT_FALSE(map.erase("bob"));
+    EXPECT_EQ(map.size(), 0u);
+}
+
+TEST(ShardedMapTest, ConcurrentTakeHandsOutEachValueOnce)
+{
+    ShardedMap<int, int> map;
+    constexpr int kKeys = 2000;
+    for (int i = 0; i < kKeys; ++i)
+    {
+        map.insert(i, i);
+    }
+
+    // 全スレッドが全キーを take しても、各値を受け取るのは 1 スレッドだけ
+    std::atomic<int> taken{0};
+    std::atomic<long long> sum{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back(
+            [&]
+            {
+                for (int i = 0; i < kKeys; ++i)
+                {
+                    if (auto v = map.take(i))
+                    {
+                        ++taken;
+                        sum += *v;
+                    }
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(taken.load(), kKeys);
+    EXPECT_EQ(sum.load(), static_cast<long long>(kKeys) * (kKeys - 1) / 2);
+    EXPECT_EQ(map.size(), 0u);
+}
@@ -0,0 +1,257 @@
+// ユーザー/セッションストアの競合ベンチマーク
+// CreateAuthenticationChallenge と VerifyAuthentication が行うストア操作（ユーザー参照、セッション挿入、
+// セッション取り出し）を 1〜64 スレッドで繰り返し、単一 mutex のストアと ShardedMap のスループットを比較する。
+// 続けて、登録済みユーザーの表の 1 ユーザーあたりのメモリを ShardedMap<std::string, UserInfo> と UserTable で比較する。
+
+#include <malloc.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "sharded_map.hpp"
+#include "user_table.hpp"
+
+namespace
+{
+// operator new で確保中のバイト数（malloc の確保単位に切り上げた大きさ）
+std::atomic<std::size_t> g_heap_in_use{0};
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+    {
+        g_heap_in_use.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p != nullptr)
+    {
+        g_heap_in_use.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+namespace
+{
+struct User
+{
+    std::string name;
+    int group = 0;
+};
+
+struct Session
+{
+    std::string user;
+    int group = 0;
+};
+
+// 変更前の AuthServiceImpl と同じ構成: ストアごとに 1 つの mutex、チャレンジ作成時はユーザー→セッションの順に入れ子でロック
+class MutexStores
+{
+   public:
+    void add_user(const std::string& name) { users_[name] = {name, 0}; }
+
+    bool create_challenge(const std::string& user, const std::string& auth_id)
+    {
+        std::lock_guard<std::mutex> user_lock(user_mutex_);
+        auto it = users_.find(user);
+        if (it == users_.end())
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> session_lock(session_mutex_);
+        sessions_[auth_id] = {user, it->second.group};
+        return true;
+    }
+
+    bool verify(const std::string& auth_id)
+    {
+        std::optional<Session> session;
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            auto it = sessions_.find(auth_id);
+            if (it == sessions_.end())
+            {
+                return false;
+            }
+            session = it->second;
+            sessions_.erase(it);
+        }
+        std::lock_guard<std::mutex> lock(user_mutex_);
+        return users_.count(session->user) != 0;
+    }
+
+   private:
+    std::mutex user_mutex_;
+    std::unordered_map<std::string, User> users_;
+    std::mutex session_mutex_;
+    std::unordered_map<std::string, Session> sessions_;
+};
+
+// 変更後の AuthServiceImpl と同じ構成: シャード単位のロックを 1 つずつ取る
+class ShardedStores
+{
+   public:
+    void add_user(const std::string& name) { users_.insert(name, {name, 0}); }
+
+    bool create_challenge(const std::string& user, const std::string& auth_id)
+    {
+        std::optional<int> group;
+        users_.visit(user, [&](const User& u) { group = u.group; });
+        if (!group)
+        {
+            return false;
+        }
+        sessions_.insert_or_assign(auth_id, {user, *group});
+        return true;
+    }
+
+    bool verify(const std::string& auth_id)
+    {
+        std::optional<Session> session = sessions_.take(auth_id);
+        if (!session)
+        {
+            return false;
+        }
+        return users_.visit(session->user, [](const User&) {});
+    }
+
+   private:
+    ShardedMap<std::string, User> users_;
+    ShardedMap<std::string, Session> sessions_;
+};
+
+constexpr int kUsers = 10000;
+
+std::size_t heap_in_use() { return g_heap_in_use.load(std::memory_order_relaxed); }
+
+// 1024 ビットの公開鍵を持つユーザー
+UserInfo make_user(int i)
+{
+    const boost::multiprecision::cpp_int base = boost::multiprecision::cpp_int(1) << 1023;
+    return {.name = "user" + std::to_string(i), .group = GroupId::kModp1024, .y1 = base + i, .y2 = base + 2 * i};
+}
+
+// users 人を登録した表のヒープ使用量を 1 ユーザーあたりのバイト数で返す
+template <typename Insert>
+double bytes_per_user(int users, Insert&& insert)
+{
+    const std::size_t before = heap_in_use();
+    for (int i = 0; i < users; ++i)
+    {
+        insert(make_user(i));
+    }
+    return static_cast<double>(heap_in_use() - before) / users;
+}
+
+// threads 本のスレッドで duration の間ログイン（チャレンジ作成 + 検証）を繰り返し、毎秒のログイン数を返す
+template <typename Stores>
+double run(Stores& stores, int threads, std::chrono::milliseconds duration)
+{
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::atomic<long long> total{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                while (!start.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+                long long count = 0;
+                unsigned user = static_cast<unsigned>(t) * 7919u;
+                std::string auth_id = "auth-" + std::to_string(t) + "-";
+                const std::size_t prefix = auth_id.size();
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    const std::string name = "user" + std::to_string(user++ % kUsers);
+                    auth_id.resize(prefix);
+                    auth_id += std::to_string(count);
+                    if (stores.create_challenge(name, auth_id) && stores.verify(auth_id))
+                    {
+                        ++count;
+                    }
+                }
+                total += count;
+            });
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(total.load()) / elapsed.count();
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    // 引数: 1 点あたりの計測時間（ミリ秒、既定値 500）
+    const std::chrono::milliseconds duration(argc > 1 ? std::atol(argv[1]) : 500);
+
+    MutexStores mutex_stores;
+    ShardedStores sharded_stores;
+    for (int i = 0; i < kUsers; ++i)
+    {
+        mutex_stores.add_user("user" + std::to_string(i));
+        sharded_stores.add_user("user" + std::to_string(i));
+    }
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    std::cout << std::setw(8) << "threads" << std::setw(18) << "mutex logins/s" << std::setw(18)
+              << "sharded logins/s" << std::setw(10) << "speedup" << "\n";
+    for (int threads = 1; threads <= 64; threads *= 2)
+    {
+        const double baseline = run(mutex_stores, threads, duration);
+        const double sharded = run(sharded_stores, threads, duration);
+        std::cout << std::setw(8) << threads << std::setw(18) << std::fixed << std::setprecision(0) << baseline
+                  << std::setw(18) << sharded << std::setw(9) << std::setprecision(2) << sharded / baseline << "x"
+                  << std::endl;
+    }
+
+    constexpr int kTableUsers = 200000;
+    double map_bytes = 0;
+    {
+        ShardedMap<std::string, UserInfo> map;
+        map_bytes = bytes_per_user(kTableUsers,
+                                   [&](UserInfo user)
+                                   {
+                                       const std::string name = user.name;
+                                       map.insert(name, std::move(user));
+                                   });
+    }
+    UserTable table;
+    const double table_bytes =
+        bytes_per_user(kTableUsers, [&](const UserInfo& user) { table.insert(user.name, *make_user_keys(user)); });
+    std::cout << "\nbytes per registered user (" << kTableUsers << " users, 1024-bit keys)\n"
+              << std::setw(34) << "ShardedMap<std::string, UserInfo>" << std::setw(10) << std::setprecision(0)
+              << map_bytes << "\n"
+              << std::setw(34) << "UserTable" << std::setw(10) << table_bytes << std::endl;
+    return 0;
+}
@@ -0,0 +1,273 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 階層タイマーホイール
+ * @note  時刻は整数の tick で表す。レベル l は 64 スロットを持ち、1 スロットが 64^l tick を受け持つ
+ *        （4 レベルで 64^4 = 約 1,677 万 tick 先まで。それより先の期限は最上位レベルの最遠スロットに置き、
+ *        カスケード時に置き直す）。
+ *        スロットはノード番号による双方向リストで、登録・取り消しはタイマー数によらず O(1)。
+ *        advance は経過した tick ごとにレベル 0 のスロットを 1 つ処理し、レベル 0 が一周するたびに
+ *        上位レベルのスロットを 1 つ下位レベルへ振り分ける（全タイマーの走査は行わない）。
+ *        スレッドセーフではない。呼び出し側で排他すること。
+ * @tparam T タイマーに持たせる値
+ */
+template <typename T>
+class TimerWheel
+{
+   public:
+    using Tick = std::uint64_t;
+
+    static constexpr unsigned kSlotBits = 6;
+    static constexpr unsigned kSlots = 1u << kSlotBits;
+    static constexpr unsigned kLevels = 4;
+
+    // schedule が返すタイマーの識別子。発火・取り消し済みのハンドルで cancel しても何も起きない。
+    struct Handle
+    {
+        std::uint32_t index = kNone;
+        std::uint32_t generation = 0;
+    };
+
+    /**
+     * @fn
+     * @brief コンストラクタ
+     * @param now 現在時刻（この時刻までのタイマーは発火済みとみなす）
+     */
+    explicit TimerWheel(Tick now = 0) : current_(now)
+    {
+        heads_.fill(kNone);
+        tails_.fill(kNone);
+    }
+
+    /**
+     * @fn
+     * @brief 期限 expiry のタイマーを登録する
+     * @note  expiry が現在時刻以前の場合は次の tick で発火する
+     */
+    Handle schedule(Tick expiry, T value)
+    {
+        std::uint32_t index;
+        if (!free_.empty())
+        {
+            index = free_.back();
+            free_.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& node = nodes_[index];
+        node.value = std::move(value);
+        node.expiry = expiry > current_ ? expiry : current_ + 1;
+        node.active = true;
+        place(index);
+        ++size_;
+        return {index, node.generation};
+    }
+
+    /**
+     * @fn
+     * @brief タイマーを取り消す
+     * @return 取り消した場合は true（発火・取り消し済みの場合は false）
+     */
+    bool cancel(Handle handle)
+    {
+        if (!valid(handle))
+        {
+            return false;
+        }
+        unlink(handle.index);
+        release(handle.index);
+        return true;
+    }
+
+    /**
+     * @fn
+     * @brief 時刻を now まで進め、期限が now 以前のタイマーを発火する
+     * @param now 現在時刻
+     * @param on_expire 発火したタイマーの値を受け取る関数 void(T&&)
+     */
+    template <typename Func>
+    void advance(Tick now, Func&& on_expire)
+    {
+        while (current_ < now)
+        {
+            ++current_;
+            if ((current_ & (kSlots - 1)) == 0)
+            {
+                cascade(1);
+            }
+            std::uint32_t index = detach(0, static_cast<unsigned>(current_ & (kSlots - 1)));
+            while (index != kNone)
+            {
+                const std::uint32_t next = nodes_[index].next;
+                T value = std::move(nodes_[index].value);
+                release(index);
+                on_expire(std::move(value));
+                index = next;
+            }
+        }
+    }
+
+    /**
+     * @fn
+     * @brief 最も早く発火するスロットからタイマーを 1 つ取り出す（容量超過時の追い出し用）
+     * @note  走査するのは高々 kLevels * kSlots スロット。スロット内では登録順に取り出すため、
+     *        レベル 1 以上では取り出すタイマーの期限は最早のものとスロット幅以内の誤差がある
+     *        （全タイマーの有効期間が同じなら、最も古く登録したものになる）。
+     * @param on_pop 取り出したタイマーの値を受け取る関数 void(T&&)
+     * @return タイマーがなかった場合は false
+     */
+    template <typename Func>
+    bool pop_earliest(Func&& on_pop)
+    {
+        for (unsigned level = 0; level < kLevels; ++level)
+        {
+            const Tick position = current_ >> (kSlotBits * level);
+            for (unsigned i = 1; i <= kSlots; ++i)
+            {
+                const unsigned slot = static_cast<unsigned>((position + i) & (kSlots - 1));
+                const std::uint32_t index = heads_[level * kSlots + slot];
+                if (index != kNone)
+                {
+                    unlink(index);
+                    T value = std::move(nodes_[index].value);
+                    release(index);
+                    on_pop(std::move(value));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    std::size_t size() const { return size_; }
+    Tick now() const { return current_; }
+
+   private:
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node
+    {
+        T value{};
+        Tick expiry = 0;
+        std::uint32_t prev = kNone;
+        std::uint32_t next = kNone;
+        std::uint32_t generation = 0;
+        std::uint16_t bucket = 0;  // level * kSlots + slot
+        bool active = false;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> free_;
+    std::array<std::uint32_t, kLevels * kSlots> heads_;
+    std::array<std::uint32_t, kLevels * kSlots> tails_;
+    Tick current_;
+    std::size_t size_ = 0;
+
+    bool valid(Handle handle) const
+    {
+        return handle.index < nodes_.size() && nodes_[handle.index].active &&
+               nodes_[handle.index].generation == handle.generation;
+    }
+
+    // 現在時刻との差からレベルとスロットを決めてリストの末尾につなぐ（スロット内は登録順）
+    void place(std::uint32_t index)
+    {
+        Node& node = nodes_[index];
+        const Tick delta = node.expiry > current_ ? node.expiry - current_ : 0;
+        unsigned level = 0;
+        while (level + 1 < kLevels && delta >= (Tick(1) << (kSlotBits * (level + 1))))
+        {
+            ++level;
+        }
+        Tick position = node.expiry >> (kSlotBits * level);
+        if (delta >= (Tick(1) << (kSlotBits * kLevels)))
+        {
+            // ホイールの範囲外: 最上位レベルの最遠スロットに置き、カスケード時に置き直す
+            position = (current_ >> (kSlotBits * level)) + kSlots - 1;
+        }
+        const unsigned bucket = level * kSlots + static_cast<unsigned>(position & (kSlots - 1));
+        node.bucket = static_cast<std::uint16_t>(bucket);
+        node.prev = tails_[bucket];
+        node.next = kNone;
+        if (node.prev != kNone)
+        {
+            nodes_[node.prev].next = index;
+        }
+        else
+        {
+            heads_[bucket] = index;
+        }
+        tails_[bucket] = index;
+    }
+
+    void unlink(std::uint32_t index)
+    {
+        Node& node = nodes_[index];
+        if (node.prev != kNone)
+        {
+            nodes_[node.prev].next = node.next;
+        }
+        else
+        {
+            heads_[node.bucket] = node.next;
+        }
+        if (node.next != kNone)
+        {
+            nodes_[node.next].prev = node.prev;
+        }
+        else
+        {
+            tails_[node.bucket] = node.prev;
+        }
+    }
+
+    void release(std::uint32_t index)
+    {
+        Node& node = nodes_[index];
+        node.value = T{};
+        node.active = false;
+        ++node.generation;
+        free_.push_back(index);
+        --size_;
+    }
+
+    // スロットのリストを丸ごと切り離し、先頭のノード番号を返す
+    std::uint32_t detach(unsigned level, unsigned slot)
+    {
+        const unsigned bucket = level * kSlots + slot;
+        const std::uint32_t head = heads_[bucket];
+        heads_[bucket] = kNone;
+        tails_[bucket] = kNone;
+        return head;
+    }
+
+    // 現在時刻が属するレベル level のスロットを下位レベルへ振り分ける（上位レベルも一周していれば先に振り分ける）
+    void cascade(unsigned level)
+    {
+        const unsigned slot = static_cast<unsigned>((current_ >> (kSlotBits * level)) & (kSlots - 1));
+        if (slot == 0 && level + 1 < kLevels)
+        {
+            cascade(level + 1);
+        }
+        std::uint32_t index = detach(level, slot);
+        while (index != kNone)
+        {
+            const std::uint32_t next = nodes_[index].next;
+            place(index);
+            index = next;
+        }
+    }
+};
+
+#endif  // TIMER_WHEEL_HPP
@@ -0,0 +1,116 @@
+#include "user_import.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace
+{
+// RegisterBatch に渡した 1 バッチ分の行
+struct ImportBatch
+{
+    RegisterBatchRequest request;
+    RegisterBatchResponse response;
+    // request.users(i) の行番号
+    std::vector<std::size_t> lines;
+    std::promise<grpc::Status> done;
+};
+
+void log_import_failure(std::size_t line, const std::string& user, const std::string& error)
+{
+    log_warn("import_failed", {{"line", line}, {"user", user}, {"error", error}});
+}
+
+// バッチの完了を待ち、行ごとの結果を集計する
+void collect(ImportBatch& batch, ImportSummary& summary)
+{
+    const grpc::Status status = batch.done.get_future().get();
+    for (int i = 0; i < batch.request.users_size(); ++i)
+    {
+        const bool ok = status.ok() && i < batch.response.results_size() && batch.response.results(i).code() == 0;
+        if (ok)
+        {
+            ++summary.registered;
+            continue;
+        }
+        ++summary.failed;
+        log_import_failure(batch.lines[i], batch.request.users(i).user(),
+                           status.ok() ? batch.response.results(i).message() : status.error_message());
+    }
+}
+}  // namespace
+
+std::optional<ImportSummary> import_users(AuthServiceImpl& service, const std::string& path, std::size_t batch_size)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    batch_size = std::max<std::size_t>(1, batch_size);
+
+    ImportSummary summary;
+    std::size_t line_number = 0;
+    std::string line;
+    // 登録中のバッチ（この間に次のバッチを読む）
+    std::unique_ptr<ImportBatch> in_flight;
+    while (file)
+    {
+        auto batch = std::make_unique<ImportBatch>();
+        batch->request.mutable_users()->Reserve(static_cast<int>(batch_size));
+        batch->lines.reserve(batch_size);
+        while (batch->lines.size() < batch_size && std::getline(file, line))
+        {
+            ++line_number;
+            std::istringstream fields(line);
+            std::string user;
+            std::string group_name;
+            std::string y1;
+            std::string y2;
+            if (!(fields >> user))
+            {
+                continue;  // 空行
+            }
+            ++summary.records;
+            const auto group = (fields >> group_name) ? parse_group_id(group_name) : std::nullopt;
+            if (!group || !(fields >> y1 >> y2))
+            {
+                ++summary.failed;
+                log_import_failure(line_number, user, "expected \"<user> <modp1024|p256> <y1_hex> <y2_hex>\"");
+                continue;
+            }
+            RegisterRequest* request = batch->request.add_users();
+            request->set_user(std::move(user));
+            request->set_group(static_cast<Group>(*group));
+            request->set_encoding(HEX);
+            request->set_y1(std::move(y1));
+            request->set_y2(std::move(y2));
+            batch->lines.push_back(line_number);
+        }
+        if (batch->lines.empty())
+        {
+            break;
+        }
+
+        ImportBatch* submitted = batch.get();
+        service.RegisterBatchAsync(&submitted->request, &submitted->response,
+                                   [submitted](grpc::Status status) { submitted->done.set_value(std::move(status)); });
+        if (in_flight)
+        {
+            collect(*in_flight, summary);
+        }
+        in_flight = std::move(batch);
+        log_info("import_progress", {{"lines", line_number}});
+    }
+    if (in_flight)
+    {
+        collect(*in_flight, summary);
+    }
+    return summary;
+}
@@ -0,0 +1,31 @@
+#ifndef USER_IMPORT_HPP
+#define USER_IMPORT_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "auth_service_impl.hpp"
+
+// import_users の集計
+struct ImportSummary
+{
+    // 空行を除く行数
+    std::size_t records = 0;
+    std::size_t registered = 0;
+    // 形式に合わない行、検査に失敗した行、登録済みのユーザーの行
+    std::size_t failed = 0;
+};
+
+/**
+ * @fn
+ * @brief ファイルのユーザーをまとめて登録する（zkp_server --import）
+ * @note  1 行に「ユーザー名 群 y1 y2」（群は modp1024 | p256、y1 / y2 は通信形式の HEX と同じ 16 進数）。
+ *        batch_size 行ずつ RegisterBatch と同じ処理（公開鍵の並列の検査と、ユーザーストアへのまとめての挿入）に
+ *        渡し、その間に次の batch_size 行を読む。失敗した行は行番号と理由をログに残し、他の行の登録は続ける。
+ * @return ファイルを開けない場合は std::nullopt
+ */
+std::optional<ImportSummary> import_users(AuthServiceImpl& service, const std::string& path,
+                                          std::size_t batch_size = 65536);
+
+#endif  // USER_IMPORT_HPP
@@ -0,0 +1,871 @@
+#include "user_store.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr char kSnapshotMagic[8] = {'Z', 'K', 'P', 'U', 'S', 'E', 'R', 'S'};
+// 2: 索引のハッシュを hash_user_name に変えた（1 のファイルはレコードだけを使い、索引は作り直す）
+constexpr std::uint32_t kFormatVersion = 2;
+constexpr std::uint32_t kRawFnvIndexVersion = 1;
+constexpr const char* kSnapshotFile = "users.snapshot";
+constexpr const char* kSnapshotTempFile = "users.snapshot.tmp";
+
+// スナップショットの先頭。続いて record_count 個のレコード、slot_count 個の索引（レコード番号 + 1、0 は空き）
+struct SnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_bytes;
+    std::uint64_t record_count;
+    std::uint64_t slot_count;      // 2 のべき乗
+    std::uint64_t log_generation;  // この世代までのログの内容を含む
+    std::uint8_t reserved[24];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader must keep its on-disk size");
+
+bool write_all(int fd, const void* data, std::size_t size)
+{
+    const auto* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = ::write(fd, p, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// rename や作成したファイルのディレクトリエントリを確定させる
+bool sync_directory(const fs::path& dir)
+{
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+fs::path log_path(const fs::path& dir, std::uint64_t generation)
+{
+    return dir / ("users." + std::to_string(generation) + ".log");
+}
+
+// "users.<世代>.log" の世代。ログファイルでない場合は std::nullopt
+std::optional<std::uint64_t> log_generation(const fs::path& path)
+{
+    const std::string name = path.filename().string();
+    constexpr std::string_view kPrefix = "users.";
+    constexpr std::string_view kSuffix = ".log";
+    if (name.size() <= kPrefix.size() + kSuffix.size() || name.compare(0, kPrefix.size(), kPrefix) != 0 ||
+        name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) != 0)
+    {
+        return std::nullopt;
+    }
+    const std::string digits = name.substr(kPrefix.size(), name.size() - kPrefix.size() - kSuffix.size());
+    if (!std::all_of(digits.begin(), digits.end(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+    {
+        return std::nullopt;
+    }
+    return std::stoull(digits);
+}
+
+/**
+ * @fn
+ * @brief スナップショットの索引を作る（slot_count は 2 のべき乗で count より大きい）
+ * @param record_at i 番目のレコードを返す
+ */
+template <typename RecordAt>
+std::vector<std::uint32_t> build_snapshot_index(RecordAt&& record_at, std::size_t count, std::size_t slot_count)
+{
+    std::vector<std::uint32_t> index(slot_count, 0);
+    const std::size_t mask = slot_count - 1;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::size_t slot = hash_user_name(record_at(i).name_view()) & mask;
+        while (index[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = static_cast<std::uint32_t>(i + 1);
+    }
+    return index;
+}
+
+std::size_t round_up_to_power_of_two(std::size_t n)
+{
+    std::size_t capacity = 1;
+    while (capacity < n)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+}  // namespace
+
+/**
+ * @brief mmap した読み取り専用のスナップショット
+ * @note  索引はユーザー名のハッシュ（hash_user_name）による線形探索のオープンアドレス法（負荷率 1/2 以下）。
+ *        形式 1 のファイルは索引のハッシュが異なるため、読み込み時に索引をメモリ上に作り直す。
+ */
+class UserStore::Snapshot
+{
+   public:
+    // path をマップする。ファイルがない場合は nullptr、形式が壊れている場合は std::runtime_error を投げる。
+    static std::unique_ptr<const Snapshot> open(const fs::path& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == ENOENT)
+            {
+                return nullptr;
+            }
+            throw std::runtime_error("cannot open user snapshot: " + path.string());
+        }
+        struct stat st = {};
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader))
+        {
+            ::close(fd);
+            throw std::runtime_error("corrupted user snapshot: " + path.string());
+        }
+        const auto bytes = static_cast<std::size_t>(st.st_size);
+        void* data = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("cannot map user snapshot: " + path.string());
+        }
+        // 確認は先頭から順に読み、以後の検索はランダムアクセスになるため先読みしない
+        ::madvise(data, bytes, MADV_SEQUENTIAL);
+        std::unique_ptr<Snapshot> snapshot(new Snapshot(data, bytes));
+        if (!snapshot->validate())
+        {
+            throw std::runtime_error("corrupted user snapshot: " + path.string());
+        }
+        ::madvise(data, bytes, MADV_RANDOM);
+        return snapshot;
+    }
+
+    ~Snapshot() { ::munmap(data_, bytes_); }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    const UserRecord* find(std::string_view name) const
+    {
+        const std::uint64_t mask = header_->slot_count - 1;
+        for (std::uint64_t slot = hash_user_name(name) & mask;; slot = (slot + 1) & mask)
+        {
+            const std::uint32_t entry = index_[slot];
+            if (entry == 0)
+            {
+                return nullptr;
+            }
+            const UserRecord& record = records_[entry - 1];
+            if (record.name_view() == name)
+            {
+                return &record;
+            }
+        }
+    }
+
+    std::size_t size() const { return static_cast<std::size_t>(header_->record_count); }
+    const UserRecord* records() const { return records_; }
+    std::uint64_t log_generation() const { return header_->log_generation; }
+    // 形式 1 のファイルを読み、索引をメモリ上に作り直した（現在の形式で書き直す必要がある）
+    bool index_rebuilt() const { return !rebuilt_index_.empty(); }
+
+   private:
+    void* data_;
+    std::size_t bytes_;
+    const SnapshotHeader* header_;
+    const UserRecord* records_;
+    const std::uint32_t* index_;
+    std::vector<std::uint32_t> rebuilt_index_;
+
+    Snapshot(void* data, std::size_t bytes)
+        : data_(data),
+          bytes_(bytes),
+          header_(static_cast<const SnapshotHeader*>(data)),
+          records_(reinterpret_cast<const UserRecord*>(static_cast<const char*>(data) + sizeof(SnapshotHeader))),
+          index_(nullptr)
+    {
+    }
+
+    /**
+     * @fn
+     * @brief ヘッダ、ファイルサイズ、全レコードのチェックサム、索引を確認し、索引の位置を決める
+     * @note  ヘッダの件数は信用せず、掛け算が溢れないようファイルサイズからの割り算で比べる。
+     *        索引の要素はレコードの範囲内で、使用中の要素はレコードと同じ数（空きがあるため探索は必ず止まる）。
+     */
+    bool validate()
+    {
+        const SnapshotHeader& h = *header_;
+        if (std::memcmp(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+            (h.version != kFormatVersion && h.version != kRawFnvIndexVersion) || h.record_bytes != sizeof(UserRecord) ||
+            h.slot_count == 0 || (h.slot_count & (h.slot_count - 1)) != 0 || h.record_count > h.slot_count / 2 ||
+            h.record_count >= std::numeric_limits<std::uint32_t>::max())
+        {
+            return false;
+        }
+        const std::size_t body = bytes_ - sizeof(SnapshotHeader);
+        if (h.record_count > body / sizeof(UserRecord))
+        {
+            return false;
+        }
+        const std::size_t index_bytes = body - h.record_count * sizeof(UserRecord);
+        if (index_bytes % sizeof(std::uint32_t) != 0 || index_bytes / sizeof(std::uint32_t) != h.slot_count)
+        {
+            return false;
+        }
+        for (std::uint64_t i = 0; i < h.record_count; ++i)
+        {
+            if (!valid_user_record(records_[i]))
+            {
+                return false;
+            }
+        }
+        index_ = reinterpret_cast<const std::uint32_t*>(records_ + h.record_count);
+        std::uint64_t used = 0;
+        for (std::uint64_t slot = 0; slot < h.slot_count; ++slot)
+        {
+            if (index_[slot] > h.record_count)
+            {
+                return false;
+            }
+            used += index_[slot] != 0 ? 1 : 0;
+        }
+        if (used != h.record_count)
+        {
+            return false;
+        }
+        if (h.version == kRawFnvIndexVersion)
+        {
+            rebuilt_index_ = build_snapshot_index([this](std::size_t i) -> const UserRecord& { return records_[i]; },
+                                                  h.record_count, h.slot_count);
+            index_ = rebuilt_index_.data();
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief 追記ログと group commit を行う書き込みスレッド
+ * @note  append はレコードを待ち行列に積むだけで戻る。書き込みスレッドは待ち行列をまとめて取り出し、
+ *        1 回の write と fdatasync で確定させてから各レコードの done を呼ぶ。fdatasync の間に届いた
+ *        レコードは次の 1 回にまとまるため、登録が集中するほど 1 件あたりの fdatasync は減る。
+ */
+class UserStore::Log
+{
+   public:
+    Log(const fs::path& dir, std::uint64_t generation) : dir_(dir), generation_(generation)
+    {
+        fd_ = open_log(generation_);
+        if (fd_ < 0 || !sync_directory(dir_))
+        {
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+            throw std::runtime_error("cannot open user log: " + log_path(dir_, generation_).string());
+        }
+        writer_ = std::thread([this] { writer_loop(); });
+    }
+
+    // 待ち行列に残ったレコードを書き込んでから止める
+    ~Log()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+        ::close(fd_);
+    }
+
+    void append(const UserRecord& record, std::function<void(bool)> done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!failed_)
+            {
+                pending_.push_back({record, std::move(done)});
+                cv_.notify_one();
+                return;
+            }
+        }
+        done(false);
+    }
+
+    /**
+     * @fn
+     * @brief 複数のレコードを追記する。全てが同じ write と fdatasync で確定し、確定後に done を 1 回呼ぶ。
+     */
+    void append_batch(const std::vector<UserRecord>& records, std::function<void(bool)> done)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!failed_)
+            {
+                // 書き込みスレッドは待ち行列をまとめて取り出すため、同じロックの間に積んだレコードは同じ回に書かれる
+                pending_.reserve(pending_.size() + records.size());
+                for (std::size_t i = 0; i < records.size(); ++i)
+                {
+                    pending_.push_back({records[i], i + 1 == records.size() ? std::move(done) : nullptr});
+                }
+                cv_.notify_one();
+                return;
+            }
+        }
+        done(false);
+    }
+
+    /**
+     * @fn
+     * @brief 次の世代のログに切り替える（呼び出し前に append したレコードは前の世代に確定する）
+     * @return 切り替える前の世代。書き込みに失敗している場合は std::nullopt
+     */
+    std::optional<std::uint64_t> rotate()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const std::uint64_t target = ++rotate_requests_;
+        cv_.notify_one();
+        rotated_cv_.wait(lock, [&] { return rotations_done_ >= target; });
+        return failed_ ? std::nullopt : std::optional<std::uint64_t>(rotated_from_);
+    }
+
+   private:
+    struct Pending
+    {
+        UserRecord record;
+        // append_batch のレコードは最後の 1 件だけが持つ
+        std::function<void(bool)> done;
+    };
+
+    const fs::path dir_;
+    // 書き込みスレッドだけが使う
+    std::uint64_t generation_;
+    int fd_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable rotated_cv_;
+    std::vector<Pending> pending_;
+    std::uint64_t rotate_requests_ = 0;
+    std::uint64_t rotations_done_ = 0;
+    std::uint64_t rotated_from_ = 0;
+    bool failed_ = false;
+    bool stopping_ = false;
+    std::thread writer_;
+
+    int open_log(std::uint64_t generation) const
+    {
+        return ::open(log_path(dir_, generation).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    // 新しい世代のファイルを作ってから古いファイルを閉じる
+    bool switch_generation()
+    {
+        const int fd = open_log(generation_ + 1);
+        if (fd < 0 || !sync_directory(dir_))
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return false;
+        }
+        ::close(fd_);
+        fd_ = fd;
+        ++generation_;
+        return true;
+    }
+
+    void writer_loop()
+    {
+        std::vector<Pending> batch;
+        std::vector<UserRecord> records;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty() || rotate_requests_ != rotations_done_; });
+            if (stopping_ && pending_.empty() && rotate_requests_ == rotations_done_)
+            {
+                return;
+            }
+            batch.swap(pending_);
+            const std::uint64_t rotate_target = rotate_requests_;
+            bool ok = !failed_;
+            lock.unlock();
+
+            if (ok && !batch.empty())
+            {
+                records.clear();
+                for (const Pending& pending : batch)
+                {
+                    records.push_back(pending.record);
+                }
+                ok = write_all(fd_, records.data(), records.size() * sizeof(UserRecord)) && ::fdatasync(fd_) == 0;
+            }
+            const std::uint64_t previous_generation = generation_;
+            const bool rotate = rotate_target != rotations_done_;
+            if (ok && rotate)
+            {
+                ok = switch_generation();
+            }
+            if (!ok)
+            {
+                log_error("user_log_write_failed",
+                          {{"generation", previous_generation}, {"error", std::strerror(errno)}});
+            }
+            for (Pending& pending : batch)
+            {
+                if (pending.done)
+                {
+                    pending.done(ok);
+                }
+            }
+            batch.clear();
+
+            lock.lock();
+            failed_ = failed_ || !ok;
+            if (rotate)
+            {
+                rotated_from_ = previous_generation;
+                rotations_done_ = rotate_target;
+                rotated_cv_.notify_all();
+            }
+        }
+    }
+};
+
+UserStore::UserStore(const UserStoreOptions& options) : options_(options)
+{
+    if (options_.data_dir.empty())
+    {
+        return;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    const fs::path dir(options_.data_dir);
+    std::error_code error;
+    fs::create_directories(dir, error);
+    if (error)
+    {
+        throw std::runtime_error("cannot create user store directory: " + dir.string());
+    }
+    fs::remove(dir / kSnapshotTempFile, error);
+
+    snapshot_ = Snapshot::open(dir / kSnapshotFile);
+    const std::uint64_t snapshot_generation = snapshot_ ? snapshot_->log_generation() : 0;
+
+    std::vector<std::uint64_t> generations;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir))
+    {
+        if (const auto generation = log_generation(entry.path()))
+        {
+            generations.push_back(*generation);
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+
+    // スナップショットより新しい世代のログを順に読み直す（末尾の書きかけのレコードは捨てる）
+    std::size_t replayed = 0;
+    std::uint64_t last_generation = snapshot_generation;
+    for (const std::uint64_t generation : generations)
+    {
+        last_generation = std::max(last_generation, generation);
+        const fs::path path = log_path(dir, generation);
+        if (generation <= snapshot_generation)
+        {
+            // スナップショットを置き換えた後、消す前に終了した場合の残り
+            fs::remove(path, error);
+            continue;
+        }
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot open user log: " + path.string());
+        }
+        std::vector<UserRecord> chunk(4096);
+        std::size_t buffered = 0;  // chunk に読み込んだバイト数
+        bool truncated = false;
+        while (!truncated)
+        {
+            const ssize_t n = ::read(fd, reinterpret_cast<char*>(chunk.data()) + buffered,
+                                     chunk.size() * sizeof(UserRecord) - buffered);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                truncated = buffered != 0;
+                break;
+            }
+            buffered += static_cast<std::size_t>(n);
+            const std::size_t complete = buffered / sizeof(UserRecord);
+            for (std::size_t i = 0; i < complete && !truncated; ++i)
+            {
+                const UserRecord& record = chunk[i];
+                if (!valid_user_record(record))
+                {
+                    truncated = true;
+                    break;
+                }
+                if (snapshot_ == nullptr || snapshot_->find(record.name_view()) == nullptr)
+                {
+                    users_.insert(record.name_view(), user_keys(record), true);
+                }
+                ++replayed;
+            }
+            const std::size_t rest = buffered - complete * sizeof(UserRecord);
+            std::memmove(chunk.data(), reinterpret_cast<char*>(chunk.data()) + complete * sizeof(UserRecord), rest);
+            buffered = rest;
+        }
+        ::close(fd);
+        if (truncated)
+        {
+            log_warn("user_log_truncated", {{"path", path.string()}, {"records", replayed}});
+        }
+    }
+    unsnapshotted_.store(replayed, std::memory_order_relaxed);
+
+    // 読み直したログには追記せず、新しい世代から書き始める
+    log_ = std::make_unique<Log>(dir, last_generation + 1);
+    if (snapshot_ && snapshot_->index_rebuilt())
+    {
+        // 古い形式のスナップショットを今の形式で書き直す（失敗した場合は次の起動でも索引を作り直す）
+        log_warn("user_snapshot_upgraded",
+                 {{"path", (dir / kSnapshotFile).string()}, {"from_version", kRawFnvIndexVersion}});
+        write_snapshot();
+    }
+    snapshot_thread_ = std::thread([this] { snapshot_loop(); });
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started);
+    log_info("user_store_loaded", {{"dir", options_.data_dir},
+                                   {"snapshot_users", snapshot_ ? snapshot_->size() : std::size_t(0)},
+                                   {"log_records", replayed},
+                                   {"elapsed_ms", elapsed.count()}});
+}
+
+UserStore::~UserStore()
+{
+    if (snapshot_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(snapshot_mutex_);
+            stopping_ = true;
+        }
+        snapshot_cv_.notify_all();
+        snapshot_thread_.join();
+    }
+    // 書き込み待ちの登録を確定させてから止める（完了通知は users_ を参照する）
+    log_.reset();
+}
+
+std::optional<UserInfo> UserStore::find(const std::string& name) const
+{
+    if (snapshot_ != nullptr)
+    {
+        if (const UserRecord* record = snapshot_->find(name))
+        {
+            return to_user_info(*record);
+        }
+    }
+    std::optional<UserInfo> user;
+    users_.visit(name, [&](std::string_view found, const UserKeys& keys) { user = to_user_info(found, keys); });
+    return user;
+}
+
+std::optional<GroupId> UserStore::find_group(const std::string& name) const
+{
+    if (snapshot_ != nullptr)
+    {
+        if (const UserRecord* record = snapshot_->find(name))
+        {
+            return static_cast<GroupId>(record->group);
+        }
+    }
+    std::optional<GroupId> group;
+    users_.visit(name, [&](std::string_view, const UserKeys& keys) { group = static_cast<GroupId>(keys.group); });
+    return group;
+}
+
+void UserStore::insert(UserInfo user, std::function<void(UserInsertResult)> done)
+{
+    const std::optional<UserKeys> keys = make_user_keys(user);
+    // ファイルに書く場合だけ、ユーザー名が固定長のレコードに収まる必要がある
+    const std::optional<UserRecord> record = keys && log_ ? make_user_record(user.name, *keys) : std::nullopt;
+    if (!keys || (log_ != nullptr && !record))
+    {
+        done(UserInsertResult::kTooLarge);
+        return;
+    }
+    if (snapshot_ != nullptr && snapshot_->find(user.name) != nullptr)
+    {
+        done(UserInsertResult::kAlreadyExists);
+        return;
+    }
+    // 先にメモリ上の表に入れてユーザー名を確保する（同じ名前の同時登録は 1 つだけがログに書かれる）
+    if (!users_.insert(user.name, *keys))
+    {
+        done(UserInsertResult::kAlreadyExists);
+        return;
+    }
+    if (log_ == nullptr)
+    {
+        done(UserInsertResult::kInserted);
+        return;
+    }
+    log_->append(*record,
+                 [this, name = std::move(user.name), done = std::move(done)](bool ok)
+                 {
+                     if (!ok)
+                     {
+                         users_.erase(name);
+                         done(UserInsertResult::kStorageFailed);
+                         return;
+                     }
+                     users_.mark_durable(name);
+                     count_unsnapshotted(1);
+                     done(UserInsertResult::kInserted);
+                 });
+}
+
+UserInsertResult UserStore::insert(UserInfo user)
+{
+    std::promise<UserInsertResult> promise;
+    std::future<UserInsertResult> result = promise.get_future();
+    insert(std::move(user), [&promise](UserInsertResult r) { promise.set_value(r); });
+    return result.get();
+}
+
+void UserStore::insert_batch(std::vector<UserInfo> users,
+                             std::function<void(std::vector<UserInsertResult>)> done)
+{
+    std::vector<UserInsertResult> results(users.size(), UserInsertResult::kTooLarge);
+    // 表に入れるユーザーと、その users での位置
+    std::vector<UserTable::Item> items;
+    std::vector<std::size_t> positions;
+    items.reserve(users.size());
+    positions.reserve(users.size());
+    for (std::size_t i = 0; i < users.size(); ++i)
+    {
+        const std::optional<UserKeys> keys = make_user_keys(users[i]);
+        if (!keys || (log_ != nullptr && users[i].name.size() > kMaxNameBytes))
+        {
+            continue;
+        }
+        if (snapshot_ != nullptr && snapshot_->find(users[i].name) != nullptr)
+        {
+            results[i] = UserInsertResult::kAlreadyExists;
+            continue;
+        }
+        items.push_back({users[i].name, *keys});
+        positions.push_back(i);
+    }
+
+    std::vector<bool> inserted;
+    users_.insert_batch(items, inserted);
+    // ログには挿入できたユーザーだけを書く
+    std::vector<UserRecord> written;
+    std::vector<std::string> names;
+    if (log_ != nullptr)
+    {
+        written.reserve(items.size());
+    }
+    for (std::size_t j = 0; j < items.size(); ++j)
+    {
+        results[positions[j]] = inserted[j] ? UserInsertResult::kInserted : UserInsertResult::kAlreadyExists;
+        if (inserted[j] && log_ != nullptr)
+        {
+            written.push_back(*make_user_record(items[j].name, items[j].keys));
+            names.push_back(std::move(users[positions[j]].name));
+        }
+    }
+    if (log_ == nullptr || written.empty())
+    {
+        done(std::move(results));
+        return;
+    }
+    const std::size_t count = written.size();
+    log_->append_batch(written,
+                       [this, count, names = std::move(names), results = std::move(results),
+                        done = std::move(done)](bool ok) mutable
+                       {
+                           if (!ok)
+                           {
+                               for (const std::string& name : names)
+                               {
+                                   users_.erase(name);
+                               }
+                               for (UserInsertResult& result : results)
+                               {
+                                   if (result == UserInsertResult::kInserted)
+                                   {
+                                       result = UserInsertResult::kStorageFailed;
+                                   }
+                               }
+                               done(std::move(results));
+                               return;
+                           }
+                           for (const std::string& name : names)
+                           {
+                               users_.mark_durable(name);
+                           }
+                           count_unsnapshotted(count);
+                           done(std::move(results));
+                       });
+}
+
+std::vector<UserInsertResult> UserStore::insert_batch(std::vector<UserInfo> users)
+{
+    std::promise<std::vector<UserInsertResult>> promise;
+    std::future<std::vector<UserInsertResult>> results = promise.get_future();
+    insert_batch(std::move(users), [&promise](std::vector<UserInsertResult> r) { promise.set_value(std::move(r)); });
+    return results.get();
+}
+
+void UserStore::count_unsnapshotted(std::size_t count)
+{
+    const std::size_t before = unsnapshotted_.fetch_add(count, std::memory_order_relaxed);
+    if (before < options_.snapshot_records && before + count >= options_.snapshot_records)
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        snapshot_cv_.notify_all();
+    }
+}
+
+std::size_t UserStore::size() const { return (snapshot_ ? snapshot_->size() : 0) + users_.size(); }
+
+bool UserStore::write_snapshot()
+{
+    if (log_ == nullptr)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    const auto started = std::chrono::steady_clock::now();
+    const std::size_t unsnapshotted = unsnapshotted_.load(std::memory_order_relaxed);
+
+    // 切り替え前の世代までのログのレコードは、すべてメモリ上の表に入っていて確定済みになっている
+    const std::optional<std::uint64_t> generation = log_->rotate();
+    if (!generation)
+    {
+        return false;
+    }
+    // 確定していない登録（次の世代のログに書かれる）は、書き込みに失敗すると取り消されるため含めない
+    std::vector<UserRecord> added;
+    users_.for_each_durable([&](std::string_view name, const UserKeys& keys)
+                            { added.push_back(*make_user_record(name, keys)); });
+
+    const std::size_t base = snapshot_ ? snapshot_->size() : 0;
+    const std::size_t count = base + added.size();
+    const std::vector<std::uint32_t> index = build_snapshot_index(
+        [&](std::size_t i) -> const UserRecord& { return i < base ? snapshot_->records()[i] : added[i - base]; },
+        count, round_up_to_power_of_two(std::max<std::size_t>(1, count * 2)));
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.version = kFormatVersion;
+    header.record_bytes = sizeof(UserRecord);
+    header.record_count = count;
+    header.slot_count = index.size();
+    header.log_generation = *generation;
+
+    const fs::path dir(options_.data_dir);
+    const fs::path temp_path = dir / kSnapshotTempFile;
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && write_all(fd, &header, sizeof(header)) &&
+              (base == 0 || write_all(fd, snapshot_->records(), base * sizeof(UserRecord))) &&
+              write_all(fd, added.data(), added.size() * sizeof(UserRecord)) &&
+              write_all(fd, index.data(), index.size() * sizeof(std::uint32_t)) && ::fdatasync(fd) == 0;
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    ok = ok && ::rename(temp_path.c_str(), (dir / kSnapshotFile).c_str()) == 0 && sync_directory(dir);
+    if (!ok)
+    {
+        log_error("user_snapshot_failed", {{"path", temp_path.string()}, {"error", std::strerror(errno)}});
+        return false;
+    }
+
+    // 取り込んだ世代までのログは不要になる
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir, error))
+    {
+        const auto log = log_generation(entry.path());
+        if (log && *log <= *generation)
+        {
+            fs::remove(entry.path(), error);
+        }
+    }
+    unsnapshotted_.fetch_sub(unsnapshotted, std::memory_order_relaxed);
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started);
+    log_info("user_snapshot_written",
+             {{"users", count}, {"log_generation", *generation}, {"elapsed_ms", elapsed.count()}});
+    return true;
+}
+
+void UserStore::snapshot_loop()
+{
+    std::unique_lock<std::mutex> lock(snapshot_mutex_);
+    while (true)
+    {
+        snapshot_cv_.wait_for(lock, options_.snapshot_interval,
+                              [this]
+                              {
+                                  return stopping_ || (options_.snapshot_records != 0 &&
+                                                       unsnapshotted_.load(std::memory_order_relaxed) >=
+                                                           options_.snapshot_records);
+                              });
+        if (stopping_)
+        {
+            return;
+        }
+        if (unsnapshotted_.load(std::memory_order_relaxed) == 0)
+        {
+            continue;
+        }
+        lock.unlock();
+        const bool ok = write_snapshot();
+        lock.lock();
+        if (!ok)
+        {
+            // 失敗した場合は次の間隔まで待つ
+            snapshot_cv_.wait_for(lock, options_.snapshot_interval, [this] { return stopping_; });
+        }
+    }
+}
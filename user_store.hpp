@@ -0,0 +1,160 @@
+#ifndef USER_STORE_HPP
+#define USER_STORE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lock_stats.hpp"
+#include "user_table.hpp"
+#include "zkp_group.hpp"
+
+// UserStore::insert の結果
+enum class UserInsertResult
+{
+    kInserted,
+    kAlreadyExists,
+    kTooLarge,       // 公開鍵が kUserKeyBytes に収まらない、または永続化する場合にユーザー名がレコードに収まらない
+    kStorageFailed,  // ログへの書き込みに失敗した（以後の登録もすべて失敗する）
+};
+
+// UserStore の設定
+struct UserStoreOptions
+{
+    // 永続化先のディレクトリ（なければ作る）。空の場合はメモリ上だけに保持し、再起動で失われる。
+    std::string data_dir;
+    // 前回のスナップショット以降に登録があれば、この間隔でスナップショットを作る
+    std::chrono::milliseconds snapshot_interval{60000};
+    // 前回のスナップショット以降の登録がこの件数に達したら、間隔を待たずにスナップショットを作る
+    std::size_t snapshot_records = 100000;
+};
+
+/**
+ * @brief ユーザー名 -> ユーザー情報のストア（data_dir を指定した場合は永続化する）
+ * @note  永続化する場合、ディレクトリには次の 2 種類のファイルを置く。
+ *        - users.<世代>.log：登録の追記ログ（UserRecord の列）。書き込みは専用スレッドがまとめて行い、
+ *          1 回の write と fdatasync で溜まった登録をすべて確定させる（group commit）。登録の完了は
+ *          fdatasync の後に通知する。
+ *        - users.snapshot：UserRecord の配列と、ユーザー名のハッシュによるオープンアドレス法の索引。
+ *          起動時は mmap してチェックサムと索引を 1 回確認するだけでメモリには読み込まず、
+ *          検索はマップしたレコードから直接 y1 / y2 を読む。
+ *        起動時はスナップショットをマップし、スナップショットより新しい世代のログだけを読み直す。
+ *        スナップショットは専用スレッドが定期的に作り直す（ログを次の世代に切り替えてから、
+ *        マップ中のスナップショットとメモリ上の書き込みが確定したユーザーを書き出し、rename で置き換えて古いログを消す）。
+ *        メモリ上（UserTable）に持つのは起動後に登録したユーザーとログから読み直したユーザーだけ。
+ */
+class UserStore
+{
+   public:
+    // 永続化する場合に登録できるユーザー名のバイト数（メモリ上だけの場合は上限なし）
+    static constexpr std::size_t kMaxNameBytes = kUserNameBytes;
+
+    /**
+     * @fn
+     * @brief コンストラクタ。永続化する場合はスナップショットをマップしてログを読み直す。
+     * @note  ディレクトリやファイルを開けない場合、スナップショットが壊れている場合は std::runtime_error を投げる。
+     */
+    explicit UserStore(const UserStoreOptions& options = {});
+    ~UserStore();
+
+    UserStore(const UserStore&) = delete;
+    UserStore& operator=(const UserStore&) = delete;
+
+    /**
+     * @fn
+     * @brief ユーザー情報のコピーを取得する
+     * @return 存在しない場合は std::nullopt
+     */
+    std::optional<UserInfo> find(const std::string& name) const;
+
+    /**
+     * @fn
+     * @brief ユーザーの群だけを取得する（公開鍵を整数に変換しない）
+     */
+    std::optional<GroupId> find_group(const std::string& name) const;
+
+    /**
+     * @fn
+     * @brief ユーザーが存在しない場合のみ登録する。永続化する場合はログへの書き込みが確定してから done を呼ぶ。
+     * @note  done はログの書き込みスレッド、または呼び出し元のスレッドで呼ばれる。
+     *        登録したユーザーは確定を待たずに検索できる（確定前に異常終了した場合は失われる）。
+     */
+    void insert(UserInfo user, std::function<void(UserInsertResult)> done);
+
+    /**
+     * @fn
+     * @brief insert の同期版（書き込みが確定するまで待つ）
+     */
+    UserInsertResult insert(UserInfo user);
+
+    /**
+     * @fn
+     * @brief 複数のユーザーをまとめて登録する（それぞれ存在しない場合のみ）。永続化する場合は
+     *        全てのレコードを 1 回の書き込みでログに追記し、確定してから done を呼ぶ。
+     * @note  メモリ上の表にはシャードごとに 1 回のロックで挿入する。users 内で名前が重なる場合は先のものを登録する。
+     *        done はログの書き込みスレッド、または呼び出し元のスレッドで呼ばれる。
+     * @param done users と同じ順の結果
+     */
+    void insert_batch(std::vector<UserInfo> users, std::function<void(std::vector<UserInsertResult>)> done);
+
+    /**
+     * @fn
+     * @brief insert_batch の同期版（書き込みが確定するまで待つ）
+     */
+    std::vector<UserInsertResult> insert_batch(std::vector<UserInfo> users);
+
+    /**
+     * @fn
+     * @brief スナップショットを作り直し、取り込んだ世代のログを消す（通常は専用スレッドが定期的に呼ぶ）
+     * @return 永続化しない場合、書き込みに失敗した場合は false
+     */
+    bool write_snapshot();
+
+    // 登録済みのユーザー数
+    std::size_t size() const;
+
+    // メモリ上の表のロック待ちの累計
+    LockWaitCounters lock_wait() const { return users_.lock_wait(); }
+
+    // メモリ上の表が使うバイト数（マップしたスナップショットを除く）
+    std::size_t memory_bytes() const { return users_.memory_bytes(); }
+
+    bool persistent() const { return log_ != nullptr; }
+
+   private:
+    class Snapshot;
+    class Log;
+
+    const UserStoreOptions options_;
+    // 起動時にマップしたスナップショット（読み取り専用、なければ nullptr）
+    std::unique_ptr<const Snapshot> snapshot_;
+    // スナップショットにないユーザー。登録後は参照のみのため、検索は共有ロックで並行に行える。
+    UserTable users_;
+    std::unique_ptr<Log> log_;
+    // 前回のスナップショット以降にログへ書き込んだ（または起動時に読み直した）レコード数
+    std::atomic<std::size_t> unsnapshotted_{0};
+
+    // write_snapshot を同時に 1 つだけ実行する
+    std::mutex write_mutex_;
+    // スナップショットを作るスレッド
+    std::mutex snapshot_mutex_;
+    std::condition_variable snapshot_cv_;
+    bool stopping_ = false;
+    std::thread snapshot_thread_;
+
+    void snapshot_loop();
+
+    // ログに確定した count 件を数え、件数でスナップショットを作る場合は作成を促す
+    void count_unsnapshotted(std::size_t count);
+};
+
+#endif  // USER_STORE_HPP
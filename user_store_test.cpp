@@ -0,0 +1,461 @@
+#include "user_store.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using boost::multiprecision::cpp_int;
+
+namespace
+{
+// テストごとのデータディレクトリ（破棄時に削除する）
+class TempDataDir
+{
+   public:
+    explicit TempDataDir(const std::string& name) : path_(testing::TempDir() + name) { fs::remove_all(path_); }
+    ~TempDataDir() { fs::remove_all(path_); }
+
+    const std::string& path() const { return path_; }
+
+    std::vector<std::string> files() const
+    {
+        std::vector<std::string> out;
+        for (const fs::directory_entry& entry : fs::directory_iterator(path_))
+        {
+            out.push_back(entry.path().filename().string());
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+   private:
+    std::string path_;
+};
+
+UserInfo make_user(const std::string& name, int i)
+{
+    // 1024 ビットの値と P-256 の点の大きさの値を混ぜる
+    const cpp_int base = i % 2 == 0 ? (cpp_int(1) << 1023) : (cpp_int(4) << 512);
+    const GroupId group = i % 2 == 0 ? GroupId::kModp1024 : GroupId::kP256;
+    return {.name = name, .group = group, .y1 = base + i, .y2 = base * 3 / 4 + i};
+}
+
+void expect_user(const UserStore& store, const std::string& name, int i)
+{
+    const auto user = store.find(name);
+    ASSERT_TRUE(user) << name;
+    const UserInfo expected = make_user(name, i);
+    EXPECT_EQ(user->name, expected.name);
+    EXPECT_EQ(user->group, expected.group);
+    EXPECT_EQ(user->y1, expected.y1);
+    EXPECT_EQ(user->y2, expected.y2);
+    EXPECT_EQ(store.find_group(name), expected.group);
+}
+
+std::optional<UserInfo> find_in(const UserTable& table, std::string_view name)
+{
+    std::optional<UserInfo> user;
+    table.visit(name, [&](std::string_view found, const UserKeys& keys) { user = to_user_info(found, keys); });
+    return user;
+}
+}  // namespace
+
+TEST(UserTableTest, FindsRecordsAcrossGrowthAndErase)
+{
+    UserTable table;
+    constexpr int kUsers = 20000;
+    for (int i = 0; i < kUsers; ++i)
+    {
+        const UserInfo user = make_user("user" + std::to_string(i), i);
+        ASSERT_TRUE(table.insert(user.name, *make_user_keys(user)));
+    }
+    EXPECT_FALSE(table.insert("user7", *make_user_keys(make_user("user7", 8))));
+    EXPECT_EQ(table.size(), std::size_t(kUsers));
+
+    // 削除した名前は見つからず、同じ名前で再び挿入できる
+    EXPECT_TRUE(table.erase("user100"));
+    EXPECT_FALSE(table.erase("user100"));
+    EXPECT_FALSE(table.visit("user100", [](std::string_view, const UserKeys&) {}));
+    EXPECT_TRUE(table.insert("user100", *make_user_keys(make_user("user100", 100))));
+
+    for (int i = 0; i < kUsers; ++i)
+    {
+        const std::string name = "user" + std::to_string(i);
+        const std::optional<UserInfo> found = find_in(table, name);
+        ASSERT_TRUE(found) << name;
+        const UserInfo expected = make_user(name, i);
+        EXPECT_EQ(found->name, name);
+        EXPECT_EQ(found->group, expected.group);
+        EXPECT_EQ(found->y1, expected.y1);
+        EXPECT_EQ(found->y2, expected.y2);
+    }
+
+    std::size_t visited = 0;
+    table.for_each([&](std::string_view, const UserKeys&) { ++visited; });
+    EXPECT_EQ(visited, std::size_t(kUsers));
+
+    // 1 ユーザーあたりのメモリはエントリ、名前（文字列領域は最大 2 倍）と索引、シャードごとの確保単位の端数だけ
+    const std::size_t slack = UserTable::kShards * UserTable::kChunkRecords * sizeof(UserKeys);
+    EXPECT_LT(table.memory_bytes(), kUsers * (sizeof(UserKeys) + 16 + 2 * 9 + 32) + slack);
+}
+TEST(UserTableTest, ForEachDurableSkipsUnconfirmedUsers)
+{
+    UserTable table;
+    const UserKeys keys = *make_user_keys(make_user("alice", 0));
+    ASSERT_TRUE(table.insert("alice", keys, true));
+    ASSERT_TRUE(table.insert("bob", keys));
+    ASSERT_TRUE(table.insert("carol", keys));
+    EXPECT_TRUE(table.mark_durable("carol"));
+    EXPECT_FALSE(table.mark_durable("dave"));
+
+    const auto names = [&](bool durable_only)
+    {
+        std::vector<std::string> out;
+        const auto add = [&](std::string_view name, const UserKeys&) { out.emplace_back(name); };
+        durable_only ? table.for_each_durable(add) : table.for_each(add);
+        std::sort(out.begin(), out.end());
+        return out;
+    };
+    EXPECT_EQ(names(false), (std::vector<std::string>{"alice", "bob", "carol"}));
+    EXPECT_EQ(names(true), (std::vector<std::string>{"alice", "carol"}));
+    // 書き込みに失敗して取り消したユーザー
+    EXPECT_TRUE(table.erase("carol"));
+    EXPECT_EQ(names(true), (std::vector<std::string>{"alice"}));
+}
+
+TEST(UserTableTest, BatchInsertSkipsExistingAndRepeatedNames)
+{
+    UserTable table;
+    ASSERT_TRUE(table.insert("user5", *make_user_keys(make_user("user5", 5))));
+    std::vector<std::string> names;
+    for (int i = 0; i < 5000; ++i)
+    {
+        names.push_back("user" + std::to_string(i));
+    }
+    names.push_back("user7");
+    std::vector<UserTable::Item> items;
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        // バッチ内で重なる名前は先のものが入る
+        items.push_back({names[i], *make_user_keys(make_user(names[i], i < 5000 ? static_cast<int>(i) : 8))});
+    }
+
+    std::vector<bool> inserted;
+    EXPECT_EQ(table.insert_batch(items, inserted), 4999u);
+    ASSERT_EQ(inserted.size(), items.size());
+    EXPECT_FALSE(inserted[5]);
+    EXPECT_TRUE(inserted[7]);
+    EXPECT_FALSE(inserted.back());
+    EXPECT_EQ(table.size(), 5000u);
+    for (int i = 0; i < 5000; ++i)
+    {
+        const std::string name = "user" + std::to_string(i);
+        const std::optional<UserInfo> found = find_in(table, name);
+        ASSERT_TRUE(found) << name;
+        EXPECT_EQ(found->y1, make_user(name, i).y1);
+    }
+}
+
+TEST(UserStoreTest, InMemoryStoreRejectsDuplicates)
+{
+    UserStore store;
+    EXPECT_FALSE(store.persistent());
+    EXPECT_EQ(store.insert(make_user("alice", 0)), UserInsertResult::kInserted);
+    EXPECT_EQ(store.insert(make_user("alice", 1)), UserInsertResult::kAlreadyExists);
+    // メモリ上だけの場合、ユーザー名はファイルのレコードの上限より長くてよい
+    const std::string long_name = std::string(300, 'x') + "@example.com";
+    EXPECT_EQ(store.insert(make_user(long_name, 2)), UserInsertResult::kInserted);
+    EXPECT_EQ(store.insert(make_user(long_name, 3)), UserInsertResult::kAlreadyExists);
+    EXPECT_EQ(store.insert(make_user("", 3)), UserInsertResult::kTooLarge);
+    expect_user(store, "alice", 0);
+    expect_user(store, long_name, 2);
+    EXPECT_FALSE(store.find("bob"));
+    EXPECT_FALSE(store.find_group("bob"));
+    EXPECT_EQ(store.size(), 2u);
+    EXPECT_FALSE(store.write_snapshot());
+}
+
+TEST(UserStoreTest, RecoversRegistrationsFromLogAndSnapshot)
+{
+    TempDataDir dir("user_store_recovery");
+    const UserStoreOptions options = {.data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1)};
+    {
+        UserStore store(options);
+        EXPECT_TRUE(store.persistent());
+        for (int i = 0; i < 10; ++i)
+        {
+            EXPECT_EQ(store.insert(make_user("user" + std::to_string(i), i)), UserInsertResult::kInserted);
+        }
+        EXPECT_EQ(store.insert(make_user(std::string(UserStore::kMaxNameBytes + 1, 'x'), 0)),
+                  UserInsertResult::kTooLarge);
+    }
+    {
+        // ログだけから復元する
+        UserStore store(options);
+        EXPECT_EQ(store.size(), 10u);
+        expect_user(store, "user3", 3);
+        EXPECT_EQ(store.insert(make_user("user3", 4)), UserInsertResult::kAlreadyExists);
+
+        // スナップショットに取り込んだ世代のログは消える
+        EXPECT_TRUE(store.write_snapshot());
+        EXPECT_EQ(dir.files(), (std::vector<std::string>{"users.3.log", "users.snapshot"}));
+        for (int i = 10; i < 15; ++i)
+        {
+            EXPECT_EQ(store.insert(make_user("user" + std::to_string(i), i)), UserInsertResult::kInserted);
+        }
+    }
+    {
+        // スナップショットとその後のログから復元する
+        UserStore store(options);
+        EXPECT_EQ(store.size(), 15u);
+        for (int i = 0; i < 15; ++i)
+        {
+            expect_user(store, "user" + std::to_string(i), i);
+        }
+        EXPECT_EQ(store.insert(make_user("user0", 1)), UserInsertResult::kAlreadyExists);
+        EXPECT_FALSE(store.find("user15"));
+
+        // スナップショットのユーザーとメモリ上のユーザーをまとめて書き直す
+        EXPECT_TRUE(store.write_snapshot());
+    }
+    UserStore store(options);
+    EXPECT_EQ(store.size(), 15u);
+    expect_user(store, "user14", 14);
+}
+
+TEST(UserStoreTest, BatchRegistrationReportsEachUserAndIsDurable)
+{
+    TempDataDir dir("user_store_batch");
+    const UserStoreOptions options = {.data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1)};
+    {
+        UserStore store(options);
+        EXPECT_EQ(store.insert(make_user("user1", 1)), UserInsertResult::kInserted);
+        std::vector<UserInfo> users;
+        for (int i = 0; i < 100; ++i)
+        {
+            users.push_back(make_user("user" + std::to_string(i), i));
+        }
+        users.push_back(make_user(std::string(UserStore::kMaxNameBytes + 1, 'x'), 0));
+        users.push_back(make_user("user2", 3));
+
+        const std::vector<UserInsertResult> results = store.insert_batch(users);
+        ASSERT_EQ(results.size(), users.size());
+        EXPECT_EQ(results[0], UserInsertResult::kInserted);
+        EXPECT_EQ(results[1], UserInsertResult::kAlreadyExists);
+        EXPECT_EQ(results[99], UserInsertResult::kInserted);
+        EXPECT_EQ(results[100], UserInsertResult::kTooLarge);
+        EXPECT_EQ(results[101], UserInsertResult::kAlreadyExists);
+        EXPECT_EQ(store.size(), 100u);
+        EXPECT_TRUE(store.write_snapshot());
+
+        // スナップショットにあるユーザーも登録済みとして扱う
+        EXPECT_EQ(store.insert_batch({make_user("user50", 0), make_user("user100", 100)}),
+                  (std::vector<UserInsertResult>{UserInsertResult::kAlreadyExists, UserInsertResult::kInserted}));
+    }
+    UserStore store(options);
+    EXPECT_EQ(store.size(), 101u);
+    expect_user(store, "user2", 2);
+    expect_user(store, "user100", 100);
+}
+
+TEST(UserStoreTest, IgnoresTornRecordAtEndOfLog)
+{
+    TempDataDir dir("user_store_torn");
+    const UserStoreOptions options = {.data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1)};
+    {
+        UserStore store(options);
+        EXPECT_EQ(store.insert(make_user("alice", 0)), UserInsertResult::kInserted);
+        EXPECT_EQ(store.insert(make_user("bob", 1)), UserInsertResult::kInserted);
+    }
+    {
+        // 書き込みの途中で終了した場合と同じく、レコードの一部だけを追記する
+        std::ofstream log(dir.path() + "/users.1.log", std::ios::binary | std::ios::app);
+        log << std::string(100, 'z');
+    }
+    UserStore store(options);
+    EXPECT_EQ(store.size(), 2u);
+    expect_user(store, "bob", 1);
+    EXPECT_EQ(store.insert(make_user("carol", 2)), UserInsertResult::kInserted);
+}
+
+TEST(UserStoreTest, RejectsCorruptedSnapshot)
+{
+    TempDataDir dir("user_store_corrupted");
+    const UserStoreOptions options = {.data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1)};
+    {
+        UserStore store(options);
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_EQ(store.insert(make_user("user" + std::to_string(i), i)), UserInsertResult::kInserted);
+        }
+        ASSERT_TRUE(store.write_snapshot());
+    }
+    const std::string path = dir.path() + "/users.snapshot";
+    std::string original;
+    {
+        std::ifstream in(path, std::ios::binary);
+        original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // ヘッダ（64 バイト）、3 件のレコード、8 個の索引
+    constexpr std::size_t kRecordsOffset = 64;
+    const std::size_t index_offset = kRecordsOffset + 3 * sizeof(UserRecord);
+    ASSERT_EQ(original.size(), index_offset + 8 * sizeof(std::uint32_t));
+
+    const auto open_with = [&](const std::function<void(std::string&)>& corrupt)
+    {
+        std::string bytes = original;
+        corrupt(bytes);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+        UserStore store(options);
+    };
+    const auto put_u64 = [](std::string& bytes, std::size_t offset, std::uint64_t value)
+    { std::memcpy(bytes.data() + offset, &value, sizeof(value)); };
+
+    EXPECT_NO_THROW(open_with([](std::string&) {}));
+    // 2^63 + 3 件は 2 倍も 320 バイト倍も溢れて、索引の数とファイルサイズに一致してしまう
+    EXPECT_THROW(open_with([&](std::string& b) { put_u64(b, 16, (std::uint64_t(1) << 63) + 3); }),
+                 std::runtime_error);
+    EXPECT_THROW(open_with([&](std::string& b) { put_u64(b, 24, 16); }), std::runtime_error);
+    // 知らない形式
+    EXPECT_THROW(open_with([](std::string& b) { b[8] = 3; }), std::runtime_error);
+    EXPECT_THROW(open_with([](std::string& b) { b.pop_back(); }), std::runtime_error);
+    // レコードの範囲外を指す索引、空きのない索引
+    EXPECT_THROW(open_with([&](std::string& b) { std::memset(b.data() + index_offset, 0xFF, 4); }),
+                 std::runtime_error);
+    EXPECT_THROW(open_with(
+                     [&](std::string& b)
+                     {
+                         for (std::size_t slot = index_offset; slot < b.size(); slot += 4)
+                         {
+                             b[slot] = b[slot] == 0 ? 1 : b[slot];
+                         }
+                     }),
+                 std::runtime_error);
+    // 公開鍵の 1 バイトが化けたレコード
+    EXPECT_THROW(open_with([&](std::string& b) { b[kRecordsOffset + sizeof(UserRecord) + 200] ^= 1; }),
+                 std::runtime_error);
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << original;
+    UserStore store(options);
+    EXPECT_EQ(store.size(), 3u);
+    expect_user(store, "user2", 2);
+}
+
+TEST(UserStoreTest, ConcurrentRegistrationsAreAllDurable)
+{
+    TempDataDir dir("user_store_concurrent");
+    // 件数でスナップショットを作り直しながら登録を続ける
+    const UserStoreOptions options = {
+        .data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1), .snapshot_records = 50};
+    constexpr int kThreads = 8;
+    constexpr int kUsers = 40;
+    std::atomic<int> completed{0};
+    {
+        UserStore store(options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back(
+                [&, t]
+                {
+                    for (int i = 0; i < kUsers; ++i)
+                    {
+                        const int id = t * kUsers + i;
+                        store.insert(make_user("user" + std::to_string(id), id),
+                                     [&](UserInsertResult result)
+                                     {
+                                         EXPECT_EQ(result, UserInsertResult::kInserted);
+                                         ++completed;
+                                     });
+                    }
+                });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        // 破棄時に書き込み待ちの登録も確定させる
+    }
+    EXPECT_EQ(completed, kThreads * kUsers);
+    UserStore store(options);
+    EXPECT_EQ(store.size(), std::size_t(kThreads) * kUsers);
+    expect_user(store, "user0", 0);
+    expect_user(store, "user" + std::to_string(kThreads * kUsers - 1), kThreads * kUsers - 1);
+}
+
+TEST(UserStoreTest, RebuildsIndexOfVersion1Snapshot)
+{
+    TempDataDir dir("user_store_version1");
+    const UserStoreOptions options = {.data_dir = dir.path(), .snapshot_interval = std::chrono::hours(1)};
+    constexpr int kUsers = 50;
+    {
+        UserStore store(options);
+        for (int i = 0; i < kUsers; ++i)
+        {
+            EXPECT_EQ(store.insert(make_user("user" + std::to_string(i), i)), UserInsertResult::kInserted);
+        }
+        ASSERT_TRUE(store.write_snapshot());
+    }
+    const std::string path = dir.path() + "/users.snapshot";
+    const auto read_file = [&]
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    const auto version_of = [](const std::string& bytes)
+    {
+        std::uint32_t version = 0;
+        std::memcpy(&version, bytes.data() + 8, sizeof(version));
+        return version;
+    };
+    std::string bytes = read_file();
+    ASSERT_EQ(version_of(bytes), 2u);
+
+    // 形式 1 と同じく、混ぜていない FNV-1a で索引を作り直す
+    constexpr std::size_t kRecordsOffset = 64;
+    const std::size_t index_offset = kRecordsOffset + kUsers * sizeof(UserRecord);
+    const std::size_t slots = (bytes.size() - index_offset) / sizeof(std::uint32_t);
+    std::vector<std::uint32_t> index(slots, 0);
+    for (std::uint32_t i = 0; i < kUsers; ++i)
+    {
+        UserRecord record;
+        std::memcpy(&record, bytes.data() + kRecordsOffset + i * sizeof(UserRecord), sizeof(record));
+        const std::string_view name = record.name_view();
+        std::size_t slot = fnv1a(name.data(), name.size()) & (slots - 1);
+        while (index[slot] != 0)
+        {
+            slot = (slot + 1) & (slots - 1);
+        }
+        index[slot] = i + 1;
+    }
+    std::memcpy(bytes.data() + index_offset, index.data(), slots * sizeof(std::uint32_t));
+    const std::uint32_t version1 = 1;
+    std::memcpy(bytes.data() + 8, &version1, sizeof(version1));
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+
+    {
+        // 古い索引を読み違えず、全員が見つかる。読み込み時に今の形式で書き直す
+        UserStore store(options);
+        EXPECT_EQ(store.size(), static_cast<std::size_t>(kUsers));
+        for (int i = 0; i < kUsers; ++i)
+        {
+            expect_user(store, "user" + std::to_string(i), i);
+        }
+        EXPECT_EQ(store.insert(make_user("user7", 8)), UserInsertResult::kAlreadyExists);
+        EXPECT_EQ(version_of(read_file()), 2u);
+    }
+    UserStore store(options);
+    EXPECT_EQ(store.size(), static_cast<std::size_t>(kUsers));
+    expect_user(store, "user49", 49);
+}
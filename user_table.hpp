@@ -0,0 +1,542 @@
+#ifndef USER_TABLE_HPP
+#define USER_TABLE_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "lock_stats.hpp"
+#include "zkp_group.hpp"
+
+// 登録済みユーザーの情報
+struct UserInfo
+{
+    std::string name;
+    GroupId group = GroupId::kModp1024;
+    boost::multiprecision::cpp_int y1;
+    boost::multiprecision::cpp_int y2;
+};
+
+// 公開鍵（ビッグエンディアン）のバイト数と、ファイルのレコード（UserRecord）に収まるユーザー名のバイト数
+inline constexpr std::size_t kUserKeyBytes = 128;
+inline constexpr std::size_t kUserNameBytes = 56;
+
+// ユーザーの群と公開鍵（ビッグエンディアン、上位をゼロで埋める）
+struct UserKeys
+{
+    std::uint8_t group;
+    unsigned char y1[kUserKeyBytes];
+    unsigned char y2[kUserKeyBytes];
+};
+
+/**
+ * @brief ユーザー 1 人分の固定長レコード（追記ログとスナップショットの形式）
+ * @note  ユーザー名と公開鍵をレコード内に持つ。ファイルにはホストのバイト順でそのまま書く。
+ *        メモリ上の表（UserTable）はユーザー名を別の領域に置くため、長さの上限はファイルに書く場合だけ。
+ */
+struct UserRecord
+{
+    std::uint32_t checksum;  // checksum 以降のバイトの FNV-1a（ログの途中で切れたレコードを見分ける）
+    std::uint8_t group;
+    std::uint8_t name_length;
+    std::uint8_t reserved[2];
+    char name[kUserNameBytes];
+    unsigned char y1[kUserKeyBytes];  // ビッグエンディアン、上位をゼロで埋める
+    unsigned char y2[kUserKeyBytes];
+
+    std::string_view name_view() const { return std::string_view(name, name_length); }
+};
+static_assert(sizeof(UserRecord) == 320, "UserRecord must keep its on-disk size");
+static_assert(std::is_trivially_copyable_v<UserRecord>);
+
+/**
+ * @fn
+ * @brief 64 ビットの FNV-1a ハッシュ
+ */
+inline std::uint64_t fnv1a(const void* data, std::size_t size)
+{
+    const auto* p = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @fn
+ * @brief ユーザー名のハッシュ（メモリ上の表とスナップショットの索引で共通）
+ * @note  FNV-1a の下位ビットは偏るため、乗算で全ビットに混ぜる。索引のスロットは下位ビットで選ぶ。
+ */
+inline std::uint64_t hash_user_name(std::string_view name)
+{
+    return fnv1a(name.data(), name.size()) * 0x9E3779B97F4A7C15ull;
+}
+
+inline std::uint32_t user_record_checksum(const UserRecord& record)
+{
+    const auto* body = reinterpret_cast<const unsigned char*>(&record) + sizeof(record.checksum);
+    return static_cast<std::uint32_t>(fnv1a(body, sizeof(UserRecord) - sizeof(record.checksum)));
+}
+
+/**
+ * @fn
+ * @brief ユーザー情報の群と公開鍵を固定長に変換する
+ * @return ユーザー名が空の場合、公開鍵が kUserKeyBytes に収まらない場合は std::nullopt
+ */
+inline std::optional<UserKeys> make_user_keys(const UserInfo& user)
+{
+    if (user.name.empty())
+    {
+        return std::nullopt;
+    }
+    UserKeys keys{};
+    keys.group = static_cast<std::uint8_t>(user.group);
+    const auto export_key = [](const boost::multiprecision::cpp_int& value, unsigned char* out)
+    {
+        if (value < 0 || (value != 0 && boost::multiprecision::msb(value) >= kUserKeyBytes * 8))
+        {
+            return false;
+        }
+        if (value != 0)
+        {
+            const std::size_t used = boost::multiprecision::msb(value) / 8 + 1;
+            boost::multiprecision::export_bits(value, out + (kUserKeyBytes - used), 8, true);
+        }
+        return true;
+    };
+    if (!export_key(user.y1, keys.y1) || !export_key(user.y2, keys.y2))
+    {
+        return std::nullopt;
+    }
+    return keys;
+}
+
+/**
+ * @fn
+ * @brief ユーザー名と公開鍵をファイルのレコードに変換する
+ * @return ユーザー名が空または kUserNameBytes を超える場合は std::nullopt
+ */
+inline std::optional<UserRecord> make_user_record(std::string_view name, const UserKeys& keys)
+{
+    if (name.empty() || name.size() > kUserNameBytes)
+    {
+        return std::nullopt;
+    }
+    UserRecord record{};
+    record.group = keys.group;
+    record.name_length = static_cast<std::uint8_t>(name.size());
+    std::memcpy(record.name, name.data(), name.size());
+    std::memcpy(record.y1, keys.y1, kUserKeyBytes);
+    std::memcpy(record.y2, keys.y2, kUserKeyBytes);
+    record.checksum = user_record_checksum(record);
+    return record;
+}
+
+// レコードの群と公開鍵
+inline UserKeys user_keys(const UserRecord& record)
+{
+    UserKeys keys;
+    keys.group = record.group;
+    std::memcpy(keys.y1, record.y1, kUserKeyBytes);
+    std::memcpy(keys.y2, record.y2, kUserKeyBytes);
+    return keys;
+}
+
+/**
+ * @fn
+ * @brief ユーザー名と公開鍵からユーザー情報を組み立てる（公開鍵はバイト列から直接変換する）
+ */
+inline UserInfo to_user_info(std::string_view name, const UserKeys& keys)
+{
+    UserInfo user;
+    user.name.assign(name);
+    user.group = static_cast<GroupId>(keys.group);
+    boost::multiprecision::import_bits(user.y1, keys.y1, keys.y1 + kUserKeyBytes, 8, true);
+    boost::multiprecision::import_bits(user.y2, keys.y2, keys.y2 + kUserKeyBytes, 8, true);
+    return user;
+}
+
+inline UserInfo to_user_info(const UserRecord& record)
+{
+    UserInfo user;
+    user.name.assign(record.name_view());
+    user.group = static_cast<GroupId>(record.group);
+    boost::multiprecision::import_bits(user.y1, record.y1, record.y1 + kUserKeyBytes, 8, true);
+    boost::multiprecision::import_bits(user.y2, record.y2, record.y2 + kUserKeyBytes, 8, true);
+    return user;
+}
+
+// ファイルから読んだレコードが壊れていないか
+inline bool valid_user_record(const UserRecord& record)
+{
+    return record.checksum == user_record_checksum(record) && record.name_length != 0 &&
+           record.name_length <= kUserNameBytes && record.group < kGroupCount;
+}
+
+/**
+ * @brief 登録済みユーザーのコンパクトな表（ユーザー名 -> 群と公開鍵）
+ * @note  ShardedMap<std::string, UserInfo> はユーザーごとにハッシュノード、キーと name の 2 つの文字列、
+ *        y1 / y2 の cpp_int のヒープ領域を持つ。この表は公開鍵を固定長のエントリ（Entry）に持ち、
+ *        エントリはシャードごとの連続した領域（kChunkRecords 件ずつ確保し、以後は移動しない）に詰めて置く。
+ *        ユーザー名はシャードごとの文字列領域に続けて置き（intern）、エントリには位置と長さだけを持つ。
+ *        名前の長さに上限はない（ファイルに書く場合の上限は UserStore が確認する）。
+ *        索引はユーザー名のハッシュによる線形探索のオープンアドレス法で、要素は 8 バイト
+ *        （ハッシュの上位 32 ビットとエントリ番号）。ハッシュが一致した場合だけ名前を比べる。
+ *        1 ユーザーあたりのメモリはエントリの 272 バイト、名前の長さ、索引の 8〜16 バイト程度で、件数に比例する。
+ *        シャードごとに std::shared_mutex を持ち、検索は共有ロックで並行に行える。
+ *        削除はまれ（永続化に失敗した登録の取り消し）なため、エントリの名前を外すだけで領域は再利用しない。
+ *        エントリは永続化が確定したか（durable）を持ち、スナップショットには確定したものだけを書く。
+ */
+class UserTable
+{
+   public:
+    static constexpr std::size_t kShards = 64;
+    static constexpr std::size_t kChunkRecords = 256;
+
+    // insert_batch に渡す 1 件（name は挿入時に表の文字列領域へコピーする）
+    struct Item
+    {
+        std::string_view name;
+        UserKeys keys;
+    };
+
+    UserTable() = default;
+    UserTable(const UserTable&) = delete;
+    UserTable& operator=(const UserTable&) = delete;
+
+    /**
+     * @fn
+     * @brief 同じ名前のユーザーが存在しない場合のみ挿入する
+     * @param name ユーザー名（空でないこと）
+     * @param durable 永続化が確定しているか（ログから読み直したユーザー）。false の場合は後で mark_durable を呼ぶ
+     * @return 挿入した場合は true
+     */
+    bool insert(std::string_view name, const UserKeys& keys, bool durable = false)
+    {
+        const std::uint64_t hash = hash_user_name(name);
+        Shard& shard = shard_for(hash);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        shard.reserve(1, name.size());
+        return shard.insert(name, keys, hash, durable);
+    }
+
+    /**
+     * @fn
+     * @brief 複数のユーザーをまとめて挿入する（それぞれ同じ名前のユーザーが存在しない場合のみ）
+     * @note  シャードごとに振り分け、シャードごとに 1 回だけロックして、索引・エントリ・文字列の領域を
+     *        挿入する件数分まとめて広げてから挿入する。items 内で名前が重なる場合は先のものを挿入する。
+     * @param inserted items と同じ順に、挿入したかを書き込む
+     * @return 挿入した件数
+     */
+    std::size_t insert_batch(const std::vector<Item>& items, std::vector<bool>& inserted)
+    {
+        inserted.assign(items.size(), false);
+        std::vector<std::uint64_t> hashes(items.size());
+        std::array<std::vector<std::size_t>, kShards> by_shard;
+        for (std::size_t i = 0; i < items.size(); ++i)
+        {
+            hashes[i] = hash_user_name(items[i].name);
+            by_shard[shard_index(hashes[i])].push_back(i);
+        }
+        std::size_t total = 0;
+        for (std::size_t s = 0; s < kShards; ++s)
+        {
+            if (by_shard[s].empty())
+            {
+                continue;
+            }
+            std::size_t name_bytes = 0;
+            for (const std::size_t i : by_shard[s])
+            {
+                name_bytes += items[i].name.size();
+            }
+            Shard& shard = shards_[s];
+            auto lock = lock_timed(shard.mutex, shard.lock_wait);
+            shard.reserve(by_shard[s].size(), name_bytes);
+            for (const std::size_t i : by_shard[s])
+            {
+                inserted[i] = shard.insert(items[i].name, items[i].keys, hashes[i], false);
+                total += inserted[i] ? 1 : 0;
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @fn
+     * @brief 共有ロックを保持したままユーザーを f(std::string_view name, const UserKeys&) に渡す
+     * @note  f の中で同じ表にアクセスしないこと。
+     * @return ユーザーが存在して f を呼んだ場合は true
+     */
+    template <typename Func>
+    bool visit(std::string_view name, Func&& f) const
+    {
+        const std::uint64_t hash = hash_user_name(name);
+        const Shard& shard = shard_for(hash);
+        auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+        const Entry* entry = shard.find(hash, name);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        f(shard.name(*entry), entry->keys);
+        return true;
+    }
+
+    /**
+     * @fn
+     * @brief ユーザーを削除する
+     * @return 削除した場合は true
+     */
+    bool erase(std::string_view name)
+    {
+        const std::uint64_t hash = hash_user_name(name);
+        Shard& shard = shard_for(hash);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        auto* entry = const_cast<Entry*>(shard.find(hash, name));
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        // 索引の要素は残し、名前が一致しないエントリとして探索を続けさせる（次に索引を作り直すときに外れる）
+        entry->name_length = 0;
+        --shard.live;
+        return true;
+    }
+
+    /**
+     * @fn
+     * @brief ユーザーの永続化が確定したことを記録する
+     * @return ユーザーが存在した場合は true
+     */
+    bool mark_durable(std::string_view name)
+    {
+        const std::uint64_t hash = hash_user_name(name);
+        Shard& shard = shard_for(hash);
+        auto lock = lock_timed(shard.mutex, shard.lock_wait);
+        auto* entry = const_cast<Entry*>(shard.find(hash, name));
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        entry->durable = true;
+        return true;
+    }
+
+    /**
+     * @fn
+     * @brief 全ユーザーを f(std::string_view name, const UserKeys&) に渡す。シャードを 1 つずつ共有ロックして走査する。
+     * @note  f の中で同じ表にアクセスしないこと。
+     */
+    template <typename Func>
+    void for_each(Func&& f) const
+    {
+        scan(f, false);
+    }
+
+    /**
+     * @fn
+     * @brief 永続化が確定したユーザーだけを f(std::string_view name, const UserKeys&) に渡す（for_each と同じ走査）
+     */
+    template <typename Func>
+    void for_each_durable(Func&& f) const
+    {
+        scan(f, true);
+    }
+
+    // 要素数（シャードを 1 つずつロックして数えるため、並行更新中は概数）
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for (const Shard& shard : shards_)
+        {
+            auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+            total += shard.live;
+        }
+        return total;
+    }
+
+    // エントリ・文字列の領域と索引が使うバイト数
+    std::size_t memory_bytes() const
+    {
+        std::size_t total = 0;
+        for (const Shard& shard : shards_)
+        {
+            auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+            total += shard.chunks.size() * kChunkRecords * sizeof(Entry) + shard.names.capacity() +
+                     shard.index.size() * sizeof(std::uint64_t);
+        }
+        return total;
+    }
+
+    LockWaitCounters lock_wait() const
+    {
+        LockWaitCounters total;
+        for (const Shard& shard : shards_)
+        {
+            total += shard.lock_wait.load();
+        }
+        return total;
+    }
+
+   private:
+    struct Entry
+    {
+        std::uint64_t name_offset;  // シャードの文字列領域での位置
+        std::uint32_t name_length;  // 0 は削除済み
+        UserKeys keys;
+        bool durable;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        mutable LockWaitStats lock_wait;
+        // (ハッシュの上位 32 ビット << 32) | (エントリ番号 + 1)。0 は空き
+        std::vector<std::uint64_t> index;
+        std::vector<std::unique_ptr<Entry[]>> chunks;
+        // ユーザー名を続けて置く領域（削除した名前の分も残す）
+        std::vector<char> names;
+        std::size_t entries = 0;  // 削除済みを含む
+        std::size_t live = 0;
+
+        Entry& entry(std::size_t i) { return chunks[i / kChunkRecords][i % kChunkRecords]; }
+        const Entry& entry(std::size_t i) const { return chunks[i / kChunkRecords][i % kChunkRecords]; }
+
+        std::string_view name(const Entry& e) const
+        {
+            return std::string_view(names.data() + e.name_offset, e.name_length);
+        }
+
+        bool matches(std::uint64_t slot_value, std::uint64_t hash, std::string_view key) const
+        {
+            return (slot_value >> 32) == (hash >> 32) && name(entry((slot_value & 0xFFFFFFFFu) - 1)) == key;
+        }
+
+        const Entry* find(std::uint64_t hash, std::string_view key) const
+        {
+            if (index.empty())
+            {
+                return nullptr;
+            }
+            const std::size_t mask = index.size() - 1;
+            for (std::size_t slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                if (matches(index[slot], hash, key))
+                {
+                    return &entry((index[slot] & 0xFFFFFFFFu) - 1);
+                }
+            }
+            return nullptr;
+        }
+
+        // あと count 件（名前は合計 name_bytes バイト）挿入しても負荷率が 0.7 を超えないよう索引を広げ、領域を確保する
+        void reserve(std::size_t count, std::size_t name_bytes)
+        {
+            std::size_t slots = std::max<std::size_t>(16, index.size());
+            while ((entries + count) * 10 > slots * 7)
+            {
+                slots *= 2;
+            }
+            if (slots != index.size())
+            {
+                rehash(slots);
+            }
+            const std::size_t chunks_needed = (entries + count + kChunkRecords - 1) / kChunkRecords;
+            chunks.reserve(chunks_needed);
+            while (chunks.size() < chunks_needed)
+            {
+                chunks.push_back(std::make_unique<Entry[]>(kChunkRecords));
+            }
+            if (names.size() + name_bytes > names.capacity())
+            {
+                names.reserve(std::max(names.size() + name_bytes, names.capacity() * 2));
+            }
+        }
+
+        // reserve した後に呼ぶ。同じ名前のユーザーが存在する場合は挿入しない
+        bool insert(std::string_view key, const UserKeys& keys, std::uint64_t hash, bool durable)
+        {
+            const std::size_t mask = index.size() - 1;
+            std::size_t slot = hash & mask;
+            for (; index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                if (matches(index[slot], hash, key))
+                {
+                    return false;
+                }
+            }
+            Entry& e = entry(entries);
+            e.name_offset = names.size();
+            e.name_length = static_cast<std::uint32_t>(key.size());
+            e.keys = keys;
+            e.durable = durable;
+            names.insert(names.end(), key.begin(), key.end());
+            index[slot] = (hash >> 32 << 32) | (entries + 1);
+            ++entries;
+            ++live;
+            return true;
+        }
+
+        // 索引を slots 個にして作り直す（削除済みのエントリは外す）
+        void rehash(std::size_t slots)
+        {
+            std::vector<std::uint64_t> next(slots, 0);
+            const std::size_t mask = next.size() - 1;
+            for (const std::uint64_t slot_value : index)
+            {
+                if (slot_value == 0 || entry((slot_value & 0xFFFFFFFFu) - 1).name_length == 0)
+                {
+                    continue;
+                }
+                const std::uint64_t hash = hash_user_name(name(entry((slot_value & 0xFFFFFFFFu) - 1)));
+                std::size_t slot = hash & mask;
+                while (next[slot] != 0)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                next[slot] = slot_value;
+            }
+            index.swap(next);
+        }
+    };
+
+    std::array<Shard, kShards> shards_;
+
+    template <typename Func>
+    void scan(Func& f, bool durable_only) const
+    {
+        for (const Shard& shard : shards_)
+        {
+            auto lock = lock_shared_timed(shard.mutex, shard.lock_wait);
+            for (std::size_t i = 0; i < shard.entries; ++i)
+            {
+                const Entry& entry = shard.entry(i);
+                if (entry.name_length != 0 && (entry.durable || !durable_only))
+                {
+                    f(shard.name(entry), entry.keys);
+                }
+            }
+        }
+    }
+
+    // 索引のスロットは下位ビットで選ぶため、シャードの選択には上位ビットを使う
+    static std::size_t shard_index(std::uint64_t hash) { return static_cast<std::size_t>(hash >> 58) & (kShards - 1); }
+
+    Shard& shard_for(std::uint64_t hash) { return shards_[shard_index(hash)]; }
+    const Shard& shard_for(std::uint64_t hash) const { return shards_[shard_index(hash)]; }
+};
+
+#endif  // USER_TABLE_HPP
@@ -0,0 +1,151 @@
+#ifndef WIRE_ENCODING_HPP
+#define WIRE_ENCODING_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace boost::multiprecision;
+
+// RPC で整数（群の要素・スカラー）を運ぶ形式（protos/zkp_auth.proto の Encoding と同じ値）
+enum class WireEncoding
+{
+    kHex = 0,     // 16進数文字列（"0x" なし、ゼロ埋めなし）。移行期間中の旧クライアント向け
+    kBinary = 1,  // 固定長のビッグエンディアンのバイト列
+};
+
+/**
+ * @fn
+ * @brief 非負整数 x を表すのに必要なバイト数を返す（x = 0 の場合は 0）
+ */
+inline std::size_t byte_length(const cpp_int& x) { return x.is_zero() ? 0 : static_cast<std::size_t>(msb(x)) / 8 + 1; }
+
+/**
+ * @fn
+ * @brief 非負整数を length バイトのビッグエンディアンに変換する（上位をゼロで埋める）
+ * @param x 変換する整数（256^length 未満であること）
+ * @param length 出力するバイト数
+ * @return 変換後のバイト列。x が length バイトに収まらない場合は空文字列
+ */
+inline std::string encode_fixed(const cpp_int& x, std::size_t length)
+{
+    const std::size_t used = byte_length(x);
+    if (used > length || x < 0)
+    {
+        return {};
+    }
+    std::string out(length, '\0');
+    if (used != 0)
+    {
+        export_bits(x, reinterpret_cast<unsigned char*>(out.data()) + (length - used), 8, true);
+    }
+    return out;
+}
+
+/**
+ * @fn
+ * @brief length バイトのビッグエンディアンを非負整数に変換する
+ * @return バイト数が length と異なる場合は std::nullopt
+ */
+inline std::optional<cpp_int> decode_fixed(std::string_view bytes, std::size_t length)
+{
+    if (bytes.size() != length)
+    {
+        return std::nullopt;
+    }
+    cpp_int x;
+    const auto* first = reinterpret_cast<const unsigned char*>(bytes.data());
+    import_bits(x, first, first + bytes.size(), 8, true);
+    return x;
+}
+
+/**
+ * @fn
+ * @brief 非負整数を16進数文字列（小文字、"0x" なし、ゼロ埋めなし）に変換する
+ */
+inline std::string encode_hex(const cpp_int& x)
+{
+    static constexpr char kDigits[] = "0123456789abcdef";
+    const std::string bytes = encode_fixed(x, byte_length(x));
+    if (bytes.empty())
+    {
+        return "0";
+    }
+    std::string out;
+    out.reserve(bytes.size() * 2);
+    for (const char c : bytes)
+    {
+        const auto b = static_cast<unsigned char>(c);
+        out.push_back(kDigits[b >> 4]);
+        out.push_back(kDigits[b & 0x0f]);
+    }
+    if (out[0] == '0')
+    {
+        out.erase(0, 1);
+    }
+    return out;
+}
+
+/**
+ * @fn
+ * @brief 16進数文字列（"0x" なし）を非負整数に変換する。空文字列は 0 とする。
+ * @return 16進数以外の文字を含む場合は std::nullopt
+ */
+inline std::optional<cpp_int> decode_hex(std::string_view hex)
+{
+    cpp_int x = 0;
+    for (const char c : hex)
+    {
+        unsigned digit = 0;
+        if (c >= '0' && c <= '9')
+        {
+            digit = static_cast<unsigned>(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = static_cast<unsigned>(c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            digit = static_cast<unsigned>(c - 'A' + 10);
+        }
+        else
+        {
+            return std::nullopt;
+        }
+        x <<= 4;
+        x |= digit;
+    }
+    return x;
+}
+
+/**
+ * @fn
+ * @brief 整数を RPC の bytes フィールドの形式に変換する
+ * @param x 変換する整数
+ * @param encoding 形式
+ * @param length kBinary の場合のバイト数（群の要素なら要素長、スカラーなら位数のバイト長）
+ */
+inline std::string encode_wire(const cpp_int& x, WireEncoding encoding, std::size_t length)
+{
+    return encoding == WireEncoding::kBinary ? encode_fixed(x, length) : encode_hex(x);
+}
+
+/**
+ * @fn
+ * @brief RPC の bytes フィールドを整数に変換する
+ * @return 形式に合わない（kBinary で長さが異なる、kHex で16進数でないか length バイトに収まる桁数を超える）場合は
+ *         std::nullopt（長すぎる値を多倍長整数に変換しない）
+ */
+inline std::optional<cpp_int> decode_wire(std::string_view bytes, WireEncoding encoding, std::size_t length)
+{
+    if (encoding == WireEncoding::kBinary)
+    {
+        return decode_fixed(bytes, length);
+    }
+    return bytes.size() <= 2 * length ? decode_hex(bytes) : std::nullopt;
+}
+
+#endif  // WIRE_ENCODING_HPP
@@ -0,0 +1,64 @@
+#include "wire_encoding.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "zkp_backend.hpp"
+#include "zkp_group.hpp"
+
+TEST(WireEncodingTest, FixedLengthRoundTrip)
+{
+    const cpp_int x("0x0102030405");
+
+    const std::string bytes = encode_fixed(x, 8);
+    EXPECT_EQ(bytes, std::string("\0\0\0\x01\x02\x03\x04\x05", 8));  // 上位をゼロで埋めたビッグエンディアン
+    EXPECT_EQ(decode_fixed(bytes, 8), x);
+
+    EXPECT_EQ(encode_fixed(0, 4), std::string(4, '\0'));
+    EXPECT_EQ(decode_fixed(std::string(4, '\0'), 4), 0);
+    EXPECT_TRUE(encode_fixed(x, 4).empty());  // 収まらない値は符号化しない
+    EXPECT_FALSE(decode_fixed(bytes, 7));     // 長さが異なるバイト列は受け付けない
+}
+
+TEST(WireEncodingTest, HexMatchesLegacyFormat)
+{
+    // 旧クライアントの形式: 小文字、"0x" なし、ゼロ埋めなし
+    EXPECT_EQ(encode_hex(cpp_int("0xabc0123")), "abc0123");
+    EXPECT_EQ(encode_hex(0), "0");
+    EXPECT_EQ(decode_hex("ABC0123"), cpp_int("0xabc0123"));
+    EXPECT_EQ(decode_hex(""), 0);
+    EXPECT_FALSE(decode_hex("12g4"));
+    EXPECT_FALSE(decode_hex("0x12"));
+}
+
+TEST(WireEncodingTest, GroupLengths)
+{
+    const auto modp = make_zkp_backend(GroupId::kModp1024, {});
+    const auto p256 = make_zkp_backend(GroupId::kP256, {});
+    EXPECT_EQ(modp->element_bytes(), 128u);
+    EXPECT_EQ(modp->scalar_bytes(), 20u);
+    EXPECT_EQ(p256->element_bytes(), 65u);
+    EXPECT_EQ(p256->scalar_bytes(), 32u);
+
+    // 群の要素・スカラーの最大値が固定長に収まり、両形式で往復できる
+    const cpp_int elements[] = {get_zkp_mont_group().modulus() - 1, (cpp_int(4) << 512) | (cpp_int(1) << 511)};
+    const ZkpBackend* backends[] = {modp.get(), p256.get()};
+    for (int i = 0; i < 2; ++i)
+    {
+        const ZkpBackend& zkp = *backends[i];
+        const cpp_int scalar = zkp.order() - 1;
+        for (const WireEncoding encoding : {WireEncoding::kHex, WireEncoding::kBinary})
+        {
+            EXPECT_EQ(decode_wire(encode_wire(elements[i], encoding, zkp.element_bytes()), encoding,
+                                  zkp.element_bytes()),
+                      elements[i]);
+            EXPECT_EQ(decode_wire(encode_wire(scalar, encoding, zkp.scalar_bytes()), encoding, zkp.scalar_bytes()),
+                      scalar);
+        }
+        // 16 進数は固定長に収まる桁数まで（先頭の 0 を含めてよい）
+        const std::string digits(2 * zkp.scalar_bytes(), '0');
+        EXPECT_EQ(decode_wire(digits, WireEncoding::kHex, zkp.scalar_bytes()), cpp_int(0));
+        EXPECT_FALSE(decode_wire(digits + "1", WireEncoding::kHex, zkp.scalar_bytes()));
+    }
+}
@@ -0,0 +1,273 @@
+#ifndef ZKP_BACKEND_HPP
+#define ZKP_BACKEND_HPP
+
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "batch_verifier.hpp"
+#include "chaum_pedersen.hpp"
+#include "key_table_cache.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_group.hpp"
+
+using namespace boost::multiprecision;
+
+/**
+ * @brief 群ごとの Chaum-Pedersen 検証器をサービスから同じ形で扱うためのインターフェース
+ * @note  サービスは群の要素を整数表現（ModpGroup は [1, p) の整数、EcGroup は SEC1 非圧縮形式）で保持し、
+ *        検証時にだけ各群の要素表現へ変換する。
+ *        ログイン頻度の高いユーザーは公開鍵の固定基底テーブルをキャッシュし、検証に使う（KeyTableCache）。
+ */
+class ZkpBackend
+{
+   public:
+    virtual ~ZkpBackend() = default;
+
+    virtual GroupId group_id() const = 0;
+
+    // チャレンジ・秘密鍵の範囲を決める位数 q
+    virtual const cpp_int& order() const = 0;
+
+    // 固定長のバイナリ形式で送るときの長さ（群の要素の整数表現、および q 未満のスカラー）
+    virtual std::size_t element_bytes() const = 0;
+    virtual std::size_t scalar_bytes() const = 0;
+
+    /**
+     * @fn
+     * @brief 整数表現が群の要素として妥当かを確認する
+     */
+    virtual bool is_valid_element(const cpp_int& x) const = 0;
+
+    /**
+     * @fn
+     * @brief 整数表現が公開鍵として妥当か（群の要素で、位数 q の部分群に属し、単位元でない）を確認する
+     */
+    virtual bool is_valid_public_key(const cpp_int& y) const = 0;
+
+    /**
+     * @fn
+     * @brief 整数表現がコミットメントとして妥当か（群の要素で、単位元でない）を確認する
+     * @note  べき乗を含まない確認だけ行う（Z_p^* では 1 < r < p）。単位元は k = 0 のコミットメントに当たる。
+     */
+    virtual bool is_valid_commitment(const cpp_int& r) const = 0;
+
+    /**
+     * @fn
+     * @brief 非対話ログインのチャレンジを導出する（BasicChaumPedersen::fiat_shamir_challenge）
+     */
+    virtual Challenge fiat_shamir_challenge(const PublicKeys& public_keys, const Commitment& commitment,
+                                            std::string_view user, std::uint64_t timestamp_ms) const = 0;
+
+    /**
+     * @fn
+     * @brief 整数表現の証明を検証する。バッチ検証が有効な場合は蓄積窓が締め切られるまでブロックする。
+     * @param user 公開鍵の持ち主（公開鍵テーブルのキャッシュのキー）
+     * @return 検証結果。要素として不正な値が含まれる場合も false。
+     */
+    virtual bool verify(const std::string& user, const Commitment& commitment, const PublicKeys& public_keys,
+                        const Challenge& challenge, const Response& response) = 0;
+
+    /**
+     * @fn
+     * @brief 整数表現の証明の検証を検証用ワーカースレッドに依頼し、検証を待たずに戻る
+     * @param done 検証結果を受け取るコールバック（ワーカースレッド、または要素が不正な場合は呼び出し元で呼ばれる）
+     * @return 受け付けた場合は true。検証待ちが上限に達している場合は false（done は呼ばれない）。
+     */
+    virtual bool submit(const std::string& user, const Commitment& commitment, const PublicKeys& public_keys,
+                        const Challenge& challenge, const Response& response, std::function<void(bool)> done) = 0;
+
+    // 公開鍵テーブルのキャッシュの集計値
+    virtual KeyTableCacheStats key_table_stats() const = 0;
+};
+
+/**
+ * @brief ZkpBackend の実装。群コンテキストを共有する BasicChaumPedersen とバッチ検証器を持つ。
+ * @note  公開鍵テーブルがキャッシュにあるユーザーの証明は、バッチにまとめずテーブルで検証する。
+ *        テーブルは、ログイン回数がしきい値に達したユーザーの検証に成功した後、
+ *        結果を返してから同じスレッドで構築する（検証に失敗する証明ではテーブルを作らない）。
+ * @tparam CP BasicChaumPedersen のインスタンス型
+ */
+template <typename CP>
+class BasicZkpBackend final : public ZkpBackend
+{
+   public:
+    using Tables = typename CP::PublicKeyTables;
+
+    BasicZkpBackend(GroupId id, CP cp, const BatchVerifierOptions& options,
+                    const KeyTableCacheOptions& key_table_options = {})
+        : id_(id),
+          cp_(std::move(cp)),
+          identity_(cp_.group().pow_g(0)),
+          batch_verifier_(cp_, options),
+          key_tables_(key_table_options)
+    {
+    }
+
+    GroupId group_id() const override { return id_; }
+
+    const cpp_int& order() const override { return cp_.order(); }
+
+    std::size_t element_bytes() const override { return cp_.group().encoded_bytes(); }
+    std::size_t scalar_bytes() const override { return byte_length(cp_.order()); }
+
+    bool is_valid_element(const cpp_int& x) const override { return cp_.group().decode(x).has_value(); }
+
+    bool is_valid_public_key(const cpp_int& y) const override
+    {
+        const auto element = cp_.group().decode(y);
+        return element && cp_.group().is_public_key(*element);
+    }
+
+    bool is_valid_commitment(const cpp_int& r) const override
+    {
+        const auto element = cp_.group().decode(r);
+        return element && !cp_.group().equal(*element, identity_);
+    }
+
+    Challenge fiat_shamir_challenge(const PublicKeys& public_keys, const Commitment& commitment,
+                                    std::string_view user, std::uint64_t timestamp_ms) const override
+    {
+        return cp_.fiat_shamir_challenge(public_keys, commitment, user, timestamp_ms);
+    }
+
+    bool verify(const std::string& user, const Commitment& commitment, const PublicKeys& public_keys,
+                const Challenge& challenge, const Response& response) override
+    {
+        auto proof = decode_proof(commitment, public_keys, challenge, response);
+        if (!proof)
+        {
+            return false;
+        }
+        if (!attach_key_tables(user, *proof))
+        {
+            // テーブルで検証する証明は蓄積窓を待たない
+            return proof->key_tables ? cp_.verify_proof(*proof) : batch_verifier_.verify(std::move(*proof));
+        }
+        const typename CP::PublicKeys keys = proof->public_keys;
+        const bool is_verified = batch_verifier_.verify(std::move(*proof));
+        finish_key_tables(user, keys, is_verified);
+        return is_verified;
+    }
+
+    bool submit(const std::string& user, const Commitment& commitment, const PublicKeys& public_keys,
+                const Challenge& challenge, const Response& response, std::function<void(bool)> done) override
+    {
+        auto proof = decode_proof(commitment, public_keys, challenge, response);
+        if (!proof)
+        {
+            done(false);
+            return true;
+        }
+        if (!attach_key_tables(user, *proof))
+        {
+            return batch_verifier_.submit(std::move(*proof), std::move(done));
+        }
+        typename CP::PublicKeys keys = proof->public_keys;
+        const bool accepted = batch_verifier_.submit(
+            std::move(*proof),
+            [this, user, keys = std::move(keys), done = std::move(done)](bool is_verified)
+            {
+                done(is_verified);
+                finish_key_tables(user, keys, is_verified);
+            });
+        if (!accepted)
+        {
+            key_tables_.cancel_build(user);
+        }
+        return accepted;
+    }
+
+    KeyTableCacheStats key_table_stats() const override { return key_tables_.stats(); }
+
+   private:
+    const GroupId id_;
+    const CP cp_;
+    // 群の単位元（g^0）
+    const typename CP::Element identity_;
+    // cp_ より後に宣言すること
+    BatchVerifier<CP> batch_verifier_;
+    // ユーザー名 -> 公開鍵テーブル（ログイン頻度の高いユーザーだけ）
+    KeyTableCache<Tables> key_tables_;
+
+    /**
+     * @fn
+     * @brief キャッシュにある公開鍵テーブルを証明に付ける
+     * @return テーブルがなく、このスレッドが構築を引き受けた場合は true（finish_key_tables か cancel_build を呼ぶこと）
+     */
+    bool attach_key_tables(const std::string& user, typename CP::Proof& proof)
+    {
+        if (auto tables = key_tables_.find(user))
+        {
+            const auto& group = cp_.group();
+            if (group.equal(tables->y1->base(), proof.public_keys.y1) &&
+                group.equal(tables->y2->base(), proof.public_keys.y2))
+            {
+                proof.key_tables = std::move(tables);
+                return false;
+            }
+            // 同じ名前で公開鍵が変わっている
+            key_tables_.erase(user);
+        }
+        return key_tables_.begin_build(user);
+    }
+
+    // 検証に成功した場合だけテーブルを構築してキャッシュに入れる
+    void finish_key_tables(const std::string& user, const typename CP::PublicKeys& public_keys, bool is_verified)
+    {
+        if (!is_verified)
+        {
+            key_tables_.cancel_build(user);
+            return;
+        }
+        auto tables = std::make_shared<const Tables>(
+            cp_.make_public_key_tables(public_keys, key_tables_.options().window_bits));
+        const std::size_t bytes = tables->memory_bytes();
+        key_tables_.insert(user, std::move(tables), bytes);
+    }
+
+    // 整数表現を群の要素表現に変換する。不正な値が含まれる場合は std::nullopt
+    std::optional<typename CP::Proof> decode_proof(const Commitment& commitment, const PublicKeys& public_keys,
+                                                   const Challenge& challenge, const Response& response) const
+    {
+        const auto& group = cp_.group();
+        auto r1 = group.decode(commitment.r1);
+        auto r2 = group.decode(commitment.r2);
+        auto y1 = group.decode(public_keys.y1);
+        auto y2 = group.decode(public_keys.y2);
+        if (!r1 || !r2 || !y1 || !y2)
+        {
+            return std::nullopt;
+        }
+        return typename CP::Proof{{*r1, *r2}, {*y1, *y2}, challenge, response};
+    }
+};
+
+/**
+ * @fn
+ * @brief 群の識別子に対応するバックエンドを生成する
+ * @param id 群の識別子
+ * @param options バッチ検証の蓄積窓
+ * @param key_table_options 公開鍵テーブルのキャッシュ（メモリの上限は群ごと）
+ */
+inline std::unique_ptr<ZkpBackend> make_zkp_backend(GroupId id, const BatchVerifierOptions& options,
+                                                    const KeyTableCacheOptions& key_table_options = {})
+{
+    switch (id)
+    {
+    case GroupId::kP256:
+        return std::make_unique<BasicZkpBackend<P256ChaumPedersen>>(id, P256ChaumPedersen(get_zkp_p256_group()),
+                                                                    options, key_table_options);
+    case GroupId::kModp1024:
+    default:
+        return std::make_unique<BasicZkpBackend<MontChaumPedersen>>(id, MontChaumPedersen(get_zkp_mont_group()),
+                                                                    options, key_table_options);
+    }
+}
+
+#endif  // ZKP_BACKEND_HPP
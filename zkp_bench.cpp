@@ -0,0 +1,458 @@
+// ChaumPedersen の基本操作のマイクロベンチマーク（Google Benchmark）
+// 群ごと（トイ群、RFC5114 1024-bit の cpp_int 参照実装と Montgomery 実装、RFC3526 2048/3072-bit、P-256）に
+// 各操作の時間と 1 回あたりのメモリ確保回数（allocs_per_iter）を計測する。
+// 結果は --benchmark_format=json または --benchmark_out=<file> --benchmark_out_format=json で機械可読に出力できる。
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "chaum_pedersen.hpp"
+#include "multi_buffer_exp.hpp"
+#include "wire_encoding.hpp"
+#include "zkp_constants.hpp"
+#include "zkp_group.hpp"
+
+// --- メモリ確保回数の計測 ---
+// 全ての operator new（アラインメント指定付きも含む）を数える（ベンチマークの各反復の前後の差を取る）
+namespace
+{
+std::atomic<std::uint64_t> g_allocations{0};
+
+void* counted_alloc(std::size_t size, std::size_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+    {
+        size = 1;
+    }
+    // aligned_alloc は size がアラインメントの倍数であることを要求する
+    void* p = alignment <= alignof(std::max_align_t)
+                  ? std::malloc(size)
+                  : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+}  // namespace
+
+// GCC は置き換えた operator new / delete を malloc / free と対にして -Wmismatched-new-delete を出すが、
+// ここでは全ての確保と解放を malloc 系と free に揃えているため問題ない
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void* operator new(std::size_t size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return counted_alloc(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+namespace
+{
+// RFC3526 2048-bit MODP Group（安全素数 p = 2q + 1、g = 2 は位数 q）
+constexpr const char* kModp2048PrimeHex =
+    "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+    "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+    "4FE1356D6D51C245E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7ED"
+    "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE45B3DC2007CB8A163BF05"
+    "98DA48361C55D39A69163FA8FD24CF5F83655D23DCA3AD961C62F356208552BB"
+    "9ED529077096966D670C354E4ABC9804F1746C08CA18217C32905E462E36CE3B"
+    "E39E772C180E86039B2783A2EC07A28FB5C55DF06F4C52C9DE2BCBF695581718"
+    "3995497CEA956AE515D2261898FA051015728E5A8AACAA68FFFFFFFFFFFFFFFF";
+
+// RFC3526 3072-bit MODP Group
+constexpr const char* kModp3072PrimeHex =
+    "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+    "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+    "4FE1356D6D51C245E485B576625E7EC6F44C42E9A637ED6B0BFF5CB6F406B7ED"
+    "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE45B3DC2007CB8A163BF05"
+    "98DA48361C55D39A69163FA8FD24CF5F83655D23DCA3AD961C62F356208552BB"
+    "9ED529077096966D670C354E4ABC9804F1746C08CA18217C32905E462E36CE3B"
+    "E39E772C180E86039B2783A2EC07A28FB5C55DF06F4C52C9DE2BCBF695581718"
+    "3995497CEA956AE515D2261898FA051015728E5A8AAAC42DAD33170D04507A33"
+    "A85521ABDF1CBA64ECFB850458DBEF0A8AEA71575D060C7DB3970F85A6E1E4C7"
+    "ABF5AE8CDB0933D71E8C94E04A25619DCEE3D2261AD2EE6BF12FFA06D98A0864"
+    "D87602733EC86A64521F2B18177B200CBBE117577A615D6C770988C0BAD946E2"
+    "08E24FA074E5AB3143DB5BFCE0FD108E4B82D120A93AD2CAFFFFFFFFFFFFFFFF";
+
+// 安全素数 p の群の公開パラメータ {p, q = (p-1)/2, g = 2, h = g^2}
+ZKPConstants safe_prime_constants(const char* prime_hex)
+{
+    const cpp_int p("0x" + std::string(prime_hex));
+    return {p, (p - 1) / 2, 2, 4};
+}
+
+// --- ベンチマーク対象の群（cp() がプロセス共通の BasicChaumPedersen を返す） ---
+
+// テストと同じトイ群（p = 23, q = 11）。固定基底テーブルなし。
+struct Toy
+{
+    using CP = ChaumPedersen;
+    static const CP& cp()
+    {
+        static const CP instance(23, 11, 4, 9);
+        return instance;
+    }
+};
+
+// RFC5114 1024-bit（cpp_int 参照実装）
+struct Rfc5114
+{
+    using CP = ChaumPedersen;
+    static const CP& cp()
+    {
+        static const CP instance(get_zkp_group());
+        return instance;
+    }
+};
+
+// RFC5114 1024-bit（Montgomery 固定長実装、サーバが使う実装）
+struct Rfc5114Mont
+{
+    using CP = MontChaumPedersen;
+    static const CP& cp()
+    {
+        static const CP instance(get_zkp_mont_group());
+        return instance;
+    }
+};
+
+struct Modp2048
+{
+    using CP = BasicChaumPedersen<ModpGroup<MontgomeryArithmetic<32>>>;
+    static const CP& cp()
+    {
+        static const CP instance(ModpGroup<MontgomeryArithmetic<32>>(safe_prime_constants(kModp2048PrimeHex)));
+        return instance;
+    }
+};
+
+struct Modp3072
+{
+    using CP = BasicChaumPedersen<ModpGroup<MontgomeryArithmetic<48>>>;
+    static const CP& cp()
+    {
+        static const CP instance(ModpGroup<MontgomeryArithmetic<48>>(safe_prime_constants(kModp3072PrimeHex)));
+        return instance;
+    }
+};
+
+struct P256
+{
+    using CP = P256ChaumPedersen;
+    static const CP& cp()
+    {
+        static const CP instance(get_zkp_p256_group());
+        return instance;
+    }
+};
+
+// 反復ごとのメモリ確保回数をカウンタに記録する
+class AllocationCounter
+{
+   public:
+    explicit AllocationCounter(benchmark::State& state)
+        : state_(state), start_(g_allocations.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~AllocationCounter()
+    {
+        const auto allocations = g_allocations.load(std::memory_order_relaxed) - start_;
+        state_.counters["allocs_per_iter"] =
+            benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+   private:
+    benchmark::State& state_;
+    const std::uint64_t start_;
+};
+
+template <typename G>
+void BM_GenerateRandom(benchmark::State& state)
+{
+    const cpp_int& q = G::cp().order();
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(generate_random(q));
+    }
+}
+
+template <typename G>
+void BM_CalculatePublicKeys(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const cpp_int x = generate_random(cp.order());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.calculate_public_keys(x));
+    }
+}
+
+template <typename G>
+void BM_CreateCommitment(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const cpp_int k = generate_random(cp.order());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.create_commitment(k));
+    }
+}
+
+template <typename G>
+void BM_SolveResponse(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const cpp_int k = generate_random(cp.order());
+    const cpp_int x = generate_random(cp.order());
+    const Challenge c{generate_random(cp.order())};
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.solve_response(k, c, x));
+    }
+}
+
+template <typename G>
+void BM_VerifyProof(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const cpp_int x = generate_random(cp.order());
+    const cpp_int k = generate_random(cp.order());
+    const auto public_keys = cp.calculate_public_keys(x);
+    const auto commitment = cp.create_commitment(k);
+    const Challenge c{generate_random(cp.order())};
+    const Response s = cp.solve_response(k, c, x);
+    if (!cp.verify_proof(commitment, public_keys, c, s))
+    {
+        state.SkipWithError("proof does not verify");
+        return;
+    }
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.verify_proof(commitment, public_keys, c, s));
+    }
+}
+
+// ログイン頻度の高いユーザーの検証（公開鍵 y1, y2 の固定基底テーブルを使う）。引数はウィンドウ幅
+template <typename G>
+void BM_VerifyProofWithKeyTables(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const cpp_int x = generate_random(cp.order());
+    const cpp_int k = generate_random(cp.order());
+    const auto key_tables = cp.make_public_key_tables(cp.calculate_public_keys(x), state.range(0));
+    const auto commitment = cp.create_commitment(k);
+    const Challenge c{generate_random(cp.order())};
+    const Response s = cp.solve_response(k, c, x);
+    if (!cp.verify_proof(commitment, key_tables, c, s))
+    {
+        state.SkipWithError("proof does not verify");
+        return;
+    }
+    state.counters["table_bytes"] = static_cast<double>(key_tables.memory_bytes());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.verify_proof(commitment, key_tables, c, s));
+    }
+}
+
+// 公開鍵テーブルの構築（キャッシュに入れる際に 1 回だけかかる）
+template <typename G>
+void BM_MakePublicKeyTables(benchmark::State& state)
+{
+    const auto& cp = G::cp();
+    const auto public_keys = cp.calculate_public_keys(generate_random(cp.order()));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.make_public_key_tables(public_keys, state.range(0)));
+    }
+}
+
+// RFC5114 1024-bit 群で、引数のカーネル（SimdKernel の値）に切り替えて計測する。終わったら既定のカーネルに戻す
+class KernelScope
+{
+   public:
+    explicit KernelScope(benchmark::State& state) : kernel_(static_cast<SimdKernel>(state.range(0)))
+    {
+        supported_ = set_simd_kernel(kernel_);
+        if (supported_)
+        {
+            state.SetLabel(std::string(simd_kernel_name(kernel_)));
+        }
+        else
+        {
+            state.SkipWithError("kernel not supported by this CPU");
+        }
+    }
+
+    ~KernelScope() { set_simd_kernel(detect_simd_kernel()); }
+
+    bool supported() const { return supported_; }
+
+   private:
+    SimdKernel kernel_;
+    bool supported_ = false;
+};
+
+// 独立した 8 件の y^c（160-bit の指数）を pow_many でまとめて計算する
+void BM_PowMany(benchmark::State& state)
+{
+    const KernelScope scope(state);
+    if (!scope.supported())
+    {
+        return;
+    }
+    const auto& group = Rfc5114Mont::cp().group();
+    std::vector<ZKPMontGroup::Element> bases;
+    std::vector<cpp_int> exponents;
+    for (int i = 0; i < 8; ++i)
+    {
+        bases.push_back(group.pow_g(generate_random(group.order())));
+        exponents.push_back(generate_random(group.order()));
+    }
+    std::vector<ZKPMontGroup::Term> terms;
+    for (std::size_t i = 0; i < bases.size(); ++i)
+    {
+        terms.push_back({bases[i], exponents[i]});
+    }
+    std::vector<ZKPMontGroup::Element> results(terms.size());
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        group.pow_many(terms.data(), nullptr, terms.size(), results.data());
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(terms.size()));
+}
+
+// サーバの既定のバッチサイズ（32 件）の verify_batch
+void BM_VerifyBatch(benchmark::State& state)
+{
+    const KernelScope scope(state);
+    if (!scope.supported())
+    {
+        return;
+    }
+    const auto& cp = Rfc5114Mont::cp();
+    std::vector<MontChaumPedersen::Proof> proofs;
+    for (int i = 0; i < 32; ++i)
+    {
+        const cpp_int x = generate_random(cp.order());
+        const cpp_int k = generate_random(cp.order());
+        const Challenge c{generate_random(cp.order())};
+        proofs.push_back({cp.create_commitment(k), cp.calculate_public_keys(x), c, cp.solve_response(k, c, x)});
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(cp.verify_batch(proofs));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(proofs.size()));
+}
+
+void BM_GetZkpConstants(benchmark::State& state)
+{
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(get_zkp_constants());
+    }
+}
+
+// 群の要素の大きさ（ビット数 state.range(0)）の値で RPC の整数フィールドの変換を計測する
+cpp_int value_of_bits(std::int64_t bits) { return (cpp_int(1) << (bits - 1)) | cpp_int(0x1234567); }
+
+void BM_EncodeHex(benchmark::State& state)
+{
+    const cpp_int x = value_of_bits(state.range(0));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(encode_hex(x));
+    }
+}
+
+void BM_DecodeHex(benchmark::State& state)
+{
+    const std::string hex = encode_hex(value_of_bits(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decode_hex(hex));
+    }
+}
+
+void BM_EncodeFixed(benchmark::State& state)
+{
+    const cpp_int x = value_of_bits(state.range(0));
+    const std::size_t length = byte_length(x);
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(encode_fixed(x, length));
+    }
+}
+
+void BM_DecodeFixed(benchmark::State& state)
+{
+    const cpp_int x = value_of_bits(state.range(0));
+    const std::string bytes = encode_fixed(x, byte_length(x));
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(decode_fixed(bytes, bytes.size()));
+    }
+}
+}  // namespace
+
+#define ZKP_GROUP_BENCHMARKS(G)                                         \
+    BENCHMARK_TEMPLATE(BM_GenerateRandom, G);                           \
+    BENCHMARK_TEMPLATE(BM_CalculatePublicKeys, G);                      \
+    BENCHMARK_TEMPLATE(BM_CreateCommitment, G);                         \
+    BENCHMARK_TEMPLATE(BM_SolveResponse, G);                            \
+    BENCHMARK_TEMPLATE(BM_VerifyProof, G);                              \
+    BENCHMARK_TEMPLATE(BM_VerifyProofWithKeyTables, G)->Arg(4)->Arg(6); \
+    BENCHMARK_TEMPLATE(BM_MakePublicKeyTables, G)->Arg(4)->Arg(6)
+
+ZKP_GROUP_BENCHMARKS(Toy);
+ZKP_GROUP_BENCHMARKS(Rfc5114);
+ZKP_GROUP_BENCHMARKS(Rfc5114Mont);
+ZKP_GROUP_BENCHMARKS(Modp2048);
+ZKP_GROUP_BENCHMARKS(Modp3072);
+ZKP_GROUP_BENCHMARKS(P256);
+
+BENCHMARK(BM_PowMany)->DenseRange(0, kSimdKernelCount - 1);
+BENCHMARK(BM_VerifyBatch)->DenseRange(0, kSimdKernelCount - 1);
+BENCHMARK(BM_GetZkpConstants);
+BENCHMARK(BM_EncodeHex)->Arg(160)->Arg(1024)->Arg(2048)->Arg(3072);
+BENCHMARK(BM_DecodeHex)->Arg(160)->Arg(1024)->Arg(2048)->Arg(3072);
+BENCHMARK(BM_EncodeFixed)->Arg(160)->Arg(1024)->Arg(2048)->Arg(3072);
+BENCHMARK(BM_DecodeFixed)->Arg(160)->Arg(1024)->Arg(2048)->Arg(3072);
+
+BENCHMARK_MAIN();
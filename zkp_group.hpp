@@ -0,0 +1,106 @@
+#ifndef ZKP_GROUP_HPP
+#define ZKP_GROUP_HPP
+
+#include <optional>
+#include <string_view>
+
+#include "ec_group.hpp"
+#include "modp_group.hpp"
+#include "modular_arithmetic.hpp"
+#include "zkp_constants.hpp"
+
+// サーバ・クライアント間で合意する群の識別子（protos/zkp_auth.proto の Group と同じ値）
+enum class GroupId
+{
+    kModp1024 = 0,  // RFC5114 1024-bit MODP Group with 160-bit Prime Order Subgroup
+    kP256 = 1,      // NIST P-256
+};
+
+inline constexpr std::size_t kGroupCount = 2;
+
+/**
+ * @fn
+ * @brief 群の識別子をコマンドライン・ログ用の名前に変換する
+ */
+inline constexpr std::string_view group_name(GroupId id)
+{
+    switch (id)
+    {
+    case GroupId::kModp1024:
+        return "modp1024";
+    case GroupId::kP256:
+        return "p256";
+    }
+    return "unknown";
+}
+
+/**
+ * @fn
+ * @brief 名前（"modp1024" / "p256"）を群の識別子に変換する
+ * @return 未知の名前の場合は std::nullopt
+ */
+inline std::optional<GroupId> parse_group_id(std::string_view name)
+{
+    for (std::size_t i = 0; i < kGroupCount; ++i)
+    {
+        const auto id = static_cast<GroupId>(i);
+        if (group_name(id) == name)
+        {
+            return id;
+        }
+    }
+    return std::nullopt;
+}
+
+// cpp_int による参照実装の群
+using ZKPGroup = ModpGroup<CppIntModArithmetic>;
+
+// 1024-bit p を 16 リムの Montgomery 表現で扱う群
+using Rfc5114Arithmetic = MontgomeryArithmetic<16>;
+using ZKPMontGroup = ModpGroup<Rfc5114Arithmetic>;
+
+// RFC5114 の p, q, g をコンパイル時にリム配列へ変換し、h = g^2 mod p も Montgomery 表現で求めておく
+inline constexpr Rfc5114Arithmetic kRfc5114Arithmetic{limbs_from_hex<16>(kRfc5114PrimeHex)};
+inline constexpr Limbs<3> kRfc5114OrderLimbs = limbs_from_hex<3>(kRfc5114OrderHex);
+inline constexpr Rfc5114Arithmetic::Element kRfc5114G =
+    kRfc5114Arithmetic.to_montgomery(limbs_from_hex<16>(kRfc5114GeneratorHex));
+inline constexpr Rfc5114Arithmetic::Element kRfc5114H = kRfc5114Arithmetic.sqr(kRfc5114G);
+
+/**
+ * @fn
+ * @brief RFC5114 1024-bit MODP Group のプロセス共通コンテキスト（cpp_int 参照実装）を取得する
+ * @note  初回呼び出し時に一度だけ定数の解析とテーブル構築を行う（スレッドセーフ）。
+ * @return ZKPGroup への参照
+ */
+inline const ZKPGroup& get_zkp_group()
+{
+    static const ZKPGroup group(get_zkp_constants());
+    return group;
+}
+
+/**
+ * @fn
+ * @brief RFC5114 1024-bit MODP Group のプロセス共通コンテキスト（Montgomery 固定長実装）を取得する
+ * @note  定数はコンパイル時に変換済みのため、初回呼び出し時の処理は固定基底テーブルの構築のみ。
+ * @return ZKPMontGroup への参照
+ */
+inline const ZKPMontGroup& get_zkp_mont_group()
+{
+    static const ZKPMontGroup group(kRfc5114Arithmetic, integer_from_limbs(kRfc5114Arithmetic.modulus_limbs()),
+                                    integer_from_limbs(kRfc5114OrderLimbs), kRfc5114G, kRfc5114H);
+    return group;
+}
+
+/**
+ * @fn
+ * @brief NIST P-256 のプロセス共通コンテキストを取得する
+ * @note  初回呼び出し時に一度だけ H の導出と固定基底テーブルの構築を行う（スレッドセーフ）。
+ * @return EcGroup への参照
+ */
+inline const EcGroup& get_zkp_p256_group()
+{
+    static const EcGroup group;
+    return group;
+}
+
+#endif  // ZKP_GROUP_HPP